@@ -50,6 +50,14 @@ static int not_enable_crtc_registers;
 static int not_enable_80_column_output;
 static int video_bank_select; /* bits 0-3 of d5f6, $0-$f 16 banks */
 static int crtreg[0x40];
+
+/* Changes to the display since AF80_ClearChanged: screen positions written
+   to, and what the cells were last drawn with. */
+static UBYTE changed[0x800];
+static int all_changed = TRUE;
+static int drawn_blink;
+static int drawn_cursor_row;
+static int drawn_cursor_column;
 static int const rgbi_palette[16] = {
 	0x000000, /* black */
 	0x0000AA, /* blue */
@@ -79,25 +87,25 @@ int AF80_palette[16];
 static void update_d6(void)
 {
 	if (!not_enable_2k_character_ram) {
-		memcpy(MEMORY_mem + 0xd600, af80_screen + (video_bank_select<<7), 0x80);
-		memcpy(MEMORY_mem + 0xd680, af80_screen + (video_bank_select<<7), 0x80);
+		MEMORY_dCopyToMem(af80_screen + (video_bank_select<<7), 0xd600, 0x80);
+		MEMORY_dCopyToMem(af80_screen + (video_bank_select<<7), 0xd680, 0x80);
 	}
 	else if (!not_enable_2k_attribute_ram) {
-		memcpy(MEMORY_mem + 0xd600, af80_attrib + (video_bank_select<<7), 0x80);
-		memcpy(MEMORY_mem + 0xd680, af80_attrib + (video_bank_select<<7), 0x80);
+		MEMORY_dCopyToMem(af80_attrib + (video_bank_select<<7), 0xd600, 0x80);
+		MEMORY_dCopyToMem(af80_attrib + (video_bank_select<<7), 0xd680, 0x80);
 	}
 	else if (not_enable_crtc_registers) {
-		memset(MEMORY_mem + 0xd600, 0xff, 0x100);
+		MEMORY_dFillMem(0xd600, 0xff, 0x100);
 	}
 }
 
 static void update_d5(void)
 {
 	if (not_rom_output_enable) {
-		memset(MEMORY_mem + 0xd500, 0xff, 0x100);
+		MEMORY_dFillMem(0xd500, 0xff, 0x100);
 	}
 	else {
-		memcpy(MEMORY_mem + 0xd500, af80_rom + (rom_bank_select<<8), 0x100);
+		MEMORY_dCopyToMem(af80_rom + (rom_bank_select<<8), 0xd500, 0x100);
 	}
 }
 
@@ -105,12 +113,12 @@ static void update_8000_9fff(void)
 {
 	if (not_right_cartridge_rd4_control) return;
 	if (not_rom_output_enable) {
-		memset(MEMORY_mem + 0x8000, 0xff, 0x2000);
+		MEMORY_dFillMem(0x8000, 0xff, 0x2000);
 	}
 	else {
 		int i;
 		for (i=0; i<32; i++) {
-		memcpy(MEMORY_mem + 0x8000 + (i<<8), af80_rom + (rom_bank_select<<8), 0x100);
+		MEMORY_dCopyToMem(af80_rom + (rom_bank_select<<8), 0x8000 + (i<<8), 0x100);
 		}
 	}
 }
@@ -237,16 +245,22 @@ void AF80_D6PutByte(UWORD addr, UBYTE byte)
 		MEMORY_dPutByte((addr&0xff7f),byte);
 		MEMORY_dPutByte((addr&0xff7f)+0x80,byte);
 		af80_screen[(addr&0x7f) + (video_bank_select<<7)] = byte;
+		changed[(addr&0x7f) + (video_bank_select<<7)] = TRUE;
 	}
 	else if (!not_enable_2k_attribute_ram) {
 		MEMORY_dPutByte((addr&0xff7f),byte);
 		MEMORY_dPutByte((addr&0xff7f)+0x80,byte);
 		af80_attrib[(addr&0x7f) + (video_bank_select<<7)] = byte;
+		changed[(addr&0x7f) + (video_bank_select<<7)] = TRUE;
 		D(printf("AF80 Write, attribute,  addr:%4x byte:%2x, cpu:%4x\n", addr, byte,CPU_remember_PC[(CPU_remember_PC_curpos-1)%CPU_REMEMBER_PC_STEPS]));
 	}
 	else if (!not_enable_crtc_registers) {
 		if (video_bank_select == 0 ) {
 			if ((addr&0xff)<0x40) {
+				/* start address and split screen registers */
+				if ((addr&0xff) >= 0x0c && (addr&0xff) <= 0x10 && crtreg[addr&0xff] != byte) {
+					all_changed = TRUE;
+				}
 				crtreg[addr&0xff] = byte;
 			}
 			D(if (1 || (addr!=0xd618 && addr!=0xd619)) printf("AF80 Write addr:%4x byte:%2x, cpu:%4x\n", addr, byte,CPU_remember_PC[(CPU_remember_PC_curpos-1)%CPU_REMEMBER_PC_STEPS]));
@@ -329,14 +343,24 @@ void AF80_D5PutByte(UWORD addr, UBYTE byte)
 	D(if (addr!=0xd5f7 && addr!=0xd5f6) printf("AF80 Write addr:%4x byte:%2x, cpu:%4x\n", addr, byte,CPU_remember_PC[(CPU_remember_PC_curpos-1)%CPU_REMEMBER_PC_STEPS]));
 }
 
+/* Returns the position in screen memory of the cell at ROW, COLUMN. */
+static int ScreenPos(int row, int column)
+{
+	int screen_pos;
+	if (row >= crtreg[0x10]) {
+		screen_pos = (row-crtreg[0x10])*80 + column + crtreg[0x0e] + ((crtreg[0x0f]&0x3f)<<8);
+	}
+	else {
+		screen_pos = row*80+column + crtreg[0x0c] + ((crtreg[0x0d]&0x3f)<<8);
+	}
+	return screen_pos & 0x7ff;
+}
+
 UBYTE AF80_GetPixels(int scanline, int column, int *colour, int blink)
 {
-#define AF80_ROWS 25
-#define AF80_CELL_HEIGHT 10
 	UBYTE character;
 	int attrib;
 	UBYTE font_data;
-	int table_start = crtreg[0x0c] + ((crtreg[0x0d]&0x3f)<<8);
 	int row = scanline / AF80_CELL_HEIGHT;
 	int line = scanline % AF80_CELL_HEIGHT;
 	int screen_pos;
@@ -344,13 +368,7 @@ UBYTE AF80_GetPixels(int scanline, int column, int *colour, int blink)
 		return 0;
 	}
 
-	if (row >= crtreg[0x10]) {
-		screen_pos = (row-crtreg[0x10])*80 + column + crtreg[0x0e] + ((crtreg[0x0f]&0x3f)<<8);
-	}
-	else {
-		screen_pos = row*80+column + table_start;
-	}
-	screen_pos &= 0x7ff;
+	screen_pos = ScreenPos(row, column);
 	character = af80_screen[screen_pos];
 	attrib = af80_attrib[screen_pos];
 	font_data = af80_charset[character*16 + line];
@@ -370,6 +388,36 @@ UBYTE AF80_GetPixels(int scanline, int column, int *colour, int blink)
 	return font_data;
 }
 
+int AF80_CellChanged(int row, int column, int blink)
+{
+	int screen_pos;
+	int cursor;
+	if (row >= AF80_ROWS) {
+		return FALSE;
+	}
+	if (all_changed) {
+		return TRUE;
+	}
+	screen_pos = ScreenPos(row, column);
+	if (changed[screen_pos]) {
+		return TRUE;
+	}
+	cursor = row == crtreg[0x18] && column == crtreg[0x19];
+	if (cursor != (row == drawn_cursor_row && column == drawn_cursor_column)) {
+		return TRUE;
+	}
+	return blink != drawn_blink && (cursor || (af80_attrib[screen_pos] & 0x02));
+}
+
+void AF80_ClearChanged(int blink)
+{
+	memset(changed, 0, sizeof(changed));
+	all_changed = FALSE;
+	drawn_blink = blink;
+	drawn_cursor_row = crtreg[0x18];
+	drawn_cursor_column = crtreg[0x19];
+}
+
 void AF80_Reset(void)
 {
 	memset(af80_screen, 0, 0x800);
@@ -383,6 +431,7 @@ void AF80_Reset(void)
 	not_enable_80_column_output = 0;
 	video_bank_select = 0;
 	memset(crtreg, 0, sizeof(crtreg));
+	all_changed = TRUE;
 }
 
 /*
@@ -14,7 +14,14 @@ int AF80_D5GetByte(UWORD addr, int no_side_effects);
 void AF80_D5PutByte(UWORD addr, UBYTE byte);
 int AF80_D6GetByte(UWORD addr, int no_side_effects);
 void AF80_D6PutByte(UWORD addr, UBYTE byte);
+#define AF80_ROWS 25
+#define AF80_CELL_HEIGHT 10
 UBYTE AF80_GetPixels(int scanline, int column, int *colour, int blink);
+/* Returns whether the character cell at ROW, COLUMN looks different with
+   BLINK than when it was drawn before the last AF80_ClearChanged(). */
+int AF80_CellChanged(int row, int column, int blink);
+/* Called after drawing the screen with BLINK. */
+void AF80_ClearChanged(int blink);
 extern int AF80_enabled;
 void AF80_Reset(void);
 
@@ -35,6 +35,7 @@
 #define AKEY_CX85_DELETE           -29
 #define AKEY_CX85_YES              -30
 #define AKEY_TURBO                 -31
+#define AKEY_REWIND                -33
 #ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
 #define AKEY_KEYB                  -32
 #endif
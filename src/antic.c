@@ -77,6 +77,9 @@ int ANTIC_pal_blending = 0;
    to improve video system performance */
 #ifdef DIRTYRECT
 
+/* Index in Screen_dirty of the 8-pixel block that PTR points into. */
+#define DIRTY_BLOCK(ptr) (((UBYTE *) (ptr) - (UBYTE *) Screen_atari) >> 3)
+
 static UWORD *scratchUWordPtr;
 static UWORD scratchUWord;
 static ULONG *scratchULongPtr;
@@ -89,26 +92,26 @@ static UBYTE scratchUByte;
 #define WRITE_VIDEO(ptr, val) \
 	do { \
 		scratchUWordPtr = (ptr); \
-		Screen_dirty[((ULONG) scratchUWordPtr - (ULONG) Screen_atari) >> 3] = 1; \
+		Screen_dirty[DIRTY_BLOCK(scratchUWordPtr)] = 1; \
 		*scratchUWordPtr = (val); \
 	} while (0)
 #define WRITE_VIDEO_LONG(ptr, val) \
 	do { \
 		scratchULongPtr = (ptr); \
-		Screen_dirty[((ULONG) scratchULongPtr - (ULONG) Screen_atari) >> 3] = 1; \
+		Screen_dirty[DIRTY_BLOCK(scratchULongPtr)] = 1; \
 		*scratchULongPtr = (val); \
 	} while (0)
 #define WRITE_VIDEO_BYTE(ptr, val) \
 	do { \
 		scratchUBytePtr = (ptr); \
-		Screen_dirty[((ULONG) scratchUBytePtr - (ULONG) Screen_atari) >> 3] = 1; \
+		Screen_dirty[DIRTY_BLOCK(scratchUBytePtr)] = 1; \
 		*scratchUBytePtr = (val); \
 	} while (0)
 #define FILL_VIDEO(ptr, val, size) \
 	do { \
 		scratchUBytePtr = (UBYTE*) (ptr); \
 		scratchULong = (ULONG) (size); \
-		memset(Screen_dirty + (((ULONG) scratchUBytePtr - (ULONG) Screen_atari) >> 3), 1, scratchULong >> 3); \
+		memset(Screen_dirty + DIRTY_BLOCK(scratchUBytePtr), 1, scratchULong >> 3); \
 		memset(scratchUBytePtr, (val), scratchULong); \
 	} while (0)
 
@@ -119,7 +122,7 @@ static UBYTE scratchUByte;
 		scratchUWordPtr = (ptr); \
 		scratchUWord = (val); \
 		if (*scratchUWordPtr != scratchUWord) { \
-			Screen_dirty[((ULONG) scratchUWordPtr - (ULONG) Screen_atari) >> 3] = 1; \
+			Screen_dirty[DIRTY_BLOCK(scratchUWordPtr)] = 1; \
 			*scratchUWordPtr = scratchUWord; \
 		} \
 	} while (0)
@@ -129,7 +132,7 @@ static UBYTE scratchUByte;
 		scratchULongPtr = (ptr); \
 		scratchULong = (val); \
 		if (*scratchULongPtr != scratchULong) { \
-			Screen_dirty[((ULONG) scratchULongPtr - (ULONG) Screen_atari) >> 3] = 1; \
+			Screen_dirty[DIRTY_BLOCK(scratchULongPtr)] = 1; \
 			*scratchULongPtr = scratchULong; \
 		} \
 	} while (0)
@@ -139,8 +142,8 @@ static UBYTE scratchUByte;
 		scratchULongPtr = (ptr); \
 		scratchULong = (val); \
 		if (*scratchULongPtr != scratchULong) { \
-			Screen_dirty[((ULONG) scratchULongPtr - (ULONG) Screen_atari) >> 3] = 1; \
-			Screen_dirty[((ULONG) scratchULongPtr - (ULONG) Screen_atari + 2) >> 3] = 1; \
+			Screen_dirty[DIRTY_BLOCK(scratchULongPtr)] = 1; \
+			Screen_dirty[DIRTY_BLOCK((UBYTE *) scratchULongPtr + 2)] = 1; \
 			*scratchULongPtr = scratchULong; \
 		} \
 	} while (0)
@@ -150,7 +153,7 @@ static UBYTE scratchUByte;
 		scratchUBytePtr = (ptr); \
 		scratchUByte = (val); \
 		if (*scratchUBytePtr != scratchUByte) { \
-			Screen_dirty[((ULONG) scratchUBytePtr - (ULONG) Screen_atari) >> 3] = 1; \
+			Screen_dirty[DIRTY_BLOCK(scratchUBytePtr)] = 1; \
 			*scratchUBytePtr = scratchUByte; \
 		} \
 	} while (0)
@@ -162,7 +165,7 @@ static UBYTE *scratchFillLimit;
 		scratchFillLimit = scratchUBytePtr + (size); \
 		for (; scratchUBytePtr < scratchFillLimit; scratchUBytePtr++) { \
 			if (*scratchUBytePtr != scratchUByte) { \
-				Screen_dirty[((ULONG) scratchUBytePtr - (ULONG) Screen_atari) >> 3] = 1; \
+				Screen_dirty[DIRTY_BLOCK(scratchUBytePtr)] = 1; \
 				*scratchUBytePtr = scratchUByte; \
 			} \
 		} \
@@ -3188,6 +3191,11 @@ void ANTIC_Frame(int draw_display)
 	POKEY_Scanline();		/* check and generate IRQ */
 	CPU_GO(ANTIC_NMIST_C);
 	ANTIC_NMIST = 0x5f;				/* Set VBLANK */
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	/* let the OS see fresh joysticks in its VBI */
+	if (INPUT_late_latch)
+		INPUT_latch_pending = TRUE;
+#endif
 	if (ANTIC_NMIEN & 0x40) {
 		CPU_GO(ANTIC_NMI_C);
 		CPU_NMI();
@@ -93,6 +93,7 @@
 #include "sio.h"
 #include "sysrom.h"
 #include "util.h"
+#include "workers.h"
 #if !defined(BASIC) && !defined(CURSES_BASIC)
 #include "colours.h"
 #include "screen.h"
@@ -101,6 +102,7 @@
 #include "file_export.h"
 #endif
 #ifndef BASIC
+#include "rewind.h"
 #include "statesav.h"
 #ifndef __PLUS
 #include "ui.h"
@@ -182,9 +184,18 @@ int Atari800_nframes = 0;
 int Atari800_refresh_rate = 1;
 int Atari800_collisions_in_skipped_frames = FALSE;
 int Atari800_turbo = FALSE;
+int Atari800_run_ahead = 0;
+int Atari800_running_ahead = FALSE;
+
+/* Frames for which run-ahead stays off after the last device I/O. */
+#define RUN_AHEAD_IO_PAUSE 100
+static int run_ahead_io_pause = 0;
+/* Set when a frame ahead tried to do device I/O. */
+static int run_ahead_io_hit = FALSE;
 int Atari800_turbo_speed = 0; /* percentage speed or 0 for max turbo */
 int Atari800_start_in_monitor = FALSE;
 int Atari800_auto_frameskip = FALSE;
+Atari800_frame_stats_t Atari800_frame_stats;
 
 #ifdef BENCHMARK
 static double benchmark_start_time;
@@ -358,6 +369,10 @@ int Atari800_InitialiseMachine(void)
 	Atari800_UpdateKeyboardDetached();
 	Atari800_UpdateJumper();
 	MEMORY_InitialiseMachine();
+#ifndef BASIC
+	/* The kept states are of the old machine. */
+	REWIND_Clear();
+#endif
 	Devices_UpdatePatches();
 	return have_roms;
 }
@@ -760,6 +775,17 @@ int Atari800_Initialise(int *argc, char *argv[])
 				else
 					a_m = TRUE;
 			}
+			else if (strcmp(argv[i], "-runahead") == 0) {
+				if (i_a) {
+					Atari800_run_ahead = Util_sscandec(argv[++i]);
+					if (Atari800_run_ahead < 0 || Atari800_run_ahead > Atari800_MAX_RUN_AHEAD) {
+						Log_print("Invalid number of frames to run ahead, using 0");
+						Atari800_run_ahead = 0;
+					}
+				}
+				else
+					a_m = TRUE;
+			}
 			else if (strcmp(argv[i], "-autosave-config") == 0)
 				CFG_save_on_exit = TRUE;
 			else if (strcmp(argv[i], "-no-autosave-config") == 0)
@@ -820,6 +846,7 @@ int Atari800_Initialise(int *argc, char *argv[])
 #ifndef BASIC
 					Log_print("\t-state <file>    Load saved-state file");
 					Log_print("\t-refresh <rate>  Specify screen refresh rate");
+					Log_print("\t-runahead <n>    Emulate <n> frames ahead to reduce input lag (0-%d)", Atari800_MAX_RUN_AHEAD);
 #endif
 					Log_print("\t-nopatch         Don't patch SIO routine in OS");
 					Log_print("\t-nopatchall      Don't patch OS at all, H: device won't work");
@@ -891,6 +918,10 @@ int Atari800_Initialise(int *argc, char *argv[])
 #endif
 		|| !Devices_Initialise(argc, argv)
 		|| !RTIME_Initialise(argc, argv)
+		|| !Workers_Initialise(argc, argv)
+#ifndef BASIC
+		|| !REWIND_Initialise(argc, argv)
+#endif
 #ifdef IDE
 		|| !IDE_Initialise(argc, argv)
 #endif
@@ -1200,6 +1231,11 @@ int Atari800_Exit(int run_monitor)
 #ifdef POKEYREC
 		POKEYREC_Exit();
 #endif
+#ifndef BASIC
+		REWIND_Exit();
+		StateSav_FinishBackgroundSave();
+#endif
+		Workers_Exit();
 		Devices_Exit();
 #ifdef R_IO_DEVICE
 		RDevice_Exit(); /* R: Device cleanup */
@@ -1226,6 +1262,25 @@ void Atari800_ErrExit(void)
 	Atari800_Exit(FALSE);
 }
 
+void Atari800_ResetFrameStats(void)
+{
+	memset(&Atari800_frame_stats, 0, sizeof(Atari800_frame_stats));
+}
+
+double Atari800_FrameLatePercentile(int percent)
+{
+	unsigned int count = 0;
+	int i;
+	for (i = 0; i < Atari800_LATE_BUCKETS - 1; i++) {
+		count += Atari800_frame_stats.late_histogram[i];
+		if (count * 100.0 >= (double) Atari800_frame_stats.frames * percent)
+			break;
+	}
+	if (i == Atari800_LATE_BUCKETS - 1)
+		return Atari800_frame_stats.max_late_ms;
+	return (i + 1) * 0.1;
+}
+
 #ifndef __PLUS
 #ifndef LIBATARI800
 static void autoframeskip(double curtime, double lasttime)
@@ -1262,6 +1317,35 @@ static void autoframeskip(double curtime, double lasttime)
 	}
 }
 
+/* Waking up from a sleep takes a varying time, so Atari800_Sync() sleeps
+   until a little before the deadline and busy-waits the rest. The margin
+   follows how late recent wake-ups were, within these bounds (seconds). */
+#define SPIN_MIN 0.00005
+#define SPIN_MAX 0.002
+static double spin_margin = 0.0005;
+
+/* Frames over which avg_late_ms is averaged. */
+#define LATE_AVG_FRAMES 64
+
+static void UpdateFrameStats(double late)
+{
+	Atari800_frame_stats_t *stats = &Atari800_frame_stats;
+	double late_ms = late * 1000.0;
+	int bucket = (int) (late_ms * 10.0);
+	if (bucket >= Atari800_LATE_BUCKETS)
+		bucket = Atari800_LATE_BUCKETS - 1;
+	stats->frames++;
+	stats->late_ms = late_ms;
+	stats->avg_late_ms += (late_ms - stats->avg_late_ms)
+	                      / (stats->frames < LATE_AVG_FRAMES ? stats->frames : LATE_AVG_FRAMES);
+	if (late_ms > stats->max_late_ms)
+		stats->max_late_ms = late_ms;
+	stats->late_histogram[bucket]++;
+	if (late_ms > 0.2)
+		stats->missed++;
+	stats->spin_ms = spin_margin * 1000.0;
+}
+
 void Atari800_Sync(void)
 {
 	static double lasttime = 0;
@@ -1282,11 +1366,32 @@ void Atari800_Sync(void)
 	curtime = Util_time();
 	if (Atari800_auto_frameskip)
 		autoframeskip(curtime, lasttime);
-	Util_sleep(lasttime - curtime);
-	curtime = Util_time();
+	if (lasttime - spin_margin > curtime) {
+		double wake = lasttime - spin_margin;
+		double woken_late;
+		Util_sleep_until(wake);
+		curtime = Util_time();
+		/* Grow the margin at once when a wake-up was later than it allows
+		   for, shrink it slowly otherwise. */
+		woken_late = 1.5 * (curtime - wake);
+		if (woken_late > spin_margin)
+			spin_margin = woken_late;
+		else
+			spin_margin += (woken_late - spin_margin) / 32.0;
+		if (spin_margin < SPIN_MIN)
+			spin_margin = SPIN_MIN;
+		else if (spin_margin > SPIN_MAX)
+			spin_margin = SPIN_MAX;
+	}
+	while (curtime < lasttime)
+		curtime = Util_time();
 
-	if ((lasttime + deltatime) < curtime)
+	if ((lasttime + deltatime) < curtime) {
 		lasttime = curtime;
+		Atari800_frame_stats.resyncs++;
+	}
+	else
+		UpdateFrameStats(curtime - lasttime);
 }
 
 #if defined(BASIC) || defined(VERY_SLOW) || defined(CURSES_BASIC)
@@ -1441,10 +1546,110 @@ static void basic_frame(void)
 #endif /* defined(BASIC) || defined(VERY_SLOW) || defined(CURSES_BASIC) */
 #endif /* LIBATARI800 */
 
+int Atari800_DeviceIO(void)
+{
+	run_ahead_io_pause = RUN_AHEAD_IO_PAUSE;
+	if (Atari800_running_ahead) {
+		run_ahead_io_hit = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+/* Status overlays drawn on the displayed screen. */
+static void DrawIndicators(void)
+{
+	INPUT_DrawMousePointer();
+	Screen_DrawAtariSpeed(Util_time());
+	Screen_DrawDiskLED();
+	Screen_Draw1200LED();
+	Screen_DrawStatusText();
+#ifdef SOUND
+	Screen_DrawSoundStats();
+#endif
+	Screen_DrawFrameStats();
+#ifdef DIRTYRECT
+	Screen_DrawVideoStats();
+#endif
+}
+
+static int RunAheadEnabled(void)
+{
+#ifdef NETSIO
+	/* FujiNet talks to the emulator at any time. */
+	if (netsio_enabled)
+		return FALSE;
+#endif
+	return Atari800_run_ahead > 0 && !Atari800_turbo && run_ahead_io_pause == 0;
+}
+
+/* Emulates Atari800_run_ahead frames with the current input, leaving the
+   last of them in Screen_atari, and then returns to the state before.
+   Of the per-frame work of Atari800_Frame, the frames ahead leave out
+   INPUT_Frame, as the host input is read once per real frame and stays
+   latched in the snapshot; VOTRAXSND_Frame and Sound_Update, as they are
+   silent; and PBI_BB_Frame, ACIDTEST_Frame, REWIND_Frame and the state
+   file saving, which follow the real frames only. If they reach device I/O,
+   the devices wait and the real frame is shown instead. */
+static void RunAhead(void)
+{
+	static StateSav_snapshot_t snapshot;
+	static UBYTE screen[Screen_WIDTH * Screen_HEIGHT];
+	int i;
+#ifdef SOUND
+	int was_idle = POKEYSND_idle;
+#endif
+
+	if (!StateSav_SaveSnapshot(&snapshot)) {
+		Log_print("Cannot save a snapshot, run-ahead disabled");
+		Atari800_run_ahead = 0;
+		StateSav_FreeSnapshot(&snapshot);
+		return;
+	}
+	memcpy(screen, Screen_atari, sizeof(screen));
+	Atari800_running_ahead = TRUE;
+	run_ahead_io_hit = FALSE;
+#ifdef SOUND
+	POKEYSND_SetIdle(TRUE);
+#endif
+	for (i = 1; i <= Atari800_run_ahead && !run_ahead_io_hit; i++) {
+		Devices_Frame();
+		GTIA_Frame();
+		/* Only the last frame is shown. */
+		ANTIC_Frame(i == Atari800_run_ahead || Atari800_collisions_in_skipped_frames);
+		POKEY_Frame();
+	}
+	if (!StateSav_RestoreSnapshot(&snapshot)) {
+		/* Can't happen, as the snapshot was just read back from memory. */
+		Log_print("Cannot restore a snapshot, run-ahead disabled");
+		Atari800_run_ahead = 0;
+	}
+	if (run_ahead_io_hit) {
+		memcpy(Screen_atari, screen, sizeof(screen));
+		Screen_EntireDirty();
+	}
+#ifdef SOUND
+	if (!was_idle) {
+		/* The sound of the frames ahead is never heard. */
+		POKEYSND_DiscardIdle();
+		POKEYSND_SetIdle(FALSE);
+	}
+#endif
+	Atari800_running_ahead = FALSE;
+}
+#endif /* !defined(BASIC) && !defined(CURSES_BASIC) */
+
 void Atari800_Frame(void)
 {
 #ifndef BASIC
 	static int refresh_counter = 0;
+#endif
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	/* Decided once, so that the indicators are drawn exactly once. */
+	int run_ahead = RunAheadEnabled();
+#endif
+#ifndef BASIC
 
 #ifdef CTRL_C_HANDLER
 	if (sigint_flag) {
@@ -1467,6 +1672,11 @@ void Atari800_Frame(void)
 	case AKEY_TURBO:
 		Atari800_turbo = !Atari800_turbo;
 		break;
+	case AKEY_REWIND:
+		/* Go back two frames and emulate one of them again, to show it. */
+		if (REWIND_StepBack())
+			REWIND_StepBack();
+		break;
 	case AKEY_UI:
 #ifdef SOUND
 		Sound_Pause();
@@ -1518,11 +1728,12 @@ void Atari800_Frame(void)
 		basic_frame();
 #else
 		ANTIC_Frame(TRUE);
-		INPUT_DrawMousePointer();
-		Screen_DrawAtariSpeed(Util_time());
-		Screen_DrawDiskLED();
-		Screen_Draw1200LED();
-		Screen_DrawStatusText();
+#ifdef XEP80_EMULATION
+		XEP80_UpdateScreen();
+#endif
+		/* With run-ahead they go on the frame shown instead. */
+		if (!run_ahead)
+			DrawIndicators();
 #endif /* CURSES_BASIC */
 #ifdef DONT_DISPLAY
 		Atari800_display_screen = FALSE;
@@ -1548,6 +1759,20 @@ void Atari800_Frame(void)
 #ifdef SOUND
 	Sound_Update();
 #endif
+#ifndef BASIC
+	REWIND_Frame();
+	StateSav_PollBackgroundSave();
+#endif
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	if (Atari800_display_screen && run_ahead) {
+		/* Not if this frame has started device I/O. */
+		if (RunAheadEnabled())
+			RunAhead();
+		DrawIndicators();
+	}
+#endif
+	if (run_ahead_io_pause > 0)
+		run_ahead_io_pause--;
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 	/* multimedia stats are drawn here so they don't get recorded in the video */
 	Screen_DrawMultimediaStats();
@@ -118,6 +118,25 @@ extern int Atari800_auto_frameskip;
    Set to FALSE for accurate emulation with Atari800_refresh_rate > 1. */
 extern int Atari800_collisions_in_skipped_frames;
 
+/* Number of frames emulated ahead of each displayed frame (0 = off).
+   Every displayed frame is emulated on from an in-memory snapshot with the
+   current input, the last of these frames is shown and the emulator goes
+   back to the snapshot. This hides the input lag of games that react a
+   frame or two after reading the controls. The frames ahead are silent.
+   Not in effect in turbo mode, and paused while disks, tape or other
+   devices are in use (see Atari800_DeviceIO). */
+extern int Atari800_run_ahead;
+#define Atari800_MAX_RUN_AHEAD 8
+/* TRUE while the frames ahead are emulated. Anything that keeps a record
+   of the emulation outside of the snapshot (eg. logs) should ignore them. */
+extern int Atari800_running_ahead;
+/* To be called by the emulated devices before any work that reaches
+   outside the emulated machine (disk images, host files, printers, tape,
+   speech) or changes device state that the snapshots don't keep. Pauses
+   run-ahead for a while. Returns FALSE while the frames ahead are emulated:
+   the device must then do nothing, and the frames ahead are dropped. */
+int Atari800_DeviceIO(void);
+
 /* Set to TRUE to run emulated Atari as fast as possible */
 extern int Atari800_turbo;
 /* Percentage speed or 0 for max turbo */
@@ -184,6 +203,39 @@ UNALIGNED_STAT_DECL(memory_write_aligned_word_stat)
 /* Sleeps until it's time to emulate next Atari frame. */
 void Atari800_Sync(void);
 
+/* How evenly Atari800_Sync() paces the frames. A frame is late by the
+   time from its deadline until Atari800_Sync() returns. Times are in
+   milliseconds. */
+#define Atari800_LATE_BUCKETS 32
+typedef struct Atari800_frame_stats_t {
+	/* Frames paced since the last reset. */
+	unsigned int frames;
+	/* Lateness of the last frame, averaged over recent frames, and the
+	   largest seen. */
+	double late_ms;
+	double avg_late_ms;
+	double max_late_ms;
+	/* Number of frames with lateness in [0.1 * i, 0.1 * (i + 1)) ms; the
+	   last bucket also counts all later frames. */
+	unsigned int late_histogram[Atari800_LATE_BUCKETS];
+	/* Number of frames more than 0.2 ms late. */
+	unsigned int missed;
+	/* Number of times the emulation fell more than a frame behind and the
+	   schedule was restarted. These frames are not counted above. */
+	unsigned int resyncs;
+	/* How long before a deadline Atari800_Sync() stops sleeping and
+	   busy-waits instead. */
+	double spin_ms;
+} Atari800_frame_stats_t;
+
+extern Atari800_frame_stats_t Atari800_frame_stats;
+
+void Atari800_ResetFrameStats(void);
+
+/* Returns the lateness in ms that PERCENT % of the frames counted in
+   Atari800_frame_stats did not exceed, to a bucket's precision. */
+double Atari800_FrameLatePercentile(int percent);
+
 /* Load a ROM image filename of size nbytes into buffer */
 int Atari800_LoadImage(const char *filename, UBYTE *buffer, int nbytes);
 
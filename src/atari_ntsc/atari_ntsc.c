@@ -2,6 +2,8 @@
 
 #include "colours.h"
 #include "atari_ntsc.h"
+/* Atari change: SIMD support for the vectorised blitters. */
+#include "blit.h"
 
 /* Copyright (C) 2006-2007 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -66,6 +68,39 @@ static void correct_errors( atari_ntsc_rgb_t color, atari_ntsc_rgb_t* out )
 	}
 }
 
+/* Atari change: vectorised blitters. */
+int atari_ntsc_vectorize = 1;
+
+/* Atari change: fills the vtable entry of one color (see atari_ntsc.h) from
+its kernel. Output pixel x of a chunk sums kernel entries of the 4 pixels of
+the chunk and the 7 before it (taps 7..10 and 0..6); for a pixel in column i
+of its chunk, the entries used depend on whether the chunk has reached
+COLOR_IN for that column yet, see ATARI_NTSC_RGB_OUT_14_. */
+static void init_vtable( atari_ntsc_rgb_t const* kernel, unsigned int vtable [atari_ntsc_vec_taps] [atari_ntsc_vec_lanes] )
+{
+	int x, i;
+	for ( x = 0; x < atari_ntsc_vec_taps * atari_ntsc_vec_lanes; x++ )
+		vtable [x / atari_ntsc_vec_lanes] [x % atari_ntsc_vec_lanes] = 0;
+	for ( x = 0; x < atari_ntsc_out_chunk; x++ )
+	{
+		for ( i = 0; i < atari_ntsc_in_chunk; i++ )
+		{
+			int entry = (x + 7 - 2 * i) % 7 + 14 * i;
+			if ( x >= 2 * i )
+			{
+				/* this chunk's pixel is kernel, previous chunk's is kernelx */
+				vtable [i + 7] [x] += (unsigned int) kernel [entry];
+				vtable [i + 3] [x] += (unsigned int) kernel [entry + 7];
+			}
+			else
+			{
+				vtable [i + 3] [x] += (unsigned int) kernel [entry];
+				vtable [i - 1] [x] += (unsigned int) kernel [entry + 7];
+			}
+		}
+	}
+}
+
 void atari_ntsc_init( atari_ntsc_t* ntsc, atari_ntsc_setup_t const* setup )
 {
 	/* Atari change: no alternating burst phases - remove merge_fields variable. */
@@ -134,6 +169,8 @@ void atari_ntsc_init( atari_ntsc_t* ntsc, atari_ntsc_setup_t const* setup )
 				gen_kernel( &impl, y, i, q, kernel );
 				/* Atari change: no alternating burst phases - remove code for merge_fields. */
 				correct_errors( rgb, kernel );
+				/* Atari change: vectorised blitters. */
+				init_vtable( kernel, ntsc->vtable [entry] );
 			}
 		}
 	}
@@ -146,6 +183,7 @@ void atari_ntsc_init( atari_ntsc_t* ntsc, atari_ntsc_setup_t const* setup )
    pixel formats. */
 
 #include <limits.h>
+#include <string.h>
 
 #if USHRT_MAX == 0xFFFF
 	typedef unsigned short atari_ntsc_out16_t;
@@ -161,10 +199,280 @@ void atari_ntsc_init( atari_ntsc_t* ntsc, atari_ntsc_setup_t const* setup )
 	#error "Need 32-bit int type"
 #endif
 
+/* Atari change: vectorised blitters. A row is processed one output chunk at
+a time, as the sum of the 11 vtable vectors of the pixels that contribute to
+it. Integer sums wrap the same way in any lane width, so the result equals
+that of ATARI_NTSC_RGB_OUT. */
+#if defined(BLIT_SSE2) || defined(BLIT_AVX2) || defined(BLIT_NEON)
+#define ATARI_NTSC_VECTOR
+
+#ifdef BLIT_AVX2
+#include <immintrin.h>
+#elif defined(BLIT_SSE2)
+#include <emmintrin.h>
+#endif
+#ifdef BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+/* Longest row handled by the vectorised blitters. */
+enum { max_vector_width = 1024 };
+
+/* Stores the 7 pixels of a chunk from 8 computed ones. The 8th pixel may be
+written as well, except in the last chunk of a row. */
+static void store_chunk( void* out, void const* pixels, int size, int last )
+{
+	if ( last )
+		memcpy( out, pixels, atari_ntsc_out_chunk * size );
+	else
+		memcpy( out, pixels, atari_ntsc_vec_lanes * size );
+}
+
+#ifdef BLIT_SSE2
+static __m128i sse2_clamp( __m128i raw )
+{
+	__m128i sub = _mm_and_si128( _mm_srli_epi32( raw, 9 ), _mm_set1_epi32( atari_ntsc_clamp_mask ) );
+	__m128i clamp = _mm_sub_epi32( _mm_set1_epi32( atari_ntsc_clamp_add ), sub );
+	raw = _mm_or_si128( raw, clamp );
+	clamp = _mm_sub_epi32( clamp, sub );
+	return _mm_and_si128( raw, clamp );
+}
+
+#define SSE2_SHR( v, shift, mask ) _mm_and_si128( _mm_srli_epi32( v, shift ), _mm_set1_epi32( mask ) )
+#define SSE2_SHL( v, shift, mask ) _mm_and_si128( _mm_slli_epi32( v, shift ), _mm_set1_epi32( mask ) )
+
+static __m128i sse2_format( __m128i raw, int format )
+{
+	switch ( format )
+	{
+	case ATARI_NTSC_RGB_FORMAT_RGB16:
+		return _mm_or_si128( _mm_or_si128( SSE2_SHR( raw, 13, 0xF800 ), SSE2_SHR( raw, 8, 0x07E0 ) ), SSE2_SHR( raw, 4, 0x001F ) );
+	case ATARI_NTSC_RGB_FORMAT_BGR16:
+		return _mm_or_si128( _mm_or_si128( SSE2_SHR( raw, 24, 0x001F ), SSE2_SHR( raw, 8, 0x07E0 ) ), SSE2_SHL( raw, 7, 0xF800 ) );
+	case ATARI_NTSC_RGB_FORMAT_ARGB32:
+		return _mm_or_si128( _mm_or_si128( SSE2_SHR( raw, 5, 0xFF0000 ), SSE2_SHR( raw, 3, 0xFF00 ) ),
+		                     _mm_or_si128( SSE2_SHR( raw, 1, 0xFF ), _mm_set1_epi32( (int) 0xFF000000 ) ) );
+	default: /* ATARI_NTSC_RGB_FORMAT_BGRA32 */
+		return _mm_or_si128( _mm_or_si128( SSE2_SHR( raw, 13, 0xFF00 ), SSE2_SHL( raw, 5, 0xFF0000 ) ),
+		                     _mm_or_si128( SSE2_SHL( raw, 23, (int) 0xFF000000 ), _mm_set1_epi32( 0xFF ) ) );
+	}
+}
+
+/* Packs 16-bit values held in 32-bit lanes; packs_epi32 saturates signed
+values, so the range is moved down and back up. */
+static __m128i sse2_pack16( __m128i lo, __m128i hi )
+{
+	__m128i const bias32 = _mm_set1_epi32( 0x8000 );
+	__m128i packed = _mm_packs_epi32( _mm_sub_epi32( lo, bias32 ), _mm_sub_epi32( hi, bias32 ) );
+	return _mm_add_epi16( packed, _mm_set1_epi16( (short) 0x8000 ) );
+}
+
+static void row_sse2( atari_ntsc_t const* ntsc, unsigned char const* in, int chunks, void* out, int format )
+{
+	int c;
+	for ( c = 0; c < chunks; c++, in += atari_ntsc_in_chunk )
+	{
+		__m128i lo = _mm_setzero_si128();
+		__m128i hi = _mm_setzero_si128();
+		int t;
+		for ( t = 0; t < atari_ntsc_vec_taps; t++ )
+		{
+			unsigned int const* v = ntsc->vtable [in [t]] [t];
+			lo = _mm_add_epi32( lo, _mm_loadu_si128( (__m128i const*) v ) );
+			hi = _mm_add_epi32( hi, _mm_loadu_si128( (__m128i const*) (v + 4) ) );
+		}
+		lo = sse2_format( sse2_clamp( lo ), format );
+		hi = sse2_format( sse2_clamp( hi ), format );
+		if ( format == ATARI_NTSC_RGB_FORMAT_RGB16 || format == ATARI_NTSC_RGB_FORMAT_BGR16 )
+		{
+			__m128i pixels = sse2_pack16( lo, hi );
+			store_chunk( (atari_ntsc_out16_t*) out + c * atari_ntsc_out_chunk, &pixels, sizeof (atari_ntsc_out16_t), c == chunks - 1 );
+		}
+		else
+		{
+			__m128i pixels [2];
+			pixels [0] = lo;
+			pixels [1] = hi;
+			store_chunk( (atari_ntsc_out32_t*) out + c * atari_ntsc_out_chunk, pixels, sizeof (atari_ntsc_out32_t), c == chunks - 1 );
+		}
+	}
+}
+#endif /* BLIT_SSE2 */
+
+#ifdef BLIT_AVX2
+__attribute__((target("avx2")))
+static void row_avx2( atari_ntsc_t const* ntsc, unsigned char const* in, int chunks, void* out, int format )
+{
+	__m256i const clamp_mask = _mm256_set1_epi32( atari_ntsc_clamp_mask );
+	__m256i const clamp_add = _mm256_set1_epi32( atari_ntsc_clamp_add );
+	int c;
+	for ( c = 0; c < chunks; c++, in += atari_ntsc_in_chunk )
+	{
+		__m256i raw = _mm256_setzero_si256();
+		__m256i sub, clamp, rgb;
+		int t;
+		for ( t = 0; t < atari_ntsc_vec_taps; t++ )
+			raw = _mm256_add_epi32( raw, _mm256_loadu_si256( (__m256i const*) ntsc->vtable [in [t]] [t] ) );
+		sub = _mm256_and_si256( _mm256_srli_epi32( raw, 9 ), clamp_mask );
+		clamp = _mm256_sub_epi32( clamp_add, sub );
+		raw = _mm256_or_si256( raw, clamp );
+		clamp = _mm256_sub_epi32( clamp, sub );
+		raw = _mm256_and_si256( raw, clamp );
+		switch ( format )
+		{
+		case ATARI_NTSC_RGB_FORMAT_RGB16:
+			rgb = _mm256_or_si256( _mm256_or_si256(
+				_mm256_and_si256( _mm256_srli_epi32( raw, 13 ), _mm256_set1_epi32( 0xF800 ) ),
+				_mm256_and_si256( _mm256_srli_epi32( raw, 8 ), _mm256_set1_epi32( 0x07E0 ) ) ),
+				_mm256_and_si256( _mm256_srli_epi32( raw, 4 ), _mm256_set1_epi32( 0x001F ) ) );
+			break;
+		case ATARI_NTSC_RGB_FORMAT_BGR16:
+			rgb = _mm256_or_si256( _mm256_or_si256(
+				_mm256_and_si256( _mm256_srli_epi32( raw, 24 ), _mm256_set1_epi32( 0x001F ) ),
+				_mm256_and_si256( _mm256_srli_epi32( raw, 8 ), _mm256_set1_epi32( 0x07E0 ) ) ),
+				_mm256_and_si256( _mm256_slli_epi32( raw, 7 ), _mm256_set1_epi32( 0xF800 ) ) );
+			break;
+		case ATARI_NTSC_RGB_FORMAT_ARGB32:
+			rgb = _mm256_or_si256( _mm256_or_si256(
+				_mm256_and_si256( _mm256_srli_epi32( raw, 5 ), _mm256_set1_epi32( 0xFF0000 ) ),
+				_mm256_and_si256( _mm256_srli_epi32( raw, 3 ), _mm256_set1_epi32( 0xFF00 ) ) ),
+				_mm256_or_si256( _mm256_and_si256( _mm256_srli_epi32( raw, 1 ), _mm256_set1_epi32( 0xFF ) ),
+				                 _mm256_set1_epi32( (int) 0xFF000000 ) ) );
+			break;
+		default: /* ATARI_NTSC_RGB_FORMAT_BGRA32 */
+			rgb = _mm256_or_si256( _mm256_or_si256(
+				_mm256_and_si256( _mm256_srli_epi32( raw, 13 ), _mm256_set1_epi32( 0xFF00 ) ),
+				_mm256_and_si256( _mm256_slli_epi32( raw, 5 ), _mm256_set1_epi32( 0xFF0000 ) ) ),
+				_mm256_or_si256( _mm256_and_si256( _mm256_slli_epi32( raw, 23 ), _mm256_set1_epi32( (int) 0xFF000000 ) ),
+				                 _mm256_set1_epi32( 0xFF ) ) );
+			break;
+		}
+		if ( format == ATARI_NTSC_RGB_FORMAT_RGB16 || format == ATARI_NTSC_RGB_FORMAT_BGR16 )
+		{
+			/* values fit in 16 bits, so the unsigned pack needs no care */
+			__m128i pixels = _mm_packus_epi32( _mm256_castsi256_si128( rgb ), _mm256_extracti128_si256( rgb, 1 ) );
+			store_chunk( (atari_ntsc_out16_t*) out + c * atari_ntsc_out_chunk, &pixels, sizeof (atari_ntsc_out16_t), c == chunks - 1 );
+		}
+		else
+			store_chunk( (atari_ntsc_out32_t*) out + c * atari_ntsc_out_chunk, &rgb, sizeof (atari_ntsc_out32_t), c == chunks - 1 );
+	}
+}
+#endif /* BLIT_AVX2 */
+
+#if defined(BLIT_NEON) && !defined(BLIT_SSE2)
+static uint32x4_t neon_clamp( uint32x4_t raw )
+{
+	uint32x4_t sub = vandq_u32( vshrq_n_u32( raw, 9 ), vdupq_n_u32( atari_ntsc_clamp_mask ) );
+	uint32x4_t clamp = vsubq_u32( vdupq_n_u32( atari_ntsc_clamp_add ), sub );
+	raw = vorrq_u32( raw, clamp );
+	clamp = vsubq_u32( clamp, sub );
+	return vandq_u32( raw, clamp );
+}
+
+static uint32x4_t neon_format( uint32x4_t raw, int format )
+{
+	switch ( format )
+	{
+	case ATARI_NTSC_RGB_FORMAT_RGB16:
+		return vorrq_u32( vorrq_u32( vandq_u32( vshrq_n_u32( raw, 13 ), vdupq_n_u32( 0xF800 ) ),
+		                             vandq_u32( vshrq_n_u32( raw, 8 ), vdupq_n_u32( 0x07E0 ) ) ),
+		                  vandq_u32( vshrq_n_u32( raw, 4 ), vdupq_n_u32( 0x001F ) ) );
+	case ATARI_NTSC_RGB_FORMAT_BGR16:
+		return vorrq_u32( vorrq_u32( vandq_u32( vshrq_n_u32( raw, 24 ), vdupq_n_u32( 0x001F ) ),
+		                             vandq_u32( vshrq_n_u32( raw, 8 ), vdupq_n_u32( 0x07E0 ) ) ),
+		                  vandq_u32( vshlq_n_u32( raw, 7 ), vdupq_n_u32( 0xF800 ) ) );
+	case ATARI_NTSC_RGB_FORMAT_ARGB32:
+		return vorrq_u32( vorrq_u32( vandq_u32( vshrq_n_u32( raw, 5 ), vdupq_n_u32( 0xFF0000 ) ),
+		                             vandq_u32( vshrq_n_u32( raw, 3 ), vdupq_n_u32( 0xFF00 ) ) ),
+		                  vorrq_u32( vandq_u32( vshrq_n_u32( raw, 1 ), vdupq_n_u32( 0xFF ) ), vdupq_n_u32( 0xFF000000 ) ) );
+	default: /* ATARI_NTSC_RGB_FORMAT_BGRA32 */
+		return vorrq_u32( vorrq_u32( vandq_u32( vshrq_n_u32( raw, 13 ), vdupq_n_u32( 0xFF00 ) ),
+		                             vandq_u32( vshlq_n_u32( raw, 5 ), vdupq_n_u32( 0xFF0000 ) ) ),
+		                  vorrq_u32( vandq_u32( vshlq_n_u32( raw, 23 ), vdupq_n_u32( 0xFF000000 ) ), vdupq_n_u32( 0xFF ) ) );
+	}
+}
+
+static void row_neon( atari_ntsc_t const* ntsc, unsigned char const* in, int chunks, void* out, int format )
+{
+	int c;
+	for ( c = 0; c < chunks; c++, in += atari_ntsc_in_chunk )
+	{
+		uint32x4_t lo = vdupq_n_u32( 0 );
+		uint32x4_t hi = vdupq_n_u32( 0 );
+		int t;
+		for ( t = 0; t < atari_ntsc_vec_taps; t++ )
+		{
+			unsigned int const* v = ntsc->vtable [in [t]] [t];
+			lo = vaddq_u32( lo, vld1q_u32( v ) );
+			hi = vaddq_u32( hi, vld1q_u32( v + 4 ) );
+		}
+		lo = neon_format( neon_clamp( lo ), format );
+		hi = neon_format( neon_clamp( hi ), format );
+		if ( format == ATARI_NTSC_RGB_FORMAT_RGB16 || format == ATARI_NTSC_RGB_FORMAT_BGR16 )
+		{
+			uint16x8_t pixels = vcombine_u16( vmovn_u32( lo ), vmovn_u32( hi ) );
+			store_chunk( (atari_ntsc_out16_t*) out + c * atari_ntsc_out_chunk, &pixels, sizeof (atari_ntsc_out16_t), c == chunks - 1 );
+		}
+		else
+		{
+			uint32x4_t pixels [2];
+			pixels [0] = lo;
+			pixels [1] = hi;
+			store_chunk( (atari_ntsc_out32_t*) out + c * atari_ntsc_out_chunk, pixels, sizeof (atari_ntsc_out32_t), c == chunks - 1 );
+		}
+	}
+}
+#endif /* BLIT_NEON */
+
+/* Blits with the vectorised code if possible. Returns 0 if the caller has
+to use the scalar code instead. */
+static int blit_vector( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* input, long in_row_width,
+		int in_width, int in_height, void* rgb_out, long out_pitch, int format )
+{
+	/* The pixels contributing to the chunks of a row, starting with the
+	7 black pixels before the first chunk and ending with the black chunk
+	that finishes the row. */
+	unsigned char row [max_vector_width + 16];
+	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
+	void (*row_func)( atari_ntsc_t const*, unsigned char const*, int, void*, int ) = NULL;
+
+	if ( !atari_ntsc_vectorize || in_width > max_vector_width )
+		return 0;
+#ifdef BLIT_AVX2
+	if ( BLIT_HaveAVX2() )
+		row_func = row_avx2;
+#endif
+#ifdef BLIT_SSE2
+	if ( row_func == NULL )
+		row_func = row_sse2;
+#elif defined(BLIT_NEON)
+	row_func = row_neon;
+#endif
+	if ( row_func == NULL )
+		return 0;
+
+	memset( row, atari_ntsc_black, sizeof row );
+	for ( ; in_height; --in_height )
+	{
+		/* The first pixel enters in BEGIN_ROW, the rest in chunks. */
+		memcpy( row + 6, input, chunk_count * atari_ntsc_in_chunk + 1 );
+		row_func( ntsc, row, chunk_count + 1, rgb_out, format );
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+	return 1;
+}
+#endif /* BLIT_SSE2 || BLIT_AVX2 || BLIT_NEON */
+
 void atari_ntsc_blit_rgb16( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* input, long in_row_width,
 		int in_width, int in_height, void* rgb_out, long out_pitch )
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
+#ifdef ATARI_NTSC_VECTOR
+	/* Atari change: vectorised blitters. */
+	if ( blit_vector( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_RGB16 ) )
+		return;
+#endif
 	for ( ; in_height; --in_height )
 	{
 		ATARI_NTSC_IN_T const* line_in = input;
@@ -222,6 +530,11 @@ void atari_ntsc_blit_bgr16( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* inp
 		int in_width, int in_height, void* rgb_out, long out_pitch )
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
+#ifdef ATARI_NTSC_VECTOR
+	/* Atari change: vectorised blitters. */
+	if ( blit_vector( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_BGR16 ) )
+		return;
+#endif
 	for ( ; in_height; --in_height )
 	{
 		ATARI_NTSC_IN_T const* line_in = input;
@@ -279,6 +592,11 @@ void atari_ntsc_blit_argb32( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* in
 		int in_width, int in_height, void* rgb_out, long out_pitch )
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
+#ifdef ATARI_NTSC_VECTOR
+	/* Atari change: vectorised blitters. */
+	if ( blit_vector( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_ARGB32 ) )
+		return;
+#endif
 	for ( ; in_height; --in_height )
 	{
 		ATARI_NTSC_IN_T const* line_in = input;
@@ -336,6 +654,11 @@ void atari_ntsc_blit_bgra32( atari_ntsc_t const* ntsc, ATARI_NTSC_IN_T const* in
 		int in_width, int in_height, void* rgb_out, long out_pitch )
 {
 	int chunk_count = (in_width - 1) / atari_ntsc_in_chunk;
+#ifdef ATARI_NTSC_VECTOR
+	/* Atari change: vectorised blitters. */
+	if ( blit_vector( ntsc, input, in_row_width, in_width, in_height, rgb_out, out_pitch, ATARI_NTSC_RGB_FORMAT_BGRA32 ) )
+		return;
+#endif
 	for ( ; in_height; --in_height )
 	{
 		ATARI_NTSC_IN_T const* line_in = input;
@@ -121,11 +121,23 @@ statement in a block (unless you're using C++). */
 	ATARI_NTSC_RGB_OUT_14_( index, rgb_out, bits, 0 )
 
 
+/* Atari change: vectorised blitters. When nonzero (the default), the
+blitters use SSE2, AVX2 or NEON code where the build and the CPU support it;
+set to zero to force the original scalar code. Output is the same. */
+extern int atari_ntsc_vectorize;
+
 /* private */
 enum { atari_ntsc_entry_size = 56 };
 typedef unsigned long atari_ntsc_rgb_t;
+/* Atari change: the kernels rearranged for the vectorised blitters. Each
+output chunk of 7 pixels is the sum of 11 vectors, one for each input pixel
+that contributes to it; vtable [color] [tap] holds the contribution of a
+pixel of that color at that position, one lane per output pixel. */
+enum { atari_ntsc_vec_taps = 11 };
+enum { atari_ntsc_vec_lanes = 8 };
 struct atari_ntsc_t {
 	atari_ntsc_rgb_t table [atari_ntsc_palette_size] [atari_ntsc_entry_size];
+	unsigned int vtable [atari_ntsc_palette_size] [atari_ntsc_vec_taps] [atari_ntsc_vec_lanes];
 };
 enum { atari_ntsc_burst_size = atari_ntsc_entry_size / atari_ntsc_burst_count };
 
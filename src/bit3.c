@@ -43,6 +43,15 @@ static int video_latch = 0;
 static int rom_bank_select; /* bits 5 and 0-2 of d508, $0-$f 16 banks */
 static UBYTE crtreg[0x40];
 
+/* Changes to the display since BIT3_ClearChanged: screen positions written
+   to, and what the cells were last drawn with. */
+static UBYTE changed[0x800];
+static int all_changed = TRUE;
+static int drawn_blink;
+static int drawn_cursor_pos;
+static int drawn_cursor_start;
+static int drawn_cursor_end;
+
 int BIT3_palette[2] = {
 	0x000000, /* black */
 	0xFFFFFF  /* white (high intensity) */
@@ -56,7 +65,7 @@ int BIT3_palette[2] = {
 
 static void update_d6(void)
 {
-	memcpy(MEMORY_mem + 0xd600, bit3_rom + (rom_bank_select<<8), 0x100);
+	MEMORY_dCopyToMem(bit3_rom + (rom_bank_select<<8), 0xd600, 0x100);
 }
 
 int BIT3_Initialise(int *argc, char *argv[])
@@ -195,6 +204,10 @@ void BIT3_D5PutByte(UWORD addr, UBYTE byte)
 	}
 	else if (addr == 0xd581) {
 		/* write selected crtc register */
+		/* start address registers */
+		if (((crtreg[0]&0x3f) == 0x0c || (crtreg[0]&0x3f) == 0x0d) && crtreg[crtreg[0]&0x3f] != byte) {
+			all_changed = TRUE;
+		}
 		crtreg[crtreg[0]&0x3f] = byte;
 	}
 	else if (addr == 0xd583 || addr == 0xd585) {
@@ -202,6 +215,7 @@ void BIT3_D5PutByte(UWORD addr, UBYTE byte)
 		 * This code supports both since the manual only mentions using 
 		 * d583 for read/write */
 		bit3_screen[(((crtreg[0x12]&0x07)<<8)|crtreg[0x13])] = byte;
+		changed[(((crtreg[0x12]&0x07)<<8)|crtreg[0x13])] = TRUE;
 		crtreg[0x13]++;
 		if(crtreg[0x13] == 0) {
 			crtreg[0x12] = ((crtreg[0x12]+1)&0x3f);
@@ -209,13 +223,23 @@ void BIT3_D5PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
+/* Returns the address of the cell at ROW, COLUMN, as compared with the
+   cursor address. */
+static int ScreenPos(int row, int column)
+{
+	int table_start = crtreg[0x0d] + ((crtreg[0x0c]&0x3f)<<8);
+	return (row*80+column + table_start)&0x3fff;
+}
+
+static int CursorPos(void)
+{
+	return ((crtreg[0x0e]&0x3f)<<8)|crtreg[0x0f];
+}
+
 UBYTE BIT3_GetPixels(int scanline, int column, int *colour, int blink)
 {
-#define BIT3_ROWS 24
-#define BIT3_CELL_HEIGHT 10
 	UBYTE character;
 	UBYTE font_data;
-	int table_start = crtreg[0x0d] + ((crtreg[0x0c]&0x3f)<<8);
 	int row = scanline / BIT3_CELL_HEIGHT;
 	int line = scanline % BIT3_CELL_HEIGHT;
 	int screen_pos;
@@ -223,13 +247,13 @@ UBYTE BIT3_GetPixels(int scanline, int column, int *colour, int blink)
 	if (row  >= BIT3_ROWS) {
 		return 0;
 	}
-	screen_pos = ((row*80+column + table_start)&0x3fff);
+	screen_pos = ScreenPos(row, column);
 	character = bit3_screen[screen_pos&0x7ff];
 	font_data = bit3_charset[(character&0x7f)*16 + line];
 	if (character & 0x80) {
 		font_data ^= 0xff; /* invert */
 	}
-	if (screen_pos == (((crtreg[0x0e]&0x3f)<<8)|crtreg[0x0f]) && !blink) {
+	if (screen_pos == CursorPos() && !blink) {
 		if (line >= (crtreg[0x0a]&0x1f) && line <= (crtreg[0x0b]&0x1f)){
 			if ((crtreg[0x0a]&0x60) == 0x00 ||
 			((crtreg[0x0a]&0x60) == 0x40 && !blink) ||
@@ -246,11 +270,43 @@ UBYTE BIT3_GetPixels(int scanline, int column, int *colour, int blink)
 	return font_data;
 }
 
+int BIT3_CellChanged(int row, int column, int blink)
+{
+	int screen_pos;
+	int cursor;
+	if (row >= BIT3_ROWS) {
+		return FALSE;
+	}
+	if (all_changed) {
+		return TRUE;
+	}
+	screen_pos = ScreenPos(row, column);
+	if (changed[screen_pos&0x7ff]) {
+		return TRUE;
+	}
+	cursor = screen_pos == CursorPos();
+	if (cursor != (screen_pos == drawn_cursor_pos)) {
+		return TRUE;
+	}
+	return cursor && (blink != drawn_blink || crtreg[0x0a] != drawn_cursor_start || crtreg[0x0b] != drawn_cursor_end);
+}
+
+void BIT3_ClearChanged(int blink)
+{
+	memset(changed, 0, sizeof(changed));
+	all_changed = FALSE;
+	drawn_blink = blink;
+	drawn_cursor_pos = CursorPos();
+	drawn_cursor_start = crtreg[0x0a];
+	drawn_cursor_end = crtreg[0x0b];
+}
+
 void BIT3_Reset(void)
 {
 	memset(bit3_screen, 0, 0x800);
 	rom_bank_select = 0;
 	memset(crtreg, 0, sizeof(crtreg));
+	all_changed = TRUE;
 	update_d6();
 	video_latch = 0;
 	VIDEOMODE_Set80Column(video_latch);
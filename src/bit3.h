@@ -14,7 +14,14 @@ int BIT3_D5GetByte(UWORD addr, int no_side_effects);
 void BIT3_D5PutByte(UWORD addr, UBYTE byte);
 int BIT3_D6GetByte(UWORD addr, int no_side_effects);
 void BIT3_D6PutByte(UWORD addr, UBYTE byte);
+#define BIT3_ROWS 24
+#define BIT3_CELL_HEIGHT 10
 UBYTE BIT3_GetPixels(int scanline, int column, int *colour, int blink);
+/* Returns whether the character cell at ROW, COLUMN looks different with
+   BLINK than when it was drawn before the last BIT3_ClearChanged(). */
+int BIT3_CellChanged(int row, int column, int blink);
+/* Called after drawing the screen with BLINK. */
+void BIT3_ClearChanged(int blink);
 extern int BIT3_enabled;
 void BIT3_Reset(void);
 
@@ -0,0 +1,262 @@
+/*
+ * blit.c - conversion of colour indices to host pixels
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include "blit.h"
+
+#ifdef BLIT_AVX2
+#include <immintrin.h>
+#elif defined(BLIT_SSE2)
+#include <emmintrin.h>
+#endif
+#ifdef BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+/* Scaled rows are looked up in a row of pixels expanded beforehand, so that
+   a source pixel shown several times goes through the palette only once.
+   Wider spans than this are scaled directly. */
+#define MAX_SPAN 512
+
+int BLIT_vectorize = TRUE;
+
+#ifdef BLIT_AVX2
+int BLIT_HaveAVX2(void)
+{
+#ifdef __AVX2__
+	return TRUE;
+#else
+	static int have_avx2 = -1;
+	if (have_avx2 < 0) {
+		__builtin_cpu_init();
+		have_avx2 = __builtin_cpu_supports("avx2") != 0;
+	}
+	return have_avx2;
+#endif
+}
+
+static int UseAVX2(void)
+{
+	return BLIT_vectorize && BLIT_HaveAVX2();
+}
+
+__attribute__((target("avx2")))
+static void Expand8to32_AVX2(ULONG *dest, UBYTE const *src, int width, ULONG const *palette)
+{
+	int i;
+	for (i = 0; i + 8 <= width; i += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *) (src + i)));
+		_mm256_storeu_si256((__m256i *) (dest + i), _mm256_i32gather_epi32((int const *) palette, idx, 4));
+	}
+	for (; i < width; i++)
+		dest[i] = palette[src[i]];
+}
+
+__attribute__((target("avx2")))
+static void Gather32_AVX2(ULONG *dest, ULONG const *row, int const *xs, int lo, int width)
+{
+	__m256i base = _mm256_set1_epi32(lo);
+	int i;
+	for (i = 0; i + 8 <= width; i += 8) {
+		__m256i idx = _mm256_sub_epi32(_mm256_loadu_si256((__m256i const *) (xs + i)), base);
+		_mm256_storeu_si256((__m256i *) (dest + i), _mm256_i32gather_epi32((int const *) row, idx, 4));
+	}
+	for (; i < width; i++)
+		dest[i] = row[xs[i] - lo];
+}
+
+/* ROW holds 16-bit pixels zero-extended to 32 bits. */
+__attribute__((target("avx2")))
+static void Gather16_AVX2(UWORD *dest, ULONG const *row, int const *xs, int lo, int width)
+{
+	__m256i base = _mm256_set1_epi32(lo);
+	int i;
+	for (i = 0; i + 16 <= width; i += 16) {
+		__m256i idx_a = _mm256_sub_epi32(_mm256_loadu_si256((__m256i const *) (xs + i)), base);
+		__m256i idx_b = _mm256_sub_epi32(_mm256_loadu_si256((__m256i const *) (xs + i + 8)), base);
+		__m256i a = _mm256_i32gather_epi32((int const *) row, idx_a, 4);
+		__m256i b = _mm256_i32gather_epi32((int const *) row, idx_b, 4);
+		/* packus works within 128-bit lanes, so put the quarters back in order. */
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8);
+		_mm256_storeu_si256((__m256i *) (dest + i), packed);
+	}
+	for (; i < width; i++)
+		dest[i] = (UWORD) row[xs[i] - lo];
+}
+#endif /* BLIT_AVX2 */
+
+void BLIT_Expand8to16(UWORD *dest, UBYTE const *src, int width, UWORD const *palette)
+{
+	int i;
+	for (i = 0; i + 4 <= width; i += 4) {
+		dest[i] = palette[src[i]];
+		dest[i + 1] = palette[src[i + 1]];
+		dest[i + 2] = palette[src[i + 2]];
+		dest[i + 3] = palette[src[i + 3]];
+	}
+	for (; i < width; i++)
+		dest[i] = palette[src[i]];
+}
+
+void BLIT_Expand8to32(ULONG *dest, UBYTE const *src, int width, ULONG const *palette)
+{
+	int i;
+#ifdef BLIT_AVX2
+	if (UseAVX2()) {
+		Expand8to32_AVX2(dest, src, width, palette);
+		return;
+	}
+#endif
+	for (i = 0; i + 4 <= width; i += 4) {
+		dest[i] = palette[src[i]];
+		dest[i + 1] = palette[src[i + 1]];
+		dest[i + 2] = palette[src[i + 2]];
+		dest[i + 3] = palette[src[i + 3]];
+	}
+	for (; i < width; i++)
+		dest[i] = palette[src[i]];
+}
+
+void BLIT_ScaleColumns(int *xs, int width, int x, int dx)
+{
+	while (--width >= 0) {
+		xs[width] = x >> 16;
+		x -= dx;
+	}
+}
+
+void BLIT_Scale8(UBYTE *dest, UBYTE const *src, int const *xs, int width)
+{
+	int i;
+	for (i = 0; i < width; i++)
+		dest[i] = src[xs[i]];
+}
+
+void BLIT_Scale8to16(UWORD *dest, UBYTE const *src, int const *xs, int width, UWORD const *palette)
+{
+	ULONG row[MAX_SPAN];
+	int lo, span, i;
+	if (width <= 0)
+		return;
+	lo = xs[0];
+	span = xs[width - 1] - lo + 1;
+	if (span > MAX_SPAN) {
+		for (i = 0; i < width; i++)
+			dest[i] = palette[src[xs[i]]];
+		return;
+	}
+	for (i = 0; i < span; i++)
+		row[i] = palette[src[lo + i]];
+#ifdef BLIT_AVX2
+	if (UseAVX2()) {
+		Gather16_AVX2(dest, row, xs, lo, width);
+		return;
+	}
+#endif
+	for (i = 0; i < width; i++)
+		dest[i] = (UWORD) row[xs[i] - lo];
+}
+
+void BLIT_Scale8to32(ULONG *dest, UBYTE const *src, int const *xs, int width, ULONG const *palette)
+{
+	ULONG row[MAX_SPAN];
+	int lo, span, i;
+	if (width <= 0)
+		return;
+	lo = xs[0];
+	span = xs[width - 1] - lo + 1;
+	if (span > MAX_SPAN) {
+		for (i = 0; i < width; i++)
+			dest[i] = palette[src[xs[i]]];
+		return;
+	}
+	BLIT_Expand8to32(row, src + lo, span, palette);
+#ifdef BLIT_AVX2
+	if (UseAVX2()) {
+		Gather32_AVX2(dest, row, xs, lo, width);
+		return;
+	}
+#endif
+	for (i = 0; i < width; i++)
+		dest[i] = row[xs[i] - lo];
+}
+
+void BLIT_Scale32(ULONG *dest, ULONG const *src, int const *xs, int width)
+{
+	int i;
+#ifdef BLIT_AVX2
+	if (UseAVX2()) {
+		Gather32_AVX2(dest, src, xs, 0, width);
+		return;
+	}
+#endif
+	for (i = 0; i < width; i++)
+		dest[i] = src[xs[i]];
+}
+
+void BLIT_Scale32to16(UWORD *dest, ULONG const *src, int const *xs, int width)
+{
+	int i;
+#ifdef BLIT_AVX2
+	if (UseAVX2()) {
+		Gather16_AVX2(dest, src, xs, 0, width);
+		return;
+	}
+#endif
+	for (i = 0; i < width; i++)
+		dest[i] = (UWORD) src[xs[i]];
+}
+
+void BLIT_ExpandBits32(ULONG *dest, UBYTE pixels, ULONG fg, ULONG bg)
+{
+	int i;
+#if defined(BLIT_SSE2)
+	if (BLIT_vectorize) {
+		__m128i bits = _mm_set1_epi32(pixels);
+		__m128i mask_lo = _mm_set_epi32(0x08, 0x04, 0x02, 0x01);
+		__m128i mask_hi = _mm_set_epi32(0x80, 0x40, 0x20, 0x10);
+		__m128i f = _mm_set1_epi32((int) fg);
+		__m128i b = _mm_set1_epi32((int) bg);
+		__m128i sel_lo = _mm_cmpeq_epi32(_mm_and_si128(bits, mask_lo), mask_lo);
+		__m128i sel_hi = _mm_cmpeq_epi32(_mm_and_si128(bits, mask_hi), mask_hi);
+		_mm_storeu_si128((__m128i *) dest, _mm_or_si128(_mm_and_si128(sel_lo, f), _mm_andnot_si128(sel_lo, b)));
+		_mm_storeu_si128((__m128i *) (dest + 4), _mm_or_si128(_mm_and_si128(sel_hi, f), _mm_andnot_si128(sel_hi, b)));
+		return;
+	}
+#elif defined(BLIT_NEON)
+	if (BLIT_vectorize) {
+		static uint32_t const mask_lo[4] = { 0x01, 0x02, 0x04, 0x08 };
+		static uint32_t const mask_hi[4] = { 0x10, 0x20, 0x40, 0x80 };
+		uint32x4_t bits = vdupq_n_u32(pixels);
+		uint32x4_t f = vdupq_n_u32(fg);
+		uint32x4_t b = vdupq_n_u32(bg);
+		vst1q_u32((uint32_t *) dest, vbslq_u32(vtstq_u32(bits, vld1q_u32(mask_lo)), f, b));
+		vst1q_u32((uint32_t *) dest + 4, vbslq_u32(vtstq_u32(bits, vld1q_u32(mask_hi)), f, b));
+		return;
+	}
+#endif
+	for (i = 0; i < 8; i++) {
+		dest[i] = (pixels & 0x01) ? fg : bg;
+		pixels >>= 1;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef BLIT_H_
+#define BLIT_H_
+
+#include "atari.h"
+
+/* SIMD instruction sets the kernels can be built with. AVX2 code is
+   compiled with a function attribute and used only if BLIT_HaveAVX2()
+   says the CPU supports it, so that a generic x86 build still uses it. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define BLIT_AVX2
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define BLIT_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BLIT_NEON
+#endif
+
+#ifdef BLIT_AVX2
+int BLIT_HaveAVX2(void);
+#endif
+
+/* Row kernels that turn 8-bit colour indices (as in Screen_atari) into host
+   pixels. Where the compiler and the CPU allow it they use SIMD
+   instructions (AVX2 gathers, SSE2 or NEON selects), otherwise plain C; the
+   output is the same either way. */
+
+/* When nonzero (the default), the kernels below use SIMD code where the
+   build and the CPU support it; set to zero to force plain C, eg. to check
+   that the output is the same (see tools/blitcheck.c). */
+extern int BLIT_vectorize;
+
+/* Converts WIDTH colour indices from SRC into pixels in DEST using
+   PALETTE. */
+void BLIT_Expand8to16(UWORD *dest, UBYTE const *src, int width, UWORD const *palette);
+void BLIT_Expand8to32(ULONG *dest, UBYTE const *src, int width, ULONG const *palette);
+
+/* Fills XS with the source column of each of the WIDTH pixels of a scaled
+   row. The columns are those of a 16.16 fixed-point position that starts
+   at X for the rightmost pixel and moves left by DX for each pixel, ie.
+   XS[k] = (X - (WIDTH - 1 - k) * DX) >> 16. The table is the same for all
+   rows of a frame. */
+void BLIT_ScaleColumns(int *xs, int width, int x, int dx);
+
+/* Write WIDTH pixels of a scaled row to DEST, pixel k coming from
+   SRC[XS[k]]. XS must be non-decreasing, as filled by BLIT_ScaleColumns. */
+void BLIT_Scale8(UBYTE *dest, UBYTE const *src, int const *xs, int width);
+void BLIT_Scale8to16(UWORD *dest, UBYTE const *src, int const *xs, int width, UWORD const *palette);
+void BLIT_Scale8to32(ULONG *dest, UBYTE const *src, int const *xs, int width, ULONG const *palette);
+
+/* As above, for rows of pixels that are already in host format. For
+   BLIT_Scale32to16, SRC holds 16-bit pixels zero-extended to 32 bits. */
+void BLIT_Scale32(ULONG *dest, ULONG const *src, int const *xs, int width);
+void BLIT_Scale32to16(UWORD *dest, ULONG const *src, int const *xs, int width);
+
+/* Writes 8 pixels for the bits of PIXELS, least significant bit first: FG
+   for bits that are set, BG for bits that are clear. */
+void BLIT_ExpandBits32(ULONG *dest, UBYTE pixels, ULONG fg, ULONG bg);
+
+#endif /* BLIT_H_ */
@@ -1588,6 +1588,7 @@ static void InitCartridge(CARTRIDGE_image_t *cart)
 {
 	PreprocessCart(cart);
 	ResetCartState(cart);
+	MEMORY_MarkBankWritten(cart == &CARTRIDGE_main ? MEMORY_REGION_CART : MEMORY_REGION_PIGGYBACK);
 	if (cart == &CARTRIDGE_main) {
 		/* Check if we should automatically switch between computer/5200. */
 		int for5200 = CartIsFor5200(CARTRIDGE_main.type);
@@ -2038,6 +2039,18 @@ void CARTRIDGE_Exit(void)
 
 #ifndef BASIC
 
+/* Determines active cartridge (main or piggyback) from the cartridges'
+   states and maps it. */
+static void DetermineActiveCart(void)
+{
+	if (CartIsPassthrough(CARTRIDGE_main.type) && (CARTRIDGE_main.state & 0x0c) == 0x08)
+		active_cart = &CARTRIDGE_piggyback;
+	else
+		active_cart = &CARTRIDGE_main;
+
+	MapActiveCart();
+}
+
 void CARTRIDGE_StateRead(UBYTE version)
 {
 	int saved_type = CARTRIDGE_NONE;
@@ -2102,13 +2115,7 @@ void CARTRIDGE_StateRead(UBYTE version)
 		}
 	}
 
-	/* Determine active cartridge (main or piggyback). */
-	if (CartIsPassthrough(CARTRIDGE_main.type) && (CARTRIDGE_main.state & 0x0c) == 0x08)
-		active_cart = &CARTRIDGE_piggyback;
-	else
-		active_cart = &CARTRIDGE_main;
-
-	MapActiveCart();
+	DetermineActiveCart();
 }
 
 void CARTRIDGE_StateSave(void)
@@ -2137,6 +2144,19 @@ void CARTRIDGE_StateSave(void)
 	}
 }
 
+void CARTRIDGE_StateSaveBanks(void)
+{
+	StateSav_SaveINT(&CARTRIDGE_main.state, 1);
+	StateSav_SaveINT(&CARTRIDGE_piggyback.state, 1);
+}
+
+void CARTRIDGE_StateReadBanks(void)
+{
+	StateSav_ReadINT(&CARTRIDGE_main.state, 1);
+	StateSav_ReadINT(&CARTRIDGE_piggyback.state, 1);
+	DetermineActiveCart();
+}
+
 #endif
 
 /*
@@ -113,6 +113,10 @@ UBYTE CARTRIDGE_GetByte(UWORD addr, int no_side_effects);
 void CARTRIDGE_PutByte(UWORD addr, UBYTE byte);
 void CARTRIDGE_StateSave(void);
 void CARTRIDGE_StateRead(UBYTE version);
+/* Save and restore only the bank switching state of the inserted
+   cartridges, for in-memory snapshots where the cartridges stay. */
+void CARTRIDGE_StateSaveBanks(void);
+void CARTRIDGE_StateReadBanks(void);
 
 /* addr must be $4fxx in 5200 mode or $8fxx in 800 mode. */
 UBYTE CARTRIDGE_BountyBob1GetByte(UWORD addr, int no_side_effects);
@@ -305,6 +305,8 @@ void CASSETTE_PutByte(int byte)
 void CASSETTE_TapeMotor(int onoff)
 {
 	if (cassette_motor != onoff) {
+		if (CASSETTE_status != CASSETTE_STATUS_NONE && !Atari800_DeviceIO())
+			return;
 		if (CASSETTE_record && CASSETTE_writable)
 			/* Recording disabled, flush the tape */
 			IMG_TAPE_Flush(cassette_file);
@@ -380,6 +382,8 @@ static int CassetteRead(int num_ticks)
 
 int CASSETTE_AddScanLine(void)
 {
+	if ((CASSETTE_readable || CASSETTE_writable) && !Atari800_DeviceIO())
+		return FALSE;
 	/* increment elapsed cassette time */
 	if (CASSETTE_record) {
 		CassetteWrite(114);
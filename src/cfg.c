@@ -34,6 +34,7 @@
 #include "log.h"
 #include "memory.h"
 #include "pbi.h"
+#include "rewind.h"
 #include "rtime.h"
 #include "sysrom.h"
 #ifdef XEP80_EMULATION
@@ -49,6 +50,7 @@
 #include "pokeysnd.h"
 #include "ui.h"
 #include "util.h"
+#include "workers.h"
 #if !defined(BASIC) && !defined(CURSES_BASIC)
 #include "colours.h"
 #include "screen.h"
@@ -205,6 +207,11 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 				Atari800_collisions_in_skipped_frames = Util_sscanbool(ptr);
 			else if (strcmp(string, "SCREEN_REFRESH_RATIO") == 0)
 				Atari800_refresh_rate = Util_sscandec(ptr);
+			else if (strcmp(string, "RUN_AHEAD") == 0) {
+				Atari800_run_ahead = Util_sscandec(ptr);
+				if (Atari800_run_ahead < 0 || Atari800_run_ahead > Atari800_MAX_RUN_AHEAD)
+					Atari800_run_ahead = 0;
+			}
 			else if (strcmp(string, "DISABLE_BASIC") == 0)
 				Atari800_disable_basic = Util_sscanbool(ptr);
 			else if (strcmp(string, "TURBO_SPEED") == 0) {
@@ -316,6 +323,12 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 			}
 			else if (RTIME_ReadConfig(string, ptr)) {
 			}
+			else if (Workers_ReadConfig(string, ptr)) {
+			}
+#ifndef BASIC
+			else if (REWIND_ReadConfig(string, ptr)) {
+			}
+#endif
 #ifdef XEP80_EMULATION
 			else if (XEP80_ReadConfig(string, ptr)) {
 			}
@@ -416,6 +429,7 @@ int CFG_WriteConfig(void)
 #ifndef BASIC
 	fprintf(fp, "SCREEN_REFRESH_RATIO=%d\n", Atari800_refresh_rate);
 	fprintf(fp, "ACCURATE_SKIPPED_FRAMES=%d\n", Atari800_collisions_in_skipped_frames);
+	fprintf(fp, "RUN_AHEAD=%d\n", Atari800_run_ahead);
 #endif
 
 	fprintf(fp, "MACHINE_TYPE=Atari %s\n", machine_type_string[Atari800_machine_type]);
@@ -469,6 +483,10 @@ int CFG_WriteConfig(void)
 	CARTRIDGE_WriteConfig(fp);
 	CASSETTE_WriteConfig(fp);
 	RTIME_WriteConfig(fp);
+	Workers_WriteConfig(fp);
+#ifndef BASIC
+	REWIND_WriteConfig(fp);
+#endif
 #ifdef XEP80_EMULATION
 	XEP80_WriteConfig(fp);
 #endif
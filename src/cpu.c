@@ -135,7 +135,7 @@ static int service_pokey_irq;
 
 /* 6502 stack handling */
 #define PL                  MEMORY_dGetByte(0x0100 + ++S)
-#define PH(x)               MEMORY_dPutByte(0x0100 + S--, x)
+#define PH(x)               (MEMORY_page_written[1] = MEMORY_write_generation, MEMORY_mem[0x0100 + S--] = (x))
 #define PHW(x)              PH((x) >> 8); PH((x) & 0xff)
 
 #ifndef FALCON_CPUASM
@@ -2516,7 +2516,9 @@ void CPU_StateSave(UBYTE SaveVerbose)
 	StateSav_SaveUBYTE(&CPU_regY, 1);
 	StateSav_SaveUBYTE(&CPU_IRQ, 1);
 
+	StateSav_BeginSection("MEMORY");
 	MEMORY_StateSave(SaveVerbose);
+	StateSav_BeginSection("CPU");
 
 	STATESAV_TAG(pc);
 	StateSav_SaveUWORD(&CPU_regPC, 1);
@@ -2534,7 +2536,9 @@ void CPU_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 	StateSav_ReadUBYTE(&CPU_regY, 1);
 	StateSav_ReadUBYTE(&CPU_IRQ, 1);
 
+	StateSav_BeginSection("MEMORY");
 	MEMORY_StateRead(SaveVerbose, StateVersion);
+	StateSav_BeginSection("CPU");
 
 	StateSav_ReadUWORD(&CPU_regPC, 1);
 }
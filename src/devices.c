@@ -1472,8 +1472,10 @@ static void Devices_H_BinLoaderCont(void)
 				if (initBinFile && (MEMORY_dGetByte(0x2e3) != 0xd7)) {
 					/* run INIT routine which RTSes directly to RUN routine */
 					CPU_regPC--;
-					MEMORY_dPutByte(0x0100 + CPU_regS--, CPU_regPC >> 8);	/* high */
-					MEMORY_dPutByte(0x0100 + CPU_regS--, CPU_regPC & 0xff);	/* low */
+					MEMORY_dPutByte(0x0100 + CPU_regS, CPU_regPC >> 8);	/* high */
+					CPU_regS--;
+					MEMORY_dPutByte(0x0100 + CPU_regS, CPU_regPC & 0xff);	/* low */
+					CPU_regS--;
 					CPU_regPC = MEMORY_dGetWordAligned(0x2e2);
 				}
 				return;
@@ -1486,7 +1488,8 @@ static void Devices_H_BinLoaderCont(void)
 	CPU_regS--;
 	ESC_Add((UWORD) (0x100 + CPU_regS), ESC_BINLOADER_CONT, Devices_H_BinLoaderCont);
 	CPU_regS--;
-	MEMORY_dPutByte(0x0100 + CPU_regS--, 0x01);	/* high */
+	MEMORY_dPutByte(0x0100 + CPU_regS, 0x01);	/* high */
+	CPU_regS--;
 	MEMORY_dPutByte(0x0100 + CPU_regS, CPU_regS + 1);	/* low */
 	CPU_regS--;
 	CPU_regPC = MEMORY_dGetWordAligned(0x2e2);
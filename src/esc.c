@@ -137,6 +137,19 @@ void ESC_Remove(UBYTE esc_code)
 void ESC_Run(UBYTE esc_code)
 {
 	if (esc_address[esc_code] == CPU_regPC - 2 && esc_function[esc_code] != NULL) {
+		if (!Atari800_DeviceIO()) {
+			/* Running ahead: wait here until the frames ahead end. */
+			CPU_regPC -= 2;
+			if (MEMORY_dGetByte(CPU_regPC) == 0xd2) {
+				/* ESCRTS does an RTS next, so make it return here. */
+				UWORD addr = CPU_regPC - 1;
+				MEMORY_dPutByte(0x0100 + CPU_regS, (UBYTE) (addr >> 8));	/* high */
+				CPU_regS--;
+				MEMORY_dPutByte(0x0100 + CPU_regS, (UBYTE) addr);	/* low */
+				CPU_regS--;
+			}
+			return;
+		}
 		esc_function[esc_code]();
 		return;
 	}
@@ -35,6 +35,9 @@
 #include "statesav.h"
 #endif
 #include "pokeysnd.h"
+#ifdef POKEYREC
+#include "pokeyrec.h"
+#endif
 #include "screen.h"
 
 /* GTIA Registers ---------------------------------------------------------- */
@@ -548,13 +551,14 @@ UBYTE GTIA_GetByte(UWORD addr, int no_side_effects)
 		return (GTIA_P3PL & 0x07)          /* mask in player 0,1, and 2 */
 		     & GTIA_collisions_mask_player_player;
 	case GTIA_OFFSET_TRIG0:
-		return GTIA_TRIG[0] & GTIA_TRIG_latch[0];
 	case GTIA_OFFSET_TRIG1:
-		return GTIA_TRIG[1] & GTIA_TRIG_latch[1];
 	case GTIA_OFFSET_TRIG2:
-		return GTIA_TRIG[2] & GTIA_TRIG_latch[2];
 	case GTIA_OFFSET_TRIG3:
-		return GTIA_TRIG[3] & GTIA_TRIG_latch[3];
+#ifndef BASIC
+		if (INPUT_latch_pending && !no_side_effects)
+			INPUT_LateLatch();
+#endif
+		return GTIA_TRIG[addr & 0x03] & GTIA_TRIG_latch[addr & 0x03];
 	case GTIA_OFFSET_PAL:
 		return (Atari800_tv_mode == Atari800_TV_PAL) ? 0x01 : 0x0f;
 	case GTIA_OFFSET_CONSOL:
@@ -618,6 +622,9 @@ void GTIA_PutByte(UWORD addr, UBYTE byte)
 		GTIA_speaker = !(byte & 0x08);
 #ifdef CONSOLE_SOUND
 		POKEYSND_UpdateConsol(1);
+#endif
+#ifdef POKEYREC
+		POKEYREC_LogConsol(GTIA_speaker);
 #endif
 		consol_mask = (~byte) & 0x0f;
 		break;
@@ -854,11 +854,15 @@ static void mmio_ide_write(struct ide_device *s, int addr, uint8_t val) {
 
 void IDE_PutByte(uint16_t addr, uint8_t val) {
     struct ide_device *s = &device;
+    if (!Atari800_DeviceIO())
+        return;
     mmio_ide_write(s, addr, val);
 }
 
 uint8_t IDE_GetByte(uint16_t addr, int no_side_effects) {
     struct ide_device *s = &device;
+    if (!no_side_effects && !Atari800_DeviceIO())
+        return 0xff;
     return mmio_ide_read(s, addr);
 }
 
@@ -37,6 +37,7 @@
 #include "pia.h"
 #include "platform.h"
 #include "pokey.h"
+#include "statesav.h"
 #include "util.h"
 #ifndef CURSES_BASIC
 #include "screen.h" /* for Screen_atari */
@@ -111,6 +112,13 @@ static const UBYTE mouse_st_codes[16] = {
 
 static UBYTE STICK[4];
 static UBYTE TRIG_input[4];
+static UBYTE last_stick[4] = {INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE};
+static int last_key_code = AKEY_NONE;
+static int last_key_break = 0;
+static int bit5_5200 = 0;
+
+int INPUT_late_latch = FALSE;
+int INPUT_latch_pending = FALSE;
 
 static int joy_multijoy_no = 0;	/* number of selected joy */
 
@@ -235,6 +243,10 @@ int INPUT_Initialise(int *argc, char *argv[])
 			playingback_exit_after = FALSE;
 		}
 #endif /* EVENT_RECORDING */
+		else if (strcmp(argv[i], "-latelatch") == 0)
+			INPUT_late_latch = TRUE;
+		else if (strcmp(argv[i], "-no-latelatch") == 0)
+			INPUT_late_latch = FALSE;
  		else if (strcmp(argv[i], "-directmouse") == 0) {
 			INPUT_direct_mouse = 1;
 		}
@@ -266,6 +278,8 @@ int INPUT_Initialise(int *argc, char *argv[])
 				Log_print("\t-directmouse     Use absolute X/Y mouse coords");
 				Log_print("\t-cx85 <n>        Emulate CX85 numeric keypad on port <n>");
 				Log_print("\t-multijoy        Emulate MultiJoy4 interface");
+				Log_print("\t-latelatch       Read joysticks when the program reads them");
+				Log_print("\t-no-latelatch    Read joysticks once before each frame");
 				#ifdef EVENT_RECORDING
 					Log_print("\t-record <file>   Record input to <file>");
 					Log_print("\t-playback <file> Playback input from <file>");
@@ -311,6 +325,15 @@ void INPUT_Exit(void) {
 #endif
 }
 
+int INPUT_EventRecordingActive(void)
+{
+#ifdef EVENT_RECORDING
+	return recording || playingback;
+#else
+	return FALSE;
+#endif
+}
+
 /* mouse_step is used in Amiga, ST, trak-ball and joystick modes.
    It moves mouse_x and mouse_y in the direction given by
    mouse_move_x and mouse_move_y.
@@ -422,12 +445,66 @@ static UBYTE mouse_step(void)
 	return r;
 }
 
+/* Resolves left+right and up+down pressed together on joystick NUM to the
+   direction pressed last. */
+static void BlockOppositeDirections(int num)
+{
+	if (INPUT_joy_block_opposite_directions) {
+		if ((STICK[num] & 0x0c) == 0) {	/* right and left simultaneously */
+			if (last_stick[num] & 0x04)	/* if wasn't left before, move left */
+				STICK[num] |= 0x08;
+			else						/* else move right */
+				STICK[num] |= 0x04;
+		}
+		else {
+			last_stick[num] &= 0x03;
+			last_stick[num] |= STICK[num] & 0x0c;
+		}
+		if ((STICK[num] & 0x03) == 0) {	/* up and down simultaneously */
+			if (last_stick[num] & 0x01)	/* if wasn't up before, move up */
+				STICK[num] |= 0x02;
+			else						/* else move down */
+				STICK[num] |= 0x01;
+		}
+		else {
+			last_stick[num] &= 0x0c;
+			last_stick[num] |= STICK[num] & 0x03;
+		}
+	}
+	else
+		last_stick[num] = STICK[num];
+}
+
+static void AutoFire(int num)
+{
+	if ((INPUT_joy_autofire[num] == INPUT_AUTOFIRE_FIRE && !TRIG_input[num]) || (INPUT_joy_autofire[num] == INPUT_AUTOFIRE_CONT))
+		TRIG_input[num] = (Atari800_nframes & 2) ? 1 : 0;
+}
+
+/* Passes the joystick state on to PIA and GTIA. */
+static void UpdatePorts(void)
+{
+	if (INPUT_joy_multijoy && Atari800_machine_type != Atari800_MACHINE_5200) {
+		PIA_PORT_input[0] = 0xf0 | STICK[joy_multijoy_no];
+		PIA_PORT_input[1] = 0xff;
+		GTIA_TRIG[0] = TRIG_input[joy_multijoy_no];
+		GTIA_TRIG[1] = 1;
+	}
+	else {
+		GTIA_TRIG[0] = TRIG_input[0];
+		GTIA_TRIG[1] = TRIG_input[1];
+		PIA_PORT_input[0] = (STICK[1] << 4) | STICK[0];
+		PIA_PORT_input[1] = (STICK[3] << 4) | STICK[2];
+	}
+	if (Atari800_machine_type != Atari800_MACHINE_XLXE) {
+		GTIA_TRIG[2] = TRIG_input[2];
+		GTIA_TRIG[3] = TRIG_input[3];
+	}
+}
+
 void INPUT_Frame(void)
 {
 	int i;
-	static int last_key_code = AKEY_NONE;
-	static int last_key_break = 0;
-	static UBYTE last_stick[4] = {INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE};
 	static int last_mouse_buttons = 0;
 
 	scanline_counter = 10000;	/* do nothing in INPUT_Scanline() */
@@ -505,7 +582,6 @@ void INPUT_Frame(void)
 		/* Bit 5 is different for each keypress because it is one
 		 * of the missing lines. */
 		if (Atari800_machine_type == Atari800_MACHINE_5200) {
-			static int bit5_5200 = 0;
 			if (bit5_5200) {
 				INPUT_key_code &= ~0x20;
 			}
@@ -568,30 +644,7 @@ void INPUT_Frame(void)
 	STICK[3] = (i >> 4) & 0x0f;
 
 	for (i = 0; i < 4; i++) {
-		if (INPUT_joy_block_opposite_directions) {
-			if ((STICK[i] & 0x0c) == 0) {	/* right and left simultaneously */
-				if (last_stick[i] & 0x04)	/* if wasn't left before, move left */
-					STICK[i] |= 0x08;
-				else						/* else move right */
-					STICK[i] |= 0x04;
-			}
-			else {
-				last_stick[i] &= 0x03;
-				last_stick[i] |= STICK[i] & 0x0c;
-			}
-			if ((STICK[i] & 0x03) == 0) {	/* up and down simultaneously */
-				if (last_stick[i] & 0x01)	/* if wasn't up before, move up */
-					STICK[i] |= 0x02;
-				else						/* else move down */
-					STICK[i] |= 0x01;
-			}
-			else {
-				last_stick[i] &= 0x0c;
-				last_stick[i] |= STICK[i] & 0x03;
-			}
-		}
-		else
-			last_stick[i] = STICK[i];
+		BlockOppositeDirections(i);
 		/* Joystick Triggers */
 #ifdef EVENT_RECORDING
 		if(playingback){
@@ -609,8 +662,7 @@ void INPUT_Frame(void)
 			gzprintf(recordfp,"%d ",TRIG_input[i]);
 		}
 #endif
-		if ((INPUT_joy_autofire[i] == INPUT_AUTOFIRE_FIRE && !TRIG_input[i]) || (INPUT_joy_autofire[i] == INPUT_AUTOFIRE_CONT))
-			TRIG_input[i] = (Atari800_nframes & 2) ? 1 : 0;
+		AutoFire(i);
 	}
 #ifdef EVENT_RECORDING
 	if(recording){
@@ -854,28 +906,64 @@ void INPUT_Frame(void)
 		}
 	}
 
-	if (INPUT_joy_multijoy && Atari800_machine_type != Atari800_MACHINE_5200) {
-		PIA_PORT_input[0] = 0xf0 | STICK[joy_multijoy_no];
-		PIA_PORT_input[1] = 0xff;
-		GTIA_TRIG[0] = TRIG_input[joy_multijoy_no];
-		GTIA_TRIG[1] = 1;
-	}
-	else {
-		GTIA_TRIG[0] = TRIG_input[0];
-		GTIA_TRIG[1] = TRIG_input[1];
-		PIA_PORT_input[0] = (STICK[1] << 4) | STICK[0];
-		PIA_PORT_input[1] = (STICK[3] << 4) | STICK[2];
-	}
-	if (Atari800_machine_type != Atari800_MACHINE_XLXE) {
-		GTIA_TRIG[2] = TRIG_input[2];
-		GTIA_TRIG[3] = TRIG_input[3];
-	}
+	UpdatePorts();
+
+	/* Read the host controllers again when the program gets to them. Not
+	   while recording or playing back, as the recording is per frame. */
+#ifdef EVENT_RECORDING
+	INPUT_latch_pending = INPUT_late_latch && !recording && !playingback;
+#else
+	INPUT_latch_pending = INPUT_late_latch;
+#endif
 
 #ifdef EVENT_RECORDING
 	update_adler32_of_screen();
 #endif
 }
 
+void INPUT_LateLatch(void)
+{
+	UBYTE keep_stick[4];
+	UBYTE keep_trig[4];
+	int i;
+
+	INPUT_latch_pending = FALSE;
+	/* Frames run ahead assume the input stays as it is. */
+	if (Atari800_running_ahead)
+		return;
+#ifdef SUPPORTS_PLATFORM_POLLINPUT
+	PLATFORM_PollInput();
+#endif
+	memcpy(keep_stick, STICK, sizeof(STICK));
+	memcpy(keep_trig, TRIG_input, sizeof(TRIG_input));
+	i = PLATFORM_PORT(0);
+	STICK[0] = i & 0x0f;
+	STICK[1] = (i >> 4) & 0x0f;
+	i = PLATFORM_PORT(1);
+	STICK[2] = i & 0x0f;
+	STICK[3] = (i >> 4) & 0x0f;
+	for (i = 0; i < 4; i++) {
+		BlockOppositeDirections(i);
+		TRIG_input[i] = PLATFORM_TRIG(i);
+		AutoFire(i);
+	}
+	/* Ports driven by the mouse or the CX85 keypad keep what INPUT_Frame
+	   made of them. */
+	if (INPUT_mouse_mode != INPUT_MOUSE_OFF) {
+		STICK[INPUT_mouse_port] = keep_stick[INPUT_mouse_port];
+		TRIG_input[INPUT_mouse_port] = keep_trig[INPUT_mouse_port];
+	}
+	if (INPUT_cx85) {
+		STICK[cx85_port] = keep_stick[cx85_port];
+		TRIG_input[cx85_port] = keep_trig[cx85_port];
+	}
+	UpdatePorts();
+	if (GTIA_GRACTL & 4) {
+		for (i = 0; i < 4; i++)
+			GTIA_TRIG_latch[i] &= GTIA_TRIG[i];
+	}
+}
+
 #ifdef EVENT_RECORDING
 static void update_adler32_of_screen(void)
 {
@@ -983,6 +1071,47 @@ void INPUT_Scanline(void)
 	}
 }
 
+/* The state of the controllers and what INPUT_Frame remembers of the
+   previous frames, for in-memory snapshots only. */
+void INPUT_StateSaveHistory(void)
+{
+	StateSav_SaveUBYTE(STICK, 4);
+	StateSav_SaveUBYTE(TRIG_input, 4);
+	StateSav_SaveUBYTE(last_stick, 4);
+	StateSav_SaveINT(&last_key_code, 1);
+	StateSav_SaveINT(&last_key_break, 1);
+	StateSav_SaveINT(&bit5_5200, 1);
+	StateSav_SaveINT(&joy_multijoy_no, 1);
+	StateSav_SaveINT(&mouse_x, 1);
+	StateSav_SaveINT(&mouse_y, 1);
+	StateSav_SaveINT(&mouse_move_x, 1);
+	StateSav_SaveINT(&mouse_move_y, 1);
+	StateSav_SaveINT(&mouse_last_right, 1);
+	StateSav_SaveINT(&mouse_last_down, 1);
+	StateSav_SaveINT(&scanline_counter, 1);
+	StateSav_SaveINT(&max_scanline_counter, 1);
+}
+
+void INPUT_StateReadHistory(void)
+{
+	StateSav_ReadUBYTE(STICK, 4);
+	StateSav_ReadUBYTE(TRIG_input, 4);
+	StateSav_ReadUBYTE(last_stick, 4);
+	StateSav_ReadINT(&last_key_code, 1);
+	StateSav_ReadINT(&last_key_break, 1);
+	StateSav_ReadINT(&bit5_5200, 1);
+	StateSav_ReadINT(&joy_multijoy_no, 1);
+	StateSav_ReadINT(&mouse_x, 1);
+	StateSav_ReadINT(&mouse_y, 1);
+	StateSav_ReadINT(&mouse_move_x, 1);
+	StateSav_ReadINT(&mouse_move_y, 1);
+	StateSav_ReadINT(&mouse_last_right, 1);
+	StateSav_ReadINT(&mouse_last_down, 1);
+	StateSav_ReadINT(&scanline_counter, 1);
+	StateSav_ReadINT(&max_scanline_counter, 1);
+	joy_multijoy_no &= 3;
+}
+
 void INPUT_SelectMultiJoy(int no)
 {
 	no &= 3;
@@ -1019,9 +1148,18 @@ void INPUT_CenterMousePointer(void)
 
 #ifndef CURSES_BASIC
 
+#ifdef DIRTYRECT
+/* The pointer is drawn straight into Screen_atari, so mark what it covers. */
+#define MARK_DIRTY(p)	(Screen_dirty[((UBYTE *) (p) - (UBYTE *) Screen_atari) >> 3] = 1)
+#else
+#define MARK_DIRTY(p)
+#endif
+
 #define PLOT(dx, dy)	do {\
 							ptr[(dx) + Screen_WIDTH * (dy)] ^= 0x0f0f;\
 							ptr[(dx) + Screen_WIDTH * (dy) + Screen_WIDTH / 2] ^= 0x0f0f;\
+							MARK_DIRTY(&ptr[(dx) + Screen_WIDTH * (dy)]);\
+							MARK_DIRTY(&ptr[(dx) + Screen_WIDTH * (dy) + Screen_WIDTH / 2]);\
 						} while (0)
 
 /* draw light pen cursor */
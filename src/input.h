@@ -76,13 +76,29 @@ extern int INPUT_direct_mouse;      /* When true, convert the mouse pointer
 													position directly into POKEY POT values */
 
 extern int INPUT_cx85;      /* emulate CX85 numeric keypad */
+
+/* Late input latching. INPUT_Frame reads the host joysticks before the
+   frame is emulated; with INPUT_late_latch set they are read again when
+   the program first reads PORTA, PORTB (400/800), or TRIG0-3 in a frame,
+   and once more after vertical blank begins, where the OS reads them.
+   Keyboard and 5200 analog input are still taken before the frame. */
+extern int INPUT_late_latch;
+/* Set while the next read of a joystick register should call
+   INPUT_LateLatch. */
+extern int INPUT_latch_pending;
 /* Functions ----------------------------------------------------------- */
 
 int INPUT_Initialise(int *argc, char *argv[]);
 void INPUT_Exit(void);
 void INPUT_Frame(void);
+/* Returns TRUE while input is being recorded or played back (-record,
+   -playback). */
+int INPUT_EventRecordingActive(void);
+void INPUT_LateLatch(void);
 void INPUT_Scanline(void);
 void INPUT_SelectMultiJoy(int no);
+void INPUT_StateSaveHistory(void);
+void INPUT_StateReadHistory(void);
 void INPUT_CenterMousePointer(void);
 void INPUT_DrawMousePointer(void);
 int INPUT_Recording(void);
@@ -44,12 +44,15 @@
 #include "screen.h"
 #include "sio.h"
 #include "../sound.h"
+#include "pokeysnd.h"
+#include "rewind.h"
 #include "util.h"
 #include "libatari800/main.h"
 #include "libatari800/cpu_crash.h"
 #include "libatari800/init.h"
 #include "libatari800/input.h"
 #include "libatari800/video.h"
+#include "libatari800/slot.h"
 #include "libatari800/sound.h"
 #include "libatari800/statesav.h"
 
@@ -138,7 +141,9 @@ char *error_messages[] = {
 	"invalid display list",
 	"self test",
 	"memo pad",
-	"invalid escape opcode"
+	"invalid escape opcode",
+	"state not restored",
+	"worker process stopped"
 };
 char *unknown_error = "unknown error";
 
@@ -192,6 +197,35 @@ void libatari800_clear_input_array(input_template_t *input)
 }
 
 
+/* Emulates one frame with INPUT, drawing the screen if DRAW_DISPLAY.
+   Returns the error code. */
+static int RunFrame(input_template_t *input, int draw_display)
+{
+	LIBATARI800_Input_array = input;
+	INPUT_key_code = PLATFORM_Keyboard();
+	LIBATARI800_Mouse();
+#ifdef HAVE_SETJMP
+	if ((libatari800_error_code = setjmp(libatari800_cpu_crash))) {
+		/* called from within CPU_GO to indicate crash */
+		Log_print("libatari800_next_frame: notified of CPU crash: %d\n", CPU_cim_encountered);
+	}
+	else
+#endif /* HAVE_SETJMP */
+	{
+		/* normal operation */
+		LIBATARI800_Frame(draw_display);
+		if (CPU_cim_encountered) {
+			libatari800_error_code = LIBATARI800_CPU_CRASH;
+		}
+		else if (ANTIC_dlist == 0) {
+			libatari800_error_code = LIBATARI800_DLIST_ERROR;
+		}
+	}
+	PLATFORM_DisplayScreen();
+	return libatari800_error_code;
+}
+
+
 /** Perform one video frame's worth of emulation
  * 
  * This is the main driver for libatari800. This function runs the emulator for enough
@@ -211,28 +245,97 @@ void libatari800_clear_input_array(input_template_t *input)
  */
 int libatari800_next_frame(input_template_t *input)
 {
-	LIBATARI800_Input_array = input;
-	INPUT_key_code = PLATFORM_Keyboard();
-	LIBATARI800_Mouse();
-#ifdef HAVE_SETJMP
-	if ((libatari800_error_code = setjmp(libatari800_cpu_crash))) {
-		/* called from within CPU_GO to indicate crash */
-		Log_print("libatari800_next_frame: notified of CPU crash: %d\n", CPU_cim_encountered);
+	return !RunFrame(input, TRUE);
+}
+
+
+/** Perform several video frames' worth of emulation
+ *
+ * Runs up to \a n frames, each with the next input in \a inputs, and
+ * stops early after the first frame that sets an error code. This saves
+ * the overhead of a call per frame, and with
+ * \a LIBATARI800_RUN_SKIP_DRAWING the screen is only drawn for the frames
+ * whose screen is kept and for the last of the \a n frames, which is
+ * what \a libatari800_get_screen_ptr then holds.
+ *
+ * Skipped frames do not draw the display, so unless the
+ * ACCURATE_SKIPPED_FRAMES option is on they do not detect collisions, and
+ * the emulation may differ from running the frames one by one. Whether a
+ * frame sets an error is only known after it ran, so when the run stops
+ * early the screen is that of the last frame drawn, not the one that
+ * stopped it.
+ *
+ * The flags select further outputs, stored in the caller's buffers in
+ * \a output:
+ *
+ *   - \a LIBATARI800_RUN_KEEP_FRAMES copies the screen of every
+ *     output->frame_interval-th frame (the last of every group of
+ *     frame_interval frames) into output->screens, which must have room
+ *     for n / frame_interval screens of 384x240 bytes
+ *   - \a LIBATARI800_RUN_KEEP_SOUND appends the sound of each frame to
+ *     output->sound, which must have room for
+ *     n * \a libatari800_get_sound_buffer_allocated_size bytes
+ *   - \a LIBATARI800_RUN_KEEP_MEMORY copies the 64k of main memory after
+ *     the last frame run into output->memory
+ *
+ * With \a LIBATARI800_RUN_SAME_INPUT, \a inputs points to a single input
+ * template used for all frames. If \a inputs is NULL, the frames are run
+ * with no input, as if with a template cleared by
+ * \a libatari800_clear_input_array.
+ *
+ * @param n number of frames to run
+ * @param inputs array of \a n input template structures, or NULL
+ * @param flags combination of the \a LIBATARI800_RUN_* flags
+ * @param output buffers for the kept outputs, also receiving the number of
+ * frames run, screens kept and bytes of sound; may be NULL if nothing is kept
+ *
+ * @returns number of frames run; less than \a n if emulation stopped with
+ * an error, which is then in \a libatari800_error_code
+ */
+int libatari800_run_frames(int n, input_template_t *inputs, int flags, run_frames_output_t *output)
+{
+	static input_template_t no_input;
+	int interval = 1;
+	int i;
+
+	if (inputs == NULL) {
+		libatari800_clear_input_array(&no_input);
+		inputs = &no_input;
+		flags |= LIBATARI800_RUN_SAME_INPUT;
+	}
+	if (output != NULL) {
+		output->frames_run = 0;
+		output->screens_kept = 0;
+		output->sound_len = 0;
+		if ((flags & LIBATARI800_RUN_KEEP_FRAMES) && output->frame_interval > 1)
+			interval = output->frame_interval;
 	}
 	else
-#endif /* HAVE_SETJMP */
-	{
-		/* normal operation */
-		LIBATARI800_Frame();
-		if (CPU_cim_encountered) {
-			libatari800_error_code = LIBATARI800_CPU_CRASH;
+		flags &= ~(LIBATARI800_RUN_KEEP_FRAMES | LIBATARI800_RUN_KEEP_SOUND | LIBATARI800_RUN_KEEP_MEMORY);
+
+	for (i = 0; i < n; i++) {
+		int keep_screen = (flags & LIBATARI800_RUN_KEEP_FRAMES) && (i + 1) % interval == 0;
+		int error = RunFrame(flags & LIBATARI800_RUN_SAME_INPUT ? inputs : &inputs[i],
+		                     !(flags & LIBATARI800_RUN_SKIP_DRAWING) || keep_screen || i == n - 1);
+		if (keep_screen) {
+			memcpy(output->screens + output->screens_kept * Screen_WIDTH * Screen_HEIGHT,
+			       Screen_atari, Screen_WIDTH * Screen_HEIGHT);
+			output->screens_kept++;
 		}
-		else if (ANTIC_dlist == 0) {
-			libatari800_error_code = LIBATARI800_DLIST_ERROR;
+		if (flags & LIBATARI800_RUN_KEEP_SOUND) {
+			memcpy(output->sound + output->sound_len, LIBATARI800_Sound_array, sound_array_fill);
+			output->sound_len += sound_array_fill;
+		}
+		if (error) {
+			i++;
+			break;
 		}
 	}
-	PLATFORM_DisplayScreen();
-	return !libatari800_error_code;
+	if (flags & LIBATARI800_RUN_KEEP_MEMORY)
+		memcpy(output->memory, MEMORY_mem, 65536);
+	if (output != NULL)
+		output->frames_run = i;
+	return i;
 }
 
 
@@ -391,6 +494,52 @@ int libatari800_get_sound_sample_size() {
 }
 
 
+/** Choose whether emulated frames produce audio
+ *
+ * When sound is disabled, POKEY sound synthesis is skipped entirely and the
+ * sound buffer stays empty, which saves CPU time when nobody listens to the
+ * audio. POKEY timers, interrupts and serial I/O are emulated as usual. When
+ * sound is enabled again, audio continues from the current state of the
+ * sound registers.
+ *
+ * @param enabled if False, don't generate audio
+ *
+ * @returns the previous setting
+ */
+int libatari800_set_sound_enabled(int enabled)
+{
+	int prev = LIBATARI800_Sound_output;
+	LIBATARI800_Sound_output = enabled;
+	POKEYSND_SetIdle(!enabled);
+	return prev;
+}
+
+
+/** Return audio latency statistics
+ *
+ * Reports the estimated output latency, the fill of the internal audio buffer,
+ * how often it ran empty (underruns) or full (overruns), and the emulation speed
+ * adjustment used to keep it filled. If libatari800 was initialized with the
+ * \a -sndlatencytest argument, \a probe_ms holds the last measured time from a
+ * POKEY write until its samples left the buffer, otherwise it is -1.
+ *
+ * @param stats pointer to structure to be filled
+ */
+void libatari800_get_sound_stats(sound_stats_t *stats)
+{
+	stats->latency_ms = (float)Sound_stats.latency_ms;
+	stats->fill_ms = (float)Sound_stats.fill_ms;
+	stats->avg_fill_ms = (float)Sound_stats.avg_fill_ms;
+	stats->min_fill_ms = (float)Sound_stats.min_fill_ms;
+	stats->max_fill_ms = (float)Sound_stats.max_fill_ms;
+	stats->underruns = Sound_stats.underruns;
+	stats->overruns = Sound_stats.overruns;
+	stats->speed_adjust = (float)Sound_stats.speed_adjust;
+	stats->adjusted_frames = Sound_stats.adjusted_frames;
+	stats->probe_ms = (float)Sound_stats.probe_ms;
+}
+
+
 /** Return the video frame rate
  *
  * It is important to note that libatari800 can run as fast as the host computer will
@@ -426,6 +575,21 @@ int libatari800_get_frame_number() {
 }
 
 
+static void GetStateFlags(statesav_flags_t *flags)
+{
+	flags->selftest_enabled = MEMORY_selftest_enabled;
+	flags->nframes = (ULONG)Atari800_nframes;
+	flags->sample_residual = (ULONG)(0xffffffff * sample_residual);
+}
+
+static void SetStateFlags(const statesav_flags_t *flags)
+{
+	MEMORY_selftest_enabled = flags->selftest_enabled;
+	Atari800_nframes = flags->nframes;
+	sample_residual = (double)flags->sample_residual / (double)0xffffffff;
+}
+
+
 /** Save the state of the emulator
  *
  * Save the state of the emulator into a data structure that can later be used
@@ -451,14 +615,17 @@ int libatari800_get_frame_number() {
  * gets the current state of the emulator, locates the \a cpu_state_t structure
  * and the \a pc_state_t structure within it, and prints the values of interest.
  *
+ * The structure has room for the state of a 64 KB machine. The state of a
+ * machine with more memory, like a 130XE, does not fit; state->tags.size is
+ * then 0 and only state->flags is set. Use \a libatari800_state_size and
+ * \a libatari800_save_state_buffer for those.
+ *
  * @param state pointer to an already allocated \a emulator_state_t structure
  */
 void libatari800_get_current_state(emulator_state_t *state)
 {
 	LIBATARI800_StateSave(state->state, &state->tags);
-	state->flags.selftest_enabled = MEMORY_selftest_enabled;
-	state->flags.nframes = (ULONG)Atari800_nframes;
-	state->flags.sample_residual = (ULONG)(0xffffffff * sample_residual);
+	GetStateFlags(&state->flags);
 }
 
 
@@ -471,14 +638,311 @@ void libatari800_get_current_state(emulator_state_t *state)
  * data in \a state has been altered it is possible that the emulator will
  * be returned to an invalid state and further emulation will fail.
  *
+ * A \a state whose tags.size is 0 is ignored. To know whether a state was
+ * restored, use \a libatari800_restore_state_buffer.
+ *
  * @param state pointer to an already allocated \a emulator_state_t structure
  */
 void libatari800_restore_state(emulator_state_t *state)
 {
-	LIBATARI800_StateLoad(state->state);
-	MEMORY_selftest_enabled = state->flags.selftest_enabled;
-	Atari800_nframes = state->flags.nframes;
-	sample_residual = (double)state->flags.sample_residual / (double)0xffffffff;
+	if (state->tags.size == 0)
+		return;
+	if (LIBATARI800_StateLoad(state->state))
+		SetStateFlags(&state->flags);
+}
+
+
+/** Size of the state of the emulator
+ *
+ * The \a emulator_state_t structure has room for the state of a 64 KB
+ * machine. This is the number of bytes the state of the current machine
+ * takes, to be passed to \a libatari800_save_state_buffer. It changes
+ * with the memory size, the cartridge and the names of the mounted media.
+ *
+ * @return number of bytes of the state
+ */
+ULONG libatari800_state_size(void)
+{
+	return LIBATARI800_StateSaveSized(NULL, 0, NULL);
+}
+
+
+/** Save the state of the emulator into a buffer
+ *
+ * Like \a libatari800_get_current_state, but the state is stored in a
+ * buffer allocated by the caller, usually of \a libatari800_state_size
+ * bytes. The offsets in \a tags are into \a buffer.
+ *
+ * @param buffer where to store the state
+ * @param size number of bytes at \a buffer
+ * @param tags if not NULL, set to the offsets of the parts of the state
+ * @param flags if not NULL, set to the values kept besides the state
+ *
+ * @return number of bytes of the state, or 0 if it doesn't fit in \a size
+ * bytes
+ */
+ULONG libatari800_save_state_buffer(UBYTE *buffer, ULONG size, statesav_tags_t *tags, statesav_flags_t *flags)
+{
+	ULONG used;
+
+	if (buffer == NULL)
+		return 0;
+	used = LIBATARI800_StateSaveSized(buffer, size, tags);
+	if (used > 0 && flags != NULL)
+		GetStateFlags(flags);
+	return used;
+}
+
+
+/** Restore the state of the emulator from a buffer
+ *
+ * Returns the emulator to a state saved by \a libatari800_save_state_buffer.
+ * As with \a libatari800_restore_state, the data is not checked beyond its
+ * size.
+ *
+ * @param buffer the state
+ * @param size number of bytes returned when it was saved
+ * @param flags if not NULL, the values saved with it
+ *
+ * @return FALSE if \a size bytes don't hold a whole state
+ */
+int libatari800_restore_state_buffer(const UBYTE *buffer, ULONG size, const statesav_flags_t *flags)
+{
+	if (!LIBATARI800_StateLoadSized(buffer, size))
+		return FALSE;
+	if (flags != NULL)
+		SetStateFlags(flags);
+	return TRUE;
+}
+
+
+/** Set the memory used to keep states for rewinding
+ *
+ * While it is not 0, the state at the end of every frame is kept, stored as
+ * the difference from the state of the next frame, until \a megabytes of
+ * memory are filled; from then on, the oldest states are dropped. Setting it
+ * drops all the kept states. The -rewind command line option sets it too.
+ *
+ * @param megabytes memory for the kept states, or 0 to stop keeping them
+ */
+void libatari800_set_rewind_buffer_size(int megabytes)
+{
+	if (megabytes < 0)
+		megabytes = 0;
+	REWIND_SetBufferSize(megabytes);
+}
+
+
+/** Go back to the state of an earlier frame
+ *
+ * Restores the state kept \a frames frames before the current one, or the
+ * oldest state kept if there are fewer. Going back one frame costs much less
+ * than emulating one. The screen and the sound buffer are left as they were
+ * until the next frame is emulated.
+ *
+ * As for \a libatari800_slot_select, the machine configuration and the
+ * media are not part of the state.
+ *
+ * @param frames number of frames to go back
+ *
+ * @return number of frames gone back
+ */
+int libatari800_rewind(int frames)
+{
+	int i;
+	for (i = 0; i < frames; i++)
+		if (!REWIND_StepBack())
+			break;
+	return i;
+}
+
+
+/** Number of frames the emulator can go back
+ *
+ * @return how many frames \a libatari800_rewind can go back
+ */
+int libatari800_get_rewind_frames(void)
+{
+	return REWIND_Frames();
+}
+
+
+/** Track writes to the banks of extended memory and cartridge RAM
+ *
+ * Writes to main memory are always tracked. Tracking the memory banked
+ * into it makes switching a bank out compare it with what the bank held
+ * before, a little slower than just copying it, so it is off until turned
+ * on here.
+ *
+ * @param enable TRUE to track the banks
+ */
+void libatari800_set_bank_tracking(int enable)
+{
+	MEMORY_TrackBanks(enable);
+}
+
+
+/** Size of a memory region
+ *
+ * @param region one of the LIBATARI800_MEMORY_* values
+ *
+ * @return number of 256-byte pages of the region, 0 if the machine has none
+ */
+int libatari800_get_region_pages(int region)
+{
+	if (region < 0 || region >= MEMORY_REGIONS)
+		return 0;
+	return MEMORY_RegionPages(region);
+}
+
+
+/** Start tracking the pages written from now on
+ *
+ * Several callers can track writes independently, each passing the value
+ * it got from here to \a libatari800_get_written_pages.
+ *
+ * @return marker for the pages written after this call
+ */
+ULONG libatari800_clear_written_pages(void)
+{
+	return MEMORY_NewWriteGeneration();
+}
+
+
+/** Find the pages of a memory region written since a marker
+ *
+ * The bank of a region that is currently switched into main memory is
+ * written there, so writes to it are reported for LIBATARI800_MEMORY_MAIN
+ * until it is switched out. The markers start over after 2^32 markers and
+ * snapshots; a marker from before that reports all pages written.
+ *
+ * @param region one of the LIBATARI800_MEMORY_* values
+ * @param since marker returned by \a libatari800_clear_written_pages
+ * @param flags set to TRUE or FALSE for each page of the region, as many
+ * as \a libatari800_get_region_pages returns
+ *
+ * @return number of pages written, or -1 if the region is a bank region
+ * and bank tracking is off
+ */
+int libatari800_get_written_pages(int region, ULONG since, UBYTE *flags)
+{
+	if (region < 0 || region >= MEMORY_REGIONS)
+		return -1;
+	return MEMORY_GetWrittenPages(region, since, flags);
+}
+
+
+/** Create another machine slot
+ *
+ * libatari800 emulates one machine at a time. A slot keeps the state of a
+ * machine while another slot is selected, so that several machines can
+ * take turns: selecting a slot saves the state of the previously selected
+ * one and restores its own, including a disk transfer in progress and the
+ * last joystick and key input seen. The new slot starts as a copy of the
+ * current one, and runs on its own once selected with
+ * \a libatari800_slot_select.
+ *
+ * The slots are not independent emulators. They share the machine
+ * configuration and the attached media, so calls such as
+ * \a libatari800_reboot_with_file or \a libatari800_mount_disk_image
+ * affect every slot, and they never run at the same time. Threads that each
+ * drive their own slots must go through \a libatari800_slot_lock, which
+ * lets only one of them run at a time; to emulate in parallel, use
+ * separate processes, as \a libatari800_vec_new does.
+ *
+ * @return pointer to the new slot, to be released with
+ * \a libatari800_slot_free, or NULL if the state of the current slot could
+ * not be saved
+ */
+libatari800_slot_t *libatari800_slot_new(void)
+{
+	return LIBATARI800_Slot_New();
+}
+
+
+/** Create a copy of a machine slot
+ *
+ * The copy shares the main memory of \a slot in 256-byte pages, each page
+ * copied only once either slot writes to it, so cloning costs far less than
+ * saving and restoring the whole state. This makes it cheap to branch the
+ * emulation, e.g. for a tree search.
+ *
+ * @param slot slot returned by \a libatari800_slot_new or
+ * \a libatari800_slot_clone, or NULL for the default slot
+ *
+ * @return pointer to the new slot, to be released with
+ * \a libatari800_slot_free, or NULL if the state of the current slot could
+ * not be saved
+ */
+libatari800_slot_t *libatari800_slot_clone(libatari800_slot_t *slot)
+{
+	return LIBATARI800_Slot_Clone(slot);
+}
+
+
+/** Free a machine slot
+ *
+ * If \a slot is the current slot, the default slot (the one set up by
+ * \a libatari800_init) is selected first.
+ *
+ * @param slot slot returned by \a libatari800_slot_new
+ */
+void libatari800_slot_free(libatari800_slot_t *slot)
+{
+	LIBATARI800_Slot_Free(slot);
+}
+
+
+/** Choose the slot whose machine the other libatari800 functions run
+ *
+ * @param slot slot returned by \a libatari800_slot_new, or NULL for the
+ * default slot
+ *
+ * @retval FALSE if the state of the current slot could not be saved or
+ * that of \a slot could not be restored; the current slot stays selected
+ * @retval TRUE if successful
+ */
+int libatari800_slot_select(libatari800_slot_t *slot)
+{
+	return LIBATARI800_Slot_Select(slot);
+}
+
+
+/** Return the current slot
+ *
+ * @return the selected slot, or NULL for the default slot
+ */
+libatari800_slot_t *libatari800_slot_current(void)
+{
+	return LIBATARI800_Slot_Current();
+}
+
+
+/** Select a slot for the calling thread
+ *
+ * Waits until no other thread holds the emulator, then selects \a slot.
+ * The calling thread may use the other libatari800 functions until it
+ * calls \a libatari800_slot_unlock, which it must do even if this fails.
+ *
+ * @param slot slot returned by \a libatari800_slot_new, or NULL for the
+ * default slot
+ *
+ * @retval FALSE if \a slot could not be selected, see
+ * \a libatari800_slot_select
+ * @retval TRUE if successful
+ */
+int libatari800_slot_lock(libatari800_slot_t *slot)
+{
+	LIBATARI800_Slot_Lock();
+	return LIBATARI800_Slot_Select(slot);
+}
+
+
+/** Let other threads use the emulator again
+ */
+void libatari800_slot_unlock(void)
+{
+	LIBATARI800_Slot_Unlock();
 }
 
 
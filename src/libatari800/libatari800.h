@@ -119,6 +119,10 @@ typedef struct {
 } input_template_t;
 
 
+/* Room for the state in emulator_state_t. It is part of the size of the
+   structure, so it stays as it is; a state that doesn't fit, like that of
+   a 130XE, needs libatari800_save_state_buffer. libatari800_state_size
+   gives the size the current machine needs. */
 #define STATESAV_MAX_SIZE 210000
 
 /* byte offsets into output_template.state array of groups of data
@@ -257,6 +261,55 @@ typedef struct {
     int Base_mult[4];
 } pokey_state_t;
 
+/* audio latency statistics, all times in milliseconds */
+typedef struct {
+    float latency_ms;
+    float fill_ms;
+    float avg_fill_ms;
+    float min_fill_ms;
+    float max_fill_ms;
+    unsigned int underruns;
+    unsigned int overruns;
+    float speed_adjust;
+    unsigned int adjusted_frames;
+    float probe_ms;
+} sound_stats_t;
+
+/* flags for libatari800_run_frames */
+/* Draws only the kept screens and the screen of the last of the n frames.
+   If the run stops early with an error, the frame that stopped it was not
+   drawn unless its screen was kept, so the screen is older than the CPU
+   and memory state. */
+#define LIBATARI800_RUN_SKIP_DRAWING 0x01
+#define LIBATARI800_RUN_KEEP_FRAMES 0x02
+#define LIBATARI800_RUN_KEEP_SOUND 0x04
+#define LIBATARI800_RUN_KEEP_MEMORY 0x08
+#define LIBATARI800_RUN_SAME_INPUT 0x10
+
+/* outputs of libatari800_run_frames, in buffers allocated by the caller */
+typedef struct {
+    int frame_interval;
+    UBYTE *screens;
+    UBYTE *sound;
+    UBYTE *memory;
+
+    /* set by libatari800_run_frames */
+    int frames_run;
+    int screens_kept;
+    int sound_len;
+} run_frames_output_t;
+
+/* memory regions for libatari800_get_written_pages */
+#define LIBATARI800_MEMORY_MAIN 0
+#define LIBATARI800_MEMORY_XE 1
+#define LIBATARI800_MEMORY_AXLON 2
+#define LIBATARI800_MEMORY_MOSAIC 3
+#define LIBATARI800_MEMORY_CART 4
+#define LIBATARI800_MEMORY_PIGGYBACK 5
+
+/* a machine taking turns on the emulator, see libatari800_slot_new */
+typedef struct libatari800_slot libatari800_slot_t;
+
 extern int libatari800_error_code;
 #define LIBATARI800_UNIDENTIFIED_CART_TYPE 1
 #define LIBATARI800_CPU_CRASH 2
@@ -265,6 +318,8 @@ extern int libatari800_error_code;
 #define LIBATARI800_SELF_TEST 5
 #define LIBATARI800_MEMO_PAD 6
 #define LIBATARI800_INVALID_ESCAPE_OPCODE 7
+#define LIBATARI800_STATE_ERROR 8
+#define LIBATARI800_WORKER_ERROR 9
 
 int libatari800_init(int argc, char **argv);
 
@@ -276,6 +331,8 @@ void libatari800_clear_input_array(input_template_t *input);
 
 int libatari800_next_frame(input_template_t *input);
 
+int libatari800_run_frames(int n, input_template_t *inputs, int flags, run_frames_output_t *output);
+
 int libatari800_mount_disk_image(int diskno, const char *filename, int readonly);
 
 int libatari800_reboot_with_file(const char *filename);
@@ -296,14 +353,53 @@ int libatari800_get_num_sound_channels();
 
 int libatari800_get_sound_sample_size();
 
+int libatari800_set_sound_enabled(int enabled);
+
+void libatari800_get_sound_stats(sound_stats_t *stats);
+
 float libatari800_get_fps();
 
 int libatari800_get_frame_number();
 
+/* state->tags.size is 0 if the state doesn't fit in emulator_state_t. */
 void libatari800_get_current_state(emulator_state_t *state);
 
 void libatari800_restore_state(emulator_state_t *state);
 
+ULONG libatari800_state_size(void);
+
+ULONG libatari800_save_state_buffer(UBYTE *buffer, ULONG size, statesav_tags_t *tags, statesav_flags_t *flags);
+
+int libatari800_restore_state_buffer(const UBYTE *buffer, ULONG size, const statesav_flags_t *flags);
+
+void libatari800_set_rewind_buffer_size(int megabytes);
+
+int libatari800_rewind(int frames);
+
+int libatari800_get_rewind_frames(void);
+
+void libatari800_set_bank_tracking(int enable);
+
+int libatari800_get_region_pages(int region);
+
+ULONG libatari800_clear_written_pages(void);
+
+int libatari800_get_written_pages(int region, ULONG since, UBYTE *flags);
+
+libatari800_slot_t *libatari800_slot_new(void);
+
+libatari800_slot_t *libatari800_slot_clone(libatari800_slot_t *slot);
+
+void libatari800_slot_free(libatari800_slot_t *slot);
+
+int libatari800_slot_select(libatari800_slot_t *slot);
+
+libatari800_slot_t *libatari800_slot_current(void);
+
+int libatari800_slot_lock(libatari800_slot_t *slot);
+
+void libatari800_slot_unlock(void);
+
 void libatari800_exit();
 
 /* Disk management functions */
@@ -0,0 +1,46 @@
+#ifndef LIBATARI800_VEC_H_
+#define LIBATARI800_VEC_H_
+
+#include "libatari800.h"
+
+/* Runs a batch of emulators in lockstep, each in a worker process of its
+   own, so that they step in parallel. The inputs and the observations are
+   kept in batch buffers shared with the workers: the caller writes the
+   inputs and reads the observations in place. */
+
+typedef struct libatari800_vec libatari800_vec_t;
+
+/* flags for libatari800_vec_new: which observations to keep, and whether
+   steps draw only their last frame (see LIBATARI800_RUN_SKIP_DRAWING) */
+#define LIBATARI800_VEC_SCREEN 0x01
+#define LIBATARI800_VEC_MEMORY 0x02
+#define LIBATARI800_VEC_SKIP_DRAWING 0x04
+
+#define LIBATARI800_VEC_SCREEN_SIZE (384 * 240)
+#define LIBATARI800_VEC_MEMORY_SIZE 65536
+
+libatari800_vec_t *libatari800_vec_new(int num_envs, int num_workers, int argc, char **argv, int flags, const UWORD *watch_addresses, int num_watch);
+
+void libatari800_vec_free(libatari800_vec_t *vec);
+
+int libatari800_vec_num_envs(libatari800_vec_t *vec);
+
+int libatari800_vec_num_workers(libatari800_vec_t *vec);
+
+input_template_t *libatari800_vec_inputs(libatari800_vec_t *vec);
+
+UBYTE *libatari800_vec_resets(libatari800_vec_t *vec);
+
+int libatari800_vec_step(libatari800_vec_t *vec, int frames);
+
+int libatari800_vec_reset(libatari800_vec_t *vec);
+
+const int *libatari800_vec_errors(libatari800_vec_t *vec);
+
+const UBYTE *libatari800_vec_screens(libatari800_vec_t *vec);
+
+const UBYTE *libatari800_vec_memory(libatari800_vec_t *vec);
+
+const UBYTE *libatari800_vec_watched(libatari800_vec_t *vec);
+
+#endif /* LIBATARI800_VEC_H_ */
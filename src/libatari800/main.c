@@ -51,6 +51,7 @@
 #include "libatari800/video.h"
 #include "libatari800/sound.h"
 #include "libatari800/statesav.h"
+#include "rewind.h"
 
 /* mainloop includes */
 #include "antic.h"
@@ -102,7 +103,9 @@ int PLATFORM_Initialise(int *argc, char *argv[])
 }
 
 
-void LIBATARI800_Frame(void)
+ULONG LIBATARI800_frames_run = 0;
+
+void LIBATARI800_Frame(int draw_display)
 {
 	switch (INPUT_key_code) {
 	case AKEY_COLDSTART:
@@ -127,14 +130,24 @@ void LIBATARI800_Frame(void)
 	Devices_Frame();
 	INPUT_Frame();
 	GTIA_Frame();
-	ANTIC_Frame(TRUE);
-	INPUT_DrawMousePointer();
-	Screen_DrawAtariSpeed(Util_time());
-	Screen_DrawDiskLED();
-	Screen_Draw1200LED();
+	if (draw_display) {
+		ANTIC_Frame(TRUE);
+		INPUT_DrawMousePointer();
+		Screen_DrawAtariSpeed(Util_time());
+		Screen_DrawDiskLED();
+		Screen_Draw1200LED();
+		Screen_DrawSoundStats();
+	}
+	else
+		ANTIC_Frame(Atari800_collisions_in_skipped_frames);
 	POKEY_Frame();
-	Sound_Update();
+	if (LIBATARI800_Sound_output)
+		Sound_Update();
+	else
+		sound_array_fill = 0;
 	Atari800_nframes++;
+	LIBATARI800_frames_run++;
+	REWIND_Frame();
 }
 
 
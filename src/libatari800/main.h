@@ -4,7 +4,15 @@
 #include <stdio.h>
 
 #include "config.h"
+#include "atari.h"
 
-void LIBATARI800_Frame(void);
+/* Emulates one frame. Unless DRAW_DISPLAY, the screen is not drawn, and
+   neither are the collisions unless Atari800_collisions_in_skipped_frames. */
+void LIBATARI800_Frame(int draw_display);
+
+/* Counts the frames LIBATARI800_Frame has emulated; unlike Atari800_nframes
+   it is not restored with the state, so it tells whether the screen may have
+   changed. */
+extern ULONG LIBATARI800_frames_run;
 
 #endif /* LIBATARI800_VIDEO_H_ */
@@ -0,0 +1,213 @@
+/*
+ * libatari800/slot.c - Atari800 as a library - machines taking turns on the emulator
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef THREADS
+#include <pthread.h>
+#endif
+
+#include "atari.h"
+#include "cpu.h"
+#include "memory.h"
+#include "rewind.h"
+#include "screen.h"
+#include "statesav.h"
+#include "util.h"
+#include "libatari800/main.h"
+#include "libatari800/slot.h"
+#include "libatari800/sound.h"
+
+/* The screen of a slot, shared with its clones until either runs. */
+typedef struct {
+	int refs;
+	UBYTE pixels[Screen_WIDTH * Screen_HEIGHT];
+} screen_t;
+
+struct libatari800_slot {
+	/* The machine's state; the configuration and the media are shared by
+	   all slots, so they are not in it. */
+	StateSav_snapshot_t snapshot;
+	/* What libatari800_get_current_state keeps besides the state file. */
+	int nframes;
+	int selftest_enabled;
+	double sample_residual;
+	int error_code;
+	UBYTE cim_encountered;
+	/* Output of the last frame; the screen is as LIBATARI800_frames_run
+	   was at screen_frame. */
+	screen_t *screen;
+	ULONG screen_frame;
+	UBYTE *sound;
+	unsigned int sound_fill;
+};
+
+/* The slot libatari800_init set up, used until another one is selected. */
+static libatari800_slot_t default_slot;
+static libatari800_slot_t *current = &default_slot;
+
+#ifdef THREADS
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void ReleaseScreen(screen_t *screen)
+{
+	if (screen != NULL && --screen->refs == 0)
+		free(screen);
+}
+
+static int Save(libatari800_slot_t *slot)
+{
+	if (!StateSav_SaveSnapshot(&slot->snapshot))
+		return FALSE;
+	slot->nframes = Atari800_nframes;
+	slot->selftest_enabled = MEMORY_selftest_enabled;
+	slot->sample_residual = sample_residual;
+	slot->error_code = libatari800_error_code;
+	slot->cim_encountered = CPU_cim_encountered;
+	/* Screen_atari only changes by running frames while the slot is
+	   selected, so a screen saved since the last frame is still good. */
+	if (slot->screen == NULL || slot->screen_frame != LIBATARI800_frames_run) {
+		if (slot->screen == NULL || slot->screen->refs > 1) {
+			ReleaseScreen(slot->screen);
+			slot->screen = (screen_t *) Util_malloc(sizeof(screen_t));
+			slot->screen->refs = 1;
+		}
+		memcpy(slot->screen->pixels, Screen_atari, Screen_WIDTH * Screen_HEIGHT);
+		slot->screen_frame = LIBATARI800_frames_run;
+	}
+	if (slot->sound == NULL && sound_hw_buffer_size > 0)
+		slot->sound = (UBYTE *) Util_malloc(sound_hw_buffer_size);
+	slot->sound_fill = 0;
+	if (slot->sound != NULL) {
+		memcpy(slot->sound, LIBATARI800_Sound_array, sound_array_fill);
+		slot->sound_fill = sound_array_fill;
+	}
+	return TRUE;
+}
+
+static int Load(libatari800_slot_t *slot)
+{
+	if (!StateSav_RestoreSnapshot(&slot->snapshot))
+		return FALSE;
+	Atari800_nframes = slot->nframes;
+	MEMORY_selftest_enabled = slot->selftest_enabled;
+	sample_residual = slot->sample_residual;
+	libatari800_error_code = slot->error_code;
+	CPU_cim_encountered = slot->cim_encountered;
+	memcpy(Screen_atari, slot->screen->pixels, Screen_WIDTH * Screen_HEIGHT);
+	slot->screen_frame = LIBATARI800_frames_run;
+	sound_array_fill = 0;
+	if (slot->sound != NULL) {
+		memcpy(LIBATARI800_Sound_array, slot->sound, slot->sound_fill);
+		sound_array_fill = slot->sound_fill;
+	}
+	return TRUE;
+}
+
+libatari800_slot_t *LIBATARI800_Slot_Clone(libatari800_slot_t *slot)
+{
+	libatari800_slot_t *clone;
+	if (slot == NULL)
+		slot = &default_slot;
+	if (slot == current && !Save(current))
+		return NULL;
+	clone = (libatari800_slot_t *) Util_malloc(sizeof(libatari800_slot_t));
+	memset(clone, 0, sizeof(libatari800_slot_t));
+	StateSav_CopySnapshot(&clone->snapshot, &slot->snapshot);
+	clone->nframes = slot->nframes;
+	clone->selftest_enabled = slot->selftest_enabled;
+	clone->sample_residual = slot->sample_residual;
+	clone->error_code = slot->error_code;
+	clone->cim_encountered = slot->cim_encountered;
+	clone->screen = slot->screen;
+	clone->screen->refs++;
+	clone->screen_frame = slot->screen_frame;
+	if (slot->sound != NULL) {
+		clone->sound = (UBYTE *) Util_malloc(sound_hw_buffer_size);
+		memcpy(clone->sound, slot->sound, slot->sound_fill);
+		clone->sound_fill = slot->sound_fill;
+	}
+	return clone;
+}
+
+libatari800_slot_t *LIBATARI800_Slot_New(void)
+{
+	return LIBATARI800_Slot_Clone(current);
+}
+
+void LIBATARI800_Slot_Free(libatari800_slot_t *slot)
+{
+	if (slot == NULL || slot == &default_slot)
+		return;
+	if (slot == current && !LIBATARI800_Slot_Select(NULL))
+		/* Keeps running the machine, but as the default slot. */
+		current = &default_slot;
+	StateSav_FreeSnapshot(&slot->snapshot);
+	ReleaseScreen(slot->screen);
+	free(slot->sound);
+	free(slot);
+}
+
+int LIBATARI800_Slot_Select(libatari800_slot_t *slot)
+{
+	if (slot == NULL)
+		slot = &default_slot;
+	if (slot == current)
+		return TRUE;
+	if (!Save(current))
+		return FALSE;
+	if (!Load(slot)) {
+		/* Go back to the state just saved. */
+		Load(current);
+		return FALSE;
+	}
+	current = slot;
+	/* The kept states are of the other slot. */
+	REWIND_Clear();
+	return TRUE;
+}
+
+libatari800_slot_t *LIBATARI800_Slot_Current(void)
+{
+	return current == &default_slot ? NULL : current;
+}
+
+void LIBATARI800_Slot_Lock(void)
+{
+#ifdef THREADS
+	pthread_mutex_lock(&lock);
+#endif
+}
+
+void LIBATARI800_Slot_Unlock(void)
+{
+#ifdef THREADS
+	pthread_mutex_unlock(&lock);
+#endif
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,31 @@
+#ifndef LIBATARI800_SLOT_H_
+#define LIBATARI800_SLOT_H_
+
+#include "config.h"
+#include "libatari800/libatari800.h"
+
+/* Keeps the machine state of each slot while another one is selected.
+   The emulator core has one machine, so slots take turns on it: selecting
+   a slot saves the machine's state into the previously selected slot and
+   loads the state of the new one. The state includes a serial transfer in
+   progress and the controller history of INPUT_Frame. The configuration
+   and the media are not part of it, so all slots share them. */
+
+/* Returns a copy of SLOT (the default one if NULL), sharing its main
+   memory pages until either of them changes them, or NULL if the state of
+   the current slot could not be saved. */
+libatari800_slot_t *LIBATARI800_Slot_Clone(libatari800_slot_t *slot);
+libatari800_slot_t *LIBATARI800_Slot_New(void);
+void LIBATARI800_Slot_Free(libatari800_slot_t *slot);
+
+/* Makes SLOT (or, if NULL, the slot set up by libatari800_init) the one
+   the machine runs. Returns FALSE, leaving the previous slot selected, if a
+   state could not be saved or restored. */
+int LIBATARI800_Slot_Select(libatari800_slot_t *slot);
+libatari800_slot_t *LIBATARI800_Slot_Current(void);
+
+/* Without THREADS there is nothing to lock. */
+void LIBATARI800_Slot_Lock(void);
+void LIBATARI800_Slot_Unlock(void);
+
+#endif /* LIBATARI800_SLOT_H_ */
@@ -41,6 +41,9 @@ unsigned int sound_array_fill = 0;
 
 unsigned int sound_hw_buffer_size = 0;
 
+/* FALSE when the caller doesn't want audio, see libatari800_set_sound_enabled */
+int LIBATARI800_Sound_output = TRUE;
+
 /* difference between an integer sample rate and the floating point sample rate, used
    keep track of which frames need to drop a sample to stay at the constant audio
    sampling rate */
@@ -10,6 +10,8 @@ extern unsigned int sound_array_fill;
 
 extern unsigned int sound_hw_buffer_size;
 
+extern int LIBATARI800_Sound_output;
+
 extern double sample_residual;
 
 #endif /* LIBATARI800_SOUND_H_ */
@@ -31,16 +31,39 @@
 #include "libatari800/init.h"
 
 UBYTE *LIBATARI800_StateSav_buffer = NULL;
+ULONG LIBATARI800_StateSav_size = STATESAV_MAX_SIZE;
 statesav_tags_t *LIBATARI800_StateSav_tags = NULL;
 
 
-void LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags) {
-    LIBATARI800_StateSav_buffer = buffer;
-    LIBATARI800_StateSav_tags = tags;
-	StateSav_SaveAtariState(NULL, NULL, 0);
+int LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags) {
+	return LIBATARI800_StateSaveSized(buffer, STATESAV_MAX_SIZE, tags) > 0;
 }
 
-void LIBATARI800_StateLoad(UBYTE *buffer) {
-    LIBATARI800_StateSav_buffer = buffer;
-	StateSav_ReadAtariState(NULL, NULL);
+int LIBATARI800_StateLoad(UBYTE *buffer) {
+	return LIBATARI800_StateLoadSized(buffer, STATESAV_MAX_SIZE);
+}
+
+ULONG LIBATARI800_StateSaveSized(UBYTE *buffer, ULONG size, statesav_tags_t *tags) {
+	statesav_tags_t ignored_tags;
+	int ok;
+
+	if (buffer == NULL)
+		size = 0xffffffff;
+	LIBATARI800_StateSav_buffer = buffer;
+	LIBATARI800_StateSav_size = size;
+	LIBATARI800_StateSav_tags = tags != NULL ? tags : &ignored_tags;
+	ok = StateSav_SaveAtariState(NULL, NULL, 0);
+	if (!ok)
+		LIBATARI800_StateSav_tags->size = 0;
+	LIBATARI800_StateSav_tags = NULL;
+	return ok ? StateSav_Tell() : 0;
+}
+
+int LIBATARI800_StateLoadSized(const UBYTE *buffer, ULONG size) {
+	if (buffer == NULL)
+		return FALSE;
+	/* Only read from. */
+	LIBATARI800_StateSav_buffer = (UBYTE *) buffer;
+	LIBATARI800_StateSav_size = size;
+	return StateSav_ReadAtariState(NULL, NULL);
 }
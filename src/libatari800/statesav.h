@@ -10,9 +10,18 @@
 #include "libatari800/libatari800.h"
 
 extern UBYTE *LIBATARI800_StateSav_buffer;
+extern ULONG LIBATARI800_StateSav_size;
 extern statesav_tags_t *LIBATARI800_StateSav_tags;
 
-void LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags);
-void LIBATARI800_StateLoad(UBYTE *buffer);
+/* Save and load STATESAV_MAX_SIZE bytes at most; return FALSE on failure. */
+int LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags);
+int LIBATARI800_StateLoad(UBYTE *buffer);
+
+/* Saves the state into the SIZE bytes at BUFFER, or just measures it if
+   BUFFER is NULL. Returns the number of bytes of the state, 0 if it doesn't
+   fit. TAGS may be NULL. */
+ULONG LIBATARI800_StateSaveSized(UBYTE *buffer, ULONG size, statesav_tags_t *tags);
+/* Returns FALSE if the SIZE bytes at BUFFER don't hold a whole state. */
+int LIBATARI800_StateLoadSized(const UBYTE *buffer, ULONG size);
 
 #endif /* LIBATARI800_STATESAV_H_ */
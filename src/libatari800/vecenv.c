@@ -0,0 +1,590 @@
+/*
+ * libatari800/vecenv.c - Atari800 as a library - batch of emulators run in lockstep
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(HAVE_FORK) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_WAIT_H)
+#define VEC_PROCESSES
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
+#include "libatari800.h"
+#include "libatari800_vec.h"
+#include "workers.h"
+
+/* The emulator core keeps its state in global variables, so emulators in
+   one process cannot run at the same time; each worker process runs its
+   share of the batch instead, switching between its emulators with
+   libatari800_slot_select when it has more than one. */
+
+#ifdef VEC_PROCESSES
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* Commands sent to the workers, one byte each. */
+#define CMD_STEP 's'
+#define CMD_RESET 'r'
+
+/* Sections of the shared memory are aligned to cache lines, so that
+   workers do not write to the same line. */
+#define ALIGN(x) (((x) + 63) & ~(size_t) 63)
+
+typedef struct {
+	pid_t pid;
+	int command_fd;
+	int reply_fd;
+} worker_t;
+
+struct libatari800_vec {
+	int num_envs;
+	int num_workers;
+	int flags;
+	int num_watch;
+	UWORD *watch_addresses;
+	worker_t *workers;
+
+	/* Shared with the workers. */
+	UBYTE *shared;
+	size_t shared_size;
+	int *frames;
+	input_template_t *inputs;
+	UBYTE *resets;
+	int *errors;
+	UBYTE *screens;
+	UBYTE *memory;
+	UBYTE *watched;
+};
+
+/* Copies the observations of ENV from the selected emulator. */
+static void Observe(libatari800_vec_t *vec, int env)
+{
+	UBYTE *mem = libatari800_get_main_memory_ptr();
+	int i;
+	if (vec->flags & LIBATARI800_VEC_SCREEN)
+		memcpy(vec->screens + (size_t) env * LIBATARI800_VEC_SCREEN_SIZE,
+		       libatari800_get_screen_ptr(), LIBATARI800_VEC_SCREEN_SIZE);
+	if (vec->flags & LIBATARI800_VEC_MEMORY)
+		memcpy(vec->memory + (size_t) env * LIBATARI800_VEC_MEMORY_SIZE,
+		       mem, LIBATARI800_VEC_MEMORY_SIZE);
+	for (i = 0; i < vec->num_watch; i++)
+		vec->watched[env * vec->num_watch + i] = mem[vec->watch_addresses[i]];
+}
+
+/* Main loop of worker WORKER, which runs envs WORKER, WORKER+num_workers,
+   and so on. Never returns. */
+static void Worker(libatari800_vec_t *vec, int worker, int argc, char **argv)
+{
+	int command_fd = vec->workers[worker].command_fd;
+	int reply_fd = vec->workers[worker].reply_fd;
+	int num_mine = (vec->num_envs - worker + vec->num_workers - 1) / vec->num_workers;
+	libatari800_slot_t **slots;
+	/* The state each env is reset to, sized for the machine. */
+	UBYTE *initial = NULL;
+	ULONG initial_size = 0;
+	statesav_flags_t initial_flags;
+	UBYTE status = FALSE;
+	char command;
+	char reply;
+	int run_flags = LIBATARI800_RUN_SAME_INPUT;
+	int i;
+
+	if (vec->flags & LIBATARI800_VEC_SKIP_DRAWING)
+		run_flags |= LIBATARI800_RUN_SKIP_DRAWING;
+
+	slots = (libatari800_slot_t **) malloc(num_mine * sizeof(libatari800_slot_t *));
+	if (slots != NULL && libatari800_init(argc, argv)) {
+		initial_size = libatari800_state_size();
+		initial = (UBYTE *) malloc(initial_size);
+	}
+	if (initial != NULL && libatari800_save_state_buffer(initial, initial_size, NULL, &initial_flags) > 0) {
+		/* The first env runs on the default slot, the others start as
+		   copies of it. */
+		status = TRUE;
+		slots[0] = NULL;
+		for (i = 1; i < num_mine && status; i++)
+			status = (slots[i] = libatari800_slot_new()) != NULL;
+		for (i = 0; i < num_mine && status; i++) {
+			status = libatari800_slot_select(slots[i]);
+			Observe(vec, worker + i * vec->num_workers);
+		}
+	}
+	if (write(reply_fd, &status, 1) != 1 || !status)
+		_exit(1);
+
+	/* Runs until the command pipe is closed. */
+	while (read(command_fd, &command, 1) == 1) {
+		/* The command is echoed if it worked for all envs. */
+		reply = command;
+		for (i = 0; i < num_mine; i++) {
+			int env = worker + i * vec->num_workers;
+			if (!libatari800_slot_select(slots[i])) {
+				/* The env can't run; the others go on. */
+				vec->errors[env] = LIBATARI800_STATE_ERROR;
+				reply = 0;
+				continue;
+			}
+			if (command == CMD_STEP) {
+				int frames = *vec->frames;
+				if (libatari800_run_frames(frames, &vec->inputs[env], run_flags, NULL) < frames)
+					vec->errors[env] = libatari800_error_code;
+				else
+					vec->errors[env] = 0;
+			}
+			else if (vec->resets[env]) {
+				if (libatari800_restore_state_buffer(initial, initial_size, &initial_flags))
+					vec->errors[env] = 0;
+				else {
+					vec->errors[env] = LIBATARI800_STATE_ERROR;
+					reply = 0;
+				}
+			}
+			else
+				continue;
+			Observe(vec, env);
+		}
+		if (write(reply_fd, &reply, 1) != 1)
+			break;
+	}
+	_exit(0);
+}
+
+/* Writes COMMAND to FD. If the worker reading it has stopped, fails with
+   EPIPE instead of raising SIGPIPE, which would end the calling process. */
+static int WriteCommand(int fd, char command)
+{
+	sigset_t pipe_set;
+	sigset_t old_set;
+	sigset_t pending;
+	int was_pending;
+	int result;
+
+	sigemptyset(&pipe_set);
+	sigaddset(&pipe_set, SIGPIPE);
+	sigprocmask(SIG_BLOCK, &pipe_set, &old_set);
+	sigpending(&pending);
+	was_pending = sigismember(&pending, SIGPIPE);
+	result = write(fd, &command, 1) == 1;
+	if (!result && errno == EPIPE && !was_pending) {
+		/* Drop the SIGPIPE raised by the write, so that it is not
+		   delivered once unblocked. */
+		int sig;
+		sigpending(&pending);
+		if (sigismember(&pending, SIGPIPE))
+			sigwait(&pipe_set, &sig);
+	}
+	sigprocmask(SIG_SETMASK, &old_set, NULL);
+	return result;
+}
+
+/* Sets the error code of the envs of WORKER, which has stopped. */
+static void WorkerStopped(libatari800_vec_t *vec, int worker)
+{
+	int env;
+	for (env = worker; env < vec->num_envs; env += vec->num_workers)
+		vec->errors[env] = LIBATARI800_WORKER_ERROR;
+}
+
+/* Sends COMMAND to all workers and waits until they are done. */
+static int Command(libatari800_vec_t *vec, char command)
+{
+	int result = TRUE;
+	char reply;
+	int i;
+	for (i = 0; i < vec->num_workers; i++)
+		if (!WriteCommand(vec->workers[i].command_fd, command))
+			result = FALSE;
+	/* A stopped worker closed its reply pipe, so reading it fails too. */
+	for (i = 0; i < vec->num_workers; i++) {
+		if (read(vec->workers[i].reply_fd, &reply, 1) != 1) {
+			WorkerStopped(vec, i);
+			result = FALSE;
+		}
+		else if (reply != command)
+			result = FALSE;
+	}
+	return result;
+}
+
+/* Stops the first NUM workers. */
+static void StopWorkers(libatari800_vec_t *vec, int num)
+{
+	int i;
+	for (i = 0; i < num; i++) {
+		close(vec->workers[i].command_fd);
+		close(vec->workers[i].reply_fd);
+	}
+	for (i = 0; i < num; i++)
+		waitpid(vec->workers[i].pid, NULL, 0);
+}
+
+#endif /* VEC_PROCESSES */
+
+
+/** Create a batch of emulators
+ *
+ * Starts \a num_envs emulators, all initialized with the command line
+ * arguments \a argc and \a argv as for \a libatari800_init, and spread over
+ * \a num_workers worker processes (or one per CPU core if 0 or less) that
+ * step them in parallel. The calling process does not run an emulator, and
+ * may use libatari800 by itself.
+ *
+ * Observations are stored after each step or reset in batch buffers holding
+ * one entry per emulator, one after the other:
+ *
+ *   - with \a LIBATARI800_VEC_SCREEN, the 384x240 byte screen, see
+ *     \a libatari800_vec_screens
+ *   - with \a LIBATARI800_VEC_MEMORY, the 64k of main memory, see
+ *     \a libatari800_vec_memory
+ *   - the \a num_watch bytes of main memory at \a watch_addresses, e.g. the
+ *     score, see \a libatari800_vec_watched
+ *
+ * With \a LIBATARI800_VEC_SKIP_DRAWING, a step draws only the screen of its
+ * last frame. This is faster, but collisions are then not detected in the
+ * other frames unless ACCURATE_SKIPPED_FRAMES is on, so the emulators may
+ * differ from ones stepped a frame at a time.
+ *
+ * Only available where the worker processes can be forked; returns NULL
+ * otherwise.
+ *
+ * @param num_envs number of emulators
+ * @param num_workers number of worker processes
+ * @param argc number of arguments in \a argv
+ * @param argv command line arguments, as for \a libatari800_init
+ * @param flags combination of the \a LIBATARI800_VEC_* flags
+ * @param watch_addresses array of \a num_watch main memory addresses
+ * @param num_watch number of addresses in \a watch_addresses
+ *
+ * @returns pointer to the batch, or NULL if it could not be started
+ */
+libatari800_vec_t *libatari800_vec_new(int num_envs, int num_workers, int argc, char **argv, int flags, const UWORD *watch_addresses, int num_watch)
+{
+#ifdef VEC_PROCESSES
+	libatari800_vec_t *vec;
+	size_t offset;
+	size_t inputs_offset, resets_offset, errors_offset, screens_offset, memory_offset, watched_offset;
+	int i;
+
+	if (num_envs <= 0 || num_watch < 0)
+		return NULL;
+	if (num_workers <= 0)
+		num_workers = Workers_NumCPUs();
+	if (num_workers > num_envs)
+		num_workers = num_envs;
+
+	vec = (libatari800_vec_t *) malloc(sizeof(libatari800_vec_t));
+	if (vec == NULL)
+		return NULL;
+	memset(vec, 0, sizeof(libatari800_vec_t));
+	vec->num_envs = num_envs;
+	vec->num_workers = num_workers;
+	vec->flags = flags;
+	vec->num_watch = num_watch;
+	vec->watch_addresses = (UWORD *) malloc(num_watch * sizeof(UWORD) + 1);
+	vec->workers = (worker_t *) malloc(num_workers * sizeof(worker_t));
+	if (vec->watch_addresses == NULL || vec->workers == NULL) {
+		libatari800_vec_free(vec);
+		return NULL;
+	}
+	if (num_watch > 0)
+		memcpy(vec->watch_addresses, watch_addresses, num_watch * sizeof(UWORD));
+
+	offset = ALIGN(sizeof(int));
+	inputs_offset = offset;
+	offset = ALIGN(offset + num_envs * sizeof(input_template_t));
+	resets_offset = offset;
+	offset = ALIGN(offset + num_envs);
+	errors_offset = offset;
+	offset = ALIGN(offset + num_envs * sizeof(int));
+	screens_offset = offset;
+	if (flags & LIBATARI800_VEC_SCREEN)
+		offset = ALIGN(offset + (size_t) num_envs * LIBATARI800_VEC_SCREEN_SIZE);
+	memory_offset = offset;
+	if (flags & LIBATARI800_VEC_MEMORY)
+		offset = ALIGN(offset + (size_t) num_envs * LIBATARI800_VEC_MEMORY_SIZE);
+	watched_offset = offset;
+	offset += num_envs * num_watch;
+
+	vec->shared = (UBYTE *) mmap(NULL, offset, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (vec->shared == (UBYTE *) MAP_FAILED) {
+		vec->shared = NULL;
+		libatari800_vec_free(vec);
+		return NULL;
+	}
+	vec->shared_size = offset;
+	vec->frames = (int *) vec->shared;
+	vec->inputs = (input_template_t *) (vec->shared + inputs_offset);
+	vec->resets = vec->shared + resets_offset;
+	vec->errors = (int *) (vec->shared + errors_offset);
+	vec->screens = vec->shared + screens_offset;
+	vec->memory = vec->shared + memory_offset;
+	vec->watched = vec->shared + watched_offset;
+	for (i = 0; i < num_envs; i++)
+		libatari800_clear_input_array(&vec->inputs[i]);
+
+	for (i = 0; i < num_workers; i++) {
+		int command_pipe[2];
+		int reply_pipe[2];
+		UBYTE status;
+		if (pipe(command_pipe) != 0)
+			break;
+		if (pipe(reply_pipe) != 0) {
+			close(command_pipe[0]);
+			close(command_pipe[1]);
+			break;
+		}
+		vec->workers[i].pid = fork();
+		if (vec->workers[i].pid == 0) {
+			int j;
+			/* Keep only this worker's ends of its own pipes. */
+			for (j = 0; j < i; j++) {
+				close(vec->workers[j].command_fd);
+				close(vec->workers[j].reply_fd);
+			}
+			close(command_pipe[1]);
+			close(reply_pipe[0]);
+			vec->workers[i].command_fd = command_pipe[0];
+			vec->workers[i].reply_fd = reply_pipe[1];
+			Worker(vec, i, argc, argv);
+		}
+		close(command_pipe[0]);
+		close(reply_pipe[1]);
+		vec->workers[i].command_fd = command_pipe[1];
+		vec->workers[i].reply_fd = reply_pipe[0];
+		if (vec->workers[i].pid < 0) {
+			close(command_pipe[1]);
+			close(reply_pipe[0]);
+			break;
+		}
+		/* Start the workers one by one, so that a failure stops early. */
+		if (read(vec->workers[i].reply_fd, &status, 1) != 1 || !status) {
+			i++;
+			StopWorkers(vec, i);
+			vec->num_workers = 0;
+			libatari800_vec_free(vec);
+			return NULL;
+		}
+	}
+	if (i < num_workers) {
+		StopWorkers(vec, i);
+		vec->num_workers = 0;
+		libatari800_vec_free(vec);
+		return NULL;
+	}
+	return vec;
+#else
+	return NULL;
+#endif /* VEC_PROCESSES */
+}
+
+
+/** Stop the emulators and free the batch
+ *
+ * @param vec batch returned by \a libatari800_vec_new
+ */
+void libatari800_vec_free(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	if (vec == NULL)
+		return;
+	StopWorkers(vec, vec->num_workers);
+	if (vec->shared != NULL)
+		munmap(vec->shared, vec->shared_size);
+	free(vec->watch_addresses);
+	free(vec->workers);
+	free(vec);
+#endif /* VEC_PROCESSES */
+}
+
+
+/** Return the number of emulators in the batch
+ */
+int libatari800_vec_num_envs(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->num_envs;
+#else
+	return 0;
+#endif
+}
+
+
+/** Return the number of worker processes running the batch
+ */
+int libatari800_vec_num_workers(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->num_workers;
+#else
+	return 0;
+#endif
+}
+
+
+/** Return the input batch buffer
+ *
+ * The buffer holds an \a input_template_t for each emulator, used for all
+ * frames of the next \a libatari800_vec_step. The inputs are kept between
+ * steps.
+ *
+ * @returns pointer to the input template of the first emulator
+ */
+input_template_t *libatari800_vec_inputs(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->inputs;
+#else
+	return NULL;
+#endif
+}
+
+
+/** Return the reset mask
+ *
+ * The mask holds a byte for each emulator, nonzero to have
+ * \a libatari800_vec_reset reset it.
+ */
+UBYTE *libatari800_vec_resets(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->resets;
+#else
+	return NULL;
+#endif
+}
+
+
+/** Emulate frames on all emulators of the batch
+ *
+ * Runs \a frames frames on every emulator with its input from
+ * \a libatari800_vec_inputs, as \a libatari800_run_frames does (skipping
+ * drawing if the batch was created with \a LIBATARI800_VEC_SKIP_DRAWING),
+ * and then stores the observations. An
+ * emulator that stops with an error has the error code in
+ * \a libatari800_vec_errors. The emulators of a worker process that has
+ * stopped get the error code \a LIBATARI800_WORKER_ERROR.
+ *
+ * @param vec batch returned by \a libatari800_vec_new
+ * @param frames number of frames to run
+ *
+ * @retval FALSE if a worker process did not respond
+ * @retval TRUE if successful
+ */
+int libatari800_vec_step(libatari800_vec_t *vec, int frames)
+{
+#ifdef VEC_PROCESSES
+	*vec->frames = frames;
+	return Command(vec, CMD_STEP);
+#else
+	return FALSE;
+#endif
+}
+
+
+/** Reset emulators of the batch
+ *
+ * Returns each emulator selected in \a libatari800_vec_resets to its state
+ * right after start-up, clears its error code and stores its
+ * observations, except the screen which keeps the last frame emulated. An
+ * emulator whose state could not be restored gets the error code
+ * \a LIBATARI800_STATE_ERROR instead, and the emulators of a worker
+ * process that has stopped \a LIBATARI800_WORKER_ERROR.
+ *
+ * @param vec batch returned by \a libatari800_vec_new
+ *
+ * @retval FALSE if a worker process did not respond or an emulator could
+ * not be reset
+ * @retval TRUE if successful
+ */
+int libatari800_vec_reset(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return Command(vec, CMD_RESET);
+#else
+	return FALSE;
+#endif
+}
+
+
+/** Return the error codes of the last step or reset, one int per emulator
+ */
+const int *libatari800_vec_errors(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->errors;
+#else
+	return NULL;
+#endif
+}
+
+
+/** Return the screen batch buffer
+ *
+ * Holds the screen of each emulator, 384x240 bytes each as described for
+ * \a libatari800_get_screen_ptr. Only with \a LIBATARI800_VEC_SCREEN.
+ */
+const UBYTE *libatari800_vec_screens(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->flags & LIBATARI800_VEC_SCREEN ? vec->screens : NULL;
+#else
+	return NULL;
+#endif
+}
+
+
+/** Return the main memory batch buffer
+ *
+ * Holds the 64k of main memory of each emulator. Only with
+ * \a LIBATARI800_VEC_MEMORY.
+ */
+const UBYTE *libatari800_vec_memory(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->flags & LIBATARI800_VEC_MEMORY ? vec->memory : NULL;
+#else
+	return NULL;
+#endif
+}
+
+
+/** Return the watched bytes batch buffer
+ *
+ * Holds for each emulator the bytes at the addresses given to
+ * \a libatari800_vec_new, in the same order.
+ */
+const UBYTE *libatari800_vec_watched(libatari800_vec_t *vec)
+{
+#ifdef VEC_PROCESSES
+	return vec->watched;
+#else
+	return NULL;
+#endif
+}
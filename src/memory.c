@@ -46,6 +46,10 @@
 
 UBYTE MEMORY_mem[65536 + 2];
 
+ULONG MEMORY_page_written[256];
+ULONG MEMORY_write_generation = 1;
+ULONG MEMORY_write_epoch = 0;
+
 int MEMORY_ram_size = 64;
 
 #ifndef PAGED_ATTRIB
@@ -125,6 +129,7 @@ static void alloc_axlon_memory(void){
 			axlon_ram = (UBYTE *)Util_realloc(axlon_ram, size);
 		}
 		memset(axlon_ram, 0, size);
+		MEMORY_MarkBankWritten(MEMORY_REGION_AXLON);
 	} else {
 		if (axlon_ram != NULL) {
 			free(axlon_ram);
@@ -142,6 +147,7 @@ static void alloc_mosaic_memory(void){
 			mosaic_ram = (UBYTE *)Util_realloc(mosaic_ram, size);
 		}
 		memset(mosaic_ram, 0, size);
+		MEMORY_MarkBankWritten(MEMORY_REGION_MOSAIC);
 	} else {
 		if (mosaic_ram != NULL) {
 			free(mosaic_ram);
@@ -163,6 +169,7 @@ static void AllocXEMemory(void)
 			atarixe_memory = (UBYTE *) Util_malloc(size);
 			atarixe_memory_size = size;
 			memset(atarixe_memory, 0, size);
+			MEMORY_MarkBankWritten(MEMORY_REGION_XE);
 		}
 	}
 	/* atarixe_memory not needed, free it */
@@ -208,7 +215,7 @@ void MEMORY_InitialiseMachine(void)
 		if (GTIA_GRACTL & 4)
 			GTIA_TRIG_latch[3] = 0;
 	}
-	memcpy(MEMORY_mem + os_rom_start, MEMORY_os, os_size);
+	MEMORY_dCopyToMem(MEMORY_os, os_rom_start, os_size);
 	switch (Atari800_machine_type) {
 	case Atari800_MACHINE_5200:
 		MEMORY_dFillMem(0x0000, 0x00, 0xf800);
@@ -346,6 +353,7 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 
 	/* Axlon/Mosaic for 400/800 */
 	if (Atari800_machine_type == Atari800_MACHINE_800) {
+		StateSav_BeginSection("EXTMEM");
 		StateSav_SaveINT(&MEMORY_axlon_num_banks, 1);
 		if (MEMORY_axlon_num_banks > 0){
 			StateSav_SaveINT(&axlon_curbank, 1);
@@ -357,13 +365,17 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 			StateSav_SaveINT(&mosaic_curbank, 1);
 			StateSav_SaveUBYTE(mosaic_ram, mosaic_current_num_banks * 0x1000);
 		}
+		StateSav_BeginSection("MEMORY");
 	}
 
 	/* Save amount of base RAM in kilobytes. */
 	temp = MEMORY_ram_size > 64 ? 64 : MEMORY_ram_size;
 	StateSav_SaveINT(&temp, 1);
 	STATESAV_TAG(base_ram);
-	StateSav_SaveUBYTE(&MEMORY_mem[0], 65536);
+	if (StateSav_SnapshotPages() != NULL)
+		MEMORY_SavePages(StateSav_SnapshotPages());
+	else
+		StateSav_SaveUBYTE(&MEMORY_mem[0], 65536);
 	STATESAV_TAG(base_ram_attrib);
 #ifndef PAGED_ATTRIB
 	StateSav_SaveUBYTE(&MEMORY_attrib[0], 65536);
@@ -423,7 +435,9 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 	StateSav_SaveINT(&MEMORY_cartA0BF_enabled, 1);
 
 	if (MEMORY_ram_size > 64) {
+		StateSav_BeginSection("EXTMEM");
 		StateSav_SaveUBYTE(&atarixe_memory[0], atarixe_memory_size);
+		StateSav_BeginSection("MEMORY");
 		if (ANTIC_xe_ptr != NULL && MEMORY_selftest_enabled)
 			StateSav_SaveUBYTE(antic_bank_under_selftest, 0x800);
 	}
@@ -445,6 +459,7 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 
 	/* Axlon/Mosaic for 400/800 */
 	if (Atari800_machine_type == Atari800_MACHINE_800 && StateVersion >= 5) {
+		StateSav_BeginSection("EXTMEM");
 		StateSav_ReadINT(&MEMORY_axlon_num_banks, 1);
 		if (MEMORY_axlon_num_banks > 0){
 			StateSav_ReadINT(&axlon_curbank, 1);
@@ -461,6 +476,7 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 			}
 			alloc_axlon_memory();
 			StateSav_ReadUBYTE(axlon_ram, MEMORY_axlon_num_banks * 0x4000);
+			MEMORY_MarkBankWritten(MEMORY_REGION_AXLON);
 		}
 		StateSav_ReadINT(&MEMORY_mosaic_num_banks, 1);
 		if (MEMORY_mosaic_num_banks > 0) {
@@ -474,13 +490,20 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 			}
 			alloc_mosaic_memory();
 			StateSav_ReadUBYTE(mosaic_ram, mosaic_current_num_banks * 0x1000);
+			MEMORY_MarkBankWritten(MEMORY_REGION_MOSAIC);
 		}
+		StateSav_BeginSection("MEMORY");
 	}
 
 	if (StateVersion >= 7)
 		/* Read amount of base RAM in kilobytes. */
 		StateSav_ReadINT(&base_ram_kb, 1);
-	StateSav_ReadUBYTE(&MEMORY_mem[0], 65536);
+	if (StateSav_SnapshotPages() != NULL)
+		MEMORY_RestorePages(StateSav_SnapshotPages());
+	else {
+		StateSav_ReadUBYTE(&MEMORY_mem[0], 65536);
+		MEMORY_MarkWritten(0, 65536);
+	}
 #ifndef PAGED_ATTRIB
 	StateSav_ReadUBYTE(&MEMORY_attrib[0], 65536);
 #else
@@ -645,7 +668,10 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 	ANTIC_xe_ptr = NULL;
 	AllocXEMemory();
 	if (MEMORY_ram_size > 64) {
+		StateSav_BeginSection("EXTMEM");
 		StateSav_ReadUBYTE(&atarixe_memory[0], atarixe_memory_size);
+		MEMORY_MarkBankWritten(MEMORY_REGION_XE);
+		StateSav_BeginSection("MEMORY");
 		/* a hack that makes state files compatible with previous versions:
 		   for 130 XE there's written 192 KB of unused data */
 		if (MEMORY_ram_size == 128 && StateVersion <= 6) {
@@ -694,6 +720,266 @@ void MEMORY_CopyFromMem(UWORD from, UBYTE *to, int size)
 	}
 }
 
+void MEMORY_MarkWritten(int addr, int size)
+{
+	int page = addr >> 8;
+	int last = (addr + size - 1) >> 8;
+	/* Marking one page too many when SIZE is 0 does no harm. */
+	do
+		MEMORY_page_written[page & 0xff] = MEMORY_write_generation;
+	while (++page <= last);
+}
+
+static void RestartWriteGenerations(void);
+
+ULONG MEMORY_NewWriteGeneration(void)
+{
+	if (MEMORY_write_generation == (ULONG) -1)
+		RestartWriteGenerations();
+	return MEMORY_write_generation++;
+}
+
+struct MEMORY_shared_page_t {
+	int refs;
+	UBYTE data[256];
+};
+
+static void ReleasePage(MEMORY_shared_page_t *page)
+{
+	if (page != NULL && --page->refs == 0)
+		free(page);
+}
+
+void MEMORY_SavePages(MEMORY_pages_t *pages)
+{
+	int current = pages->epoch == MEMORY_write_epoch;
+	int i;
+	for (i = 0; i < 256; i++) {
+		MEMORY_shared_page_t *page = pages->page[i];
+		if (page != NULL && current && MEMORY_page_written[i] <= pages->generation)
+			continue;
+		if (page == NULL || page->refs > 1) {
+			/* Copy on write: other copies keep the old page. */
+			ReleasePage(page);
+			page = (MEMORY_shared_page_t *) Util_malloc(sizeof(MEMORY_shared_page_t));
+			page->refs = 1;
+			pages->page[i] = page;
+		}
+		memcpy(page->data, MEMORY_mem + (i << 8), 256);
+	}
+	pages->generation = MEMORY_NewWriteGeneration();
+	pages->epoch = MEMORY_write_epoch;
+}
+
+void MEMORY_RestorePages(MEMORY_pages_t *pages)
+{
+	int current = pages->epoch == MEMORY_write_epoch;
+	int i;
+	for (i = 0; i < 256; i++) {
+		if (pages->page[i] == NULL || (current && MEMORY_page_written[i] <= pages->generation))
+			continue;
+		memcpy(MEMORY_mem + (i << 8), pages->page[i]->data, 256);
+		MEMORY_page_written[i] = MEMORY_write_generation;
+	}
+	pages->generation = MEMORY_NewWriteGeneration();
+	pages->epoch = MEMORY_write_epoch;
+}
+
+void MEMORY_SharePages(MEMORY_pages_t *dest, MEMORY_pages_t const *src)
+{
+	int i;
+	for (i = 0; i < 256; i++) {
+		if (src->page[i] != NULL)
+			src->page[i]->refs++;
+		ReleasePage(dest->page[i]);
+		dest->page[i] = src->page[i];
+	}
+	dest->generation = src->generation;
+	dest->epoch = src->epoch;
+}
+
+void MEMORY_FreePages(MEMORY_pages_t *pages)
+{
+	int i;
+	for (i = 0; i < 256; i++) {
+		ReleasePage(pages->page[i]);
+		pages->page[i] = NULL;
+	}
+	pages->generation = 0;
+	pages->epoch = 0;
+}
+
+int MEMORY_track_banks = FALSE;
+
+/* The generations of the pages of each bank region, kept for its memory
+   at BASE of PAGES pages; when the memory moves or is resized, all of it
+   counts as written. */
+static struct {
+	UBYTE const *base;
+	int pages;
+	ULONG *page_written;
+} banks[MEMORY_REGIONS];
+
+static UBYTE *RegionMemory(int region, int *pages)
+{
+	UBYTE *base = NULL;
+	int size = 0;
+	switch (region) {
+	case MEMORY_REGION_MAIN:
+		base = MEMORY_mem;
+		size = 0x10000;
+		break;
+	case MEMORY_REGION_XE:
+		base = atarixe_memory;
+		size = atarixe_memory_size;
+		break;
+	case MEMORY_REGION_AXLON:
+		base = axlon_ram;
+		size = axlon_ram == NULL ? 0 : MEMORY_axlon_num_banks * 0x4000;
+		break;
+	case MEMORY_REGION_MOSAIC:
+		base = mosaic_ram;
+		size = mosaic_current_num_banks * 0x1000;
+		break;
+	case MEMORY_REGION_CART:
+		base = CARTRIDGE_main.image;
+		size = base == NULL ? 0 : CARTRIDGE_main.size << 10;
+		break;
+	case MEMORY_REGION_PIGGYBACK:
+		base = CARTRIDGE_piggyback.image;
+		size = base == NULL ? 0 : CARTRIDGE_piggyback.size << 10;
+		break;
+	}
+	*pages = (size + 0xff) >> 8;
+	return *pages == 0 ? NULL : base;
+}
+
+/* Returns the generations of the pages of bank REGION, NULL if it has no
+   memory. */
+static ULONG *BankPageWritten(int region)
+{
+	int pages;
+	UBYTE const *base = RegionMemory(region, &pages);
+	if (base != banks[region].base || pages != banks[region].pages) {
+		int i;
+		banks[region].base = base;
+		banks[region].pages = pages;
+		free(banks[region].page_written);
+		banks[region].page_written = NULL;
+		if (pages > 0) {
+			banks[region].page_written = (ULONG *) Util_malloc(pages * sizeof(ULONG));
+			for (i = 0; i < pages; i++)
+				banks[region].page_written[i] = MEMORY_write_generation;
+		}
+	}
+	return banks[region].page_written;
+}
+
+/* Sets all pages to generation 0 and the counter to 1, so that it does not
+   wrap. Generations given out before are then from an earlier epoch. */
+static void RestartWriteGenerations(void)
+{
+	int region;
+	memset(MEMORY_page_written, 0, sizeof(MEMORY_page_written));
+	for (region = MEMORY_REGION_MAIN + 1; region < MEMORY_REGIONS; region++) {
+		if (banks[region].page_written != NULL)
+			memset(banks[region].page_written, 0, banks[region].pages * sizeof(ULONG));
+	}
+	MEMORY_write_generation = 1;
+	MEMORY_write_epoch++;
+}
+
+void MEMORY_TrackBanks(int enable)
+{
+	int region;
+	/* What changed while not tracking is unknown, so start over. */
+	for (region = MEMORY_REGION_MAIN + 1; region < MEMORY_REGIONS; region++) {
+		free(banks[region].page_written);
+		banks[region].page_written = NULL;
+		banks[region].base = NULL;
+		banks[region].pages = 0;
+		if (enable)
+			BankPageWritten(region);
+	}
+	MEMORY_track_banks = enable;
+}
+
+int MEMORY_RegionPages(int region)
+{
+	int pages;
+	RegionMemory(region, &pages);
+	return pages;
+}
+
+int MEMORY_GetWrittenPages(int region, ULONG generation, UBYTE *flags)
+{
+	ULONG const *written;
+	int pages;
+	int count = 0;
+	int i;
+	if (region == MEMORY_REGION_MAIN) {
+		written = MEMORY_page_written;
+		pages = 256;
+	}
+	else {
+		if (!MEMORY_track_banks)
+			return -1;
+		written = BankPageWritten(region);
+		pages = banks[region].pages;
+	}
+	for (i = 0; i < pages; i++) {
+		flags[i] = written[i] > generation || generation >= MEMORY_write_generation;
+		count += flags[i];
+	}
+	return count;
+}
+
+void MEMORY_CopyToBank(int region, UBYTE *dest, UBYTE const *src, int size)
+{
+	ULONG *written;
+	int offset;
+	int i;
+	if (!MEMORY_track_banks) {
+		memcpy(dest, src, size);
+		return;
+	}
+	written = BankPageWritten(region);
+	offset = dest - banks[region].base;
+	/* Only the pages that differ are copied and marked, so that a bank
+	   switched in and out again unchanged stays unwritten. */
+	for (i = 0; i < size; ) {
+		int page = (offset + i) >> 8;
+		int len = ((page + 1) << 8) - (offset + i);
+		if (len > size - i)
+			len = size - i;
+		if (memcmp(dest + i, src + i, len) != 0) {
+			memcpy(dest + i, src + i, len);
+			written[page] = MEMORY_write_generation;
+		}
+		i += len;
+	}
+}
+
+void MEMORY_MarkBankWritten(int region)
+{
+	ULONG *written;
+	int i;
+	if (!MEMORY_track_banks)
+		return;
+	written = BankPageWritten(region);
+	for (i = 0; i < banks[region].pages; i++)
+		written[i] = MEMORY_write_generation;
+}
+
+void MEMORY_CopyToCart(int addr1, int addr2, UBYTE *dst)
+{
+	int region = MEMORY_REGION_CART;
+	if (CARTRIDGE_piggyback.image != NULL && dst >= CARTRIDGE_piggyback.image
+	    && dst < CARTRIDGE_piggyback.image + (CARTRIDGE_piggyback.size << 10))
+		region = MEMORY_REGION_PIGGYBACK;
+	MEMORY_CopyToBank(region, dst, MEMORY_mem + addr1, addr2 - addr1 + 1);
+}
+
 void MEMORY_CopyToMem(const UBYTE *from, UWORD to, int size)
 {
 	while (--size >= 0) {
@@ -744,7 +1030,7 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 	if (mapram_selected && !new_mapram_selected) {
 		/* Restore RAM hidden by MapRAM. */
 		memcpy(mapram_memory, MEMORY_mem + 0x5000, 0x800);
-		memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+		MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
 	}
 
 	/* Switch XE memory bank in 0x4000-0x7fff */
@@ -785,16 +1071,16 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		        || antic_bank != new_antic_bank
 		        || (MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP && (byte & 0x20) == 0))) {
 			/* Disable Self Test ROM */
-			memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+			MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
 			if (ANTIC_xe_ptr != NULL)
 				/* Also disable Self Test from XE bank accessed by ANTIC. */
-				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+				MEMORY_CopyToBank(MEMORY_REGION_XE, atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
 			MEMORY_SetRAM(0x5000, 0x57ff);
 			MEMORY_selftest_enabled = FALSE;
 		}
 		if (cpu_bank != new_cpu_bank) {
-			memcpy(atarixe_memory + (cpu_bank << 14), MEMORY_mem + 0x4000, 0x4000);
-			memcpy(MEMORY_mem + 0x4000, atarixe_memory + (new_cpu_bank << 14), 0x4000);
+			MEMORY_CopyToBank(MEMORY_REGION_XE, atarixe_memory + (cpu_bank << 14), MEMORY_mem + 0x4000, 0x4000);
+			MEMORY_dCopyToMem(atarixe_memory + (new_cpu_bank << 14), 0x4000, 0x4000);
 		}
 
 		if (MEMORY_ram_size == 128 || MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP)
@@ -814,15 +1100,15 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 				MEMORY_SetROM(0xc000, 0xcfff);
 				MEMORY_SetROM(0xd800, 0xffff);
 			}
-			memcpy(MEMORY_mem + 0xc000, MEMORY_os, 0x1000);
-			memcpy(MEMORY_mem + 0xd800, MEMORY_os + 0x1800, 0x2800);
+			MEMORY_dCopyToMem(MEMORY_os, 0xc000, 0x1000);
+			MEMORY_dCopyToMem(MEMORY_os + 0x1800, 0xd800, 0x2800);
 			ESC_PatchOS();
 		}
 		else {
 			/* Disable OS ROM */
 			if (MEMORY_ram_size > 48) {
-				memcpy(MEMORY_mem + 0xc000, under_atarixl_os, 0x1000);
-				memcpy(MEMORY_mem + 0xd800, under_atarixl_os + 0x1800, 0x2800);
+				MEMORY_dCopyToMem(under_atarixl_os, 0xc000, 0x1000);
+				MEMORY_dCopyToMem(under_atarixl_os + 0x1800, 0xd800, 0x2800);
 				MEMORY_SetRAM(0xc000, 0xcfff);
 				MEMORY_SetRAM(0xd800, 0xffff);
 			} else {
@@ -832,10 +1118,10 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 			/* When OS ROM is disabled we also have to disable Self Test - Jindroush */
 			if (MEMORY_selftest_enabled) {
 				if (MEMORY_ram_size > 20) {
-					memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+					MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
 					if (ANTIC_xe_ptr != NULL)
 						/* Also disable Self Test from XE bank accessed by ANTIC. */
-						memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+						MEMORY_CopyToBank(MEMORY_REGION_XE, atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
 					MEMORY_SetRAM(0x5000, 0x57ff);
 				}
 				else
@@ -856,14 +1142,14 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 			}
 			if (builtin_cart_new == NULL) { /* switching RAM in */
 				if (MEMORY_ram_size > 40) {
-					memcpy(MEMORY_mem + 0xa000, under_cartA0BF, 0x2000);
+					MEMORY_dCopyToMem(under_cartA0BF, 0xa000, 0x2000);
 					MEMORY_SetRAM(0xa000, 0xbfff);
 				}
 				else
 					MEMORY_dFillMem(0xa000, 0xff, 0x2000);
 			}
 			else
-				memcpy(MEMORY_mem + 0xa000, builtin_cart_new, 0x2000);
+				MEMORY_dCopyToMem(builtin_cart_new, 0xa000, 0x2000);
 		}
 	}
 
@@ -872,10 +1158,10 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		if (MEMORY_selftest_enabled) {
 			/* Disable Self Test ROM */
 			if (MEMORY_ram_size > 20) {
-				memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+				MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
 				if (ANTIC_xe_ptr != NULL)
 					/* Also disable Self Test from XE bank accessed by ANTIC. */
-					memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+					MEMORY_CopyToBank(MEMORY_REGION_XE, atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
 				MEMORY_SetRAM(0x5000, 0x57ff);
 			}
 			else
@@ -898,16 +1184,16 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 					memcpy(antic_bank_under_selftest, atarixe_memory + (antic_bank << 14) + 0x1000, 0x800);
 				MEMORY_SetROM(0x5000, 0x57ff);
 			}
-			memcpy(MEMORY_mem + 0x5000, MEMORY_os + 0x1000, 0x800);
+			MEMORY_dCopyToMem(MEMORY_os + 0x1000, 0x5000, 0x800);
 			if (ANTIC_xe_ptr != NULL)
 				/* Also enable Self Test in the XE bank accessed by ANTIC. */
-				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, MEMORY_os + 0x1000, 0x800);
+				MEMORY_CopyToBank(MEMORY_REGION_XE, atarixe_memory + (antic_bank << 14) + 0x1000, MEMORY_os + 0x1000, 0x800);
 			MEMORY_selftest_enabled = TRUE;
 		}
 		else if (!mapram_selected && new_mapram_selected) {
 			/* Enable MapRAM */
 			memcpy(under_atarixl_os + 0x1000, MEMORY_mem + 0x5000, 0x800);
-			memcpy(MEMORY_mem + 0x5000, mapram_memory, 0x800);
+			MEMORY_dCopyToMem(mapram_memory, 0x5000, 0x800);
 		}
 	}
 }
@@ -931,19 +1217,19 @@ static void MosaicPutByte(UWORD addr, UBYTE byte)
 	if (newbank == mosaic_curbank || (newbank >= mosaic_current_num_banks && mosaic_curbank >= mosaic_current_num_banks)) return; /*same bank or rom -> rom*/
 	if (newbank >= mosaic_current_num_banks && mosaic_curbank < mosaic_current_num_banks) {
 		/*ram ->rom*/
-		memcpy(mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000,0x1000);
+		MEMORY_CopyToBank(MEMORY_REGION_MOSAIC, mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000,0x1000);
 		MEMORY_dFillMem(0xc000, 0xff, 0x1000);
 		MEMORY_SetROM(0xc000, 0xcfff);
 	}
 	else if (newbank < mosaic_current_num_banks && mosaic_curbank >= mosaic_current_num_banks) {
 		/*rom->ram*/
-		memcpy(MEMORY_mem + 0xc000, mosaic_ram+newbank*0x1000,0x1000);
+		MEMORY_dCopyToMem(mosaic_ram+newbank*0x1000, 0xc000, 0x1000);
 		MEMORY_SetRAM(0xc000, 0xcfff);
 	}
 	else {
 		/*ram -> ram*/
-		memcpy(mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000, 0x1000);
-		memcpy(MEMORY_mem + 0xc000, mosaic_ram + newbank*0x1000, 0x1000);
+		MEMORY_CopyToBank(MEMORY_REGION_MOSAIC, mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000, 0x1000);
+		MEMORY_dCopyToMem(mosaic_ram + newbank*0x1000, 0xc000, 0x1000);
 		MEMORY_SetRAM(0xc000, 0xcfff);
 	}
 	mosaic_curbank = newbank;
@@ -972,15 +1258,15 @@ static void AxlonPutByte(UWORD addr, UBYTE byte)
 {
 	int newbank;
 	/*Write-through to RAM if it is the page 0x0f shadow*/
-	if ((addr&0xff00) == 0x0f00) MEMORY_mem[addr] = byte;
+	if ((addr&0xff00) == 0x0f00) MEMORY_dPutByte(addr, byte);
 	if ((addr&0xff) < 0xc0) return; /*0xffc0-0xffff and 0x0fc0-0x0fff only*/
 #ifdef DEBUG
 	Log_print("AxlonPutByte:%4X:%2X", addr, byte);
 #endif
 	newbank = (byte&axlon_current_bankmask);
 	if (newbank == axlon_curbank) return;
-	memcpy(axlon_ram + axlon_curbank*0x4000, MEMORY_mem + 0x4000, 0x4000);
-	memcpy(MEMORY_mem + 0x4000, axlon_ram + newbank*0x4000, 0x4000);
+	MEMORY_CopyToBank(MEMORY_REGION_AXLON, axlon_ram + axlon_curbank*0x4000, MEMORY_mem + 0x4000, 0x4000);
+	MEMORY_dCopyToMem(axlon_ram + newbank*0x4000, 0x4000, 0x4000);
 	axlon_curbank = newbank;
 }
 
@@ -996,7 +1282,7 @@ void MEMORY_Cart809fDisable(void)
 {
 	if (cart809F_enabled) {
 		if (MEMORY_ram_size > 32) {
-			memcpy(MEMORY_mem + 0x8000, under_cart809F, 0x2000);
+			MEMORY_dCopyToMem(under_cart809F, 0x8000, 0x2000);
 			MEMORY_SetRAM(0x8000, 0x9fff);
 		}
 		else
@@ -1024,14 +1310,14 @@ void MEMORY_CartA0bfDisable(void)
 		UBYTE const *builtin = builtin_cart(PIA_PORTB | PIA_PORTB_mask);
 		if (builtin == NULL) { /* switch RAM in */
 			if (MEMORY_ram_size > 40) {
-				memcpy(MEMORY_mem + 0xa000, under_cartA0BF, 0x2000);
+				MEMORY_dCopyToMem(under_cartA0BF, 0xa000, 0x2000);
 				MEMORY_SetRAM(0xa000, 0xbfff);
 			}
 			else
 				MEMORY_dFillMem(0xa000, 0xff, 0x2000);
 		}
 		else
-			memcpy(MEMORY_mem + 0xa000, builtin, 0x2000);
+			MEMORY_dCopyToMem(builtin, 0xa000, 0x2000);
 		MEMORY_cartA0BF_enabled = FALSE;
 		if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
 			GTIA_TRIG[3] = 0;
@@ -6,18 +6,85 @@
 
 #include "atari.h"
 
+/* Write tracking: every write to MEMORY_mem stores MEMORY_write_generation
+   in MEMORY_page_written for the 256-byte page written to, so that a page
+   whose entry is greater than the generation seen at some point has been
+   written since. Code that writes to MEMORY_mem without the macros below
+   must call MEMORY_MarkWritten. The macros that write evaluate the address
+   more than once. */
+extern ULONG MEMORY_page_written[256];
+extern ULONG MEMORY_write_generation;
+#define MEMORY_MARK_WRITTEN(x)			(MEMORY_page_written[(x) >> 8] = MEMORY_write_generation)
+void MEMORY_MarkWritten(int addr, int size);
+/* Returns the current generation and starts a new one: pages written from
+   now on compare greater than the value returned. Before the counter
+   wraps, it starts over at 1 with all pages at 0 and MEMORY_write_epoch
+   is incremented; generations from an earlier epoch mean that all pages
+   may have changed. */
+ULONG MEMORY_NewWriteGeneration(void);
+extern ULONG MEMORY_write_epoch;
+
+/* A copy of MEMORY_mem kept in pages that copies share until they differ,
+   for in-memory snapshots. Initialise with zeros. */
+typedef struct MEMORY_shared_page_t MEMORY_shared_page_t;
+typedef struct MEMORY_pages_t {
+	MEMORY_shared_page_t *page[256];
+	/* MEMORY_mem held these pages at this write generation and epoch. */
+	ULONG generation;
+	ULONG epoch;
+} MEMORY_pages_t;
+
+/* Both copy only the pages written since PAGES were last saved or
+   restored. */
+void MEMORY_SavePages(MEMORY_pages_t *pages);
+void MEMORY_RestorePages(MEMORY_pages_t *pages);
+/* Makes DEST a copy of SRC, sharing all pages. */
+void MEMORY_SharePages(MEMORY_pages_t *dest, MEMORY_pages_t const *src);
+void MEMORY_FreePages(MEMORY_pages_t *pages);
+
+/* Write tracking of the memory banked into MEMORY_mem. Each 256-byte page
+   of a region gets the generation in which it last changed, as in
+   MEMORY_page_written. The bank mapped into MEMORY_mem at the moment lives
+   there, so writes to it count for MEMORY_REGION_MAIN until it is switched
+   out. Tracking the banks is off by default, as switching a bank out then
+   compares it with the old contents instead of just copying it. */
+#define MEMORY_REGION_MAIN       0	/* MEMORY_mem */
+#define MEMORY_REGION_XE         1	/* XL/XE extended RAM, with the saved base bank */
+#define MEMORY_REGION_AXLON      2
+#define MEMORY_REGION_MOSAIC     3
+#define MEMORY_REGION_CART       4	/* RAM of CARTRIDGE_main */
+#define MEMORY_REGION_PIGGYBACK  5	/* RAM of CARTRIDGE_piggyback */
+#define MEMORY_REGIONS           6
+extern int MEMORY_track_banks;
+void MEMORY_TrackBanks(int enable);
+/* Number of pages of REGION; 0 when the machine has no such memory. */
+int MEMORY_RegionPages(int region);
+/* Sets FLAGS[i] to TRUE for the pages of REGION written after GENERATION
+   and to FALSE for the others, and returns the number of pages written.
+   A GENERATION not yet given out is from before the counter started over,
+   so all pages count as written. Returns -1 for a bank region while bank
+   tracking is off. */
+int MEMORY_GetWrittenPages(int region, ULONG generation, UBYTE *flags);
+/* Copies SIZE bytes from SRC to DEST in the memory of REGION, marking the
+   pages it changes. */
+void MEMORY_CopyToBank(int region, UBYTE *dest, UBYTE const *src, int size);
+/* Marks all of REGION written, when its contents are replaced. */
+void MEMORY_MarkBankWritten(int region);
+
 #define MEMORY_dGetByte(x)				(MEMORY_mem[x])
-#define MEMORY_dPutByte(x, y)			(MEMORY_mem[x] = y)
+#define MEMORY_dPutByte(x, y)			(MEMORY_MARK_WRITTEN(x), MEMORY_mem[x] = y)
+/* Marks both pages a word at X is in. */
+#define MEMORY_MARK_WORD_WRITTEN(x)		(MEMORY_MARK_WRITTEN(x), MEMORY_page_written[(((x) + 1) >> 8) & 0xff] = MEMORY_write_generation)
 
 #ifndef WORDS_BIGENDIAN
 #ifdef WORDS_UNALIGNED_OK
 #define MEMORY_dGetWord(x)				UNALIGNED_GET_WORD(MEMORY_mem+(x), memory_read_word_stat)
-#define MEMORY_dPutWord(x, y)			UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_word_stat)
+#define MEMORY_dPutWord(x, y)			(MEMORY_MARK_WORD_WRITTEN(x), UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_word_stat))
 #define MEMORY_dGetWordAligned(x)		UNALIGNED_GET_WORD(MEMORY_mem+(x), memory_read_aligned_word_stat)
-#define MEMORY_dPutWordAligned(x, y)	UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_aligned_word_stat)
+#define MEMORY_dPutWordAligned(x, y)	(MEMORY_MARK_WRITTEN(x), UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_aligned_word_stat))
 #else	/* WORDS_UNALIGNED_OK */
 #define MEMORY_dGetWord(x)				(MEMORY_mem[x] + (MEMORY_mem[(x) + 1] << 8))
-#define MEMORY_dPutWord(x, y)			(MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
+#define MEMORY_dPutWord(x, y)			(MEMORY_MARK_WORD_WRITTEN(x), MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
 /* faster versions of MEMORY_jdGetWord and MEMORY_dPutWord for even addresses */
 /* TODO: guarantee that memory is UWORD-aligned and use UWORD access */
 #define MEMORY_dGetWordAligned(x)		MEMORY_dGetWord(x)
@@ -26,14 +93,14 @@
 #else	/* WORDS_BIGENDIAN */
 /* can't do any word optimizations for big endian machines */
 #define MEMORY_dGetWord(x)				(MEMORY_mem[x] + (MEMORY_mem[(x) + 1] << 8))
-#define MEMORY_dPutWord(x, y)			(MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
+#define MEMORY_dPutWord(x, y)			(MEMORY_MARK_WORD_WRITTEN(x), MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
 #define MEMORY_dGetWordAligned(x)		MEMORY_dGetWord(x)
 #define MEMORY_dPutWordAligned(x, y)	MEMORY_dPutWord(x, y)
 #endif	/* WORDS_BIGENDIAN */
 
 #define MEMORY_dCopyFromMem(from, to, size)	memcpy(to, MEMORY_mem + (from), size)
-#define MEMORY_dCopyToMem(from, to, size)		memcpy(MEMORY_mem + (to), from, size)
-#define MEMORY_dFillMem(addr1, value, length)	memset(MEMORY_mem + (addr1), value, length)
+#define MEMORY_dCopyToMem(from, to, size)		(memcpy(MEMORY_mem + (to), from, size), MEMORY_MarkWritten(to, size))
+#define MEMORY_dFillMem(addr1, value, length)	(memset(MEMORY_mem + (addr1), value, length), MEMORY_MarkWritten(addr1, length))
 
 extern UBYTE MEMORY_mem[65536 + 2];
 
@@ -58,7 +125,7 @@ extern UBYTE MEMORY_attrib[65536];
 #define MEMORY_GetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, FALSE) : MEMORY_mem[addr])
 /* Reads a byte from ADDR, but without any side effects. */
 #define MEMORY_SafeGetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) MEMORY_mem[addr] = byte; else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
+#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) MEMORY_dPutByte(addr, byte); else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
 #define MEMORY_SetRAM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_RAM, (addr2) - (addr1) + 1)
 #define MEMORY_SetROM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_ROM, (addr2) - (addr1) + 1)
 #define MEMORY_SetHARDWARE(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_HARDWARE, (addr2) - (addr1) + 1)
@@ -76,7 +143,7 @@ void MEMORY_ROM_PutByte(UWORD addr, UBYTE byte);
 #define MEMORY_GetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, FALSE) : MEMORY_mem[addr])
 /* Reads a byte from ADDR, but without any side effects. */
 #define MEMORY_SafeGetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : (MEMORY_mem[addr] = byte))
+#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : (MEMORY_dPutByte(addr, byte)))
 #define MEMORY_SetRAM(addr1, addr2) do { \
 		int i; \
 		for (i = (addr1) >> 8; i <= (addr2) >> 8; i++) { \
@@ -116,8 +183,8 @@ void MEMORY_Cart809fDisable(void);
 void MEMORY_Cart809fEnable(void);
 void MEMORY_CartA0bfDisable(void);
 void MEMORY_CartA0bfEnable(void);
-#define MEMORY_CopyFromCart(addr1, addr2, src) memcpy(MEMORY_mem + (addr1), src, (addr2) - (addr1) + 1)
-#define MEMORY_CopyToCart(addr1, addr2, dst) memcpy(dst, MEMORY_mem + (addr1), (addr2) - (addr1) + 1)
+#define MEMORY_CopyFromCart(addr1, addr2, src) MEMORY_dCopyToMem(src, addr1, (addr2) - (addr1) + 1)
+void MEMORY_CopyToCart(int addr1, int addr2, UBYTE *dst);
 void MEMORY_GetCharset(UBYTE *cs);
 
 /* Mosaic and Axlon 400/800 RAM extensions */
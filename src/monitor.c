@@ -2222,6 +2222,7 @@ static void monitor_read_from_file(UWORD *addr)
 						printf("Bad xex file\n");
 						break;
 					}
+					MEMORY_MarkWritten(*addr, nbytes);
 					printf("Read dos block: %04X-%04X, %04X bytes. \n",fromaddr,toaddr, nbytes);
 				}
 				fclose(f);
@@ -2245,6 +2246,7 @@ static void monitor_read_from_file(UWORD *addr)
 						/* read as many bytes as given or available */
 						if ((nbytes=fread(&MEMORY_mem[*addr], 1, nbytes, f)) == 0)
 							printf("Could not read bytes\n");
+						MEMORY_MarkWritten(*addr, nbytes);
 						fclose(f);
 					}
 					printf("Read %d bytes at %04X-%04X\n",nbytes,*addr,*addr+nbytes-1);
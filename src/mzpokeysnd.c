@@ -30,6 +30,7 @@
 #include "asap_internal.h"
 #else
 #include "atari.h"
+#include "workers.h"
 #endif
 #include "mzpokeysnd.h"
 #include "pokeysnd.h"
@@ -260,6 +261,10 @@ typedef struct stPokeyState
 
     int speaker;
 
+    /* Dither noise generator */
+
+    unsigned int dither_seed;
+
 } PokeyState;
 
 PokeyState pokey_states[NPOKEYS];
@@ -2280,105 +2285,177 @@ void mzpokeysnd_debugreset(UBYTE chip)
 
 #define MAX_SAMPLE 152
 
-static void mzpokeysnd_process_8(void* sndbuffer, int sndn)
+/* Dither noise in the range [-0.25, 0.25). Every chip has its own generator,
+   because the chips may be synthesised on different threads. */
+static double dither(PokeyState* ps)
+{
+    ps->dither_seed = ps->dither_seed * 1103515245 + 12345;
+    return ((ps->dither_seed >> 16) & 0x7fff) * (0.5 / 0x8000) - 0.25;
+}
+
+/* The chips do not depend on each other between register writes, so when
+   there are several of them (stereo), each one is synthesised as a separate
+   job on the worker pool, writing its own channel of the interleaved output.
+   Below this many CPU ticks the hand-off costs more than it saves. */
+#define PARALLEL_MIN_TICKS (114 * 16)
+
+typedef struct {
+    void *buffer;            /* first sample of the first chip */
+    unsigned int max_frames; /* room in buffer, in frames of num_cur_pokeys samples */
+    unsigned int num_ticks;  /* generate_sync only */
+    double samp_pos;         /* generate_sync only */
+    unsigned int frames;     /* out: frames produced */
+    double end_samp_pos;     /* out: new samp_pos */
+} SynthJob;
+
+static void run_chip_jobs(void (*func)(void *arg, int chip), SynthJob *job, unsigned int num_ticks)
 {
     int i;
-    int nsam = sndn;
-    UBYTE *buffer = (UBYTE *) sndbuffer;
+
+#ifndef ASAP
+    if (num_cur_pokeys > 1 && num_ticks >= PARALLEL_MIN_TICKS) {
+        Workers_Run(NULL, func, job, num_cur_pokeys);
+        return;
+    }
+#endif
+    for (i = 0; i < num_cur_pokeys; i++)
+        func(job, i);
+}
+
+static void process_chip_8(void *arg, int chip)
+{
+    SynthJob *job = (SynthJob *) arg;
+    PokeyState *ps = pokey_states + chip;
+    UBYTE *buffer = (UBYTE *) job->buffer + chip;
+    unsigned int n;
+
+    for (n = 0; n < job->max_frames; n++) {
+        *buffer = (UBYTE)floor(generate_sample(ps)
+         * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + dither(ps));
+        buffer += num_cur_pokeys;
+    }
+}
+
+static void process_chip_16(void *arg, int chip)
+{
+    SynthJob *job = (SynthJob *) arg;
+    PokeyState *ps = pokey_states + chip;
+    SWORD *buffer = (SWORD *) job->buffer + chip;
+    unsigned int n;
+
+    for (n = 0; n < job->max_frames; n++) {
+        *buffer = (SWORD)floor(generate_sample(ps)
+         * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + dither(ps));
+        buffer += num_cur_pokeys;
+    }
+}
+
+static void mzpokeysnd_process_8(void* sndbuffer, int sndn)
+{
+    SynthJob job;
 
     if(num_cur_pokeys<1)
         return; /* module was not initialized */
 
     /* if there are two pokeys, then the signal is stereo
        we assume even sndn */
-    while(nsam >= (int) num_cur_pokeys)
-    {
-        buffer[0] = (UBYTE)floor(generate_sample(pokey_states)
-         * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
-        for(i=1; i<num_cur_pokeys; i++)
-        {
-            buffer[i] = (UBYTE)floor(generate_sample(pokey_states + i)
-             * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
-        }
-        buffer += num_cur_pokeys;
-        nsam -= num_cur_pokeys;
-    }
+    job.buffer = sndbuffer;
+    job.max_frames = sndn / num_cur_pokeys;
+    run_chip_jobs(process_chip_8, &job, job.max_frames * (pokey_frq/POKEYSND_playback_freq));
 }
 
 static void mzpokeysnd_process_16(void* sndbuffer, int sndn)
 {
-    int i;
-    int nsam = sndn;
-    SWORD *buffer = (SWORD *) sndbuffer;
+    SynthJob job;
 
     if(num_cur_pokeys<1)
         return; /* module was not initialized */
 
     /* if there are two pokeys, then the signal is stereo
        we assume even sndn */
-    while(nsam >= (int) num_cur_pokeys)
-    {
-        buffer[0] = (SWORD)floor(generate_sample(pokey_states)
-         * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
-        for(i=1; i<num_cur_pokeys; i++)
-        {
-            buffer[i] = (SWORD)floor(generate_sample(pokey_states + i)
-             * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+    job.buffer = sndbuffer;
+    job.max_frames = sndn / num_cur_pokeys;
+    run_chip_jobs(process_chip_16, &job, job.max_frames * (pokey_frq/POKEYSND_playback_freq));
+}
+
+/* Advances one chip by job->num_ticks, producing a sample each time the
+   output position passes a sample boundary. All chips go through the same
+   positions, so the first one reports the common result. */
+static void generate_sync_chip(void *arg, int chip)
+{
+    SynthJob *job = (SynthJob *) arg;
+    PokeyState *ps = pokey_states + chip;
+    double pos = job->samp_pos;
+    double new_samp_pos;
+    unsigned int num_ticks = job->num_ticks;
+    unsigned int ticks;
+    unsigned int frames = 0;
+    UBYTE *buffer = (UBYTE *) job->buffer;
+
+    if (POKEYSND_snd_flags & POKEYSND_BIT16)
+        buffer += 2 * chip;
+    else
+        buffer += chip;
+
+    for (;;) {
+        double int_part;
+        new_samp_pos = pos + ticks_per_sample;
+        new_samp_pos = modf(new_samp_pos, &int_part);
+        ticks = (unsigned int)int_part;
+        if (ticks > num_ticks) {
+            pos -= num_ticks;
+            break;
         }
-        buffer += num_cur_pokeys;
-        nsam -= num_cur_pokeys;
+        if (frames >= job->max_frames)
+            break;
+
+        pos = new_samp_pos;
+        num_ticks -= ticks;
+
+        /* advance pokey to the new position and produce a sample */
+        advance_ticks(ps, ticks);
+        if (POKEYSND_snd_flags & POKEYSND_BIT16) {
+            *((SWORD *)buffer) = (SWORD)floor(
+                interp_read_resam_all(ps, pos)
+                * (volume.s16 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
+                + 0.5 + dither(ps)
+            );
+            buffer += 2 * num_cur_pokeys;
+        }
+        else {
+            *buffer = (UBYTE)floor(
+                interp_read_resam_all(ps, pos)
+                * (volume.s8 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
+                + 128 + 0.5 + dither(ps)
+            );
+            buffer += num_cur_pokeys;
+        }
+        frames++;
+    }
+
+    /* remaining ticks */
+    if (num_ticks > 0)
+        advance_ticks(ps, num_ticks);
+
+    if (chip == 0) {
+        job->frames = frames;
+        job->end_samp_pos = pos;
     }
 }
 
 static void generate_sync(unsigned int num_ticks)
 {
-	double new_samp_pos;
-	unsigned int ticks;
-	UBYTE *buffer = POKEYSND_process_buffer + POKEYSND_process_buffer_fill;
-	UBYTE *buffer_end = POKEYSND_process_buffer + POKEYSND_process_buffer_length;
-	unsigned int i;
+    SynthJob job;
+    unsigned int frame_size = num_cur_pokeys * ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1);
 
-	for (;;) {
-		double int_part;
-		new_samp_pos = samp_pos + ticks_per_sample;
-		new_samp_pos = modf(new_samp_pos, &int_part);
-		ticks = (unsigned int)int_part;
-		if (ticks > num_ticks) {
-			samp_pos -= num_ticks;
-			break;
-		}
-		if (buffer >= buffer_end)
-			break;
-
-		samp_pos = new_samp_pos;
-		num_ticks -= ticks;
-
-		for (i = 0; i < num_cur_pokeys; ++i) {
-			/* advance pokey to the new position and produce a sample */
-			advance_ticks(pokey_states + i, ticks);
-			if (POKEYSND_snd_flags & POKEYSND_BIT16) {
-				*((SWORD *)buffer) = (SWORD)floor(
-					interp_read_resam_all(pokey_states + i, samp_pos)
-					* (volume.s16 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
-					+ 0.5 + 0.5 * rand() / RAND_MAX - 0.25
-				);
-				buffer += 2;
-			}
-			else
-				*buffer++ = (UBYTE)floor(
-					interp_read_resam_all(pokey_states + i, samp_pos)
-					* (volume.s8 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
-					+ 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25
-				);
-		}
-	}
+    job.buffer = POKEYSND_process_buffer + POKEYSND_process_buffer_fill;
+    job.max_frames = (POKEYSND_process_buffer_length - POKEYSND_process_buffer_fill) / frame_size;
+    job.num_ticks = num_ticks;
+    job.samp_pos = samp_pos;
+    run_chip_jobs(generate_sync_chip, &job, num_ticks);
 
-	POKEYSND_process_buffer_fill = buffer - POKEYSND_process_buffer;
-	if (num_ticks > 0) {
-		/* remaining ticks */
-		for (i = 0; i < num_cur_pokeys; ++i)
-			advance_ticks(pokey_states + i, num_ticks);
-	}
+    samp_pos = job.end_samp_pos;
+    POKEYSND_process_buffer_fill += job.frames * frame_size;
 }
 
 #ifdef CONSOLE_SOUND
@@ -24,8 +24,11 @@
 
 #include "pal_blending.h"
 
+#include <string.h>
+
 #include "artifact.h"
 #include "atari.h"
+#include "blit.h"
 #include "colours.h"
 #include "colours_pal.h"
 #include "platform.h"
@@ -35,6 +38,10 @@
 #include "videomode.h"
 #endif /* SUPPORTS_CHANGE_VIDEOMODE */
 
+#ifdef BLIT_AVX2
+#include <immintrin.h>
+#endif
+
 static union {
 	UWORD bpp16[2][256];	/* 16-bit palette */
 	ULONG bpp32[2][256];	/* 32-bit palette */
@@ -98,6 +105,103 @@ void PAL_BLENDING_UpdateLookup(void)
 	}
 }
 
+#ifdef BLIT_AVX2
+/* Rows blended 8 pixels at a time. The lookups in the palettes of the
+   current and the previous line become gathers, and the average is taken
+   with SHIFT_MASK as in the scalar code, so that the result is the same
+   for any pixel format. (A packed byte average would round up.) */
+
+/* Number of scaled pixels whose source columns are computed at once. */
+#define SCALED_CHUNK 256
+
+/* Returns 8 pixels blended from the colours at CUR and PREV, in 32-bit
+   lanes. For BPP 16 the gathers read 32 bits for each 16-bit palette
+   entry, which stays within the palette union. */
+__attribute__((target("avx2")))
+static __m256i Blend8_AVX2(UBYTE const *cur, UBYTE const *prev, void const *pal, void const *pal_prev, int bpp)
+{
+	__m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *) cur));
+	__m256i p = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *) prev));
+	__m256i quad, quad_prev;
+	/* Make QUAD_PREV have the same Y component as the current line's pixel. */
+	p = _mm256_or_si256(_mm256_and_si256(p, _mm256_set1_epi32(0xf0)),
+	                    _mm256_and_si256(c, _mm256_set1_epi32(0x0f)));
+	if (bpp == 16) {
+		__m256i low = _mm256_set1_epi32(0xffff);
+		quad = _mm256_and_si256(_mm256_i32gather_epi32((int const *) pal, c, 2), low);
+		quad_prev = _mm256_and_si256(_mm256_i32gather_epi32((int const *) pal_prev, p, 2), low);
+	}
+	else {
+		quad = _mm256_i32gather_epi32((int const *) pal, c, 4);
+		quad_prev = _mm256_i32gather_epi32((int const *) pal_prev, p, 4);
+	}
+	return _mm256_add_epi32(_mm256_and_si256(quad, quad_prev),
+	                        _mm256_srli_epi32(_mm256_and_si256(_mm256_xor_si256(quad, quad_prev),
+	                                                           _mm256_set1_epi32((int) shift_mask)), 1));
+}
+
+static ULONG Blend(UBYTE cur, UBYTE prev, void const *pal, void const *pal_prev, int bpp)
+{
+	int i = (prev & 0xf0) | (cur & 0x0f);
+	ULONG quad = bpp == 16 ? ((UWORD const *) pal)[cur] : ((ULONG const *) pal)[cur];
+	ULONG quad_prev = bpp == 16 ? ((UWORD const *) pal_prev)[i] : ((ULONG const *) pal_prev)[i];
+	return (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
+}
+
+/* Writes WIDTH pixels blended from the colours in CUR and PREV to DEST
+   as 32-bit words, 16-bit pixels being zero-extended. */
+__attribute__((target("avx2")))
+static void BlendRow32_AVX2(ULONG *dest, UBYTE const *cur, UBYTE const *prev, int width, void const *pal, void const *pal_prev, int bpp)
+{
+	int i;
+	for (i = 0; i + 8 <= width; i += 8)
+		_mm256_storeu_si256((__m256i *) (dest + i), Blend8_AVX2(cur + i, prev + i, pal, pal_prev, bpp));
+	for (; i < width; i++)
+		dest[i] = Blend(cur[i], prev[i], pal, pal_prev, bpp);
+}
+
+/* As BlendRow32_AVX2, for 16-bit pixels stored in order, as the scalar
+   code does on little-endian hosts. */
+__attribute__((target("avx2")))
+static void BlendRow16_AVX2(UWORD *dest, UBYTE const *cur, UBYTE const *prev, int width, UWORD const *pal, UWORD const *pal_prev)
+{
+	int i;
+	for (i = 0; i + 8 <= width; i += 8) {
+		__m256i avg = Blend8_AVX2(cur + i, prev + i, pal, pal_prev, 16);
+		_mm_storeu_si128((__m128i *) (dest + i),
+		                 _mm_packus_epi32(_mm256_castsi256_si128(avg), _mm256_extracti128_si256(avg, 1)));
+	}
+	for (; i < width; i++)
+		dest[i] = (UWORD) Blend(cur[i], prev[i], pal, pal_prev, 16);
+}
+
+/* Writes a row of WIDTH scaled pixels of BPP bits; the source column of
+   pixel k is (X - (WIDTH - 1 - k) * DX) >> 16, as in the scalar code.
+   The source columns are blended first, then spread over the row. */
+static void ScaledRow_AVX2(void *dest, UBYTE const *src, UBYTE const *src_prev, int width, int x, int dx, int bpp, int odd, int odd_prev)
+{
+	/* The leftmost column may be -1 when scaling up more than 4 times. */
+	ULONG row[Screen_WIDTH + 1];
+	int xs[SCALED_CHUNK];
+	int lo = (x - (width - 1) * dx) >> 16;
+	int first;
+	void const *pal = bpp == 16 ? (void const *) palette.bpp16[odd] : (void const *) palette.bpp32[odd];
+	void const *pal_prev = bpp == 16 ? (void const *) palette.bpp16[odd_prev] : (void const *) palette.bpp32[odd_prev];
+
+	BlendRow32_AVX2(row, src + lo, src_prev + lo, (x >> 16) - lo + 1, pal, pal_prev, bpp);
+	/* Columns relative to LO. */
+	x -= lo * 0x10000;
+	for (first = 0; first < width; first += SCALED_CHUNK) {
+		int n = width - first < SCALED_CHUNK ? width - first : SCALED_CHUNK;
+		BLIT_ScaleColumns(xs, n, x - (width - first - n) * dx, dx);
+		if (bpp == 16)
+			BLIT_Scale32to16((UWORD *) dest + first, row, xs, n);
+		else
+			BLIT_Scale32((ULONG *) dest + first, row, xs, n);
+	}
+}
+#endif /* BLIT_AVX2 */
+
 void PAL_BLENDING_Blit16(ULONG *dest, UBYTE *src, int pitch, int width, int height, int start_odd)
 {
 	register ULONG quad, quad_prev;
@@ -105,29 +209,39 @@ void PAL_BLENDING_Blit16(ULONG *dest, UBYTE *src, int pitch, int width, int heig
 	register int pos;
 	UBYTE *src_prev = src;
 	int odd_prev = start_odd ^ 1;
+#ifdef BLIT_AVX2
+	int avx2 = BLIT_vectorize && BLIT_HaveAVX2();
+#endif
 	int width_32;
 	if (width & 0x01)
 		width_32 = width + 1;
 	else
 		width_32 = width;
 	while (height > 0) {
-		pos = width_32;
-		do {
-			pos--;
-			c = src[pos];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp16[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)] << 16;
-			quad = palette.bpp16[start_odd][c] << 16;
-			pos--;
-			c = src[pos];
-			quad_prev |= palette.bpp16[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)];
-			quad |= palette.bpp16[start_odd][c];
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos >> 1] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos >> 1] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-		} while (pos > 0);
+#ifdef BLIT_AVX2
+		if (avx2)
+			BlendRow16_AVX2((UWORD *) dest, src, src_prev, width_32, palette.bpp16[start_odd], palette.bpp16[odd_prev]);
+		else
+#endif
+		{
+			pos = width_32;
+			do {
+				pos--;
+				c = src[pos];
+				/* Make QUAD_PREV have the same Y component as the current line's pixel. */
+				quad_prev = palette.bpp16[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)] << 16;
+				quad = palette.bpp16[start_odd][c] << 16;
+				pos--;
+				c = src[pos];
+				quad_prev |= palette.bpp16[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)];
+				quad |= palette.bpp16[start_odd][c];
+				/* Since QUAD_PREV and QUAD have the same Y component, computing
+				   averages of even U/V and odd U/V is equal to computing averages
+				   of even and odd RGB components. */
+				/* dest[pos >> 1] = ((quad+quad_prev) & shift_mask)/2; */
+				dest[pos >> 1] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
+			} while (pos > 0);
+		}
 		src_prev = src;
 		src += Screen_WIDTH;
 		dest += pitch;
@@ -144,20 +258,30 @@ void PAL_BLENDING_Blit32(ULONG *dest, UBYTE *src, int pitch, int width, int heig
 	register int pos;
 	UBYTE *src_prev = src;
 	int odd_prev = start_odd ^ 1;
+#ifdef BLIT_AVX2
+	int avx2 = BLIT_vectorize && BLIT_HaveAVX2();
+#endif
 	while (height > 0) {
-		pos = width;
-		do {
-			pos--;
-			c = src[pos];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp32[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)];
-			quad = palette.bpp32[start_odd][c];
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-		} while (pos > 0);
+#ifdef BLIT_AVX2
+		if (avx2)
+			BlendRow32_AVX2(dest, src, src_prev, width, palette.bpp32[start_odd], palette.bpp32[odd_prev], 32);
+		else
+#endif
+		{
+			pos = width;
+			do {
+				pos--;
+				c = src[pos];
+				/* Make QUAD_PREV have the same Y component as the current line's pixel. */
+				quad_prev = palette.bpp32[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)];
+				quad = palette.bpp32[start_odd][c];
+				/* Since QUAD_PREV and QUAD have the same Y component, computing
+				   averages of even U/V and odd U/V is equal to computing averages
+				   of even and odd RGB components. */
+				/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
+				dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
+			} while (pos > 0);
+		}
 		src_prev = src;
 		src += Screen_WIDTH;
 		dest += pitch;
@@ -167,7 +291,7 @@ void PAL_BLENDING_Blit32(ULONG *dest, UBYTE *src, int pitch, int width, int heig
 	}
 }
 
-void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd)
+void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd, int first_line, int last_line)
 {
 	register ULONG quad, quad_prev;
 	register int x;
@@ -181,33 +305,61 @@ void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, in
 	int init_x = (width << 16) - 0x4000;
 	UBYTE *src_prev = src;
 	int odd_prev = start_odd ^ 1;
+	int repeat = FALSE;
+#ifdef BLIT_AVX2
+	int avx2 = BLIT_vectorize && BLIT_HaveAVX2();
+#endif
 
 	UBYTE c;
 
-	while (dest_height > 0) {
-		x = init_x;
-		pos = w1;
-		while (pos >= 0) {
-			c = src[x >> 16];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp16[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)] << 16;
-			quad = palette.bpp16[start_odd][c] << 16;
-			x -= dx;
-			c = src[x >> 16];
-			quad_prev |= palette.bpp16[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)];
-			quad |= palette.bpp16[start_odd][c];
-			x -= dx;
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-			pos--;
+	/* Skip to FIRST_LINE, keeping track of the source lines passed. */
+	for (; first_line > 0; first_line--, last_line--) {
+		dest += pitch;
+		y -= dy;
+		if (y < 0) {
+			y += 0x10000;
+			src_prev = src;
+			src += Screen_WIDTH;
+			start_odd ^= 1;
+			odd_prev ^= 1;
+		}
+	}
+
+	while (last_line > 0) {
+		/* Output lines that show the same source line are the same. */
+		if (repeat)
+			memcpy(dest, dest - pitch, (w1 + 1) * sizeof(ULONG));
+#ifdef BLIT_AVX2
+		else if (avx2)
+			ScaledRow_AVX2(dest, src, src_prev, 2 * (w1 + 1), init_x, dx, 16, start_odd, odd_prev);
+#endif
+		else {
+			x = init_x;
+			pos = w1;
+			while (pos >= 0) {
+				c = src[x >> 16];
+				/* Make QUAD_PREV have the same Y component as the current line's pixel. */
+				quad_prev = palette.bpp16[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)] << 16;
+				quad = palette.bpp16[start_odd][c] << 16;
+				x -= dx;
+				c = src[x >> 16];
+				quad_prev |= palette.bpp16[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)];
+				quad |= palette.bpp16[start_odd][c];
+				x -= dx;
+				/* Since QUAD_PREV and QUAD have the same Y component, computing
+				   averages of even U/V and odd U/V is equal to computing averages
+				   of even and odd RGB components. */
+				/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
+				dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
+				pos--;
+			}
 		}
 		dest += pitch;
 		y -= dy;
-		--dest_height;
+		--last_line;
+		repeat = TRUE;
 		if (y < 0) {
+			repeat = FALSE;
 			y += 0x10000;
 			src_prev = src;
 			src += Screen_WIDTH;
@@ -217,7 +369,7 @@ void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, in
 	}
 }
 
-void PAL_BLENDING_BlitScaled32(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd)
+void PAL_BLENDING_BlitScaled32(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd, int first_line, int last_line)
 {
 	register ULONG quad, quad_prev;
 	register int x;
@@ -231,29 +383,57 @@ void PAL_BLENDING_BlitScaled32(ULONG *dest, UBYTE *src, int pitch, int width, in
 	int init_x = w - 0x4000;
 	UBYTE *src_prev = src;
 	int odd_prev = start_odd ^ 1;
+	int repeat = FALSE;
+#ifdef BLIT_AVX2
+	int avx2 = BLIT_vectorize && BLIT_HaveAVX2();
+#endif
 
 	UBYTE c;
 
-	while (dest_height > 0) {
-		x = init_x;
-		pos = w1;
-		while (pos >= 0) {
-			c = src[x >> 16];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp32[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)];
-			quad = palette.bpp32[start_odd][c];
-			x -= dx;
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-			pos--;
+	/* Skip to FIRST_LINE, keeping track of the source lines passed. */
+	for (; first_line > 0; first_line--, last_line--) {
+		dest += pitch;
+		y -= dy;
+		if (y < 0) {
+			y += 0x10000;
+			src_prev = src;
+			src += Screen_WIDTH;
+			start_odd ^= 1;
+			odd_prev ^= 1;
+		}
+	}
+
+	while (last_line > 0) {
+		/* Output lines that show the same source line are the same. */
+		if (repeat)
+			memcpy(dest, dest - pitch, (w1 + 1) * sizeof(ULONG));
+#ifdef BLIT_AVX2
+		else if (avx2)
+			ScaledRow_AVX2(dest, src, src_prev, dest_width, init_x, dx, 32, start_odd, odd_prev);
+#endif
+		else {
+			x = init_x;
+			pos = w1;
+			while (pos >= 0) {
+				c = src[x >> 16];
+				/* Make QUAD_PREV have the same Y component as the current line's pixel. */
+				quad_prev = palette.bpp32[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)];
+				quad = palette.bpp32[start_odd][c];
+				x -= dx;
+				/* Since QUAD_PREV and QUAD have the same Y component, computing
+				   averages of even U/V and odd U/V is equal to computing averages
+				   of even and odd RGB components. */
+				/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
+				dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
+				pos--;
+			}
 		}
 		dest += pitch;
 		y -= dy;
-		--dest_height;
+		--last_line;
+		repeat = TRUE;
 		if (y < 0) {
+			repeat = FALSE;
 			y += 0x10000;
 			src_prev = src;
 			src += Screen_WIDTH;
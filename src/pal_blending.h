@@ -12,9 +12,11 @@ void PAL_BLENDING_Blit16(ULONG *dest, UBYTE *src, int pitch, int width, int heig
 /* Blit without scaling to a 32-BPP screen. */
 void PAL_BLENDING_Blit32(ULONG *dest, UBYTE *src, int pitch, int width, int height, int start_odd);
 
-/* Blit with scaling to a 16-BPP screen. */
-void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd);
-/* Blit with scaling to a 32-BPP screen. */
-void PAL_BLENDING_BlitScaled32(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd);
+/* Blit with scaling to a 16-BPP screen. Only lines FIRST_LINE..LAST_LINE-1
+   of the DEST_HEIGHT output lines are drawn, so that separate bands of the
+   image can be drawn in parallel. */
+void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd, int first_line, int last_line);
+/* Blit with scaling to a 32-BPP screen. Lines as in PAL_BLENDING_BlitScaled16. */
+void PAL_BLENDING_BlitScaled32(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd, int first_line, int last_line);
 
 #endif /* PAL_BLENDING_H_ */
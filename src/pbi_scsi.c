@@ -197,6 +197,8 @@ static void scsi_nextbyte(void)
 
 void PBI_SCSI_PutSEL(int newsel)
 {
+	if (!Atari800_DeviceIO())
+		return;
 	if (newsel != PBI_SCSI_SEL) {
 		/* SEL changed state */
 		PBI_SCSI_SEL = newsel;
@@ -209,6 +211,8 @@ void PBI_SCSI_PutSEL(int newsel)
 
 void PBI_SCSI_PutACK(int newack)
 {
+	if (!Atari800_DeviceIO())
+		return;
 	if (newack != PBI_SCSI_ACK) {
 		/* ACK changed state */
 		PBI_SCSI_ACK = newack;
@@ -233,6 +237,8 @@ UBYTE PBI_SCSI_GetByte(void)
 
 void PBI_SCSI_PutByte(UBYTE byte)
 {
+	if (!Atari800_DeviceIO())
+		return;
 	scsi_byte = byte;
 }
 
@@ -174,6 +174,10 @@ UBYTE PIA_GetByte(UWORD addr, int no_side_effects)
 			/* read PIBA (peripheral interface buffer A) */
 			/* also called ORA (output register A) even for reading in data sheet */
 			if (!no_side_effects) {
+#ifndef BASIC
+				if (INPUT_latch_pending)
+					INPUT_LateLatch();
+#endif
 				if (((PIA_PACTL & 0x38)>>3) == 0x04) { /* handshake */
 					if (PIA_CA2 == 1) {
 						PIA_CA2_negpending = 1;
@@ -210,6 +214,10 @@ UBYTE PIA_GetByte(UWORD addr, int no_side_effects)
 				return PIA_PORTB | PIA_PORTB_mask;
 			}
 			else {
+#ifndef BASIC
+				if (INPUT_latch_pending && !no_side_effects)
+					INPUT_LateLatch();
+#endif
 				return PIA_PORT_input[1] & (PIA_PORTB | PIA_PORTB_mask);
 			}
 		}
@@ -49,6 +49,21 @@ void PLATFORM_PaletteUpdate(void);
 void PLATFORM_Sleep(double s);
 #endif
 
+#ifdef SUPPORTS_PLATFORM_POLLINPUT
+/* Brings the state returned by PLATFORM_PORT and PLATFORM_TRIG up to date
+   in the middle of a frame (see INPUT_late_latch). Must not handle events
+   that PLATFORM_Keyboard is meant to see. */
+void PLATFORM_PollInput(void);
+#endif
+
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+/* If called on a thread that must not drive the display, eg. one that only
+   runs the emulation, runs FUNC(ARG) on the thread that does, waits for it,
+   stores its result in RESULT and returns TRUE. Otherwise returns FALSE
+   without running FUNC. */
+int PLATFORM_RunOnUIThread(int (*func)(void *), void *arg, int *result);
+#endif
+
 #ifdef SUPPORTS_PLATFORM_TIME
 /* This function is for those ports that need their own version of sleep */
 double PLATFORM_Time(void);
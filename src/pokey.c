@@ -204,7 +204,17 @@ static int POKEY_serial_byte_delay(void)
 #define SOUND_GAIN 4
 #endif
 
-#ifndef SOUND
+#ifdef POKEYREC
+/* Every sound register write also goes to the timestamped register log. */
+static void Update_Sound(UWORD addr, UBYTE val, UBYTE chip, UBYTE gain)
+{
+	POKEYREC_LogWrite(addr, val, chip);
+#ifdef SOUND
+	POKEYSND_Update(addr, val, chip, gain);
+#endif
+}
+#define POKEYSND_Update(addr, val, chip, gain) Update_Sound(addr, val, chip, gain)
+#elif !defined(SOUND)
 #define POKEYSND_Update(addr, val, chip, gain)
 #endif
 
@@ -25,6 +25,7 @@
 #include "config.h"
 #include "pokeyrec.h"
 #include "pokey.h"
+#include "antic.h"
 #include "log.h"
 #include "util.h"
 #include <string.h>
@@ -37,6 +38,11 @@ static FILE *fp;
 static int stereo;
 #endif
 
+static char *log_filename;
+static FILE *log_fp;
+static unsigned int log_clock;
+static int log_chips;
+
 static void output_pokey_values(int pokeynr) {
     int i;
     for (i=0; i<4; i++) {
@@ -47,7 +53,7 @@ static void output_pokey_values(int pokeynr) {
 }
 
 void POKEYREC_Recorder(void) {
-    if (!enabled) return;
+    if (!enabled || Atari800_running_ahead) return;
 
     if (++counter == interval) {
         counter = 0;
@@ -60,6 +66,59 @@ void POKEYREC_Recorder(void) {
     }
 }
 
+static void log_record(UBYTE event, UBYTE val) {
+    unsigned int delta = ANTIC_CPU_CLOCK - log_clock;
+
+    log_clock += delta;
+    while (delta >= 0x80) {
+        fputc((delta & 0x7f) | 0x80, log_fp);
+        delta >>= 7;
+    }
+    fputc(delta, log_fp);
+    fputc(event, log_fp);
+    fputc(val, log_fp);
+}
+
+void POKEYREC_LogWrite(UWORD addr, UBYTE val, UBYTE chip) {
+    if (!log_fp || Atari800_running_ahead) return;
+
+    if (chip >= log_chips)
+        log_chips = chip + 1;
+    log_record((chip << 4) | (addr & 0x0f), val);
+}
+
+void POKEYREC_LogConsol(int speaker) {
+    if (!log_fp || Atari800_running_ahead) return;
+
+    log_record(POKEYREC_LOG_CONSOL, speaker);
+}
+
+static int log_open(void) {
+    UBYTE header[POKEYREC_LOG_HEADER_SIZE] = POKEYREC_LOG_MAGIC;
+
+    if (!(log_fp = fopen(log_filename, "wb"))) {
+        Log_print("Unable to open '%s' for writing", log_filename);
+        return FALSE;
+    }
+    header[8] = POKEYREC_LOG_VERSION;
+    header[9] = 1;
+    header[10] = Atari800_tv_mode & 0xff;
+    header[11] = Atari800_tv_mode >> 8;
+    fwrite(header, 1, sizeof(header), log_fp);
+    log_clock = ANTIC_CPU_CLOCK;
+    log_chips = 1;
+    return TRUE;
+}
+
+static void log_close(void) {
+    log_record(POKEYREC_LOG_END, 0);
+    /* patch the number of chips actually written to */
+    if (fseek(log_fp, 9, SEEK_SET) == 0)
+        fputc(log_chips, log_fp);
+    fclose(log_fp);
+    log_fp = NULL;
+}
+
 int POKEYREC_Initialise(int *argc, char *argv[]) {
     int i, j;
 
@@ -86,6 +145,9 @@ int POKEYREC_Initialise(int *argc, char *argv[]) {
         } else if (!strcmp(argv[i], "-pokeyrec-stereo")) {
             stereo = 1;
 #endif
+        } else if (!strcmp(argv[i], "-pokeylog")) {
+            if (!available) goto missing_argument;
+            log_filename = Util_strdup(argv[++i]);
         } else {
             if (!strcmp(argv[i], "-help")) {
                 Log_print("\t-pokeyrec                  "
@@ -103,6 +165,9 @@ int POKEYREC_Initialise(int *argc, char *argv[]) {
                                 "Record second Pokey, too "
                                                     "(default: mono)");
 #endif
+                Log_print("\t-pokeylog <filename>       "
+                                "Log every sound register write with its "
+                                                                "CPU cycle");
             }
             argv[j++] = argv[i];
         }
@@ -117,6 +182,9 @@ int POKEYREC_Initialise(int *argc, char *argv[]) {
         }
     }
 
+    if (log_filename && !log_open())
+        return FALSE;
+
     return TRUE;
 
 missing_argument:
@@ -126,4 +194,5 @@ missing_argument:
 
 void POKEYREC_Exit(void) {
     if (fp) fclose(fp);
+    if (log_fp) log_close();
 }
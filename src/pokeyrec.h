@@ -1,8 +1,36 @@
 #ifndef POKEYREC_H_
 #define POKEYREC_H_
 
+#include "atari.h"
+
 void POKEYREC_Recorder(void);
 int  POKEYREC_Initialise(int *argc, char *argv[]);
 void POKEYREC_Exit(void);
 
+/* Timestamped register log ("-pokeylog"). Every write to a sound register
+   is stored together with the CPU cycle it happened on, so that the audio
+   can be rendered later (see tools/pokeyrender.c).
+
+   File layout (all multi-byte values little-endian):
+     0  8 bytes  POKEYREC_LOG_MAGIC
+     8  1 byte   POKEYREC_LOG_VERSION
+     9  1 byte   number of POKEY chips (1 or 2)
+    10  2 bytes  scanlines per frame (Atari800_TV_PAL or Atari800_TV_NTSC)
+    12  4 bytes  reserved, 0
+   followed by records of
+     n bytes  cycles since the previous record, LEB128 varint
+     1 byte   event: (chip << 4) | register offset, or one of the
+              POKEYREC_LOG_* specials below
+     1 byte   value written */
+#define POKEYREC_LOG_MAGIC       "A8PKYLOG"
+#define POKEYREC_LOG_VERSION     1
+#define POKEYREC_LOG_HEADER_SIZE 16
+/* GTIA console speaker changed, value is GTIA_speaker */
+#define POKEYREC_LOG_CONSOL      0xf0
+/* End of recording, the delta gives the length of trailing audio */
+#define POKEYREC_LOG_END         0xff
+
+void POKEYREC_LogWrite(UWORD addr, UBYTE val, UBYTE chip);
+void POKEYREC_LogConsol(int speaker);
+
 #endif
@@ -182,6 +182,15 @@ static void Generate_sync_rf(unsigned int num_ticks);
 static void null_generate_sync(unsigned int num_ticks) {}
 void (*POKEYSND_GenerateSync)(unsigned int num_ticks) = null_generate_sync;
 
+void (*POKEYSND_probe_ptr)(unsigned int buffer_pos) = NULL;
+
+int POKEYSND_idle = FALSE;
+/* Latest value and gain of every sound register written while idle, and a
+   mask of the registers that were written, per chip. */
+static UBYTE idle_val[POKEY_MAXPOKEYS][0x10];
+static UBYTE idle_gain[POKEY_MAXPOKEYS][0x10];
+static UWORD idle_written[POKEY_MAXPOKEYS];
+
 static double ticks_per_sample;
 static double samp_pos;
 static int speaker;
@@ -311,6 +320,10 @@ static void Update_synchronized_sound(void)
 int POKEYSND_UpdateProcessBuffer(void)
 {
 	int sndn;
+	if (POKEYSND_idle) {
+		POKEYSND_process_buffer_fill = 0;
+		return 0;
+	}
 	Update_synchronized_sound();
 	sndn = POKEYSND_process_buffer_fill / ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1);
 	POKEYSND_process_buffer_fill = 0;
@@ -395,8 +408,64 @@ static int pokeysnd_init_rf(ULONG freq17, int playback_freq,
 
 void POKEYSND_Update(UWORD addr, UBYTE val, UBYTE chip, UBYTE gain)
 {
+	if (POKEYSND_idle) {
+		addr &= 0x0f;
+		idle_val[chip][addr] = val;
+		idle_gain[chip][addr] = gain;
+		idle_written[chip] |= 1 << addr;
+		return;
+	}
     Update_synchronized_sound();
 	POKEYSND_Update_ptr(addr, val, chip, gain);
+	if (POKEYSND_probe_ptr != NULL && (addr & 0x0f) <= POKEY_OFFSET_AUDC4
+	    && (addr & 1) && (val & 0x0f) != 0) {
+		void (*probe)(unsigned int) = POKEYSND_probe_ptr;
+		POKEYSND_probe_ptr = NULL;
+		probe(POKEYSND_process_buffer_fill);
+	}
+}
+
+void POKEYSND_SetIdle(int idle)
+{
+	/* Order of replay: AUDCTL first, so that the divisors set up by AUDFx
+	   see the final clock settings, and STIMER last, as it resets them. */
+	static UBYTE const replay_order[] = {
+		POKEY_OFFSET_AUDCTL,
+		POKEY_OFFSET_AUDF1, POKEY_OFFSET_AUDC1, POKEY_OFFSET_AUDF2, POKEY_OFFSET_AUDC2,
+		POKEY_OFFSET_AUDF3, POKEY_OFFSET_AUDC3, POKEY_OFFSET_AUDF4, POKEY_OFFSET_AUDC4,
+		POKEY_OFFSET_SKCTL, POKEY_OFFSET_STIMER
+	};
+	int chip;
+	unsigned int i;
+
+	if (idle == POKEYSND_idle)
+		return;
+	POKEYSND_idle = idle;
+	if (idle)
+		return;
+
+	for (chip = 0; chip < POKEY_MAXPOKEYS; chip++) {
+		for (i = 0; i < sizeof(replay_order); i++) {
+			int addr = replay_order[i];
+			if (idle_written[chip] & (1 << addr))
+				POKEYSND_Update_ptr(addr, idle_val[chip][addr], chip, idle_gain[chip][addr]);
+		}
+		idle_written[chip] = 0;
+	}
+#ifdef CONSOLE_SOUND
+	if (POKEYSND_console_sound_enabled)
+		POKEYSND_UpdateConsol_ptr(1);
+#endif
+	/* The skipped time is not synthesised. */
+	POKEYSND_process_buffer_fill = 0;
+	prev_update_tick = ANTIC_CPU_CLOCK;
+}
+
+void POKEYSND_DiscardIdle(void)
+{
+	int chip;
+	for (chip = 0; chip < POKEY_MAXPOKEYS; chip++)
+		idle_written[chip] = 0;
 }
 
 static void Update_pokey_sound_rf(UWORD addr, UBYTE val, UBYTE chip,
@@ -1095,7 +1164,7 @@ static void Generate_sync_rf(unsigned int num_ticks)
 #ifdef CONSOLE_SOUND
 void POKEYSND_UpdateConsol(int set)
 {
-	if (!POKEYSND_console_sound_enabled)
+	if (!POKEYSND_console_sound_enabled || POKEYSND_idle)
 		return;
 	if (set)
 		Update_synchronized_sound();
@@ -116,6 +116,26 @@ extern unsigned int POKEYSND_process_buffer_fill;
 extern void (*POKEYSND_GenerateSync)(unsigned int num_ticks);
 int POKEYSND_UpdateProcessBuffer(void);
 
+/* While POKEYSND_idle is set, no audio is synthesised: POKEYSND_Update only
+   remembers the latest value of each sound register and
+   POKEYSND_UpdateProcessBuffer returns no samples. Use this when nobody
+   listens (sound output closed, turbo mode, headless use); timers, IRQs
+   and serial I/O are emulated by pokey.c and are not affected. When idle
+   mode ends, the remembered writes are replayed into the sound engine and
+   synthesis continues from the current CPU cycle. To get the skipped audio
+   as well, record it with -pokeylog and render it offline. */
+extern int POKEYSND_idle;
+void POKEYSND_SetIdle(int idle);
+/* Forgets the writes remembered in idle mode, so that ending it leaves the
+   sound engine as it was when idle mode began. */
+void POKEYSND_DiscardIdle(void);
+
+/* If not NULL, called on the next write that sets a non-zero volume on any
+   channel, with the offset in POKEYSND_process_buffer at which the samples
+   following the write begin. Cleared before the call, so it fires once.
+   Used by the audio latency test in sound.c. */
+extern void (*POKEYSND_probe_ptr)(unsigned int buffer_pos);
+
 #ifdef __cplusplus
 }
 
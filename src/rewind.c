@@ -0,0 +1,361 @@
+/*
+ * rewind.c - going back through the states of the last frames
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "log.h"
+#include "memory.h"
+#include "rewind.h"
+#include "statesav.h"
+#include "util.h"
+
+int REWIND_buffer_size = 0;
+
+/* The state kept last, both as a snapshot, which also saves the new
+   states, and as a plain copy: the snapshot data followed by MEMORY_mem.
+   LAST_SIZE is 0 while nothing is kept. */
+static StateSav_snapshot_t image;
+static UBYTE *last = NULL;
+static size_t last_size = 0;
+
+/* The deltas from each kept state to the one before it, oldest first,
+   wrapping around the end of RING. Each is stored as its ULONG length, the
+   delta and the length again, so that both ends can be taken off. */
+static UBYTE *ring = NULL;
+static size_t ring_size = 0;
+static size_t ring_start = 0;
+static size_t ring_used = 0;
+static int ring_frames = 0;
+
+/* A delta is a list of the 256-byte blocks of LAST that changed: the ULONG
+   offset of the block, then runs of a UBYTE count of unchanged bytes, a
+   UBYTE count of changed bytes and the changed bytes XORed with the old
+   ones. The runs cover the block, and a block has at most 256 of them. */
+#define BLOCK_SIZE 256
+#define MAX_BLOCK_DELTA (sizeof(ULONG) + 3 * BLOCK_SIZE)
+static UBYTE *delta = NULL;
+
+/* Writes the runs turning OLD into NEW to OUT and updates OLD. */
+static UBYTE *EncodeBlock(UBYTE *out, UBYTE *old, const UBYTE *new, int len)
+{
+	int i = 0;
+	while (i < len) {
+		int unchanged = 0;
+		int j;
+		while (i < len && unchanged < 255 && old[i] == new[i]) {
+			unchanged++;
+			i++;
+		}
+		/* A changed run goes on over fewer than 4 unchanged bytes, which
+		   cost less than starting another run. */
+		j = i;
+		while (j < len && j - i < 255) {
+			if (old[j] == new[j]) {
+				int k = j + 1;
+				while (k < len && k - j < 4 && old[k] == new[k])
+					k++;
+				if (k - j >= 4 || k == len || k - i > 255)
+					break;
+				j = k;
+			}
+			else
+				j++;
+		}
+		*out++ = (UBYTE) unchanged;
+		*out++ = (UBYTE) (j - i);
+		for (; i < j; i++) {
+			*out++ = old[i] ^ new[i];
+			old[i] = new[i];
+		}
+	}
+	return out;
+}
+
+/* Applies the runs at IN to OLD and returns the end of the runs. */
+static const UBYTE *ApplyBlock(const UBYTE *in, UBYTE *old, int len)
+{
+	int i = 0;
+	while (i < len) {
+		int changed;
+		i += *in++;
+		changed = *in++;
+		while (changed-- > 0)
+			old[i++] ^= *in++;
+	}
+	return in;
+}
+
+static UBYTE *EncodeBlockAt(UBYTE *out, size_t offset, const UBYTE *new, int len)
+{
+	ULONG temp = (ULONG) offset;
+	memcpy(out, &temp, sizeof(temp));
+	return EncodeBlock(out + sizeof(temp), last + offset, new, len);
+}
+
+static void RingWrite(size_t pos, const void *buf, size_t len)
+{
+	size_t first = ring_size - pos < len ? ring_size - pos : len;
+	memcpy(ring + pos, buf, first);
+	memcpy(ring, (const UBYTE *) buf + first, len - first);
+}
+
+static void RingRead(size_t pos, void *buf, size_t len)
+{
+	size_t first = ring_size - pos < len ? ring_size - pos : len;
+	memcpy(buf, ring + pos, first);
+	memcpy((UBYTE *) buf + first, ring, len - first);
+}
+
+static void Push(size_t len)
+{
+	ULONG temp = (ULONG) len;
+	size_t total = len + 2 * sizeof(temp);
+	if (total > ring_size) {
+		/* Does not fit at all: the earlier states can't be reached. */
+		ring_start = ring_used = 0;
+		ring_frames = 0;
+		return;
+	}
+	while (ring_size - ring_used < total) {
+		ULONG oldest;
+		RingRead(ring_start, &oldest, sizeof(oldest));
+		ring_start = (ring_start + oldest + 2 * sizeof(oldest)) % ring_size;
+		ring_used -= oldest + 2 * sizeof(oldest);
+		ring_frames--;
+	}
+	{
+		size_t pos = (ring_start + ring_used) % ring_size;
+		RingWrite(pos, &temp, sizeof(temp));
+		RingWrite((pos + sizeof(temp)) % ring_size, delta, len);
+		RingWrite((pos + sizeof(temp) + len) % ring_size, &temp, sizeof(temp));
+	}
+	ring_used += total;
+	ring_frames++;
+}
+
+/* Takes the newest delta off the ring into DELTA and returns its length. */
+static size_t Pop(void)
+{
+	size_t end = ring_start + ring_used + ring_size;
+	ULONG len;
+	RingRead((end - sizeof(len)) % ring_size, &len, sizeof(len));
+	RingRead((end - sizeof(len) - len) % ring_size, delta, len);
+	ring_used -= len + 2 * sizeof(len);
+	ring_frames--;
+	return len;
+}
+
+/* Keeps the state just saved in IMAGE as the first one. */
+static void Start(void)
+{
+	size_t blocks;
+	last_size = image.used + 65536;
+	last = (UBYTE *) Util_realloc(last, last_size);
+	memcpy(last, image.data->bytes, image.used);
+	MEMORY_dCopyFromMem(0, last + image.used, 65536);
+	blocks = (last_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	delta = (UBYTE *) Util_realloc(delta, blocks * MAX_BLOCK_DELTA);
+	ring_start = ring_used = 0;
+	ring_frames = 0;
+}
+
+void REWIND_Clear(void)
+{
+	StateSav_FreeSnapshot(&image);
+	free(last);
+	last = NULL;
+	last_size = 0;
+	free(delta);
+	delta = NULL;
+	ring_start = ring_used = 0;
+	ring_frames = 0;
+}
+
+void REWIND_SetBufferSize(int megabytes)
+{
+	REWIND_Clear();
+	free(ring);
+	ring = NULL;
+	ring_size = 0;
+	if (megabytes > 0) {
+		ring = (UBYTE *) malloc((size_t) megabytes << 20);
+		if (ring == NULL) {
+			Log_print("Cannot allocate %d MB for rewinding", megabytes);
+			megabytes = 0;
+		}
+		else
+			ring_size = (size_t) megabytes << 20;
+	}
+	REWIND_buffer_size = megabytes;
+}
+
+void REWIND_Frame(void)
+{
+	/* Pages of MEMORY_mem written after this have changed since the last
+	   state kept. */
+	ULONG generation = image.pages.generation;
+	ULONG epoch = image.pages.epoch;
+	size_t data_size;
+	size_t offset;
+	UBYTE *out;
+	int page;
+
+	if (ring == NULL)
+		return;
+	if (!StateSav_SaveSnapshot(&image)) {
+		REWIND_Clear();
+		return;
+	}
+	data_size = image.used;
+	if (last_size != data_size + 65536) {
+		/* The first state, or the machine changed. */
+		Start();
+		return;
+	}
+	out = delta;
+	for (offset = 0; offset < data_size; offset += BLOCK_SIZE) {
+		int len = data_size - offset < BLOCK_SIZE ? (int) (data_size - offset) : BLOCK_SIZE;
+		if (memcmp(last + offset, image.data->bytes + offset, len) != 0)
+			out = EncodeBlockAt(out, offset, image.data->bytes + offset, len);
+	}
+	for (page = 0; page < 256; page++) {
+		offset = data_size + (page << 8);
+		if ((MEMORY_page_written[page] > generation || image.pages.epoch != epoch)
+		    && memcmp(last + offset, MEMORY_mem + (page << 8), 256) != 0)
+			out = EncodeBlockAt(out, offset, MEMORY_mem + (page << 8), 256);
+	}
+	Push(out - delta);
+}
+
+int REWIND_StepBack(void)
+{
+	size_t data_size = last_size - 65536;
+	const UBYTE *in;
+	const UBYTE *end;
+	int pages[256];
+	int num_pages = 0;
+	int i;
+
+	if (ring_frames == 0)
+		return FALSE;
+	end = delta + Pop();
+	for (in = delta; in < end; ) {
+		ULONG offset;
+		int len;
+		memcpy(&offset, in, sizeof(offset));
+		if (offset < data_size) {
+			len = data_size - offset < BLOCK_SIZE ? (int) (data_size - offset) : BLOCK_SIZE;
+			in = ApplyBlock(in + sizeof(offset), last + offset, len);
+			memcpy(image.data->bytes + offset, last + offset, len);
+		}
+		else {
+			in = ApplyBlock(in + sizeof(offset), last + offset, 256);
+			pages[num_pages++] = (int) (offset - data_size) >> 8;
+		}
+	}
+	if (!StateSav_RestoreSnapshot(&image)) {
+		/* Can't happen, as the snapshot was saved by this emulator. */
+		Log_print("Cannot restore a snapshot, rewind buffer cleared");
+		REWIND_Clear();
+		return FALSE;
+	}
+	/* The snapshot has MEMORY_mem as it was in the newer state. */
+	for (i = 0; i < num_pages; i++)
+		MEMORY_dCopyToMem(last + data_size + (pages[i] << 8), pages[i] << 8, 256);
+	/* Update the snapshot's copy of these pages. */
+	StateSav_SaveSnapshot(&image);
+	return TRUE;
+}
+
+int REWIND_Frames(void)
+{
+	return ring_frames;
+}
+
+int REWIND_ReadConfig(char *option, char *ptr)
+{
+	if (strcmp(option, "REWIND_BUFFER") == 0) {
+		int size;
+		if (!Util_sscansdec(ptr, &size) || size < 0 || size > REWIND_MAX_BUFFER_SIZE)
+			return FALSE;
+		REWIND_buffer_size = size;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+void REWIND_WriteConfig(FILE *fp)
+{
+	fprintf(fp, "REWIND_BUFFER=%d\n", REWIND_buffer_size);
+}
+
+int REWIND_Initialise(int *argc, char *argv[])
+{
+	int i, j;
+
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+		int a_i = FALSE;			/* error, argument invalid! */
+
+		if (strcmp(argv[i], "-rewind") == 0) {
+			if (i_a)
+				a_i = !Util_sscansdec(argv[++i], &REWIND_buffer_size)
+				      || REWIND_buffer_size < 0 || REWIND_buffer_size > REWIND_MAX_BUFFER_SIZE;
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-rewind <n>          Keep states of the last frames in n MB for rewinding (0: off)");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		} else if (a_i) {
+			Log_print("Invalid argument for '%s'", argv[--i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	REWIND_SetBufferSize(REWIND_buffer_size);
+	return TRUE;
+}
+
+void REWIND_Exit(void)
+{
+	REWIND_Clear();
+	free(ring);
+	ring = NULL;
+	ring_size = 0;
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,41 @@
+#ifndef REWIND_H_
+#define REWIND_H_
+
+#include <stdio.h>
+
+#include "config.h"
+
+/* Keeps the states of the last frames, so that emulation can go back
+   through them. Each frame's state is stored as the difference from the
+   one after it, found from the pages of MEMORY_mem written in the frame
+   and the 256-byte blocks of the rest of the snapshot that changed. Like
+   run-ahead, it does not cover the machine configuration and the media. */
+
+/* Memory for the states in megabytes; 0 turns rewinding off. Change with
+   REWIND_SetBufferSize. */
+extern int REWIND_buffer_size;
+#define REWIND_MAX_BUFFER_SIZE 1024
+
+/* Drops the kept states and resizes the buffer. */
+void REWIND_SetBufferSize(int megabytes);
+
+/* Drops the kept states, eg. when the machine changes. */
+void REWIND_Clear(void);
+
+/* Keeps the state at the end of a frame. */
+void REWIND_Frame(void);
+
+/* Goes back to the state kept before the last one; returns FALSE when
+   there is none. The screen still shows the frame emulated last. */
+int REWIND_StepBack(void);
+
+/* Number of times REWIND_StepBack can go back. */
+int REWIND_Frames(void);
+
+int REWIND_Initialise(int *argc, char *argv[]);
+void REWIND_Exit(void);
+
+int REWIND_ReadConfig(char *option, char *ptr);
+void REWIND_WriteConfig(FILE *fp);
+
+#endif /* REWIND_H_ */
@@ -38,6 +38,9 @@
 #include "screen.h"
 #include "sio.h"
 #include "util.h"
+#ifdef SOUND
+#include "sound.h"
+#endif
 #if defined(SCREENSHOTS) || defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 #include "file_export.h"
 #endif
@@ -68,6 +71,21 @@ int Screen_show_atari_speed = FALSE;
 int Screen_show_disk_led = TRUE;
 int Screen_show_sector_counter = FALSE;
 int Screen_show_1200_leds = TRUE;
+#ifdef SOUND
+int Screen_show_sound_stats = FALSE;
+#endif
+int Screen_show_frame_stats = FALSE;
+#ifdef DIRTYRECT
+int Screen_show_video_stats = FALSE;
+/* Changed share of the area and rectangles in the last
+   Screen_CollectDirtyRects; -1 before it is first called. */
+static int dirty_percent = -1;
+static int dirty_rects = 0;
+/* With -checkdirtyrects, the screen as of the last
+   Screen_CollectDirtyRects, to find changes that were not marked. */
+static int check_dirty_rects = FALSE;
+static UBYTE *collected_screen = NULL;
+#endif
 
 #ifdef SCREENSHOTS
 #ifdef HAVE_LIBPNG
@@ -116,6 +134,22 @@ int Screen_Initialise(int *argc, char *argv[])
 		else if (strcmp(argv[i], "-showspeed") == 0) {
 			Screen_show_atari_speed = TRUE;
 		}
+#ifdef SOUND
+		else if (strcmp(argv[i], "-showsoundstats") == 0) {
+			Screen_show_sound_stats = TRUE;
+		}
+#endif
+		else if (strcmp(argv[i], "-showframestats") == 0) {
+			Screen_show_frame_stats = TRUE;
+		}
+#ifdef DIRTYRECT
+		else if (strcmp(argv[i], "-showvideostats") == 0) {
+			Screen_show_video_stats = TRUE;
+		}
+		else if (strcmp(argv[i], "-checkdirtyrects") == 0) {
+			check_dirty_rects = TRUE;
+		}
+#endif
 		else {
 			if (strcmp(argv[i], "-help") == 0) {
 				help_only = TRUE;
@@ -127,6 +161,14 @@ int Screen_Initialise(int *argc, char *argv[])
 				Log_print("\t-no-showstats    Don't show recording stats of video or audio");
 #endif
 				Log_print("\t-showspeed       Show percentage of actual speed");
+#ifdef SOUND
+				Log_print("\t-showsoundstats  Show audio latency and buffer statistics");
+#endif
+				Log_print("\t-showframestats  Show how late frames are delivered");
+#ifdef DIRTYRECT
+				Log_print("\t-showvideostats  Show the share of the screen redrawn each frame");
+				Log_print("\t-checkdirtyrects Report screen changes that are not redrawn");
+#endif
 			}
 			argv[j++] = argv[i];
 		}
@@ -173,6 +215,16 @@ int Screen_ReadConfig(char *string, char *ptr)
 		return (Screen_show_sector_counter = Util_sscanbool(ptr)) != -1;
 	else if (strcmp(string, "SCREEN_SHOW_1200XL_LEDS") == 0)
 		return (Screen_show_1200_leds = Util_sscanbool(ptr)) != -1;
+#ifdef SOUND
+	else if (strcmp(string, "SCREEN_SHOW_SOUND_STATS") == 0)
+		return (Screen_show_sound_stats = Util_sscanbool(ptr)) != -1;
+#endif
+	else if (strcmp(string, "SCREEN_SHOW_FRAME_STATS") == 0)
+		return (Screen_show_frame_stats = Util_sscanbool(ptr)) != -1;
+#ifdef DIRTYRECT
+	else if (strcmp(string, "SCREEN_SHOW_VIDEO_STATS") == 0)
+		return (Screen_show_video_stats = Util_sscanbool(ptr)) != -1;
+#endif
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 	else if (strcmp(string, "SCREEN_SHOW_MULTIMEDIA_STATS") == 0)
 		return (Screen_show_multimedia_stats = Util_sscanbool(ptr)) != -1;
@@ -187,6 +239,13 @@ void Screen_WriteConfig(FILE *fp)
 	fprintf(fp, "SCREEN_SHOW_IO_ACTIVITY=%d\n", Screen_show_disk_led);
 	fprintf(fp, "SCREEN_SHOW_IO_COUNTER=%d\n", Screen_show_sector_counter);
 	fprintf(fp, "SCREEN_SHOW_1200XL_LEDS=%d\n", Screen_show_1200_leds);
+#ifdef SOUND
+	fprintf(fp, "SCREEN_SHOW_SOUND_STATS=%d\n", Screen_show_sound_stats);
+#endif
+	fprintf(fp, "SCREEN_SHOW_FRAME_STATS=%d\n", Screen_show_frame_stats);
+#ifdef DIRTYRECT
+	fprintf(fp, "SCREEN_SHOW_VIDEO_STATS=%d\n", Screen_show_video_stats);
+#endif
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 	fprintf(fp, "SCREEN_SHOW_MULTIMEDIA_STATS=%d\n", Screen_show_multimedia_stats);
 #endif
@@ -240,6 +299,9 @@ void Screen_WriteConfig(FILE *fp)
 #define SMALLFONTXX_XX 0x1B
 #define SMALLFONTX_X_X 0x15
 
+/* Pixels are written with ANTIC_VideoPutByte, which marks the blocks they
+   change in Screen_dirty, so that the indicators and their removal are
+   redrawn by platforms that present only what changed. */
 static void SmallFont_DrawChar(UBYTE *screen, int ch, UBYTE color1, UBYTE color2)
 {
 	static const UBYTE font[SMALLFONT_COUNT][SMALLFONT_HEIGHT] = {
@@ -852,6 +914,149 @@ void Screen_DrawMultimediaStats(void)
 }
 #endif /* defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING) */
 
+#ifdef SOUND
+void Screen_DrawSoundStats(void)
+{
+	if (Screen_show_sound_stats && Sound_enabled) {
+		/* latency and average fill in ms, underruns, overruns, frames with
+		   speed adjusted, and the last latency test result */
+		char text[80];
+		UBYTE *screen = (UBYTE *) Screen_atari + Screen_visible_x1 + Screen_visible_y1 * Screen_WIDTH;
+		int len = sprintf(text, "LAT %d FILL %d UND %u OVR %u ADJ %u",
+		                  (int) Sound_stats.latency_ms, (int) Sound_stats.avg_fill_ms,
+		                  Sound_stats.underruns, Sound_stats.overruns, Sound_stats.adjusted_frames);
+		if (Sound_stats.probe_ms >= 0)
+			sprintf(text + len, " TEST %d", (int) Sound_stats.probe_ms);
+		SmallFont_DrawString(screen, text, 0x0c, 0x00);
+	}
+}
+#endif /* SOUND */
+
+void Screen_DrawFrameStats(void)
+{
+	if (Screen_show_frame_stats && Atari800_frame_stats.frames > 0) {
+		/* lateness of frames in microseconds: average, 99th percentile and
+		   maximum; frames over 0.2 ms late, and schedule restarts */
+		char text[80];
+		UBYTE *screen = (UBYTE *) Screen_atari + Screen_visible_x1
+		                + (Screen_visible_y1 + SMALLFONT_HEIGHT) * Screen_WIDTH;
+		sprintf(text, "LATE %d P99 %d MAX %d US OVER %u RESYNC %u",
+		        (int) (Atari800_frame_stats.avg_late_ms * 1000.0),
+		        (int) (Atari800_FrameLatePercentile(99) * 1000.0),
+		        (int) (Atari800_frame_stats.max_late_ms * 1000.0),
+		        Atari800_frame_stats.missed, Atari800_frame_stats.resyncs);
+		SmallFont_DrawString(screen, text, 0x0c, 0x00);
+	}
+}
+
+#ifdef DIRTYRECT
+void Screen_DrawVideoStats(void)
+{
+	if (Screen_show_video_stats && dirty_percent >= 0) {
+		/* percentage of the screen redrawn and number of rectangles */
+		char percent[16];
+		char rects[16];
+		UBYTE *screen;
+		sprintf(percent, "DIRTY %d", dirty_percent);
+		sprintf(rects, " IN %d RECTS", dirty_rects);
+		screen = (UBYTE *) Screen_atari + Screen_visible_x2 + Screen_visible_y1 * Screen_WIDTH
+		         - (strlen(percent) + 1 + strlen(rects)) * SMALLFONT_WIDTH;
+		screen = SmallFont_DrawString(screen, percent, 0x0c, 0x00);
+		SmallFont_DrawChar(screen, SMALLFONT_PERCENT, 0x0c, 0x00);
+		SmallFont_DrawString(screen + SMALLFONT_WIDTH, rects, 0x0c, 0x00);
+	}
+}
+
+/* Marks and counts the blocks of the area that differ from the screen of
+   the last call without being marked. */
+static void CheckDirtyMarks(int x, int y, int w, int h)
+{
+	int first_block = x >> 3;
+	int end_block = (x + w + 7) >> 3;
+	int missed = 0;
+	int row;
+
+	if (collected_screen == NULL) {
+		collected_screen = (UBYTE *) Util_malloc(Screen_HEIGHT * Screen_WIDTH);
+		memcpy(collected_screen, Screen_atari, Screen_HEIGHT * Screen_WIDTH);
+		return;
+	}
+	for (row = y; row < y + h; row++) {
+		UBYTE *dirty = Screen_dirty + row * (Screen_WIDTH / 8);
+		int offset = row * Screen_WIDTH;
+		int block;
+		for (block = first_block; block < end_block; block++) {
+			if (!dirty[block] && memcmp(collected_screen + offset + (block << 3),
+			                            (UBYTE *) Screen_atari + offset + (block << 3), 8) != 0) {
+				dirty[block] = 1;
+				missed++;
+			}
+		}
+		memcpy(collected_screen + offset + (first_block << 3),
+		       (UBYTE *) Screen_atari + offset + (first_block << 3), (end_block - first_block) << 3);
+	}
+	if (missed > 0)
+		Log_print("%d changed blocks of the screen were not marked dirty", missed);
+}
+
+int Screen_CollectDirtyRects(Screen_rect_t *rects, int max_rects, int x, int y, int w, int h)
+{
+	int first_block = x >> 3;
+	int end_block = (x + w + 7) >> 3;
+	int num_rects = 0;
+	long changed = 0;
+	/* The rectangle that the previous row went into, if it changed. */
+	Screen_rect_t *open = NULL;
+	int row;
+
+	if (check_dirty_rects)
+		CheckDirtyMarks(x, y, w, h);
+	for (row = y; row < y + h; row++) {
+		UBYTE *dirty = Screen_dirty + row * (Screen_WIDTH / 8);
+		int x1 = -1;
+		int x2 = -1;
+		int block;
+		for (block = first_block; block < end_block; block++) {
+			if (dirty[block]) {
+				int bx1 = block << 3 < x ? x : block << 3;
+				int bx2 = (block << 3) + 8 > x + w ? x + w : (block << 3) + 8;
+				if (x1 < 0)
+					x1 = bx1;
+				x2 = bx2;
+				changed += bx2 - bx1;
+				dirty[block] = 0;
+			}
+		}
+		if (x1 < 0) {
+			open = NULL;
+			continue;
+		}
+		if (open == NULL && num_rects < max_rects) {
+			open = &rects[num_rects++];
+			open->x = x1;
+			open->y = row;
+			open->w = x2 - x1;
+			open->h = 1;
+			continue;
+		}
+		/* Grow the open rectangle, or the last one if there are no more
+		   free, to take in this row. */
+		if (open == NULL)
+			open = &rects[num_rects - 1];
+		if (x1 < open->x) {
+			open->w += open->x - x1;
+			open->x = x1;
+		}
+		if (x2 > open->x + open->w)
+			open->w = x2 - open->x;
+		open->h = row - open->y + 1;
+	}
+	dirty_percent = w > 0 && h > 0 ? (int) (changed * 100 / ((long) w * h)) : 0;
+	dirty_rects = num_rects;
+	return num_rects;
+}
+#endif /* DIRTYRECT */
+
 char status_text[60] = {0};
 int status_text_duration = 0;
 
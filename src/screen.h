@@ -44,6 +44,10 @@ extern int Screen_show_disk_led;
 extern int Screen_show_sector_counter;
 extern int Screen_show_1200_leds;
 extern int Screen_show_multimedia_stats;
+extern int Screen_show_frame_stats;
+#ifdef SOUND
+extern int Screen_show_sound_stats;
+#endif
 
 int Screen_Initialise(int *argc, char *argv[]);
 int Screen_ReadConfig(char *string, char *ptr);
@@ -52,6 +56,31 @@ void Screen_DrawAtariSpeed(double);
 void Screen_DrawDiskLED(void);
 void Screen_Draw1200LED(void);
 void Screen_DrawMultimediaStats(void);
+void Screen_DrawFrameStats(void);
+#ifdef SOUND
+void Screen_DrawSoundStats(void);
+#endif
+#ifdef DIRTYRECT
+extern int Screen_show_video_stats;
+void Screen_DrawVideoStats(void);
+
+/* A rectangle of Screen_atari, in pixels. */
+typedef struct Screen_rect_t {
+	int x;
+	int y;
+	int w;
+	int h;
+} Screen_rect_t;
+
+/* For platforms that redraw only what changed: finds the 8-pixel blocks
+   marked in Screen_dirty within the area of Screen_atari at X, Y of size
+   W x H, and clears their marks. Rows of changed blocks are merged into at
+   most MAX_RECTS rectangles, clipped to the area and stored in RECTS.
+   Returns the number of rectangles. The share of the area that changed is
+   shown by Screen_DrawVideoStats. With -checkdirtyrects, changes since the
+   last call that were not marked are logged and redrawn. */
+int Screen_CollectDirtyRects(Screen_rect_t *rects, int max_rects, int x, int y, int w, int h);
+#endif /* DIRTYRECT */
 void Screen_FindScreenshotFilename(char *buffer, unsigned bufsize);
 int Screen_SaveScreenshot(const char *filename, int interlaced);
 void Screen_SaveNextScreenshot(int interlaced);
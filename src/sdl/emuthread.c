@@ -0,0 +1,426 @@
+/*
+ * sdl/emuthread.c - SDL library specific port code - emulation thread
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <SDL.h>
+#include <string.h>
+
+#include "akey.h"
+#include "atari.h"
+#include "../input.h"
+#include "log.h"
+#include "platform.h"
+#include "screen.h"
+#include "util.h"
+#include "sdl/emuthread.h"
+#include "sdl/input.h"
+#include "sdl/video.h"
+
+#ifdef SDL_EMUTHREAD
+
+#if SDL2
+#define BARRIER_RELEASE() SDL_MemoryBarrierRelease()
+#define BARRIER_ACQUIRE() SDL_MemoryBarrierAcquire()
+typedef SDL_threadID thread_id_t;
+#else
+#define BARRIER_RELEASE() __sync_synchronize()
+#define BARRIER_ACQUIRE() __sync_synchronize()
+typedef Uint32 thread_id_t;
+#endif
+
+/* Longest time the main thread waits for a frame before it handles
+   events and samples the input again, in ms. */
+#define POLL_INTERVAL 2
+
+int SDL_EMUTHREAD_enabled = FALSE;
+
+static SDL_Thread *thread = NULL;
+
+/* Guards the variables below, up to the input queue. COND is signalled
+   whenever one of them changes. */
+static SDL_mutex *lock = NULL;
+static SDL_cond *cond = NULL;
+
+/* Set by the emulation thread when it starts. Start waits for them, so
+   they do not change once it returns. */
+static thread_id_t thread_id;
+static int thread_started = FALSE;
+
+/* Set by the main thread to stop the emulation thread at the end of the
+   frame; PAUSED is set by the emulation thread once it has stopped. */
+static int pause_requested = FALSE;
+static int paused = FALSE;
+
+/* A call from the emulation thread to be made on the main thread. */
+static int (*call_func)(void *) = NULL;
+static void *call_arg;
+static int call_result;
+static int call_done = FALSE;
+static int halted = FALSE;
+/* Whether the main thread is making a call, during which the emulation
+   thread waits for it. Only used by the main thread. */
+static int serving_call = FALSE;
+
+/* Triple buffer of finished frames. The emulation thread copies each frame
+   into BACK and then swaps it with READY; the main thread swaps READY with
+   FRONT to show the latest frame. Neither waits for the other. */
+static UBYTE *frames[3];
+static int back = 0;
+static int ready = 1;
+static int front = 2;
+static int frame_fresh = FALSE;
+
+/* Input samples sent from the main thread to the emulation thread. Only
+   the main thread writes QUEUE_HEAD and only the emulation thread writes
+   QUEUE_TAIL, so the queue needs no lock. */
+#define QUEUE_SIZE 64
+static SDL_INPUT_sample_t queue[QUEUE_SIZE];
+static volatile unsigned int queue_head = 0;
+static volatile unsigned int queue_tail = 0;
+
+/* On the main thread: the last sample sent, with the mouse movement left
+   out; a sample that did not fit in the queue. */
+static SDL_INPUT_sample_t last_sent;
+static SDL_INPUT_sample_t unsent;
+static int have_unsent = FALSE;
+
+/* On the emulation thread: the input in use, and a key that was pressed
+   and released again before the emulation thread got to see it. */
+static SDL_INPUT_sample_t input;
+static int tapped_key = AKEY_NONE;
+
+static int Push(SDL_INPUT_sample_t const *sample)
+{
+	unsigned int head = queue_head;
+	if (head - queue_tail == QUEUE_SIZE)
+		return FALSE;
+	queue[head % QUEUE_SIZE] = *sample;
+	BARRIER_RELEASE();
+	queue_head = head + 1;
+	return TRUE;
+}
+
+static int Pop(SDL_INPUT_sample_t *sample)
+{
+	unsigned int tail = queue_tail;
+	if (tail == queue_head)
+		return FALSE;
+	BARRIER_ACQUIRE();
+	*sample = queue[tail % QUEUE_SIZE];
+	BARRIER_RELEASE();
+	queue_tail = tail + 1;
+	return TRUE;
+}
+
+/* Sends SAMPLE to the emulation thread if anything in it changed. */
+static void Send(SDL_INPUT_sample_t *sample)
+{
+	SDL_INPUT_sample_t still;
+	if (have_unsent) {
+		sample->mouse_delta_x += unsent.mouse_delta_x;
+		sample->mouse_delta_y += unsent.mouse_delta_y;
+		have_unsent = FALSE;
+	}
+	still = *sample;
+	still.mouse_delta_x = still.mouse_delta_y = 0;
+	if (sample->mouse_delta_x == 0 && sample->mouse_delta_y == 0
+	    && memcmp(&still, &last_sent, sizeof(still)) == 0)
+		return;
+	if (Push(sample))
+		last_sent = still;
+	else {
+		/* The emulation thread is busy; keep the mouse movement. */
+		unsent = *sample;
+		have_unsent = TRUE;
+	}
+}
+
+/* Takes all samples in the queue into INPUT. */
+static void Receive(void)
+{
+	SDL_INPUT_sample_t sample;
+	while (Pop(&sample)) {
+		if (sample.key_code != AKEY_NONE)
+			tapped_key = sample.key_code;
+		sample.mouse_delta_x += input.mouse_delta_x;
+		sample.mouse_delta_y += input.mouse_delta_y;
+		input = sample;
+	}
+}
+
+/* Makes the pending call, if any. LOCK is held, but released during the
+   call. */
+static void ServeCall(void)
+{
+	int (*func)(void *) = call_func;
+	int result;
+	if (func == NULL)
+		return;
+	call_func = NULL;
+	SDL_UnlockMutex(lock);
+	serving_call = TRUE;
+	result = (*func)(call_arg);
+	serving_call = FALSE;
+	SDL_LockMutex(lock);
+	call_result = result;
+	call_done = TRUE;
+	SDL_CondBroadcast(cond);
+	while (halted)
+		SDL_CondWait(cond, lock);
+}
+
+static int EmuThread(void *arg)
+{
+	SDL_LockMutex(lock);
+	thread_id = SDL_ThreadID();
+	thread_started = TRUE;
+	SDL_CondBroadcast(cond);
+	SDL_UnlockMutex(lock);
+	for (;;) {
+		SDL_LockMutex(lock);
+		if (pause_requested) {
+			SDL_INPUT_UseSample(NULL);
+			paused = TRUE;
+			SDL_CondBroadcast(cond);
+			while (pause_requested)
+				SDL_CondWait(cond, lock);
+			paused = FALSE;
+		}
+		SDL_UnlockMutex(lock);
+
+		Receive();
+		SDL_INPUT_UseSample(&input);
+		if (INPUT_key_code == AKEY_NONE)
+			INPUT_key_code = tapped_key;
+		tapped_key = AKEY_NONE;
+		input.mouse_delta_x = input.mouse_delta_y = 0;
+
+		Atari800_Frame();
+
+		if (Atari800_display_screen) {
+			int tmp;
+			memcpy(frames[back], Screen_atari, Screen_WIDTH * Screen_HEIGHT);
+			SDL_LockMutex(lock);
+			tmp = back;
+			back = ready;
+			ready = tmp;
+			frame_fresh = TRUE;
+			SDL_CondBroadcast(cond);
+			SDL_UnlockMutex(lock);
+		}
+	}
+	return 0;
+}
+
+static int Start(void)
+{
+	int i;
+	for (i = 0; i < 3; i++) {
+		frames[i] = (UBYTE *) Util_malloc(Screen_WIDTH * Screen_HEIGHT);
+		memset(frames[i], 0, Screen_WIDTH * Screen_HEIGHT);
+	}
+	lock = SDL_CreateMutex();
+	cond = SDL_CreateCond();
+	if (lock != NULL && cond != NULL) {
+		SDL_INPUT_TakeSample(&input, AKEY_NONE);
+		last_sent = input;
+#if SDL2
+		thread = SDL_CreateThread(&EmuThread, "Emulation", NULL);
+#else
+		thread = SDL_CreateThread(&EmuThread, NULL);
+#endif
+	}
+	if (thread == NULL) {
+		Log_print("Cannot start the emulation thread: %s", SDL_GetError());
+		SDL_EMUTHREAD_enabled = FALSE;
+		return FALSE;
+	}
+	SDL_LockMutex(lock);
+	while (!thread_started)
+		SDL_CondWait(cond, lock);
+	SDL_UnlockMutex(lock);
+	return TRUE;
+}
+
+/* Stops the emulation thread at the end of its frame. It goes on at the
+   next SDL_EMUTHREAD_Step. */
+static void Pause(void)
+{
+	SDL_LockMutex(lock);
+	pause_requested = TRUE;
+	SDL_CondBroadcast(cond);
+	while (!paused) {
+		if (call_func != NULL)
+			ServeCall();
+		else
+			SDL_CondWait(cond, lock);
+	}
+	SDL_UnlockMutex(lock);
+}
+
+static int NeedsMainThread(int key_code)
+{
+	switch (key_code) {
+	case AKEY_UI:
+	case AKEY_EXIT:
+	case AKEY_PBI_BB_MENU:
+#ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
+	case AKEY_KEYB:
+#endif
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+int SDL_EMUTHREAD_Step(int key_code)
+{
+	SDL_INPUT_sample_t sample;
+	int fresh;
+
+	if (!SDL_EMUTHREAD_enabled)
+		return FALSE;
+	if (NeedsMainThread(key_code)) {
+		if (thread != NULL)
+			Pause();
+		return FALSE;
+	}
+	if (thread == NULL) {
+		/* The recorded input must be what the frame sees. */
+		if (INPUT_EventRecordingActive()) {
+			SDL_EMUTHREAD_enabled = FALSE;
+			return FALSE;
+		}
+		if (!Start())
+			return FALSE;
+	}
+
+	SDL_INPUT_TakeSample(&sample, key_code);
+	Send(&sample);
+
+	SDL_LockMutex(lock);
+	if (pause_requested) {
+		pause_requested = FALSE;
+		SDL_CondBroadcast(cond);
+	}
+	if (!frame_fresh && call_func == NULL)
+		SDL_CondWaitTimeout(cond, lock, POLL_INTERVAL);
+	ServeCall();
+	fresh = frame_fresh;
+	if (fresh) {
+		int tmp = front;
+		front = ready;
+		ready = tmp;
+		frame_fresh = FALSE;
+	}
+	SDL_UnlockMutex(lock);
+
+	if (fresh) {
+		/* The 80-column cards are drawn from their own memory rather than
+		   from a copy, so they are shown while the thread is stopped. */
+		if (SDL_VIDEO_current_display_mode != VIDEOMODE_MODE_NORMAL
+#if NTSC_FILTER
+		    && SDL_VIDEO_current_display_mode != VIDEOMODE_MODE_NTSC_FILTER
+#endif
+		    )
+			Pause();
+		SDL_VIDEO_atari_frame = frames[front];
+		PLATFORM_DisplayScreen();
+		SDL_VIDEO_atari_frame = NULL;
+	}
+	return TRUE;
+}
+
+void SDL_EMUTHREAD_Pause(void)
+{
+	if (thread != NULL && !serving_call && !SDL_EMUTHREAD_OnEmuThread())
+		Pause();
+}
+
+int SDL_EMUTHREAD_OnEmuThread(void)
+{
+	return thread_started && SDL_ThreadID() == thread_id;
+}
+
+int SDL_EMUTHREAD_CallOnMain(int (*func)(void *), void *arg)
+{
+	int result;
+	SDL_LockMutex(lock);
+	call_func = func;
+	call_arg = arg;
+	SDL_CondBroadcast(cond);
+	while (!call_done)
+		SDL_CondWait(cond, lock);
+	call_done = FALSE;
+	result = call_result;
+	SDL_UnlockMutex(lock);
+	return result;
+}
+
+void SDL_EMUTHREAD_Halt(void)
+{
+	halted = TRUE;
+}
+
+void SDL_EMUTHREAD_PollInput(void)
+{
+	Receive();
+}
+
+int SDL_EMUTHREAD_ReadConfig(char *option, char *parameters)
+{
+	if (strcmp(option, "EMULATION_THREAD") == 0)
+		return (SDL_EMUTHREAD_enabled = Util_sscanbool(parameters)) != -1;
+	return FALSE;
+}
+
+void SDL_EMUTHREAD_WriteConfig(FILE *fp)
+{
+	fprintf(fp, "EMULATION_THREAD=%d\n", SDL_EMUTHREAD_enabled);
+}
+
+int SDL_EMUTHREAD_Initialise(int *argc, char *argv[])
+{
+	int i, j;
+	for (i = j = 1; i < *argc; i++) {
+		if (strcmp(argv[i], "-emuthread") == 0)
+			SDL_EMUTHREAD_enabled = TRUE;
+		else if (strcmp(argv[i], "-no-emuthread") == 0)
+			SDL_EMUTHREAD_enabled = FALSE;
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-emuthread        Run the emulation on a thread of its own");
+				Log_print("\t-no-emuthread     Run the emulation on the main thread");
+			}
+			argv[j++] = argv[i];
+		}
+	}
+	*argc = j;
+	return TRUE;
+}
+
+#endif /* SDL_EMUTHREAD */
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,62 @@
+#ifndef SDL_EMUTHREAD_H_
+#define SDL_EMUTHREAD_H_
+
+#include <stdio.h>
+
+#include "config.h"
+
+/* Running the emulation on a thread of its own. The main thread keeps
+   handling SDL events, samples the input devices and presents finished
+   frames, so that the emulation does not wait for a frame to be blitted
+   and shown before starting the next one. */
+
+/* The input queue needs memory barriers. */
+#if SDL2 || defined(__GNUC__)
+#define SDL_EMUTHREAD
+#endif
+
+#ifdef SDL_EMUTHREAD
+
+/* Whether to use the emulation thread (-emuthread). */
+extern int SDL_EMUTHREAD_enabled;
+
+/* Read/write to configuration file. */
+int SDL_EMUTHREAD_ReadConfig(char *option, char *parameters);
+void SDL_EMUTHREAD_WriteConfig(FILE *fp);
+
+/* Processing of command-line arguments. */
+int SDL_EMUTHREAD_Initialise(int *argc, char *argv[]);
+
+/* Does one iteration of the main loop on the main thread, KEY_CODE being
+   what PLATFORM_Keyboard returned: passes the input to the emulation
+   thread, starting it if needed, and shows the latest frame. Returns FALSE
+   if the caller must emulate the frame itself instead, eg. because
+   KEY_CODE opens the user interface; the emulation thread is then
+   stopped until the next call. */
+int SDL_EMUTHREAD_Step(int key_code);
+
+/* Called on the main thread before it changes what the emulation uses,
+   eg. for a hot key: stops the emulation thread, if it runs, at the end of
+   its frame. It goes on at the next SDL_EMUTHREAD_Step. */
+void SDL_EMUTHREAD_Pause(void);
+
+/* Returns TRUE when called on the emulation thread. */
+int SDL_EMUTHREAD_OnEmuThread(void);
+
+/* Runs FUNC(ARG) on the main thread and returns its result. Called on the
+   emulation thread, which waits for it; the main thread gets to it within
+   its next SDL_EMUTHREAD_Step. */
+int SDL_EMUTHREAD_CallOnMain(int (*func)(void *), void *arg);
+
+/* Called from a function run by SDL_EMUTHREAD_CallOnMain after it shut
+   down the display, for the emulation thread to exit the program: the
+   main thread then waits for good. */
+void SDL_EMUTHREAD_Halt(void);
+
+/* Takes the input sampled by the main thread since the start of the frame,
+   for PLATFORM_PollInput on the emulation thread. */
+void SDL_EMUTHREAD_PollInput(void);
+
+#endif /* SDL_EMUTHREAD */
+
+#endif /* SDL_EMUTHREAD_H_ */
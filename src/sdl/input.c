@@ -43,6 +43,7 @@
 
 #include "config.h"
 #include "sdl/input.h"
+#include "sdl/emuthread.h"
 #include "akey.h"
 #include "atari.h"
 #include "binload.h"
@@ -951,11 +952,21 @@ static Uint32 ResizeDelayCallback(Uint32 interval, void *param)
 static unsigned char *atari_screen_backup;
 #endif
 
+/* Stops the emulation thread, if any, at the end of its frame, before a
+   hot key or a window event changes what it uses. */
+static void PauseEmulation(void)
+{
+#ifdef SDL_EMUTHREAD
+	SDL_EMUTHREAD_Pause();
+#endif
+}
+
 int PLATFORM_Keyboard(void)
 {
 	int shiftctrl = 0;
 	SDL_Event event;
 	int keyboad_event_found = FALSE;
+	int consol;
 
 #ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
 	if (!atari_screen_backup)
@@ -1115,9 +1126,14 @@ int PLATFORM_Keyboard(void)
 			switch (event.window.event) {
 			case SDL_WINDOWEVENT_SIZE_CHANGED:
 			case SDL_WINDOWEVENT_RESIZED:
+				PauseEmulation();
 				VIDEOMODE_SetWindowSize(event.window.data1, event.window.data2);
 				break;
 			case SDL_WINDOWEVENT_EXPOSED:
+				PauseEmulation();
+#ifdef DIRTYRECT
+				Screen_EntireDirty();
+#endif
 				PLATFORM_DisplayScreen();
 				break;
 			}
@@ -1131,6 +1147,7 @@ int PLATFORM_Keyboard(void)
 				resize_h = event.resize.h;
 				resize_needed = TRUE;
 			} else {
+				PauseEmulation();
 				VIDEOMODE_SetWindowSize(event.resize.w, event.resize.h);
 				resize_delayed = TRUE;
 				if (SDL_AddTimer(RESIZE_INTERVAL, &ResizeDelayCallback, NULL) == NULL) {
@@ -1140,12 +1157,17 @@ int PLATFORM_Keyboard(void)
 				}
 			}
 #else
+			PauseEmulation();
 			VIDEOMODE_SetWindowSize(event.resize.w, event.resize.h);
 #endif /* HAVE_WINDOWS_H */
 			break;
 		case SDL_VIDEOEXPOSE:
 			/* When window is "uncovered", and we are in the emulator's menu,
 			   we need to refresh display manually. */
+			PauseEmulation();
+#ifdef DIRTYRECT
+			Screen_EntireDirty();
+#endif
 			PLATFORM_DisplayScreen();
 			break;
 #endif
@@ -1164,6 +1186,7 @@ int PLATFORM_Keyboard(void)
 					if (SDL_PeepEvents(events, 1, SDL_PEEKEVENT, SDL_EVENTMASK(SDL_VIDEORESIZE)) != 0)
 						resize_delayed = FALSE;
 					else {
+						PauseEmulation();
 						VIDEOMODE_SetWindowSize(resize_w, resize_h);
 						if (SDL_AddTimer(RESIZE_INTERVAL, &ResizeDelayCallback, NULL) == NULL) {
 							Log_print("Error: SDL_AddTimer failed: %s", SDL_GetError());
@@ -1194,18 +1217,21 @@ int PLATFORM_Keyboard(void)
 			switch (lastkey) {
 			case SDLK_f:
 				key_pressed = 0;
+				PauseEmulation();
 				VIDEOMODE_ToggleWindowed();
 				break;
 			case SDLK_x:
 				if (INPUT_key_shift) {
 					key_pressed = 0;
 #if defined(XEP80_EMULATION) || defined(PBI_PROTO80) || defined(AF80) || defined(BIT3)
+					PauseEmulation();
 					VIDEOMODE_Toggle80Column();
 #endif
 				}
 				break;
 			case SDLK_g:
 				key_pressed = 0;
+				PauseEmulation();
 				VIDEOMODE_ToggleHorizontalArea();
 				break;
 			case SDLK_j:
@@ -1263,6 +1289,7 @@ int PLATFORM_Keyboard(void)
 					if (Colours_setup->hue < COLOURS_HUE_MAX)
 						Colours_setup->hue += 0.02;
 				}
+				PauseEmulation();
 				Colours_Update();
 				return AKEY_NONE;
 			case SDLK_2:
@@ -1273,6 +1300,7 @@ int PLATFORM_Keyboard(void)
 					if (Colours_setup->saturation < COLOURS_SATURATION_MAX)
 						Colours_setup->saturation += 0.02;
 				}
+				PauseEmulation();
 				Colours_Update();
 				return AKEY_NONE;
 			case SDLK_3:
@@ -1283,6 +1311,7 @@ int PLATFORM_Keyboard(void)
 					if (Colours_setup->contrast < COLOURS_CONTRAST_MAX)
 					Colours_setup->contrast += 0.04;
 				}
+				PauseEmulation();
 				Colours_Update();
 				return AKEY_NONE;
 			case SDLK_4:
@@ -1293,6 +1322,7 @@ int PLATFORM_Keyboard(void)
 					if (Colours_setup->brightness < COLOURS_BRIGHTNESS_MAX)
 						Colours_setup->brightness += 0.04;
 				}
+				PauseEmulation();
 				Colours_Update();
 				return AKEY_NONE;
 			case SDLK_5:
@@ -1303,6 +1333,7 @@ int PLATFORM_Keyboard(void)
 					if (Colours_setup->gamma < COLOURS_GAMMA_MAX)
 						Colours_setup->gamma += 0.02;
 				}
+				PauseEmulation();
 				Colours_Update();
 				return AKEY_NONE;
 			case SDLK_6:
@@ -1313,6 +1344,7 @@ int PLATFORM_Keyboard(void)
 					if (Colours_setup->color_delay < COLOURS_DELAY_MAX)
 						Colours_setup->color_delay += 0.4;
 				}
+				PauseEmulation();
 				Colours_Update();
 				return AKEY_NONE;
 			case SDLK_LEFTBRACKET:
@@ -1418,20 +1450,25 @@ int PLATFORM_Keyboard(void)
 	}
 	*/
 
-	BINLOAD_pause_loading = FALSE;
+	if (BINLOAD_pause_loading) {
+		PauseEmulation();
+		BINLOAD_pause_loading = FALSE;
+	}
 
-	/* OPTION / SELECT / START keys */
-	INPUT_key_consol = INPUT_CONSOL_NONE;
+	/* OPTION / SELECT / START keys. Set in one go, as the emulation
+	   thread may be reading INPUT_key_consol. */
+	consol = INPUT_CONSOL_NONE;
 	if (get_key_state(kbhits, KBD_OPTION))
-		INPUT_key_consol &= ~INPUT_CONSOL_OPTION;
+		consol &= ~INPUT_CONSOL_OPTION;
 	if (get_key_state(kbhits, KBD_SELECT))
-		INPUT_key_consol &= ~INPUT_CONSOL_SELECT;
-	if (get_key_state(kbhits, KBD_START)) {
-		INPUT_key_consol &= ~INPUT_CONSOL_START;
-		/* Special case: 5200's START is mapped to console START */
-		if (Atari800_machine_type == Atari800_MACHINE_5200 && !UI_is_active)
-			return AKEY_5200_START;
-	}
+		consol &= ~INPUT_CONSOL_SELECT;
+	if (get_key_state(kbhits, KBD_START))
+		consol &= ~INPUT_CONSOL_START;
+	INPUT_key_consol = consol;
+	/* Special case: 5200's START is mapped to console START */
+	if (!(consol & INPUT_CONSOL_START)
+	    && Atari800_machine_type == Atari800_MACHINE_5200 && !UI_is_active)
+		return AKEY_5200_START;
 
 	/* CAPSLOCK Handling via Modifier State Sync */
 	{
@@ -1470,6 +1507,7 @@ int PLATFORM_Keyboard(void)
 		return AKEY_HELP ^ shiftctrl;
 	}
 	if (lastkey == KBD_BREAK) {
+		PauseEmulation();
 		if (BINLOAD_wait_active) {
 			BINLOAD_pause_loading = TRUE;
 			return AKEY_NONE;
@@ -1482,6 +1520,9 @@ int PLATFORM_Keyboard(void)
 		return INPUT_key_shift ? AKEY_SCREENSHOT_INTERLACE : AKEY_SCREENSHOT;
 	}
 	if (lastkey == KBD_TURBO) {
+		/* Rewinding goes on while the keys are held. */
+		if (INPUT_key_shift)
+			return AKEY_REWIND;
 		key_pressed = 0;
 		return AKEY_TURBO;
 	}
@@ -1967,7 +2008,11 @@ int PLATFORM_Keyboard(void)
 	return AKEY_NONE;
 }
 
-void SDL_INPUT_Mouse(void)
+/* Returns the mouse buttons as for INPUT_mouse_buttons. With
+   INPUT_direct_mouse, sets POT_X and POT_Y to the pot values of the mouse
+   position, otherwise DELTA_X and DELTA_Y to the movement since the last
+   call. */
+static int ReadMouse(int *delta_x, int *delta_y, int *pot_x, int *pot_y)
 {
 	Uint8 buttons;
 
@@ -1981,16 +2026,26 @@ void SDL_INPUT_Mouse(void)
 		poty = (double)poty * (228.0 / (double)SDL_VIDEO_height);
 		if(potx > 227) potx = 227;
 		if(poty > 227) poty = 227;
-		POKEY_POT_input[INPUT_mouse_port << 1] = 227 - potx;
-		POKEY_POT_input[(INPUT_mouse_port << 1) + 1] = 227 - poty;
+		*pot_x = 227 - potx;
+		*pot_y = 227 - poty;
 	} else {
-		buttons = SDL_GetRelativeMouseState(&INPUT_mouse_delta_x, &INPUT_mouse_delta_y);
+		buttons = SDL_GetRelativeMouseState(delta_x, delta_y);
 	}
 
-	INPUT_mouse_buttons =
-		((buttons & SDL_BUTTON(1)) ? 1 : 0) | /* Left button */
-		((buttons & SDL_BUTTON(3)) ? 2 : 0) | /* Right button */
-		((buttons & SDL_BUTTON(2)) ? 4 : 0); /* Middle button */
+	return ((buttons & SDL_BUTTON(1)) ? 1 : 0) | /* Left button */
+	       ((buttons & SDL_BUTTON(3)) ? 2 : 0) | /* Right button */
+	       ((buttons & SDL_BUTTON(2)) ? 4 : 0); /* Middle button */
+}
+
+void SDL_INPUT_Mouse(void)
+{
+	int pot_x, pot_y;
+
+	INPUT_mouse_buttons = ReadMouse(&INPUT_mouse_delta_x, &INPUT_mouse_delta_y, &pot_x, &pot_y);
+	if (INPUT_direct_mouse) {
+		POKEY_POT_input[INPUT_mouse_port << 1] = pot_x;
+		POKEY_POT_input[(INPUT_mouse_port << 1) + 1] = pot_y;
+	}
 }
 
 static void Init_SDL_Joysticks(void)
@@ -2459,7 +2514,22 @@ static int single_stick_port(int num) {
 	return port;
 }
 
-int PLATFORM_PORT(int num)
+void PLATFORM_PollInput(void)
+{
+#ifdef SDL_EMUTHREAD
+	/* Events can be pumped only on the main thread; take the input it
+	   has sampled since instead. */
+	if (SDL_EMUTHREAD_OnEmuThread()) {
+		SDL_EMUTHREAD_PollInput();
+		return;
+	}
+#endif
+	/* Updates the keyboard state array and the joysticks. The events stay
+	   queued for PLATFORM_Keyboard. */
+	SDL_PumpEvents();
+}
+
+static int ReadPort(int num)
 {
 #ifdef DONT_DISPLAY
 	return 0xff;
@@ -2469,7 +2539,7 @@ int PLATFORM_PORT(int num)
 #endif
 }
 
-int PLATFORM_TRIG(int num)
+static int ReadTrig(int num)
 {
 #ifdef DONT_DISPLAY
 	return 1;
@@ -2526,6 +2596,57 @@ int PLATFORM_TRIG(int num)
 #endif
 }
 
+/* Sample used instead of the devices, set by SDL_INPUT_UseSample. */
+static SDL_INPUT_sample_t const *sample = NULL;
+
+int PLATFORM_PORT(int num)
+{
+	if (sample != NULL)
+		return sample->port[num];
+	return ReadPort(num);
+}
+
+int PLATFORM_TRIG(int num)
+{
+	if (sample != NULL)
+		return num < 4 ? sample->trig[num] : 1;
+	return ReadTrig(num);
+}
+
+void SDL_INPUT_TakeSample(SDL_INPUT_sample_t *s, int key_code)
+{
+	int i;
+	s->key_code = key_code;
+	s->key_shift = INPUT_key_shift;
+	s->key_consol = INPUT_key_consol;
+	for (i = 0; i < 2; i++)
+		s->port[i] = ReadPort(i);
+	for (i = 0; i < 4; i++)
+		s->trig[i] = ReadTrig(i);
+	s->mouse_delta_x = s->mouse_delta_y = 0;
+	s->mouse_pot_x = s->mouse_pot_y = 0;
+	s->mouse_buttons = ReadMouse(&s->mouse_delta_x, &s->mouse_delta_y, &s->mouse_pot_x, &s->mouse_pot_y);
+}
+
+void SDL_INPUT_UseSample(SDL_INPUT_sample_t const *s)
+{
+	sample = s;
+	if (s == NULL)
+		return;
+	INPUT_key_code = s->key_code;
+	INPUT_key_shift = s->key_shift;
+	INPUT_key_consol = s->key_consol;
+	INPUT_mouse_buttons = s->mouse_buttons;
+	if (INPUT_direct_mouse) {
+		POKEY_POT_input[INPUT_mouse_port << 1] = s->mouse_pot_x;
+		POKEY_POT_input[(INPUT_mouse_port << 1) + 1] = s->mouse_pot_y;
+	}
+	else {
+		INPUT_mouse_delta_x = s->mouse_delta_x;
+		INPUT_mouse_delta_y = s->mouse_delta_y;
+	}
+}
+
 #ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
 
 #define REPEAT_DELAY 100  /* in ms */
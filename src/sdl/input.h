@@ -42,6 +42,31 @@ void SDL_INPUT_Restart(void);
 
 void SDL_INPUT_Mouse(void);
 
+/* The state of the keyboard, joysticks and mouse at one moment, as taken
+   on the main thread for the emulation thread (see sdl/emuthread.h). */
+typedef struct SDL_INPUT_sample_t {
+	int key_code;
+	int key_shift;
+	int key_consol;
+	int port[2];
+	int trig[4];
+	int mouse_buttons;
+	/* Movement since the previous sample, or with INPUT_direct_mouse the
+	   pot values of the mouse position. */
+	int mouse_delta_x;
+	int mouse_delta_y;
+	int mouse_pot_x;
+	int mouse_pot_y;
+} SDL_INPUT_sample_t;
+
+/* Fills SAMPLE from the devices, KEY_CODE being what PLATFORM_Keyboard
+   just returned. Does not change any of the INPUT_ variables. */
+void SDL_INPUT_TakeSample(SDL_INPUT_sample_t *sample, int key_code);
+/* Sets the INPUT_ variables from SAMPLE, and makes PLATFORM_PORT and
+   PLATFORM_TRIG return the values in SAMPLE, even as they are updated,
+   until called with NULL. */
+void SDL_INPUT_UseSample(SDL_INPUT_sample_t const *sample);
+
 /*Get pointer to a real joystick configuration (for UI)*/
 SDL_INPUT_RealJSConfig_t* SDL_INPUT_GetRealJSConfig(int joyIndex);
 
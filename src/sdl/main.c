@@ -50,6 +50,7 @@
 #include "ui_basic.h"
 #endif
 #include "videomode.h"
+#include "sdl/emuthread.h"
 #include "sdl/video.h"
 #include "sdl/input.h"
 
@@ -71,13 +72,20 @@ void PLATFORM_ConfigInit(void)
 int PLATFORM_Configure(char *option, char *parameters)
 {
 	return SDL_VIDEO_ReadConfig(option, parameters) ||
-	       SDL_INPUT_ReadConfig(option, parameters);
+	       SDL_INPUT_ReadConfig(option, parameters)
+#ifdef SDL_EMUTHREAD
+	       || SDL_EMUTHREAD_ReadConfig(option, parameters)
+#endif
+	       ;
 }
 
 void PLATFORM_ConfigSave(FILE *fp)
 {
 	SDL_VIDEO_WriteConfig(fp);
 	SDL_INPUT_WriteConfig(fp);
+#ifdef SDL_EMUTHREAD
+	SDL_EMUTHREAD_WriteConfig(fp);
+#endif
 }
 
 int PLATFORM_Initialise(int *argc, char *argv[])
@@ -108,14 +116,45 @@ int PLATFORM_Initialise(int *argc, char *argv[])
 #ifdef SOUND
 	    || !Sound_Initialise(argc, argv)
 #endif
-	    || !SDL_INPUT_Initialise(argc, argv))
+	    || !SDL_INPUT_Initialise(argc, argv)
+#ifdef SDL_EMUTHREAD
+	    || !SDL_EMUTHREAD_Initialise(argc, argv)
+#endif
+	    )
 		return FALSE;
 
 	return TRUE;
 }
 
+#ifdef SDL_EMUTHREAD
+static int ExitOnMain(void *run_monitor)
+{
+	int result = PLATFORM_Exit(*(int *) run_monitor);
+	if (!result)
+		/* The emulation thread goes on to shut down the emulator. */
+		SDL_EMUTHREAD_Halt();
+	return result;
+}
+#endif /* SDL_EMUTHREAD */
+
+int PLATFORM_RunOnUIThread(int (*func)(void *), void *arg, int *result)
+{
+#ifdef SDL_EMUTHREAD
+	if (SDL_EMUTHREAD_OnEmuThread()) {
+		*result = SDL_EMUTHREAD_CallOnMain(func, arg);
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
 int PLATFORM_Exit(int run_monitor)
 {
+#ifdef SDL_EMUTHREAD
+	/* The monitor and SDL itself must be handled on the main thread. */
+	if (SDL_EMUTHREAD_OnEmuThread())
+		return SDL_EMUTHREAD_CallOnMain(&ExitOnMain, &run_monitor);
+#endif
 	SDL_INPUT_Exit();
 	if (run_monitor) {
 		/* disable graphics, set alpha mode */
@@ -160,6 +199,37 @@ static BOOL CtrlHandler(DWORD fdwCtrlType)
 }
 #endif /* HAVE_WINDOWS_H */
 
+/* Emulates a frame on the main thread, KEY_CODE being what
+   PLATFORM_Keyboard returned. */
+static void Frame(int key_code)
+{
+	INPUT_key_code = key_code;
+#ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
+	if (INPUT_key_code == AKEY_KEYB) {
+		Sound_Pause();
+		UI_BASIC_in_kbui = TRUE;
+		INPUT_key_code = UI_BASIC_OnScreenKeyboard(NULL, Atari800_machine_type);
+		UI_BASIC_in_kbui = FALSE;
+		switch (INPUT_key_code) {
+			case AKEY_OPTION: INPUT_key_consol &= (~INPUT_CONSOL_OPTION); break;
+			case AKEY_SELECT: INPUT_key_consol &= (~INPUT_CONSOL_SELECT); break;
+			case AKEY_START: INPUT_key_consol &= (~INPUT_CONSOL_START); break;
+		}
+
+		/* flush keypresses so the key used to confirm the
+		 * on-screen keyboard does not reach the emulator */
+		while (PLATFORM_Keyboard() != AKEY_NONE)
+			Atari800_Sync();
+
+		Sound_Continue();
+	}
+#endif
+	SDL_INPUT_Mouse();
+	Atari800_Frame();
+	if (Atari800_display_screen)
+		PLATFORM_DisplayScreen();
+}
+
 int main(int argc, char **argv)
 {
 #if HAVE_WINDOWS_H
@@ -184,31 +254,12 @@ int main(int argc, char **argv)
 
 	/* main loop */
 	for (;;) {
-		INPUT_key_code = PLATFORM_Keyboard();
-#ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
-		if (INPUT_key_code == AKEY_KEYB) {
-			Sound_Pause();
-			UI_BASIC_in_kbui = TRUE;
-			INPUT_key_code = UI_BASIC_OnScreenKeyboard(NULL, Atari800_machine_type);
-			UI_BASIC_in_kbui = FALSE;
-			switch (INPUT_key_code) {
-				case AKEY_OPTION: INPUT_key_consol &= (~INPUT_CONSOL_OPTION); break;
-				case AKEY_SELECT: INPUT_key_consol &= (~INPUT_CONSOL_SELECT); break;
-				case AKEY_START: INPUT_key_consol &= (~INPUT_CONSOL_START); break;
-			}
-
-			/* flush keypresses so the key used to confirm the
-			 * on-screen keyboard does not reach the emulator */
-			while (PLATFORM_Keyboard() != AKEY_NONE)
-				Atari800_Sync();
-
-			Sound_Continue();
-		}
+		int key_code = PLATFORM_Keyboard();
+#ifdef SDL_EMUTHREAD
+		if (SDL_EMUTHREAD_Step(key_code))
+			continue;
 #endif
-		SDL_INPUT_Mouse();
-		Atari800_Frame();
-		if (Atari800_display_screen)
-			PLATFORM_DisplayScreen();
+		Frame(key_code);
 	}
 }
 
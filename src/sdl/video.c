@@ -26,6 +26,7 @@
 
 #include "af80.h"
 #include "bit3.h"
+#include "blit.h"
 #include "artifact.h"
 #include "atari.h"
 #include "colours.h"
@@ -70,6 +71,7 @@ SDL_Renderer* SDL_VIDEO_renderer = NULL;
 SDL_Texture* SDL_VIDEO_texture = NULL;
 #endif
 SDL_Surface *SDL_VIDEO_screen = NULL;
+UBYTE *SDL_VIDEO_atari_frame = NULL;
 
 /* Desktop screen resolution is stored here on initialisation. */
 static VIDEOMODE_resolution_t desktop_resolution;
@@ -557,6 +559,7 @@ int SDL_VIDEO_Initialise(int *argc, char *argv[])
 void SDL_VIDEO_Exit(void)
 {
 	SDL_VIDEO_QuitSDL();
+	SDL_VIDEO_SW_Exit();
 #ifdef NTSC_FILTER
 	if (FILTER_NTSC_emu)
 #endif
@@ -580,57 +583,22 @@ void SDL_VIDEO_BlitNormal8(Uint32 *dest, Uint8 *src, int pitch, int width, int h
 
 void SDL_VIDEO_BlitNormal16(Uint32 *dest, Uint8 *src, int pitch, int width, int height, Uint16 *palette16)
 {
-	register Uint32 quad;
-	register Uint32 *start32 = dest;
-	register Uint8 c;
-	register int pos;
-	int width_32;
-	if (width & 0x01)
-		width_32 = width + 1;
-	else
-		width_32 = width;
+	/* Rows are written in whole 32-bit words. */
+	int width_32 = (width + 1) & ~1;
 	while (height > 0) {
-		pos = width_32;
-		do {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			pos--;
-			c = src[pos];
-			quad = palette16[c];
-			pos--;
-			c = src[pos];
-			quad += palette16[c] << 16;
-#else
-			pos--;
-			c = src[pos];
-			quad = palette16[c] << 16;
-			pos--;
-			c = src[pos];
-			quad += palette16[c];
-#endif
-			start32[pos >> 1] = quad;
-		} while (pos > 0);
+		BLIT_Expand8to16((UWORD *) dest, src, width_32, (UWORD const *) palette16);
 		src += Screen_WIDTH;
-		start32 += pitch;
+		dest += pitch;
 		height--;
 	}
 }
 
 void SDL_VIDEO_BlitNormal32(Uint32 *dest, Uint8 *src, int pitch, int width, int height, Uint32 *palette32)
 {
-	register Uint32 quad;
-	register Uint32 *start32 = dest;
-	register Uint8 c;
-	register int pos;
 	while (height > 0) {
-		pos = width;
-		do {
-			pos--;
-			c = src[pos];
-			quad = palette32[c];
-			start32[pos] = quad;
-		} while (pos > 0);
+		BLIT_Expand8to32((ULONG *) dest, src, width, (ULONG const *) palette32);
 		src += Screen_WIDTH;
-		start32 += pitch;
+		dest += pitch;
 		height--;
 	}
 }
@@ -648,57 +616,22 @@ void SDL_VIDEO_BlitXEP80_8(Uint32 *dest, Uint8 *src, int pitch, int width, int h
 
 void SDL_VIDEO_BlitXEP80_16(Uint32 *dest, Uint8 *src, int pitch, int width, int height, Uint16 *palette16)
 {
-	register Uint32 quad;
-	register Uint32 *start32 = dest;
-	register Uint8 c;
-	register int pos;
-	int width_32;
-	if (width & 0x01)
-		width_32 = width + 1;
-	else
-		width_32 = width;
+	/* Rows are written in whole 32-bit words. */
+	int width_32 = (width + 1) & ~1;
 	while (height > 0) {
-		pos = width_32;
-		do {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			pos--;
-			c = src[pos];
-			quad = palette16[c];
-			pos--;
-			c = src[pos];
-			quad += palette16[c] << 16;
-#else
-			pos--;
-			c = src[pos];
-			quad = palette16[c] << 16;
-			pos--;
-			c = src[pos];
-			quad += palette16[c];
-#endif
-			start32[pos >> 1] = quad;
-		} while (pos > 0);
+		BLIT_Expand8to16((UWORD *) dest, src, width_32, (UWORD const *) palette16);
 		src += XEP80_SCRN_WIDTH;
-		start32 += pitch;
+		dest += pitch;
 		height--;
 	}
 }
 
 void SDL_VIDEO_BlitXEP80_32(Uint32 *dest, Uint8 *src, int pitch, int width, int height, Uint32 *palette32)
 {
-	register Uint32 quad;
-	register Uint32 *start32 = dest;
-	register Uint8 c;
-	register int pos;
 	while (height > 0) {
-		pos = width;
-		do {
-			pos--;
-			c = src[pos];
-			quad = palette32[c];
-			start32[pos] = quad;
-		} while (pos > 0);
+		BLIT_Expand8to32((ULONG *) dest, src, width, (ULONG const *) palette32);
 		src += XEP80_SCRN_WIDTH;
-		start32 += pitch;
+		dest += pitch;
 		height--;
 	}
 }
@@ -909,16 +842,10 @@ void SDL_VIDEO_BlitAF80_32(Uint32 *dest, int first_column, int last_column, int
 	UBYTE pixels;
 	for (; first_line < last_line; first_line++) {
 		for (column = first_column; column < last_column; column++) {
-			int i;
 			int colour;
 			pixels = AF80_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 8; i++) {
-				if (pixels & 0x01)
-					*start32++ = palette32[colour];
-				else
-					*start32++ = black;
-				pixels >>= 1;
-			}
+			BLIT_ExpandBits32((ULONG *) start32, pixels, palette32[colour], black);
+			start32 += 8;
 		}
 		start32 += skip;
 	}
@@ -1021,16 +948,10 @@ void SDL_VIDEO_BlitBIT3_32(Uint32 *dest, int first_column, int last_column, int
 	UBYTE pixels;
 	for (; first_line < last_line; first_line++) {
 		for (column = first_column; column < last_column; column++) {
-			int i;
 			int colour;
 			pixels = BIT3_GetPixels(first_line, column, &colour, blink);
-			for (i = 0; i < 8; i++) {
-				if (pixels & 0x01)
-					*start32++ = palette32[colour];
-				else
-					*start32++ = black;
-				pixels >>= 1;
-			}
+			BLIT_ExpandBits32((ULONG *) start32, pixels, palette32[colour], black);
+			start32 += 8;
 		}
 		start32 += skip;
 	}
@@ -5,6 +5,8 @@
 #include <SDL.h>
 
 #include "config.h"
+#include "atari.h"
+#include "screen.h"
 #include "videomode.h"
 
 /* Native BPP of the desktop. OpenGL modes can be opened only
@@ -25,6 +27,12 @@ extern SDL_Texture* SDL_VIDEO_texture;
 #endif
 extern SDL_Surface *SDL_VIDEO_screen;
 
+/* If not NULL, the Atari screen to show instead of Screen_atari, laid out
+   the same way. Set by the emulation thread's caller while it presents a
+   finished frame (see sdl/emuthread.h). */
+extern UBYTE *SDL_VIDEO_atari_frame;
+#define SDL_VIDEO_ATARI_SCREEN (SDL_VIDEO_atari_frame != NULL ? SDL_VIDEO_atari_frame : (UBYTE *) Screen_atari)
+
 #if HAVE_OPENGL
 /* Indicates whenther OpenGL is available on the host machine. */
 extern int SDL_VIDEO_opengl_available;
@@ -1038,7 +1038,7 @@ int SDL_VIDEO_GL_SupportsVideomode(VIDEOMODE_MODE_t mode, int stretch, int rotat
 
 static void DisplayNormal(GLvoid *dest)
 {
-	Uint8 *screen = (Uint8 *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	Uint8 *screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
 	if (bpp_32)
 		SDL_VIDEO_BlitNormal32((Uint32*)dest, screen, VIDEOMODE_actual_width, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp32);
 	else {
@@ -1054,7 +1054,7 @@ static void DisplayNormal(GLvoid *dest)
 #ifdef PAL_BLENDING
 static void DisplayPalBlending(GLvoid *dest)
 {
-	Uint8 *screen = (Uint8 *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	Uint8 *screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
 	if (bpp_32)
 		PAL_BLENDING_Blit32((ULONG*)dest, screen, VIDEOMODE_actual_width, VIDEOMODE_src_width, VIDEOMODE_src_height, VIDEOMODE_src_offset_top % 2);
 	else {
@@ -1073,7 +1073,7 @@ static void DisplayNTSCEmu(GLvoid *dest)
 {
 	(*pixel_formats[SDL_VIDEO_GL_pixel_format].ntsc_blit_func)(
 		FILTER_NTSC_emu,
-		(ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left),
+		(ATARI_NTSC_IN_T *) (SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left),
 		Screen_WIDTH,
 		VIDEOMODE_src_width,
 		VIDEOMODE_src_height,
@@ -23,6 +23,7 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <SDL.h>
 #if SDL2
@@ -32,6 +33,7 @@
 #endif
 #include "af80.h"
 #include "bit3.h"
+#include "blit.h"
 #include "artifact.h"
 #include "atari.h"
 #include "colours.h"
@@ -44,10 +46,12 @@
 #endif /* PAL_BLENDING */
 #include "platform.h"
 #include "screen.h"
+#include "ui.h"
 #include "videomode.h"
 #include "xep80.h"
 #include "xep80_fonts.h"
 #include "util.h"
+#include "workers.h"
 
 #include "sdl/palette.h"
 #include "sdl/video.h"
@@ -99,6 +103,18 @@ static void (*blit_funcs[VIDEOMODE_MODE_SIZE])(void) = {
 #endif
 };
 
+/* Most bands of lines sent to the display in a frame of an 80-column
+   card. */
+#define MAX_TEXT_RECTS 32
+
+/* Whether the surface holds what was drawn at the last frame of an
+   80-column card, so that only what changed since needs drawing. */
+static int text_drawn = FALSE;
+/* The surface rectangles changed by drawing the current frame of an
+   80-column card, or -1 if the whole displayed area must be sent. */
+static SDL_Rect text_rects[MAX_TEXT_RECTS];
+static int text_num_rects = -1;
+
 void SDL_VIDEO_SW_GetPixelFormat(PLATFORM_pixel_format_t *format)
 {
 	format->bpp = SDL_VIDEO_SW_bpp;
@@ -167,6 +183,11 @@ static void UpdatePaletteLookup(VIDEOMODE_MODE_t mode)
 void SDL_VIDEO_SW_PaletteUpdate(void)
 {
 	UpdatePaletteLookup(SDL_VIDEO_current_display_mode);
+	text_drawn = FALSE;
+#ifdef DIRTYRECT
+	/* All pixels on the surface change colour. */
+	Screen_EntireDirty();
+#endif
 }
 
 static void ModeInfo(void)
@@ -317,6 +338,11 @@ void SDL_VIDEO_SW_SetVideoMode(VIDEOMODE_resolution_t const *res, int windowed,
 		SDL_FillRect(SDL_VIDEO_screen, NULL, 0);
 #endif /* SDL2 */
 	SDL_ShowCursor(SDL_DISABLE);	/* hide mouse cursor */
+	text_drawn = FALSE;
+#ifdef DIRTYRECT
+	/* The surface has been cleared, so the next frame must be drawn whole. */
+	Screen_EntireDirty();
+#endif
 
 	if (mode == VIDEOMODE_MODE_NORMAL) {
 		if (rotate90)
@@ -377,6 +403,77 @@ int SDL_VIDEO_SW_ToggleBpp(void)
 	return SDL_VIDEO_SW_SetBpp(new_bpp);
 }
 
+/* Source column for each pixel of a scaled row, see BLIT_ScaleColumns. */
+static int *scale_columns = NULL;
+static int scale_columns_size = 0;
+
+/* Number of threads, besides the emulation thread, that draw the output
+   in horizontal bands. -1 means one per extra CPU core, 0 disables. */
+int SDL_VIDEO_SW_threads = -1;
+
+static Workers_pool_t *band_pool = NULL;
+static int band_pool_created = FALSE;
+
+/* Bands smaller than this are not worth handing to another thread. */
+#define MIN_BAND_ROWS 16
+
+typedef void (*band_func_t)(void *arg, int first, int last);
+
+typedef struct band_job_t {
+	band_func_t func;
+	void *arg;
+	int rows;
+	int num_bands;
+} band_job_t;
+
+static void BandJob(void *arg, int job)
+{
+	band_job_t *b = (band_job_t *) arg;
+	b->func(b->arg, b->rows * job / b->num_bands, b->rows * (job + 1) / b->num_bands);
+}
+
+/* Calls FUNC(ARG, first, last) for adjacent bands that together cover rows
+   0..ROWS-1, in parallel on the band pool, and returns when all are done. */
+static void RunBands(band_func_t func, void *arg, int rows)
+{
+	band_job_t b;
+	if (!band_pool_created) {
+		int n = SDL_VIDEO_SW_threads;
+		if (n < 0)
+			n = Workers_NumCPUs() - 1;
+		band_pool = Workers_CreatePool(n);
+		band_pool_created = TRUE;
+	}
+	if (band_pool == NULL || rows < 2 * MIN_BAND_ROWS) {
+		if (rows > 0)
+			func(arg, 0, rows);
+		return;
+	}
+	b.func = func;
+	b.arg = arg;
+	b.rows = rows;
+	b.num_bands = Workers_Concurrency(band_pool);
+	if (b.num_bands > rows / MIN_BAND_ROWS)
+		b.num_bands = rows / MIN_BAND_ROWS;
+	Workers_Run(band_pool, BandJob, &b, b.num_bands);
+}
+
+void SDL_VIDEO_SW_SetThreads(int value)
+{
+	SDL_VIDEO_SW_threads = value;
+	Workers_DestroyPool(band_pool);
+	band_pool = NULL;
+	band_pool_created = FALSE;
+}
+
+void SDL_VIDEO_SW_Exit(void)
+{
+	SDL_VIDEO_SW_SetThreads(SDL_VIDEO_SW_threads);
+	free(scale_columns);
+	scale_columns = NULL;
+	scale_columns_size = 0;
+}
+
 /* License of scanLines_16():*/
 /* This function has been altered from its original version */
 /* This license is a verbatim copy of the license of ZLib
@@ -412,15 +509,96 @@ int SDL_VIDEO_SW_ToggleBpp(void)
  ******************************************************************************
  */
 
+typedef struct scanlines_band_t {
+	Uint32 *buffer;
+	int width;
+	int pitch;
+	int pct;
+	int interpolate;
+} scanlines_band_t;
+
+/* Fills scanline pairs FIRST..LAST-1: each odd line is computed from the
+   even line above it (and, when interpolating, the one below). */
+static void ScanLinesBand_16(void *arg, int first, int last)
+{
+	scanlines_band_t const *band = (scanlines_band_t const *) arg;
+	Uint32* sBuf = band->buffer + band->pitch * first;
+	Uint32* pBuf = sBuf + band->pitch / 2;
+	Uint32* tBuf = sBuf + band->pitch;
+	int const width = band->width;
+	Uint32 const scanLinesPct = band->pct;
+	int w, h;
+
+	for (h = first; h < last; h++) {
+		if (band->pct < 0)
+			memcpy(pBuf, sBuf, width * sizeof(Uint32));
+		else if (band->interpolate) {
+			for (w = 0; w < width; w++) {
+				Uint32 pixel = sBuf[w];
+				Uint32 pixel2 = tBuf[w];
+				Uint32 a = ((((pixel & 0x07e0f81f)+(pixel2 & 0x07e0f81f)) * scanLinesPct) & 0xfc1f03e0) >> 5;
+				Uint32 b = ((((pixel >> 5) & 0x07c0f83f)+((pixel2 >> 5) & 0x07c0f83f)) * scanLinesPct) & 0xf81f07e0;
+				pBuf[w] = a | b;
+			}
+		}
+		else {
+			for (w = 0; w < width; w++) {
+				Uint32 pixel = sBuf[w];
+				Uint32 a = (((pixel & 0x07e0f81f) * scanLinesPct) & 0xfc1f03e0) >> 5;
+				Uint32 b = (((pixel >> 5) & 0x07c0f83f) * scanLinesPct) & 0xf81f07e0;
+				pBuf[w] = a | b;
+			}
+		}
+		sBuf += band->pitch;
+		tBuf += band->pitch;
+		pBuf += band->pitch;
+	}
+}
+
+static void ScanLinesBand_32(void *arg, int first, int last)
+{
+	scanlines_band_t const *band = (scanlines_band_t const *) arg;
+	Uint32* sBuf = band->buffer + band->pitch * first;
+	Uint32* pBuf = sBuf + band->pitch / 2;
+	Uint32* tBuf = sBuf + band->pitch;
+	int const width = band->width;
+	Uint32 const scanLinesPct = band->pct;
+	int w, h;
+
+	for (h = first; h < last; h++) {
+		if (band->pct < 0)
+			memcpy(pBuf, sBuf, width * sizeof(Uint32));
+		else if (band->interpolate) {
+			for (w = 0; w < width; w++) {
+				Uint32 pixel = sBuf[w];
+				Uint32 pixel2 = tBuf[w];
+				Uint32 a = ((((pixel & 0x00ff00ff)+(pixel2 & 0x00ff00ff)) * scanLinesPct) & 0xff00ff00) >> 8;
+				Uint32 b = ((((pixel & 0x0000ff00)+(pixel2 & 0x0000ff00)) >> 8) * scanLinesPct) & 0x0000ff00;
+				pBuf[w] = a | b;
+			}
+		}
+		else {
+			for (w = 0; w < width; w++) {
+				Uint32 pixel = sBuf[w];
+				Uint32 a = (((pixel & 0x00ff00ff) * scanLinesPct) & 0xff00ff00) >> 8;
+				Uint32 b = (((pixel & 0x0000ff00) >> 8) * scanLinesPct) & 0x0000ff00;
+				pBuf[w] = a | b;
+			}
+		}
+		sBuf += band->pitch;
+		tBuf += band->pitch;
+		pBuf += band->pitch;
+	}
+}
+
 /* Modified version, which optionally uses interpolation (slower but better).
    Caution! This function assumes that the 16-bit screen format is 565
    (rrrrrggg gggbbbbb). */
 static void scanLines_16(void* pBuffer, int width, int height, int pitch, int scanLinesPct)
 {
 	Uint32* pBuf = (Uint32*)(pBuffer)+pitch/sizeof(Uint32);
-	Uint32* sBuf = (Uint32*)(pBuffer);
-	Uint32* tBuf = (Uint32*)(pBuffer)+pitch*2/sizeof(Uint32);
-	int w, h;
+	int h;
+	scanlines_band_t band;
 	static int prev_scanLinesPct;
 
 	pitch = pitch * 2 / (int)sizeof(Uint32);
@@ -444,43 +622,25 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 	prev_scanLinesPct = scanLinesPct;
 
 
+	band.buffer = (Uint32 *) pBuffer;
+	band.width = width;
+	band.pitch = pitch;
 	if (scanLinesPct == 0) {
-	/* fill in blank scanlines */
-		for (h = 0; h < height; h++) {
-			memcpy(pBuf, sBuf, width * sizeof(Uint32));
-			sBuf += pitch;
-			pBuf += pitch;
-		}
-		return;
+		/* fill in blank scanlines */
+		band.pct = -1;
+		band.interpolate = FALSE;
 	}
-
-	if (SDL_VIDEO_interpolate_scanlines) {
-		scanLinesPct = (100-scanLinesPct) * 32 / 200;
-		for (h = 0; h < height-1; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 pixel2 = tBuf[w];
-				Uint32 a = ((((pixel & 0x07e0f81f)+(pixel2 & 0x07e0f81f)) * scanLinesPct) & 0xfc1f03e0) >> 5;
-				Uint32 b = ((((pixel >> 5) & 0x07c0f83f)+((pixel2 >> 5) & 0x07c0f83f)) * scanLinesPct) & 0xf81f07e0;
-				pBuf[w] = a | b;
-			}
-			sBuf += pitch;
-			tBuf += pitch;
-			pBuf += pitch;
-		}
-	} else {
-		scanLinesPct = (100-scanLinesPct) * 32 / 100;
-		for (h = 0; h < height; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 a = (((pixel & 0x07e0f81f) * scanLinesPct) & 0xfc1f03e0) >> 5;
-				Uint32 b = (((pixel >> 5) & 0x07c0f83f) * scanLinesPct) & 0xf81f07e0;
-				pBuf[w] = a | b;
-			}
-			sBuf += pitch;
-			pBuf += pitch;
-		}
+	else if (SDL_VIDEO_interpolate_scanlines) {
+		band.pct = (100-scanLinesPct) * 32 / 200;
+		band.interpolate = TRUE;
+		/* The last scanline has no line below to interpolate with. */
+		height--;
 	}
+	else {
+		band.pct = (100-scanLinesPct) * 32 / 100;
+		band.interpolate = FALSE;
+	}
+	RunBands(&ScanLinesBand_16, &band, height);
 }
 
 /* Modified version of scanLines_16, for 32-bit screen.
@@ -489,9 +649,8 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 static void scanLines_32(void* pBuffer, int width, int height, int pitch, int scanLinesPct)
 {
 	Uint32* pBuf = (Uint32*)(pBuffer)+pitch/sizeof(Uint32);
-	Uint32* sBuf = (Uint32*)(pBuffer);
-	Uint32* tBuf = (Uint32*)(pBuffer)+pitch*2/sizeof(Uint32);
-	int w, h;
+	int h;
+	scanlines_band_t band;
 	static int prev_scanLinesPct;
 
 	pitch = pitch * 2 / (int)sizeof(Uint32);
@@ -514,52 +673,136 @@ static void scanLines_32(void* pBuffer, int width, int height, int pitch, int sc
 	prev_scanLinesPct = scanLinesPct;
 
 
+	band.buffer = (Uint32 *) pBuffer;
+	band.width = width;
+	band.pitch = pitch;
 	if (scanLinesPct == 0) {
-	/* fill in blank scanlines */
-		for (h = 0; h < height; h++) {
-			memcpy(pBuf, sBuf, width * sizeof(Uint32));
-			sBuf += pitch;
-			pBuf += pitch;
-		}
-		return;
+		/* fill in blank scanlines */
+		band.pct = -1;
+		band.interpolate = FALSE;
+	}
+	else if (SDL_VIDEO_interpolate_scanlines) {
+		band.pct = (100-scanLinesPct) * 256 / 200;
+		band.interpolate = TRUE;
+		/* The last scanline has no line below to interpolate with. */
+		height--;
+	}
+	else {
+		band.pct = (100-scanLinesPct) * 256 / 100;
+		band.interpolate = FALSE;
 	}
+	RunBands(&ScanLinesBand_32, &band, height);
+}
 
-	if (SDL_VIDEO_interpolate_scanlines) {
-		scanLinesPct = (100-scanLinesPct) * 256 / 200;
-		for (h = 0; h < height-1; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 pixel2 = tBuf[w];
-				Uint32 a = ((((pixel & 0x00ff00ff)+(pixel2 & 0x00ff00ff)) * scanLinesPct) & 0xff00ff00) >> 8;
-				Uint32 b = ((((pixel & 0x0000ff00)+(pixel2 & 0x0000ff00)) >> 8) * scanLinesPct) & 0x0000ff00;
-				pBuf[w] = a | b;
-			}
-			sBuf += pitch;
-			tBuf += pitch;
-			pBuf += pitch;
-		}
-	} else {
-		scanLinesPct = (100-scanLinesPct) * 256 / 100;
-		for (h = 0; h < height; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 a = (((pixel & 0x00ff00ff) * scanLinesPct) & 0xff00ff00) >> 8;
-				Uint32 b = (((pixel & 0x0000ff00) >> 8) * scanLinesPct) & 0x0000ff00;
-				pBuf[w] = a | b;
-			}
-			sBuf += pitch;
-			pBuf += pitch;
+#if defined(XEP80_EMULATION) || defined(AF80) || defined(BIT3)
+/* Returns whether the current frame of an 80-column card may be drawn only
+   where it changed, and starts collecting the changed rectangles if so.
+   REDRAW tells that the card's whole screen looks different. */
+static int TextIncremental(int redraw)
+{
+	static int drawn_scanlines_percentage;
+	static int drawn_interpolate_scanlines;
+	int usable = text_drawn && !redraw
+	             && drawn_scanlines_percentage == SDL_VIDEO_scanlines_percentage
+	             && drawn_interpolate_scanlines == SDL_VIDEO_interpolate_scanlines
+#if !SDL2
+	             && !(SDL_VIDEO_screen->flags & SDL_DOUBLEBUF)
+#endif
+	             ;
+	/* The card's screen is not kept steady while the emulation thread
+	   runs, so its frames are drawn whole. */
+	text_drawn = SDL_VIDEO_atari_frame == NULL;
+	drawn_scanlines_percentage = SDL_VIDEO_scanlines_percentage;
+	drawn_interpolate_scanlines = SDL_VIDEO_interpolate_scanlines;
+	text_num_rects = usable ? 0 : -1;
+	return usable;
+}
+
+/* Applies scanlines to the whole displayed area, at PIXELS. */
+static void TextScanlines(Uint8 *pixels)
+{
+	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
+	case 16:
+		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		break;
+	case 32:
+		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		break;
+	}
+}
+
+/* Called after drawing lines FIRST..LAST-1 of the displayed area, at
+   PIXELS, in an incremental frame: applies scanlines to them and adds them
+   to the rectangles to send. */
+static void TextLinesChanged(Uint8 *pixels, int first, int last)
+{
+	/* Scanlines between two lines depend on both. */
+	int top = first > 0 ? first - 1 : 0;
+	int bottom = last < (int) VIDEOMODE_src_height ? last + 1 : last;
+	SDL_Rect *r;
+
+	pixels += SDL_VIDEO_screen->pitch * 2 * top;
+	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
+	case 16:
+		scanLines_16((void *)pixels, VIDEOMODE_dest_width, 2 * (bottom - top), SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		break;
+	case 32:
+		scanLines_32((void *)pixels, VIDEOMODE_dest_width, 2 * (bottom - top), SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		break;
+	}
+
+	top = VIDEOMODE_dest_offset_top + 2 * top;
+	bottom = VIDEOMODE_dest_offset_top + (2 * bottom < (int) VIDEOMODE_dest_height ? 2 * bottom : (int) VIDEOMODE_dest_height);
+	if (text_num_rects < 0)
+		return;
+	if (text_num_rects > 0) {
+		r = &text_rects[text_num_rects - 1];
+		if (r->y + r->h >= top) {
+			r->h = bottom - r->y;
+			return;
 		}
 	}
+	if (text_num_rects == MAX_TEXT_RECTS) {
+		text_num_rects = -1;
+		return;
+	}
+	r = &text_rects[text_num_rects++];
+	r->x = VIDEOMODE_dest_offset_left;
+	r->y = top;
+	r->w = VIDEOMODE_dest_width;
+	r->h = bottom - top;
 }
+#endif /* defined(XEP80_EMULATION) || defined(AF80) || defined(BIT3) */
 
 #ifdef XEP80_EMULATION
+/* Draws lines FIRST..LAST-1 of the displayed area from SCREEN to
+   PIXELS. */
+static void BlitXEP80Lines(Uint8 *pixels, UBYTE *screen, int first, int last)
+{
+	int pitch4 = SDL_VIDEO_screen->pitch / 2;
+	pixels += SDL_VIDEO_screen->pitch * 2 * first;
+	screen += XEP80_SCRN_WIDTH * first;
+	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
+	case 8:
+		SDL_VIDEO_BlitXEP80_8((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, last - first);
+		break;
+	case 16:
+		SDL_VIDEO_BlitXEP80_16((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, last - first, SDL_PALETTE_buffer.bpp16);
+		break;
+	default:
+		SDL_VIDEO_BlitXEP80_32((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, last - first, SDL_PALETTE_buffer.bpp32);
+	}
+}
+
 static void DisplayXEP80(void)
 {
 	static int xep80Frame = 0;
-	int pitch4 = SDL_VIDEO_screen->pitch / 2;
+	static UBYTE *drawn_screen = NULL;
 	UBYTE *screen;
-	Uint8 *pixels = (Uint8 *) SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
+	int incremental;
+	UBYTE *changed = XEP80_changed_lines + VIDEOMODE_src_offset_top;
+	Uint8 *pixels = (Uint8 *) SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top
+	                + VIDEOMODE_dest_offset_left * SDL_VIDEO_screen->format->BytesPerPixel;
 	xep80Frame++;
 	if (xep80Frame == 60) xep80Frame = 0;
 	if (xep80Frame > 29) {
@@ -569,52 +812,70 @@ static void DisplayXEP80(void)
 		screen = XEP80_screen_2;
 	}
 
+	incremental = TextIncremental(screen != drawn_screen);
+	drawn_screen = screen;
 	screen += XEP80_SCRN_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
-	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
-	case 8:
-		pixels += VIDEOMODE_dest_offset_left;
-		SDL_VIDEO_BlitXEP80_8((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height);
-		break;
-	case 16:
-		pixels += VIDEOMODE_dest_offset_left * 2;
-		SDL_VIDEO_BlitXEP80_16((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp16);
-		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
-		break;
-	default:
-		pixels += VIDEOMODE_dest_offset_left * 4;
-		SDL_VIDEO_BlitXEP80_32((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp32);
-		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+	if (incremental) {
+		int first = 0;
+		while (first < (int) VIDEOMODE_src_height) {
+			int last;
+			if (!changed[first]) {
+				first++;
+				continue;
+			}
+			for (last = first + 1; last < (int) VIDEOMODE_src_height && changed[last]; last++);
+			BlitXEP80Lines(pixels, screen, first, last);
+			TextLinesChanged(pixels, first, last);
+			first = last;
+		}
 	}
+	else {
+		BlitXEP80Lines(pixels, screen, 0, VIDEOMODE_src_height);
+		TextScanlines(pixels);
+	}
+	memset(XEP80_changed_lines, 0, sizeof(XEP80_changed_lines));
 }
 #endif
 
 #ifdef NTSC_FILTER
+typedef struct ntsc_band_t {
+	UBYTE *screen;
+	Uint8 *pixels;
+	int pitch;
+	int bpp;
+} ntsc_band_t;
+
+/* The filter works on each line separately, so bands of Atari lines can be
+   blitted independently. */
+static void NTSCBand(void *arg, int first, int last)
+{
+	ntsc_band_t const *band = (ntsc_band_t const *) arg;
+	ATARI_NTSC_IN_T *in = (ATARI_NTSC_IN_T *) (band->screen + Screen_WIDTH * first);
+	Uint8 *out = band->pixels + band->pitch * 2 * first;
+	/* blit atari image, doubled vertically */
+	if (band->bpp == 16)
+		atari_ntsc_blit_rgb16(FILTER_NTSC_emu, in, Screen_WIDTH, VIDEOMODE_src_width, last - first, out, band->pitch * 2);
+	else
+		atari_ntsc_blit_argb32(FILTER_NTSC_emu, in, Screen_WIDTH, VIDEOMODE_src_width, last - first, out, band->pitch * 2);
+}
+
 static void DisplayNTSCEmu(void)
 {
-	Uint8 *pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
-	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
+	ntsc_band_t band;
+	band.screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	band.pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
+	band.pitch = SDL_VIDEO_screen->pitch;
+	band.bpp = SDL_VIDEO_screen->format->BitsPerPixel;
+	switch (band.bpp) {
 	case 16:
-		pixels += VIDEOMODE_dest_offset_left * 2;
-		/* blit atari image, doubled vertically */
-		atari_ntsc_blit_rgb16(FILTER_NTSC_emu,
-		                      (ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left),
-		                      Screen_WIDTH,
-		                      VIDEOMODE_src_width,
-		                      VIDEOMODE_src_height,
-		                      pixels,
-		                      SDL_VIDEO_screen->pitch * 2);
-		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		band.pixels += VIDEOMODE_dest_offset_left * 2;
+		RunBands(&NTSCBand, &band, VIDEOMODE_src_height);
+		scanLines_16((void *)band.pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 		break;
 	case 32:
-		pixels += VIDEOMODE_dest_offset_left * 4;
-		atari_ntsc_blit_argb32(FILTER_NTSC_emu,
-		                      (ATARI_NTSC_IN_T *) ((UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left),
-		                       Screen_WIDTH,
-		                       VIDEOMODE_src_width,
-		                       VIDEOMODE_src_height,
-		                       pixels,
-		                       SDL_VIDEO_screen->pitch * 2);
-		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
+		band.pixels += VIDEOMODE_dest_offset_left * 4;
+		RunBands(&NTSCBand, &band, VIDEOMODE_src_height);
+		scanLines_32((void *)band.pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 		break;
 	}
 }
@@ -649,72 +910,117 @@ static void DisplayProto80(void)
 }
 #endif
 
-#ifdef AF80
-static void DisplayAF80(void)
+#if defined(AF80) || defined(BIT3)
+/* Draws the cells in columns FIRST_COLUMN..LAST_COLUMN-1 of lines
+   FIRST_LINE..LAST_LINE-1 of an 80-column card's screen to PIXELS. */
+typedef void (*cell_blit_t)(Uint8 *pixels, int first_column, int last_column, int first_line, int last_line, int blink);
+
+/* Draws the cells of an 80-column card's screen that changed, as told by
+   CELL_CHANGED, PIXELS being the top left corner of the displayed area
+   (cell FIRST_COLUMN of line FIRST_LINE). */
+static void DisplayChangedCells(cell_blit_t blit, int (*cell_changed)(int, int, int), int cell_height,
+                                Uint8 *pixels, int first_column, int last_column, int first_line, int last_line, int blink)
+{
+	int column_bytes = 8 * SDL_VIDEO_screen->format->BytesPerPixel;
+	int row;
+	for (row = first_line / cell_height; row * cell_height < last_line; row++) {
+		int top = row * cell_height > first_line ? row * cell_height : first_line;
+		int bottom = (row + 1) * cell_height < last_line ? (row + 1) * cell_height : last_line;
+		Uint8 *row_pixels = pixels + SDL_VIDEO_screen->pitch * 2 * (top - first_line);
+		int any = FALSE;
+		int column = first_column;
+		while (column < last_column) {
+			int end;
+			if (!(*cell_changed)(row, column, blink)) {
+				column++;
+				continue;
+			}
+			for (end = column + 1; end < last_column && (*cell_changed)(row, end, blink); end++);
+			(*blit)(row_pixels + column_bytes * (column - first_column), column, end, top, bottom, blink);
+			any = TRUE;
+			column = end;
+		}
+		if (any)
+			TextLinesChanged(pixels, top - first_line, bottom - first_line);
+	}
+}
+
+/* Draws an 80-column card's screen with BLIT, only where it changed if
+   possible. */
+static void DisplayCells(cell_blit_t blit, int (*cell_changed)(int, int, int), int cell_height, int blink)
 {
 	int first_column = (VIDEOMODE_src_offset_left+7) / 8;
 	int last_column = (VIDEOMODE_src_offset_left + VIDEOMODE_src_width) / 8;
 	int first_line = VIDEOMODE_src_offset_top;
 	int last_line = first_line + VIDEOMODE_src_height;
-	int pitch4 = SDL_VIDEO_screen->pitch / 2;
-	Uint8 *pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
+	Uint8 *pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top
+	                + VIDEOMODE_dest_offset_left * SDL_VIDEO_screen->format->BytesPerPixel;
 
-	static int AF80Frame = 0;
-	int blink;
-	AF80Frame++;
-	if (AF80Frame == 60) AF80Frame = 0;
-	blink = AF80Frame >= 30;
+	if (TextIncremental(FALSE))
+		DisplayChangedCells(blit, cell_changed, cell_height, pixels, first_column, last_column, first_line, last_line, blink);
+	else {
+		(*blit)(pixels, first_column, last_column, first_line, last_line, blink);
+		TextScanlines(pixels);
+	}
+}
+#endif /* defined(AF80) || defined(BIT3) */
 
+#ifdef AF80
+static void BlitAF80Cells(Uint8 *pixels, int first_column, int last_column, int first_line, int last_line, int blink)
+{
+	int pitch4 = SDL_VIDEO_screen->pitch / 2;
 	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	case 8:
-		pixels += VIDEOMODE_dest_offset_left;
 		SDL_VIDEO_BlitAF80_8((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink);
 		break;
 	case 16:
-		pixels += VIDEOMODE_dest_offset_left * 2;
 		SDL_VIDEO_BlitAF80_16((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp16);
-		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 		break;
 	default:
-		pixels += VIDEOMODE_dest_offset_left * 4;
 		SDL_VIDEO_BlitAF80_32((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp32);
-		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 	}
 }
+
+static void DisplayAF80(void)
+{
+	static int AF80Frame = 0;
+	int blink;
+	AF80Frame++;
+	if (AF80Frame == 60) AF80Frame = 0;
+	blink = AF80Frame >= 30;
+
+	DisplayCells(&BlitAF80Cells, &AF80_CellChanged, AF80_CELL_HEIGHT, blink);
+	AF80_ClearChanged(blink);
+}
 #endif
 
 #ifdef BIT3
-static void DisplayBIT3(void)
+static void BlitBIT3Cells(Uint8 *pixels, int first_column, int last_column, int first_line, int last_line, int blink)
 {
-	int first_column = (VIDEOMODE_src_offset_left+7) / 8;
-	int last_column = (VIDEOMODE_src_offset_left + VIDEOMODE_src_width) / 8;
-	int first_line = VIDEOMODE_src_offset_top;
-	int last_line = first_line + VIDEOMODE_src_height;
 	int pitch4 = SDL_VIDEO_screen->pitch / 2;
-	Uint8 *pixels = (Uint8*)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
-
-	static int BIT3Frame = 0;
-	int blink;
-	BIT3Frame++;
-	if (BIT3Frame == 60) BIT3Frame = 0;
-	blink = BIT3Frame >= 30;
-
 	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	case 8:
-		pixels += VIDEOMODE_dest_offset_left;
 		SDL_VIDEO_BlitBIT3_8((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink);
 		break;
 	case 16:
-		pixels += VIDEOMODE_dest_offset_left * 2;
 		SDL_VIDEO_BlitBIT3_16((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp16);
-		scanLines_16((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 		break;
 	default:
-		pixels += VIDEOMODE_dest_offset_left * 4;
 		SDL_VIDEO_BlitBIT3_32((Uint32 *)pixels, first_column, last_column, pitch4, first_line, last_line, blink, SDL_PALETTE_buffer.bpp32);
-		scanLines_32((void *)pixels, VIDEOMODE_dest_width, VIDEOMODE_dest_height, SDL_VIDEO_screen->pitch, SDL_VIDEO_scanlines_percentage);
 	}
 }
+
+static void DisplayBIT3(void)
+{
+	static int BIT3Frame = 0;
+	int blink;
+	BIT3Frame++;
+	if (BIT3Frame == 60) BIT3Frame = 0;
+	blink = BIT3Frame >= 30;
+
+	DisplayCells(&BlitBIT3Cells, &BIT3_CellChanged, BIT3_CELL_HEIGHT, blink);
+	BIT3_ClearChanged(blink);
+}
 #endif
 
 static void DisplayRotated(void)
@@ -722,7 +1028,7 @@ static void DisplayRotated(void)
 	unsigned int x, y;
 	register Uint32 *start32 = (Uint32 *) SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch / 4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left / 2;
 	int pitch4 = SDL_VIDEO_screen->pitch / 4 - VIDEOMODE_dest_width / 2;
-	UBYTE *screen = (UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	UBYTE *screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
 	for (y = 0; y < VIDEOMODE_dest_height; y++) {
 		for (x = 0; x < VIDEOMODE_dest_width / 2; x++) {
 			Uint8 left = screen[Screen_WIDTH * (x * 2) + VIDEOMODE_src_width - y];
@@ -737,149 +1043,225 @@ static void DisplayRotated(void)
 	}
 }
 
-static void DisplayWithoutScaling(void)
+/* Draws the part of the Atari screen at X, Y of size W x H, relative to
+   the displayed area, without scaling. */
+static void DrawWithoutScaling(int x, int y, int w, int h)
 {
 	int pitch4 = SDL_VIDEO_screen->pitch / 4;
-	UBYTE *screen = (UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
-	Uint8 *pixels = (Uint8 *) SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
+	UBYTE *screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * (VIDEOMODE_src_offset_top + y) + VIDEOMODE_src_offset_left + x;
+	Uint8 *pixels = (Uint8 *) SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * (VIDEOMODE_dest_offset_top + y);
 	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	/* Possible values are 8, 16 and 32, as checked earlier in the
 	 * PLATFORM_SetVideoMode() function. */
 	case 8:
-		pixels += VIDEOMODE_dest_offset_left;
-		SDL_VIDEO_BlitNormal8((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height);
+		pixels += VIDEOMODE_dest_offset_left + x;
+		SDL_VIDEO_BlitNormal8((Uint32 *)pixels, screen, pitch4, w, h);
 		break;
 	case 16:
-		pixels += VIDEOMODE_dest_offset_left * 2;
-		SDL_VIDEO_BlitNormal16((Uint32*)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp16);
+		pixels += (VIDEOMODE_dest_offset_left + x) * 2;
+		SDL_VIDEO_BlitNormal16((Uint32*)pixels, screen, pitch4, w, h, SDL_PALETTE_buffer.bpp16);
 		break;
 	default: /* SDL_VIDEO_screen->format->BitsPerPixel == 32 */
-		pixels += VIDEOMODE_dest_offset_left * 4;
-		SDL_VIDEO_BlitNormal32((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp32);
+		pixels += (VIDEOMODE_dest_offset_left + x) * 4;
+		SDL_VIDEO_BlitNormal32((Uint32 *)pixels, screen, pitch4, w, h, SDL_PALETTE_buffer.bpp32);
 	}
 }
 
-static void DisplayWithScaling(void)
+static void DisplayWithoutScaling(void)
+{
+	DrawWithoutScaling(0, 0, VIDEOMODE_src_width, VIDEOMODE_src_height);
+}
+
+typedef struct scale_band_t {
+	Uint8 *screen;
+	Uint8 *pixels;
+	int pitch;
+	int const *columns;
+	int left; /* column of the surface where rows start */
+	int top;
+	int dy;
+	int width;
+	int bpp;
+} scale_band_t;
+
+static void ScaleBand(void *arg, int first, int last)
+{
+	scale_band_t const *band = (scale_band_t const *) arg;
+	Uint8 *pixels = band->pixels + band->pitch * first;
+	Uint8 *prev_row = NULL;
+	int prev_y = -1;
+	int y = band->dy * (band->top + first);
+	int row_bytes = band->width * (band->bpp / 8);
+
+	for (; first < last; first++) {
+		/* When enlarging, consecutive rows often show the same source line;
+		   copy the row already drawn instead of scaling it again. */
+		if ((y >> 16) == prev_y)
+			memcpy(pixels, prev_row, row_bytes);
+		else {
+			Uint8 *src = band->screen + Screen_WIDTH * (y >> 16);
+			switch (band->bpp) {
+			case 8:
+				BLIT_Scale8((UBYTE *) pixels, src, band->columns, band->width);
+				break;
+			case 16:
+				BLIT_Scale8to16((UWORD *) pixels, src, band->columns, band->width, (UWORD const *) SDL_PALETTE_buffer.bpp16);
+				break;
+			default:
+				BLIT_Scale8to32((ULONG *) pixels, src, band->columns, band->width, (ULONG const *) SDL_PALETTE_buffer.bpp32);
+			}
+			prev_y = y >> 16;
+		}
+		prev_row = pixels;
+		pixels += band->pitch;
+		y += band->dy;
+	}
+}
+
+/* Fills BAND for drawing the whole displayed area with scaling. */
+static void SetupScaling(scale_band_t *band)
 {
-	register Uint32 quad;
-	register int x;
-	register Uint8 *screen = (UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
-	register Uint32 *pixels = (Uint32 *) SDL_VIDEO_screen->pixels;
-	int i;
-	int y = 0;
-	int w1;
 	int w = (VIDEOMODE_src_width) << 16;
 	int h = (VIDEOMODE_src_height) << 16;
-	register int dx = w / VIDEOMODE_dest_width;
-	register int yy;
-	int pos;
-	int pitch4 = SDL_VIDEO_screen->pitch / 4;
-	int dy = h / VIDEOMODE_dest_height;
+	int dx = w / VIDEOMODE_dest_width;
 	int init_x = (VIDEOMODE_src_width << 16) - 0x4000;
 
-	Uint8 c;
-
-	i = VIDEOMODE_dest_height;
+	band->screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	band->pitch = SDL_VIDEO_screen->pitch;
+	band->pixels = (Uint8 *) SDL_VIDEO_screen->pixels + band->pitch * VIDEOMODE_dest_offset_top;
+	band->top = 0;
+	band->dy = h / VIDEOMODE_dest_height;
+	band->bpp = SDL_VIDEO_screen->format->BitsPerPixel;
 
-	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	/* Possible values are 8, 16 and 32, as checked earlier in the
-	 * PLATFORM_SetVideoMode() function. */
+	 * PLATFORM_SetVideoMode() function. Rows are written in whole 32-bit
+	 * words. */
+	switch (band->bpp) {
 	case 8:
-		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left / 4;
-		w1 = VIDEOMODE_dest_width / 4 - 1;
-		while (i > 0) {
-			x = init_x;
-			pos = w1;
-			yy = Screen_WIDTH * (y >> 16);
-			while (pos >= 0) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				quad = (screen[yy + (x >> 16)] << 0);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 8);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 16);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 24);
-				x -= dx;
-#else
-				quad = (screen[yy + (x >> 16)] << 24);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 16);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 8);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 0);
-				x -= dx;
-#endif
-
-				pixels[pos] = quad;
-				pos--;
-
-			}
-			pixels += pitch4;
-			y += dy;
-			i--;
-		}
+		band->left = VIDEOMODE_dest_offset_left & ~3;
+		band->width = VIDEOMODE_dest_width & ~3;
 		break;
 	case 16:
-		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left / 2;
-		w1 = VIDEOMODE_dest_width / 2 - 1;
-		while (i > 0) {
-			x = init_x;
-			pos = w1;
-			yy = Screen_WIDTH * (y >> 16);
-			while (pos >= 0) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				c = screen[yy + (x >> 16)];
-				quad = SDL_PALETTE_buffer.bpp16[c];
-				x -= dx;
-				c = screen[yy + (x >> 16)];
-				quad += SDL_PALETTE_buffer.bpp16[c] << 16;
-				x -= dx;
-#else
-				c = screen[yy + (x >> 16)];
-				quad = SDL_PALETTE_buffer.bpp16[c] << 16;
-				x -= dx;
-				c = screen[yy + (x >> 16)];
-				quad += SDL_PALETTE_buffer.bpp16[c];
-				x -= dx;
+		band->left = VIDEOMODE_dest_offset_left & ~1;
+		band->width = VIDEOMODE_dest_width & ~1;
+		break;
+	default: /* SDL_VIDEO_screen->format->BitsPerPixel == 32 */
+		band->left = VIDEOMODE_dest_offset_left;
+		band->width = VIDEOMODE_dest_width;
+	}
+	band->pixels += band->left * (band->bpp / 8);
+
+	if (scale_columns_size < band->width) {
+		scale_columns = (int *) Util_realloc(scale_columns, band->width * sizeof(int));
+		scale_columns_size = band->width;
+	}
+	BLIT_ScaleColumns(scale_columns, band->width, init_x, dx);
+	band->columns = scale_columns;
+}
+
+static void DisplayWithScaling(void)
+{
+	scale_band_t band;
+	SetupScaling(&band);
+	RunBands(&ScaleBand, &band, VIDEOMODE_dest_height);
+}
+
+#ifdef DIRTYRECT
+/* Most rectangles drawn and sent to the display in a frame. */
+#define MAX_DIRTY_RECTS 32
+
+/* Whether the surface keeps the last frame drawn, so that only the parts
+   of Screen_atari that changed since need to be drawn. Not so for frames
+   from the emulation thread, whose marks are for Screen_atari. Menus are
+   drawn whole, and the first frame after them is drawn whole as well, as
+   the marks are set while they are shown. */
+static int DirtyRectsUsable(void)
+{
+	return SDL_VIDEO_current_display_mode == VIDEOMODE_MODE_NORMAL
+	       && SDL_VIDEO_atari_frame == NULL
+	       && !UI_is_active
+	       && (blit_funcs[0] == &DisplayWithoutScaling || blit_funcs[0] == &DisplayWithScaling)
+#if !SDL2
+	       && !(SDL_VIDEO_screen->flags & SDL_DOUBLEBUF)
 #endif
+	       ;
+}
 
-				pixels[pos] = quad;
-				pos--;
-			}
-			pixels += pitch4;
-			y += dy;
-			i--;
+/* Returns the first of the WIDTH non-decreasing COLUMNS that is at least
+   X, or WIDTH. */
+static int FirstColumn(int const *columns, int width, int x)
+{
+	int lo = 0;
+	int hi = width;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (columns[mid] < x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Draws the parts of the Atari screen that changed since the last frame
+   and stores the surface rectangles they cover in RECTS. Returns the
+   number of rectangles. */
+static int DisplayDirtyRects(SDL_Rect *rects)
+{
+	Screen_rect_t dirty[MAX_DIRTY_RECTS];
+	scale_band_t band;
+	int scaled = blit_funcs[0] == &DisplayWithScaling;
+	int n = Screen_CollectDirtyRects(dirty, MAX_DIRTY_RECTS, VIDEOMODE_src_offset_left, VIDEOMODE_src_offset_top,
+	                                 VIDEOMODE_src_width, VIDEOMODE_src_height);
+	int num_rects = 0;
+	int i;
+
+	if (n > 0 && scaled)
+		SetupScaling(&band);
+	for (i = 0; i < n; i++) {
+		/* relative to the displayed area */
+		int x = dirty[i].x - VIDEOMODE_src_offset_left;
+		int y = dirty[i].y - VIDEOMODE_src_offset_top;
+		SDL_Rect *r = &rects[num_rects];
+		if (scaled) {
+			scale_band_t part = band;
+			int x1 = FirstColumn(band.columns, band.width, x);
+			int x2 = FirstColumn(band.columns, band.width, x + dirty[i].w);
+			/* the output rows that show source lines Y..Y+H-1 */
+			int y1 = ((y << 16) + band.dy - 1) / band.dy;
+			int y2 = (((y + dirty[i].h) << 16) + band.dy - 1) / band.dy;
+			if (y2 > VIDEOMODE_dest_height)
+				y2 = VIDEOMODE_dest_height;
+			if (x1 >= x2 || y1 >= y2)
+				continue;
+			part.pixels += part.pitch * y1 + x1 * (band.bpp / 8);
+			part.columns += x1;
+			part.width = x2 - x1;
+			part.top = y1;
+			RunBands(&ScaleBand, &part, y2 - y1);
+			r->x = band.left + x1;
+			r->y = VIDEOMODE_dest_offset_top + y1;
+			r->w = x2 - x1;
+			r->h = y2 - y1;
 		}
-		break;
-	default:
-		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left;
-		w1 = VIDEOMODE_dest_width - 1;
-		/* SDL_VIDEO_screen->format->BitsPerPixel = 32 */
-		while (i > 0) {
-			x = init_x;
-			pos = w1;
-			yy = Screen_WIDTH * (y >> 16);
-			while (pos >= 0) {
-				c = screen[yy + (x >> 16)];
-				quad = SDL_PALETTE_buffer.bpp32[c];
-				x -= dx;
-				pixels[pos] = quad;
-				pos--;
-			}
-			pixels += pitch4;
-			y += dy;
-			i--;
+		else {
+			DrawWithoutScaling(x, y, dirty[i].w, dirty[i].h);
+			r->x = VIDEOMODE_dest_offset_left + x;
+			r->y = VIDEOMODE_dest_offset_top + y;
+			r->w = dirty[i].w;
+			r->h = dirty[i].h;
 		}
+		num_rects++;
 	}
+	return num_rects;
 }
+#endif /* DIRTYRECT */
 
 #ifdef PAL_BLENDING
 static void DisplayPalBlending(void)
 {
 	int pitch4 = SDL_VIDEO_screen->pitch / 4;
-	UBYTE *screen = (UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	UBYTE *screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
 	Uint8 *pixels = (Uint8 *) SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
 	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	/* Possible values are 8, 16 and 32, as checked earlier in the
@@ -894,21 +1276,39 @@ static void DisplayPalBlending(void)
 	}
 }
 
+typedef struct pal_blending_band_t {
+	UBYTE *screen;
+	ULONG *pixels;
+	int pitch4;
+	int bpp;
+} pal_blending_band_t;
+
+static void PalBlendingBand(void *arg, int first, int last)
+{
+	pal_blending_band_t const *band = (pal_blending_band_t const *) arg;
+	if (band->bpp == 16)
+		PAL_BLENDING_BlitScaled16(band->pixels, band->screen, band->pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, VIDEOMODE_dest_width, VIDEOMODE_dest_height, VIDEOMODE_src_offset_top % 2, first, last);
+	else
+		PAL_BLENDING_BlitScaled32(band->pixels, band->screen, band->pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, VIDEOMODE_dest_width, VIDEOMODE_dest_height, VIDEOMODE_src_offset_top % 2, first, last);
+}
+
 static void DisplayPalBlendingScaled(void)
 {
-	int pitch4 = SDL_VIDEO_screen->pitch / 4;
-	Uint8 *screen = (UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
-	Uint32 *pixels = (Uint32 *) SDL_VIDEO_screen->pixels;
-	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
+	pal_blending_band_t band;
+	band.pitch4 = SDL_VIDEO_screen->pitch / 4;
+	band.screen = SDL_VIDEO_ATARI_SCREEN + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	band.pixels = (ULONG *) SDL_VIDEO_screen->pixels;
+	band.bpp = SDL_VIDEO_screen->format->BitsPerPixel;
+	switch (band.bpp) {
 	/* Possible values are 8, 16 and 32, as checked earlier in the
 	 * PLATFORM_SetVideoMode() function. */
 	case 16:
-		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left / 2;
-		PAL_BLENDING_BlitScaled16((ULONG*)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, VIDEOMODE_dest_width, VIDEOMODE_dest_height, VIDEOMODE_src_offset_top % 2);
+		band.pixels += band.pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left / 2;
+		RunBands(&PalBlendingBand, &band, VIDEOMODE_dest_height);
 		break;
 	case 32:
-		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left;
-		PAL_BLENDING_BlitScaled32((ULONG*)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, VIDEOMODE_dest_width, VIDEOMODE_dest_height, VIDEOMODE_src_offset_top % 2);
+		band.pixels += band.pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left;
+		RunBands(&PalBlendingBand, &band, VIDEOMODE_dest_height);
 	}
 }
 #endif /* PAL_BLENDING */
@@ -919,8 +1319,34 @@ void SDL_VIDEO_SW_DisplayScreen(void)
 	if (!SDL_VIDEO_texture || !SDL_VIDEO_renderer || !SDL_VIDEO_screen) {
 		return;
 	}
+#ifdef DIRTYRECT
+	if (DirtyRectsUsable()) {
+		SDL_Rect rects[MAX_DIRTY_RECTS];
+		int n = DisplayDirtyRects(rects);
+		int i;
+		for (i = 0; i < n; i++)
+			SDL_UpdateTexture(SDL_VIDEO_texture, &rects[i],
+			                  (Uint8 *) SDL_VIDEO_screen->pixels + rects[i].y * SDL_VIDEO_screen->pitch + rects[i].x * SDL_VIDEO_screen->format->BytesPerPixel,
+			                  SDL_VIDEO_screen->pitch);
+	}
+	else {
+		/* Keep the marks from piling up while they are not used. */
+		Screen_EntireDirty();
+#endif
+	text_num_rects = -1;
 	(*blit_funcs[SDL_VIDEO_current_display_mode])();
-	SDL_UpdateTexture(SDL_VIDEO_texture, NULL, SDL_VIDEO_screen->pixels, SDL_VIDEO_screen->pitch);
+	if (text_num_rects >= 0) {
+		int i;
+		for (i = 0; i < text_num_rects; i++)
+			SDL_UpdateTexture(SDL_VIDEO_texture, &text_rects[i],
+			                  (Uint8 *) SDL_VIDEO_screen->pixels + text_rects[i].y * SDL_VIDEO_screen->pitch + text_rects[i].x * SDL_VIDEO_screen->format->BytesPerPixel,
+			                  SDL_VIDEO_screen->pitch);
+	}
+	else
+		SDL_UpdateTexture(SDL_VIDEO_texture, NULL, SDL_VIDEO_screen->pixels, SDL_VIDEO_screen->pitch);
+#ifdef DIRTYRECT
+	}
+#endif
 	SDL_RenderClear(SDL_VIDEO_renderer);
 	SDL_RenderCopy(SDL_VIDEO_renderer, SDL_VIDEO_texture, NULL, NULL);
 	SDL_RenderPresent(SDL_VIDEO_renderer);
@@ -934,9 +1360,28 @@ void SDL_VIDEO_SW_DisplayScreen(void)
 		   mode gets re-enabled, surface locking will work again and screen
 		   displaying will be restored */
 		   return;
+#ifdef DIRTYRECT
+	if (DirtyRectsUsable()) {
+		SDL_Rect rects[MAX_DIRTY_RECTS];
+		int n = DisplayDirtyRects(rects);
+		SDL_UnlockSurface(SDL_VIDEO_screen);
+		if (n > 0)
+			SDL_UpdateRects(SDL_VIDEO_screen, n, rects);
+		return;
+	}
+	/* Keep the marks from piling up while they are not used. */
+	Screen_EntireDirty();
+#endif
 	/* Use function corresponding to the current_display_mode. */
+	text_num_rects = -1;
 	(*blit_funcs[SDL_VIDEO_current_display_mode])();
 	SDL_UnlockSurface(SDL_VIDEO_screen);
+	if (text_num_rects >= 0) {
+		/* Only the lines of an 80-column card that changed. */
+		if (text_num_rects > 0)
+			SDL_UpdateRects(SDL_VIDEO_screen, text_num_rects, text_rects);
+		return;
+	}
 	/* SDL_UpdateRect is faster than SDL_Flip for a software surface, because
 	   it copies only the used part of the screen. */
 	if (SDL_VIDEO_screen->flags & SDL_DOUBLEBUF)
@@ -955,6 +1400,8 @@ int SDL_VIDEO_SW_ReadConfig(char *option, char *parameters)
 		else
 			SDL_VIDEO_SW_bpp = value;
 	}
+	else if (strcmp(option, "VIDEO_BLIT_THREADS") == 0)
+		return Util_sscansdec(parameters, &SDL_VIDEO_SW_threads) && SDL_VIDEO_SW_threads >= -1;
 	else
 		return FALSE;
 	return TRUE;
@@ -963,6 +1410,7 @@ int SDL_VIDEO_SW_ReadConfig(char *option, char *parameters)
 void SDL_VIDEO_SW_WriteConfig(FILE *fp)
 {
 	fprintf(fp, "VIDEO_BPP=%d\n", SDL_VIDEO_SW_bpp);
+	fprintf(fp, "VIDEO_BLIT_THREADS=%d\n", SDL_VIDEO_SW_threads);
 }
 
 int SDL_VIDEO_SW_Initialise(int *argc, char *argv[])
@@ -982,9 +1430,20 @@ int SDL_VIDEO_SW_Initialise(int *argc, char *argv[])
 			}
 			else a_m = TRUE;
 		}
+		else if (strcmp(argv[i], "-blitthreads") == 0) {
+			if (i_a) {
+				if (!Util_sscansdec(argv[++i], &SDL_VIDEO_SW_threads) || SDL_VIDEO_SW_threads < -1) {
+					Log_print("Invalid number of threads %s", argv[i]);
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
 		else {
-			if (strcmp(argv[i], "-help") == 0)
+			if (strcmp(argv[i], "-help") == 0) {
 				Log_print("\t-bpp <num>        Host color depth (0 = autodetect)");
+				Log_print("\t-blitthreads <num> Threads drawing the screen (-1 = one per extra CPU core)");
+			}
 			argv[j++] = argv[i];
 		}
 
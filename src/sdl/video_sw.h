@@ -15,6 +15,12 @@ extern int SDL_VIDEO_SW_bpp;
 int SDL_VIDEO_SW_SetBpp(int value);
 int SDL_VIDEO_SW_ToggleBpp(void);
 
+/* Number of extra threads that draw the scaled and filtered screen modes in
+   horizontal bands; -1 means one per extra CPU core, 0 draws on the calling
+   thread only. Use SDL_VIDEO_SW_SetThreads() to change it at run time. */
+extern int SDL_VIDEO_SW_threads;
+void SDL_VIDEO_SW_SetThreads(int value);
+
 /* Returns parameters of the current display pixel format. Used when computing
    lookup tables used for blitting the Atari screen to display surface. */
 void SDL_VIDEO_SW_GetPixelFormat(PLATFORM_pixel_format_t *format);
@@ -28,5 +34,6 @@ void SDL_VIDEO_SW_WriteConfig(FILE *fp);
 
 /* Initialisation and processing of command-line arguments. */
 int SDL_VIDEO_SW_Initialise(int *argc, char *argv[]);
+void SDL_VIDEO_SW_Exit(void);
 
 #endif /* SDL_VIDEO_SW_H_ */
@@ -1528,6 +1528,8 @@ static UBYTE Command_Frame(void)
 /* Enable/disable the command frame */
 void SIO_SwitchCommandFrame(int onoff)
 {
+	if (!Atari800_DeviceIO())
+		return;
 #ifdef NETSIO
 	if (netsio_enabled && netsio_netstream_active()) {
 		CommandIndex = 0;
@@ -1682,6 +1684,8 @@ void NetSIO_PutByte(int byte)
 /* Put a byte that comes out of POKEY. So get it here... */
 void SIO_PutByte(int byte)
 {
+	if (!Atari800_DeviceIO())
+		return;
 #ifdef NETSIO
 	if (netsio_enabled && !BINLOAD_start_binloading)
 	{
@@ -1843,6 +1847,8 @@ int SIO_GetByte(void)
 {
 	int byte = 0;
 
+	if (!Atari800_DeviceIO())
+		return byte;
 #ifdef NETSIO
 	if (netsio_enabled && !BINLOAD_start_binloading)
 		return NetSIO_GetByte();
@@ -1978,6 +1984,37 @@ void SIO_StateRead(void)
 	}
 }
 
+/* The serial transfer in progress, for in-memory snapshots only. */
+void SIO_StateSaveTransfer(void)
+{
+	int length = TransferStatus == SIO_NoFrame ? 0 : ExpectedBytes;
+
+	StateSav_SaveUBYTE(CommandFrame, sizeof(CommandFrame));
+	StateSav_SaveINT(&CommandIndex, 1);
+	StateSav_SaveINT(&DataIndex, 1);
+	StateSav_SaveINT(&TransferStatus, 1);
+	StateSav_SaveINT(&ExpectedBytes, 1);
+	StateSav_SaveINT(&delay_counter, 1);
+	StateSav_SaveINT(&length, 1);
+	StateSav_SaveUBYTE(DataBuffer, length);
+}
+
+void SIO_StateReadTransfer(void)
+{
+	int length = 0;
+
+	StateSav_ReadUBYTE(CommandFrame, sizeof(CommandFrame));
+	StateSav_ReadINT(&CommandIndex, 1);
+	StateSav_ReadINT(&DataIndex, 1);
+	StateSav_ReadINT(&TransferStatus, 1);
+	StateSav_ReadINT(&ExpectedBytes, 1);
+	StateSav_ReadINT(&delay_counter, 1);
+	StateSav_ReadINT(&length, 1);
+	if (length < 0 || length > (int) sizeof(DataBuffer))
+		length = 0;
+	StateSav_ReadUBYTE(DataBuffer, length);
+}
+
 #endif /* BASIC */
 
 /*
@@ -61,5 +61,7 @@ int SIO_WriteStatusBlock(int unit, const UBYTE *buffer);
 int SIO_WriteSector(int unit, int sector, const UBYTE *buffer);
 void SIO_StateSave(void);
 void SIO_StateRead(void);
+void SIO_StateSaveTransfer(void);
+void SIO_StateReadTransfer(void);
 
 #endif	/* SIO_H_ */
@@ -24,6 +24,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "sound.h"
 
@@ -76,6 +77,29 @@ static unsigned int sync_max_fill;
 /* Time of last write of sudio to output device (either by Sound_Callback or
    WriteOut). */
 double last_audio_write_time;
+/* Total number of bytes written to and read from sync_buffer, modulo 2^32.
+   Used to find when a given sample reaches the output. */
+static unsigned int total_written;
+static unsigned int total_read;
+
+/* Fields in the order of Sound_stats_t; see Sound_ResetStats. */
+Sound_stats_t Sound_stats = {
+	0.0, 0.0, 0.0, 0.0, 0.0, /* latency_ms ... max_fill_ms */
+	{ 0.0f }, 0,             /* fill_history, fill_pos */
+	0, 0,                    /* underruns, overruns */
+	1.0, 0,                  /* speed_adjust, adjusted_frames */
+	-1.0                     /* probe_ms: not measured */
+};
+
+int Sound_latency_test = FALSE;
+/* State of the latency test: ARMED - waiting for a POKEY write,
+   SYNTHESISED - write seen, samples are in POKEYSND_process_buffer at
+   probe_pos, QUEUED - samples are in sync_buffer at stream position
+   probe_pos, DONE - samples reached the output. */
+static enum { PROBE_IDLE, PROBE_ARMED, PROBE_SYNTHESISED, PROBE_QUEUED, PROBE_DONE } probe_state = PROBE_IDLE;
+static unsigned int probe_pos;
+static double probe_write_time;
+static double probe_last_time;
 
 enum { MAX_SAMPLE_SIZE = 2, /* for 16-bit */
 #ifdef STEREO_SOUND
@@ -86,6 +110,25 @@ enum { MAX_SAMPLE_SIZE = 2, /* for 16-bit */
        MAX_FRAME_SIZE = MAX_SAMPLE_SIZE * MAX_CHANNELS
 };
 
+static double BytesToMs(double bytes)
+{
+	return bytes * 1000.0 / (Sound_out.freq * Sound_out.channels * Sound_out.sample_size);
+}
+
+void Sound_ResetStats(void)
+{
+	memset(&Sound_stats, 0, sizeof(Sound_stats));
+	Sound_stats.speed_adjust = 1.0;
+	Sound_stats.probe_ms = -1.0;
+}
+
+static void ProbeEvent(unsigned int buffer_pos)
+{
+	probe_write_time = Util_time();
+	probe_pos = buffer_pos;
+	probe_state = PROBE_SYNTHESISED;
+}
+
 int Sound_ReadConfig(char *option, char *ptr)
 {
 	if (strcmp(option, "SOUND_ENABLED") == 0)
@@ -167,6 +210,8 @@ int Sound_Initialise(int *argc, char *argv[])
 			if (i_a)
 				Sound_latency = Util_sscandec(argv[++i]);
 			else a_m = TRUE;
+		else if (strcmp(argv[i], "-sndlatencytest") == 0)
+			Sound_latency_test = TRUE;
 		else {
 			if (strcmp(argv[i], "-help") == 0) {
 				help_only = TRUE;
@@ -178,6 +223,7 @@ int Sound_Initialise(int *argc, char *argv[])
 				Log_print("\t-audio8              Set sound output format to 8-bit");
 				Log_print("\t-snd-buflen <ms>     Set length of the hardware sound buffer in milliseconds");
 				Log_print("\t-snddelay <ms>       Set sound latency in milliseconds");
+				Log_print("\t-sndlatencytest      Measure and log the latency of POKEY writes");
 			}
 			argv[j++] = argv[i];
 		}
@@ -240,6 +286,7 @@ int Sound_Setup(void)
 #endif /* !SOUND_CALLBACK */
 
 	POKEYSND_Init(POKEYSND_FREQ_17_EXACT, Sound_out.freq, Sound_out.channels, Sound_out.sample_size == 2 ? POKEYSND_BIT16 : 0);
+	POKEYSND_SetIdle(FALSE);
 
 	Sound_SetLatency(Sound_latency);
 
@@ -261,6 +308,8 @@ void Sound_Exit(void)
 	if (Sound_enabled) {
 		PLATFORM_SoundExit();
 		Sound_enabled = FALSE;
+		/* Nobody listens anymore - stop synthesising. */
+		POKEYSND_SetIdle(TRUE);
 #ifndef SOUND_CALLBACK
 		free(process_buffer);
 		process_buffer = NULL;
@@ -316,6 +365,11 @@ static void FillBuffer(UBYTE *buffer, unsigned int size)
 		}
 
 		sync_read_pos = new_read_pos;
+		total_read += to_write;
+		if (probe_state == PROBE_QUEUED && (int)(total_read - probe_pos) > 0) {
+			Sound_stats.probe_ms = (Util_time() - probe_write_time) * 1000.0;
+			probe_state = PROBE_DONE;
+		}
 		if (sync_read_pos > sync_buffer_size) {
 			sync_read_pos -= sync_buffer_size;
 			sync_write_pos -= sync_buffer_size;
@@ -327,6 +381,7 @@ static void FillBuffer(UBYTE *buffer, unsigned int size)
 
 	/* Just repeat the last good frame if underflow. */
 	if (to_write < size) {
+		Sound_stats.underruns++;
 #if DEBUG
 		Log_print("Sound buffer underflow: fill %d, needed %d",
 		          to_write/Sound_out.channels/Sound_out.sample_size,
@@ -395,10 +450,32 @@ static void UpdateSyncBuffer(void)
 			sync_est_fill = fill - est_gap;
 	}
 
+	Sound_stats.fill_ms = BytesToMs(sync_est_fill);
+	Sound_stats.latency_ms = Sound_stats.fill_ms + Sound_out.buffer_ms;
+	Sound_stats.fill_history[Sound_stats.fill_pos] = (float)Sound_stats.fill_ms;
+	Sound_stats.fill_pos = (Sound_stats.fill_pos + 1) % Sound_FILL_HISTORY;
+
+	if (probe_state == PROBE_DONE) {
+		Log_print("Sound latency test: %.1f ms from POKEY write to audio output, plus %u ms hardware buffer",
+		          Sound_stats.probe_ms, Sound_out.buffer_ms);
+		probe_state = PROBE_IDLE;
+		probe_last_time = Util_time();
+	}
+	if (Sound_latency_test && probe_state == PROBE_IDLE && Util_time() - probe_last_time >= 1.0) {
+		probe_state = PROBE_ARMED;
+		POKEYSND_probe_ptr = ProbeEvent;
+	}
+
 	if (Atari800_turbo && sync_est_fill > sync_max_fill) {
+		/* The buffer is full and the samples would be thrown away, so don't
+		   synthesise any until it drains. */
+		if (probe_state == PROBE_SYNTHESISED)
+			probe_state = PROBE_IDLE;
+		POKEYSND_SetIdle(TRUE);
 		PLATFORM_SoundUnlock();
 		return;
 	}
+	POKEYSND_SetIdle(FALSE);
 
 	/* produce samples from the sound emulation */
 	samples_written = POKEYSND_UpdateProcessBuffer();
@@ -407,6 +484,7 @@ static void UpdateSyncBuffer(void)
 	/* if there isn't enough room... */
 	if (bytes_written > sync_buffer_size - fill) {
 		/* Overflow of sync_buffer. */
+		Sound_stats.overruns++;
 #if DEBUG
 		Log_print("Sound buffer overflow: free %d, needed %d",
 				  (sync_buffer_size - fill)/Sound_out.channels/Sound_out.sample_size,
@@ -447,6 +525,11 @@ static void UpdateSyncBuffer(void)
 		memcpy(sync_buffer, POKEYSND_process_buffer + first_part_size, bytes_written - first_part_size);
 	}
 
+	if (probe_state == PROBE_SYNTHESISED) {
+		probe_pos += total_written;
+		probe_state = PROBE_QUEUED;
+	}
+	total_written += bytes_written;
 	sync_write_pos = new_write_pos;
 	if (sync_write_pos > sync_read_pos + sync_buffer_size)
 		sync_write_pos -= sync_buffer_size;
@@ -478,6 +561,12 @@ void Sound_SetLatency(unsigned int latency)
 		avg_fill = sync_min_fill;
 		sync_read_pos = 0;
 		sync_write_pos = sync_min_fill;
+		total_written = total_read + sync_min_fill;
+		if (probe_state != PROBE_ARMED)
+			probe_state = PROBE_IDLE;
+		Sound_ResetStats();
+		Sound_stats.min_fill_ms = BytesToMs(sync_min_fill);
+		Sound_stats.max_fill_ms = BytesToMs(sync_max_fill);
 		free(sync_buffer);
 		sync_buffer = Util_malloc(sync_buffer_size);
 		memset(sync_buffer, 0, sync_buffer_size);
@@ -504,6 +593,10 @@ double Sound_AdjustSpeed(void)
 		else if (sync_est_fill > sync_max_fill)
 			delay_mult = 1.05;
 #endif
+		Sound_stats.avg_fill_ms = BytesToMs(avg_fill);
+		Sound_stats.speed_adjust = delay_mult;
+		if (delay_mult != 1.0)
+			Sound_stats.adjusted_frames++;
 #if DEBUG >= 2
 		Log_print("delay_mult: %f, est_fill: %u, avg_fill: %f, buf_size: %u, min_fill: %u, max_fill: %u",
 		          delay_mult,
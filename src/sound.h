@@ -80,6 +80,43 @@ extern unsigned int Sound_latency;
 
 void Sound_SetLatency(unsigned int latency);
 
+/* Audio latency statistics, updated as the emulation produces audio and the
+   output consumes it. Times are in milliseconds. */
+#define Sound_FILL_HISTORY 64
+typedef struct Sound_stats_t {
+	/* Estimated time from synthesis of a sample until it is played: the
+	   estimated fill of the sync buffer plus the hardware buffer. */
+	double latency_ms;
+	/* Estimated fill of the sync buffer, current and averaged. */
+	double fill_ms;
+	double avg_fill_ms;
+	/* Emulation speed is adjusted when avg_fill_ms leaves these bounds. */
+	double min_fill_ms;
+	double max_fill_ms;
+	/* fill_ms sampled once per frame, fill_history[fill_pos] is the oldest. */
+	float fill_history[Sound_FILL_HISTORY];
+	int fill_pos;
+	/* Number of times the output ran out of samples. */
+	unsigned int underruns;
+	/* Number of times the emulation had to wait for room in the buffer. */
+	unsigned int overruns;
+	/* Last factor returned by Sound_AdjustSpeed, and number of frames in
+	   which it was not 1.0. */
+	double speed_adjust;
+	unsigned int adjusted_frames;
+	/* Result of the latency test: time from a POKEY volume write until its
+	   first sample was passed to the audio output, -1 if not measured. */
+	double probe_ms;
+} Sound_stats_t;
+
+extern Sound_stats_t Sound_stats;
+
+void Sound_ResetStats(void);
+
+/* When TRUE (-sndlatencytest), the latency of a POKEY write is measured
+   about once a second and logged, see Sound_stats.probe_ms. */
+extern int Sound_latency_test;
+
 /* Returns a factor (1.0 by default) to adjust the speed of the emulation
  * so that if the sound buffer is too full or too empty. The emulation
  * slows down or speeds up to match the actual speed of sound output. */
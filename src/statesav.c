@@ -49,6 +49,7 @@
 #include "cartridge.h"
 #include "cpu.h"
 #include "gtia.h"
+#include "input.h"
 #include "log.h"
 #include "pbi.h"
 #include "pia.h"
@@ -68,7 +69,21 @@
 #include "xep80.h"
 #endif
 
-#define SAVE_VERSION_NUMBER 8 /* Last changed after Atari800 3.1.0 */
+#define SAVE_VERSION_NUMBER 9 /* Last changed after Atari800 7.1.2 */
+/* From this version on, state files are made of sections. libatari800 and
+   the Dreamcast port save into memory, as the single stream of the last
+   version before. */
+#define SECTIONED_VERSION_NUMBER 9
+#define STREAM_VERSION_NUMBER 8
+
+#if !defined(MEMCOMPR) && !defined(LIBATARI800)
+#define SECTIONED_FILES
+#ifdef THREADS
+/* Compress and write state files in a background thread. */
+#define BACKGROUND_SAVES
+#include <pthread.h>
+#endif
+#endif
 
 #if defined(MEMCOMPR) || defined(LIBATARI800)
 /* libatari800 pretends to care about libz but it doesn't */
@@ -76,6 +91,9 @@
 #define gzFile char *
 #define Z_OK 0
 #endif
+#ifndef Z_BUF_ERROR
+#define Z_BUF_ERROR (-5)
+#endif
 static gzFile mem_open(const char *name, const char *mode);
 static int mem_close(gzFile stream);
 static size_t mem_read(void *buf, size_t len, gzFile stream);
@@ -104,6 +122,80 @@ static size_t mem_write(const void *buf, size_t len, gzFile stream);
 static gzFile StateFile = NULL;
 static int nFileError = Z_OK;
 
+/* While not NULL, the StateSav_Save* and StateSav_Read* functions work on
+   this snapshot instead of StateFile. */
+static StateSav_snapshot_t *snapshot = NULL;
+static size_t snapshot_pos;
+static int snapshot_error;
+
+#ifdef SECTIONED_FILES
+/* A sectioned state file starts with "ATARI800", the version, SaveVerbose
+   and the ULONG number of sections, followed by the directory: for each
+   section its NUL-padded name, and the ULONG offset in the file, length in
+   the file, length uncompressed and codec. All ULONGs are little-endian.
+   The data of the sections follows the directory. */
+#define SECTION_NAME_LEN 8
+#define MAX_SECTIONS 32
+#define HEADER_LEN 14
+#define DIRECTORY_ENTRY_LEN (SECTION_NAME_LEN + 16)
+#define CODEC_STORED 0
+#define CODEC_DEFLATE 1
+/* Deflate expands data at most about 1032 times. */
+#define MAX_DEFLATE_RATIO 1032
+#ifndef Z_DEFAULT_COMPRESSION
+#define Z_DEFAULT_COMPRESSION (-1)
+#endif
+/* What StateSav_SaveFNAME writes at most. */
+#define MAX_FNAME_LEN (2 + 0xffff)
+
+/* The largest size each section can have uncompressed, so that a damaged
+   file can't make a reader allocate more. Sections not listed hold a few
+   registers and counters, and at most the 8 KB of XEP80 video RAM. */
+#define MAX_SMALL_SECTION 0x10000
+static const struct {
+	const char *name;
+	ULONG max;
+} section_limits[] = {
+	/* Axlon and Mosaic banks, or the 1 MB of XE banks */
+	{ "EXTMEM", 256 * 0x4000 + 64 * 0x1000 + 0x100 },
+	/* RAM, attributes, BASIC, OS, XEGS game, RAM under them, and
+	   ANTIC's and MapRAM's banks */
+	{ "MEMORY", 2 * 0x10000 + 3 * 0x2000 + 2 * 0x4000 + 2 * 0x800 + 0x100 },
+	{ "CART", 2 * MAX_FNAME_LEN + 0x100 },
+	{ "SIO", 8 * MAX_FNAME_LEN + 0x100 },
+	{ "PBI_MIO", 0x100000 + 2 * MAX_FNAME_LEN + 0x100 },
+	{ "PBI_BB", 0x10000 + 2 * MAX_FNAME_LEN + 0x100 }
+};
+
+typedef struct {
+	char name[SECTION_NAME_LEN];
+	UBYTE *data;
+	size_t size; /* allocated */
+	size_t used;
+	size_t pos; /* next to read */
+	int loaded;
+	/* As in the file. */
+	ULONG offset;
+	ULONG length;
+	ULONG codec;
+	UBYTE *packed;
+} section_t;
+
+/* Sections are kept in memory while a state file is saved or read. */
+#define SECTIONS_OFF  0
+#define SECTIONS_SAVE 1
+#define SECTIONS_READ 2
+static int sections_mode = SECTIONS_OFF;
+static section_t sections[MAX_SECTIONS];
+static int num_sections = 0;
+/* While not NULL, the StateSav_Save* and StateSav_Read* functions work on
+   this section. */
+static section_t *section = NULL;
+static int section_error;
+/* The file being read. */
+static FILE *section_file = NULL;
+#endif /* SECTIONED_FILES */
+
 static void GetGZErrorText(void)
 {
 #ifdef GZERROR
@@ -122,36 +214,122 @@ static void GetGZErrorText(void)
 	Log_print("State file I/O failed.");
 }
 
+/* Whether the state file or snapshot is open and without errors. */
+static int StreamOK(void)
+{
+	if (snapshot != NULL)
+		return !snapshot_error;
+#ifdef SECTIONED_FILES
+	if (section != NULL)
+		return !section_error;
+#endif
+	return StateFile && nFileError == Z_OK;
+}
+
+/* Writes LEN bytes to the state file or snapshot. Returns FALSE on error. */
+static int WriteBytes(const void *buf, size_t len)
+{
+	if (snapshot != NULL) {
+		/* Not shared while saving, see StateSav_SaveSnapshot. */
+		if (snapshot->data == NULL || snapshot_pos + len > snapshot->data->size) {
+			size_t size = snapshot->data == NULL ? 0 : snapshot->data->size * 2;
+			if (size < snapshot_pos + len)
+				size = snapshot_pos + len;
+			snapshot->data = (StateSav_snapshot_data_t *) Util_realloc(snapshot->data, sizeof(StateSav_snapshot_data_t) + size);
+			snapshot->data->refs = 1;
+			snapshot->data->size = size;
+		}
+		memcpy(snapshot->data->bytes + snapshot_pos, buf, len);
+		snapshot_pos += len;
+		return TRUE;
+	}
+#ifdef SECTIONED_FILES
+	if (section != NULL) {
+		if (section->used + len > section->size) {
+			size_t size = section->size * 2;
+			if (size < section->used + len)
+				size = section->used + len;
+			section->data = (UBYTE *) Util_realloc(section->data, size);
+			section->size = size;
+		}
+		memcpy(section->data + section->used, buf, len);
+		section->used += len;
+		return TRUE;
+	}
+#endif
+	if (GZWRITE(StateFile, buf, len) == 0) {
+		GetGZErrorText();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Reads LEN bytes from the state file or snapshot. Returns FALSE on error. */
+static int ReadBytes(void *buf, size_t len)
+{
+	if (snapshot != NULL) {
+		if (snapshot_pos + len > snapshot->used) {
+			snapshot_error = TRUE;
+			return FALSE;
+		}
+		memcpy(buf, snapshot->data->bytes + snapshot_pos, len);
+		snapshot_pos += len;
+		return TRUE;
+	}
+#ifdef SECTIONED_FILES
+	if (section != NULL) {
+		if (section->pos + len > section->used) {
+			Log_print("Section %.8s of the state file is too short.", section->name);
+			section_error = TRUE;
+			return FALSE;
+		}
+		memcpy(buf, section->data + section->pos, len);
+		section->pos += len;
+		return TRUE;
+	}
+#endif
+	if (GZREAD(StateFile, buf, len) == 0) {
+		GetGZErrorText();
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /* Value is memory location of data, num is number of type to save */
 void StateSav_SaveUBYTE(const UBYTE *data, int num)
 {
-	if (!StateFile || nFileError != Z_OK)
+	if (!StreamOK())
 		return;
 
 	/* Assumption is that UBYTE = 8bits and the pointer passed in refers
 	   directly to the active bits if in a padded location. If not (unlikely)
 	   you'll have to redefine this to save appropriately for cross-platform
 	   compatibility */
-	if (GZWRITE(StateFile, data, num) == 0)
-		GetGZErrorText();
+	WriteBytes(data, num);
 }
 
 /* Value is memory location of data, num is number of type to save */
 void StateSav_ReadUBYTE(UBYTE *data, int num)
 {
-	if (!StateFile || nFileError != Z_OK)
+	if (!StreamOK())
 		return;
 
-	if (GZREAD(StateFile, data, num) == 0)
-		GetGZErrorText();
+	ReadBytes(data, num);
 }
 
 /* Value is memory location of data, num is number of type to save */
 void StateSav_SaveUWORD(const UWORD *data, int num)
 {
-	if (!StateFile || nFileError != Z_OK)
+	if (!StreamOK())
 		return;
 
+	if (snapshot != NULL) {
+		/* The snapshot never leaves the process, so it keeps the values
+		   as they are. */
+		WriteBytes(data, num * sizeof(UWORD));
+		return;
+	}
+
 	/* UWORDS are saved as 16bits, regardless of the size on this particular
 	   platform. Each byte of the UWORD will be pushed out individually in
 	   LSB order. The shifts here and in the read routines will work for both
@@ -162,17 +340,13 @@ void StateSav_SaveUWORD(const UWORD *data, int num)
 
 		temp = *data++;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
+		if (!WriteBytes(&byte, 1))
 			break;
-		}
 
 		temp >>= 8;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
+		if (!WriteBytes(&byte, 1))
 			break;
-		}
 		num--;
 	}
 }
@@ -180,21 +354,22 @@ void StateSav_SaveUWORD(const UWORD *data, int num)
 /* Value is memory location of data, num is number of type to save */
 void StateSav_ReadUWORD(UWORD *data, int num)
 {
-	if (!StateFile || nFileError != Z_OK)
+	if (!StreamOK())
 		return;
 
+	if (snapshot != NULL) {
+		ReadBytes(data, num * sizeof(UWORD));
+		return;
+	}
+
 	while (num > 0) {
 		UBYTE byte1, byte2;
 
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
-			GetGZErrorText();
+		if (!ReadBytes(&byte1, 1))
 			break;
-		}
 
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
-			GetGZErrorText();
+		if (!ReadBytes(&byte2, 1))
 			break;
-		}
 
 		*data++ = (byte2 << 8) | byte1;
 		num--;
@@ -203,8 +378,13 @@ void StateSav_ReadUWORD(UWORD *data, int num)
 
 void StateSav_SaveINT(const int *data, int num)
 {
-	if (!StateFile || nFileError != Z_OK)
+	if (!StreamOK())
+		return;
+
+	if (snapshot != NULL) {
+		WriteBytes(data, num * sizeof(int));
 		return;
+	}
 
 	/* INTs are always saved as 32bits (4 bytes) in the file. They can be any size
 	   on the platform however. The sign bit is clobbered into the fourth byte saved
@@ -224,31 +404,23 @@ void StateSav_SaveINT(const int *data, int num)
 		temp = (unsigned int) temp0;
 
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
+		if (!WriteBytes(&byte, 1))
 			break;
-		}
 
 		temp >>= 8;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
+		if (!WriteBytes(&byte, 1))
 			break;
-		}
 
 		temp >>= 8;
 		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
+		if (!WriteBytes(&byte, 1))
 			break;
-		}
 
 		temp >>= 8;
 		byte = (temp & 0x7f) | signbit;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
+		if (!WriteBytes(&byte, 1))
 			break;
-		}
 
 		num--;
 	}
@@ -256,33 +428,30 @@ void StateSav_SaveINT(const int *data, int num)
 
 void StateSav_ReadINT(int *data, int num)
 {
-	if (!StateFile || nFileError != Z_OK)
+	if (!StreamOK())
 		return;
 
+	if (snapshot != NULL) {
+		ReadBytes(data, num * sizeof(int));
+		return;
+	}
+
 	while (num > 0) {
 		UBYTE signbit = 0;
 		int temp;
 		UBYTE byte1, byte2, byte3, byte4;
 
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
-			GetGZErrorText();
+		if (!ReadBytes(&byte1, 1))
 			break;
-		}
 
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
-			GetGZErrorText();
+		if (!ReadBytes(&byte2, 1))
 			break;
-		}
 
-		if (GZREAD(StateFile, &byte3, 1) == 0) {
-			GetGZErrorText();
+		if (!ReadBytes(&byte3, 1))
 			break;
-		}
 
-		if (GZREAD(StateFile, &byte4, 1) == 0) {
-			GetGZErrorText();
+		if (!ReadBytes(&byte4, 1))
 			break;
-		}
 
 		signbit = byte4 & 0x80;
 		byte4 &= 0x7f;
@@ -328,42 +497,268 @@ void StateSav_ReadFNAME(char *filename)
 	filename[namelen] = 0;
 }
 
-int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose)
+#ifdef SECTIONED_FILES
+static void PutULONG(UBYTE *p, ULONG value)
 {
-	UBYTE StateVersion = SAVE_VERSION_NUMBER;
+	p[0] = (UBYTE) value;
+	p[1] = (UBYTE) (value >> 8);
+	p[2] = (UBYTE) (value >> 16);
+	p[3] = (UBYTE) (value >> 24);
+}
 
-	if (StateFile != NULL) {
-		GZCLOSE(StateFile);
-		StateFile = NULL;
+static ULONG GetULONG(const UBYTE *p)
+{
+	return p[0] | (p[1] << 8) | ((ULONG) p[2] << 16) | ((ULONG) p[3] << 24);
+}
+
+static ULONG SectionLimit(const char *name)
+{
+	unsigned int i;
+	for (i = 0; i < sizeof(section_limits) / sizeof(section_limits[0]); i++)
+		if (strncmp(section_limits[i].name, name, SECTION_NAME_LEN) == 0)
+			return section_limits[i].max;
+	return MAX_SMALL_SECTION;
+}
+
+/* The zlib level requested by a gzopen()-style MODE, eg. "wb9". */
+static int CompressionLevel(const char *mode)
+{
+	if (mode != NULL)
+		for (; *mode != '\0'; mode++)
+			if (*mode >= '0' && *mode <= '9')
+				return *mode - '0';
+	return Z_DEFAULT_COMPRESSION;
+}
+
+static section_t *FindSection(const char *name)
+{
+	int i;
+	for (i = 0; i < num_sections; i++)
+		if (strncmp(sections[i].name, name, SECTION_NAME_LEN) == 0)
+			return &sections[i];
+	return NULL;
+}
+
+static void FreeSectionList(section_t *list, int count)
+{
+	int i;
+	for (i = 0; i < count; i++) {
+		free(list[i].data);
+		free(list[i].packed);
 	}
-	nFileError = Z_OK;
+}
 
-	StateFile = GZOPEN(filename, mode);
-	if (StateFile == NULL) {
-		Log_print("Could not open %s for state save.", filename);
-		GetGZErrorText();
+static void FreeSections(void)
+{
+	FreeSectionList(sections, num_sections);
+	num_sections = 0;
+	section = NULL;
+}
+
+/* Compresses the COUNT sections of LIST at zlib LEVEL and writes them,
+   after the header and the directory, to FP. Touches nothing else, so that
+   it can run in another thread. */
+static int WriteSections(FILE *fp, section_t *list, int count, UBYTE SaveVerbose, int level)
+{
+	UBYTE header[HEADER_LEN];
+	ULONG offset = HEADER_LEN + count * DIRECTORY_ENTRY_LEN;
+	int i;
+
+	memcpy(header, "ATARI800", 8);
+	header[8] = SAVE_VERSION_NUMBER;
+	header[9] = SaveVerbose;
+	PutULONG(header + 10, count);
+	if (fwrite(header, HEADER_LEN, 1, fp) != 1)
 		return FALSE;
+	for (i = 0; i < count; i++) {
+		section_t *s = &list[i];
+		UBYTE entry[DIRECTORY_ENTRY_LEN];
+		s->codec = CODEC_STORED;
+		s->length = s->used;
+#ifdef HAVE_LIBZ
+		{
+			uLongf len = compressBound(s->used);
+			s->packed = (UBYTE *) Util_malloc(len);
+			if (compress2(s->packed, &len, s->data, s->used, level) == Z_OK && len < s->used) {
+				s->codec = CODEC_DEFLATE;
+				s->length = len;
+			}
+		}
+#endif
+		s->offset = offset;
+		offset += s->length;
+		memcpy(entry, s->name, SECTION_NAME_LEN);
+		PutULONG(entry + SECTION_NAME_LEN, s->offset);
+		PutULONG(entry + SECTION_NAME_LEN + 4, s->length);
+		PutULONG(entry + SECTION_NAME_LEN + 8, s->used);
+		PutULONG(entry + SECTION_NAME_LEN + 12, s->codec);
+		if (fwrite(entry, DIRECTORY_ENTRY_LEN, 1, fp) != 1)
+			return FALSE;
 	}
-	if (GZWRITE(StateFile, "ATARI800", 8) == 0) {
-		GetGZErrorText();
-		GZCLOSE(StateFile);
-		StateFile = NULL;
+	for (i = 0; i < count; i++) {
+		section_t *s = &list[i];
+		if (s->length > 0 && fwrite(s->codec == CODEC_STORED ? s->data : s->packed, s->length, 1, fp) != 1)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Reads the header and the directory of the sectioned state file FP. */
+static int ReadDirectory(FILE *fp)
+{
+	UBYTE header[HEADER_LEN];
+	ULONG count;
+	ULONG i;
+	long file_size;
+
+	num_sections = 0;
+	if (fseek(fp, 0, SEEK_END) != 0 || (file_size = ftell(fp)) < 0)
+		return FALSE;
+	if (fseek(fp, 0, SEEK_SET) != 0
+	 || fread(header, HEADER_LEN, 1, fp) != 1
+	 || memcmp(header, "ATARI800", 8) != 0
+	 || header[8] < SECTIONED_VERSION_NUMBER)
+		return FALSE;
+	count = GetULONG(header + 10);
+	if (count > MAX_SECTIONS)
 		return FALSE;
+	for (i = 0; i < count; i++) {
+		section_t *s = &sections[i];
+		UBYTE entry[DIRECTORY_ENTRY_LEN];
+		if (fread(entry, DIRECTORY_ENTRY_LEN, 1, fp) != 1)
+			return FALSE;
+		memset(s, 0, sizeof(section_t));
+		memcpy(s->name, entry, SECTION_NAME_LEN);
+		s->offset = GetULONG(entry + SECTION_NAME_LEN);
+		s->length = GetULONG(entry + SECTION_NAME_LEN + 4);
+		s->used = GetULONG(entry + SECTION_NAME_LEN + 8);
+		s->codec = GetULONG(entry + SECTION_NAME_LEN + 12);
+		num_sections++;
+		/* Don't allocate what a damaged file claims. */
+		if (s->used > SectionLimit(s->name))
+			return FALSE;
+		if (s->offset > (ULONG) file_size || s->length > (ULONG) file_size - s->offset)
+			return FALSE;
+		if (s->codec == CODEC_STORED ? s->used != s->length
+		                             : s->used / MAX_DEFLATE_RATIO > s->length)
+			return FALSE;
 	}
+	return TRUE;
+}
 
-	STATESAV_TAG(size);  /* initialize to 0, set to actual size if successful */
-	StateSav_SaveUBYTE(&StateVersion, 1);
-	StateSav_SaveUBYTE(&SaveVerbose, 1);
-	/* The order here is important. Atari800_StateSave must be first because it saves the machine type, and
-	   decisions on what to save/not save are made based off that later in the process */
+/* Reads section S, found by ReadDirectory, from FP. */
+static int LoadSection(FILE *fp, section_t *s)
+{
+	s->data = (UBYTE *) Util_malloc(s->used > 0 ? s->used : 1);
+	s->size = s->used;
+	s->pos = 0;
+	if (fseek(fp, s->offset, SEEK_SET) != 0)
+		return FALSE;
+	switch (s->codec) {
+	case CODEC_STORED:
+		if (s->length != s->used || (s->used > 0 && fread(s->data, s->used, 1, fp) != 1))
+			return FALSE;
+		break;
+#ifdef HAVE_LIBZ
+	case CODEC_DEFLATE:
+		{
+			uLongf len = s->used;
+			s->packed = (UBYTE *) Util_malloc(s->length > 0 ? s->length : 1);
+			if (fread(s->packed, s->length, 1, fp) != 1
+			 || uncompress(s->data, &len, s->packed, s->length) != Z_OK
+			 || len != s->used)
+				return FALSE;
+		}
+		break;
+#endif
+	default:
+		Log_print("Section %.8s of the state file is compressed in an unsupported way.", s->name);
+		return FALSE;
+	}
+	s->loaded = TRUE;
+	return TRUE;
+}
+#endif /* SECTIONED_FILES */
+
+void StateSav_BeginSection(const char *name)
+{
+#ifdef SECTIONED_FILES
+	if (sections_mode == SECTIONS_OFF || snapshot != NULL)
+		return;
+	section = FindSection(name);
+	if (sections_mode == SECTIONS_READ) {
+		if (section == NULL) {
+			Log_print("The state file has no %s section.", name);
+			section_error = TRUE;
+		}
+		else if (!section->loaded && !LoadSection(section_file, section)) {
+			Log_print("Could not read section %s of the state file.", name);
+			section_error = TRUE;
+		}
+	}
+	else if (section == NULL) {
+		/* Saving: sections are written in the order they are begun. */
+		if (num_sections == MAX_SECTIONS) {
+			section_error = TRUE;
+			return;
+		}
+		section = &sections[num_sections++];
+		memset(section, 0, sizeof(section_t));
+		strncpy(section->name, name, SECTION_NAME_LEN);
+	}
+#endif /* SECTIONED_FILES */
+}
+
+int StateSav_ReadFileSection(const char *filename, const char *name, UBYTE **data, size_t *size)
+{
+#ifdef SECTIONED_FILES
+	FILE *fp;
+	section_t *s;
+	int ok = FALSE;
+
+	if (sections_mode != SECTIONS_OFF)
+		return FALSE;
+	StateSav_FinishBackgroundSave();
+	fp = fopen(filename, "rb");
+	if (fp == NULL)
+		return FALSE;
+	if (ReadDirectory(fp) && (s = FindSection(name)) != NULL && LoadSection(fp, s)) {
+		*data = s->data;
+		*size = s->used;
+		s->data = NULL;
+		ok = TRUE;
+	}
+	fclose(fp);
+	FreeSections();
+	return ok;
+#else
+	return FALSE;
+#endif /* SECTIONED_FILES */
+}
+
+/* Saves the state of all modules. The order here is important.
+   Atari800_StateSave must be first because it saves the machine type, and
+   decisions on what to save/not save are made based off that later in the
+   process. */
+static void SaveModules(UBYTE SaveVerbose)
+{
+	StateSav_BeginSection("ATARI");
 	Atari800_StateSave();
+	StateSav_BeginSection("CART");
 	CARTRIDGE_StateSave();
+	StateSav_BeginSection("SIO");
 	SIO_StateSave();
+	StateSav_BeginSection("ANTIC");
 	ANTIC_StateSave();
+	StateSav_BeginSection("CPU");
 	CPU_StateSave(SaveVerbose);
+	StateSav_BeginSection("GTIA");
 	GTIA_StateSave();
+	StateSav_BeginSection("PIA");
 	PIA_StateSave();
+	StateSav_BeginSection("POKEY");
 	POKEY_StateSave();
+	StateSav_BeginSection("XEP80");
 #ifdef XEP80_EMULATION
 	XEP80_StateSave();
 #else
@@ -372,7 +767,9 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		StateSav_SaveINT(&local_xep80_enabled, 1);
 	}
 #endif /* XEP80_EMULATION */
+	StateSav_BeginSection("PBI");
 	PBI_StateSave();
+	StateSav_BeginSection("PBI_MIO");
 #ifdef PBI_MIO
 	PBI_MIO_StateSave();
 #else
@@ -381,6 +778,7 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		StateSav_SaveINT(&local_mio_enabled, 1);
 	}
 #endif /* PBI_MIO */
+	StateSav_BeginSection("PBI_BB");
 #ifdef PBI_BB
 	PBI_BB_StateSave();
 #else
@@ -389,6 +787,7 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		StateSav_SaveINT(&local_bb_enabled, 1);
 	}
 #endif /* PBI_BB */
+	StateSav_BeginSection("PBI_XLD");
 #ifdef PBI_XLD
 	PBI_XLD_StateSave();
 #else
@@ -400,6 +799,262 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 #ifdef DREAMCAST
 	DCStateSave();
 #endif
+}
+
+/* Reads what SaveModules saved. Returns FALSE if the state needs something
+   this version does not support. */
+static int ReadModules(UBYTE StateVersion, UBYTE SaveVerbose)
+{
+	StateSav_BeginSection("ATARI");
+	Atari800_StateRead(StateVersion);
+	if (StateVersion >= 4) {
+		StateSav_BeginSection("CART");
+		CARTRIDGE_StateRead(StateVersion);
+		StateSav_BeginSection("SIO");
+		SIO_StateRead();
+	}
+	StateSav_BeginSection("ANTIC");
+	ANTIC_StateRead();
+	StateSav_BeginSection("CPU");
+	CPU_StateRead(SaveVerbose, StateVersion);
+	StateSav_BeginSection("GTIA");
+	GTIA_StateRead(StateVersion);
+	StateSav_BeginSection("PIA");
+	PIA_StateRead(StateVersion);
+	StateSav_BeginSection("POKEY");
+	POKEY_StateRead();
+	if (StateVersion >= 6) {
+		StateSav_BeginSection("XEP80");
+#ifdef XEP80_EMULATION
+		XEP80_StateRead();
+#else
+		{
+			int local_xep80_enabled = FALSE;
+			StateSav_ReadINT(&local_xep80_enabled,1);
+			if (local_xep80_enabled) {
+				Log_print("Cannot read this state file because this version does not support XEP80.");
+				return FALSE;
+			}
+		}
+#endif /* XEP80_EMULATION */
+		StateSav_BeginSection("PBI");
+		PBI_StateRead();
+		StateSav_BeginSection("PBI_MIO");
+#ifdef PBI_MIO
+		PBI_MIO_StateRead();
+#else
+		{
+			int local_mio_enabled;
+			StateSav_ReadINT(&local_mio_enabled,1);
+			if (local_mio_enabled) {
+				Log_print("Cannot read this state file because this version does not support MIO.");
+				return FALSE;
+			}
+		}
+#endif /* PBI_MIO */
+		StateSav_BeginSection("PBI_BB");
+#ifdef PBI_BB
+		PBI_BB_StateRead();
+#else
+		{
+			int local_bb_enabled;
+			StateSav_ReadINT(&local_bb_enabled,1);
+			if (local_bb_enabled) {
+				Log_print("Cannot read this state file because this version does not support the Black Box.");
+				return FALSE;
+			}
+		}
+#endif /* PBI_BB */
+		StateSav_BeginSection("PBI_XLD");
+#ifdef PBI_XLD
+		PBI_XLD_StateRead();
+#else
+		{
+			int local_xld_enabled;
+			StateSav_ReadINT(&local_xld_enabled,1);
+			if (local_xld_enabled) {
+				Log_print("Cannot read this state file because this version does not support the 1400XL/1450XLD.");
+				return FALSE;
+			}
+		}
+#endif /* PBI_XLD */
+	}
+#ifdef DREAMCAST
+	DCStateRead();
+#endif
+	return TRUE;
+}
+
+#ifdef SECTIONED_FILES
+/* Saves the state of all modules into SECTIONS. */
+static int TakeSections(UBYTE SaveVerbose)
+{
+	sections_mode = SECTIONS_SAVE;
+	section_error = FALSE;
+	SaveModules(SaveVerbose);
+	section = NULL;
+	sections_mode = SECTIONS_OFF;
+	if (section_error) {
+		FreeSections();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Writes the COUNT sections of LIST to the state file FILENAME. Returns
+   FALSE if it can't be opened and -1 on a write error. */
+static int WriteStateFile(const char *filename, section_t *list, int count, UBYTE SaveVerbose, int level)
+{
+	FILE *fp = fopen(filename, "wb");
+	int ok;
+	if (fp == NULL)
+		return FALSE;
+	ok = WriteSections(fp, list, count, SaveVerbose, level);
+	if (fclose(fp) != 0)
+		ok = FALSE;
+	return ok ? TRUE : -1;
+}
+
+static void LogWriteError(const char *filename, int result)
+{
+	if (result == FALSE)
+		Log_print("Could not open %s for state save.", filename);
+	else if (result < 0)
+		Log_print("State file I/O failed.");
+}
+#endif /* SECTIONED_FILES */
+
+#ifdef BACKGROUND_SAVES
+/* The state being written by the background thread. Between starting the
+   thread and reporting its result, only the thread touches it, except for
+   FINISHED and RESULT, which are guarded by BACKGROUND_LOCK. */
+static struct {
+	int active;
+	int finished;
+	int result;
+	pthread_t thread;
+	section_t sections[MAX_SECTIONS];
+	int num_sections;
+	UBYTE SaveVerbose;
+	char filename[FILENAME_MAX];
+	StateSav_done_func_t done;
+} background;
+static pthread_mutex_t background_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *BackgroundSave(void *arg)
+{
+	int result = WriteStateFile(background.filename, background.sections, background.num_sections, background.SaveVerbose, Z_DEFAULT_COMPRESSION);
+	FreeSectionList(background.sections, background.num_sections);
+	pthread_mutex_lock(&background_lock);
+	background.result = result;
+	background.finished = TRUE;
+	pthread_mutex_unlock(&background_lock);
+	return NULL;
+}
+
+/* Called in the emulation thread after the background thread finished. */
+static void ReportBackgroundSave(void)
+{
+	background.active = FALSE;
+	LogWriteError(background.filename, background.result);
+	if (background.done != NULL)
+		background.done(background.filename, background.result > 0);
+}
+#endif /* BACKGROUND_SAVES */
+
+void StateSav_PollBackgroundSave(void)
+{
+#ifdef BACKGROUND_SAVES
+	int finished;
+	if (!background.active)
+		return;
+	pthread_mutex_lock(&background_lock);
+	finished = background.finished;
+	pthread_mutex_unlock(&background_lock);
+	if (finished) {
+		pthread_join(background.thread, NULL);
+		ReportBackgroundSave();
+	}
+#endif /* BACKGROUND_SAVES */
+}
+
+void StateSav_FinishBackgroundSave(void)
+{
+#ifdef BACKGROUND_SAVES
+	if (background.active) {
+		pthread_join(background.thread, NULL);
+		ReportBackgroundSave();
+	}
+#endif /* BACKGROUND_SAVES */
+}
+
+int StateSav_SaveAtariStateInBackground(const char *filename, UBYTE SaveVerbose, StateSav_done_func_t done)
+{
+#ifdef BACKGROUND_SAVES
+	StateSav_FinishBackgroundSave();
+	if (!TakeSections(SaveVerbose))
+		return FALSE;
+	memcpy(background.sections, sections, num_sections * sizeof(section_t));
+	background.num_sections = num_sections;
+	num_sections = 0;
+	background.SaveVerbose = SaveVerbose;
+	Util_strlcpy(background.filename, filename, FILENAME_MAX);
+	background.done = done;
+	background.finished = FALSE;
+	background.active = TRUE;
+	if (pthread_create(&background.thread, NULL, BackgroundSave, NULL) != 0) {
+		/* Write it in this thread then. */
+		BackgroundSave(NULL);
+		background.active = FALSE;
+		ReportBackgroundSave();
+	}
+	return TRUE;
+#else /* BACKGROUND_SAVES */
+	int ok = StateSav_SaveAtariState(filename, "wb", SaveVerbose);
+	if (done != NULL)
+		done(filename, ok);
+	return TRUE;
+#endif /* BACKGROUND_SAVES */
+}
+
+int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose)
+{
+#ifdef SECTIONED_FILES
+	int result;
+
+	StateSav_FinishBackgroundSave();
+	if (!TakeSections(SaveVerbose))
+		return FALSE;
+	result = WriteStateFile(filename, sections, num_sections, SaveVerbose, CompressionLevel(mode));
+	LogWriteError(filename, result);
+	FreeSections();
+	return result > 0;
+#else /* SECTIONED_FILES */
+	UBYTE StateVersion = STREAM_VERSION_NUMBER;
+
+	if (StateFile != NULL) {
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+	}
+	nFileError = Z_OK;
+
+	StateFile = GZOPEN(filename, mode);
+	if (StateFile == NULL) {
+		Log_print("Could not open %s for state save.", filename);
+		GetGZErrorText();
+		return FALSE;
+	}
+	if (GZWRITE(StateFile, "ATARI800", 8) == 0) {
+		GetGZErrorText();
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return FALSE;
+	}
+
+	STATESAV_TAG(size);  /* initialize to 0, set to actual size if successful */
+	StateSav_SaveUBYTE(&StateVersion, 1);
+	StateSav_SaveUBYTE(&SaveVerbose, 1);
+	SaveModules(SaveVerbose);
 
 	STATESAV_TAG(size);
 	if (GZCLOSE(StateFile) != 0) {
@@ -412,13 +1067,44 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		return FALSE;
 
 	return TRUE;
+#endif /* SECTIONED_FILES */
+}
+
+#ifdef SECTIONED_FILES
+static int ReadSectionedState(const char *filename, UBYTE StateVersion, UBYTE SaveVerbose)
+{
+	int ok;
+
+	section_file = fopen(filename, "rb");
+	if (section_file == NULL) {
+		Log_print("Could not open %s for state read.", filename);
+		return FALSE;
+	}
+	sections_mode = SECTIONS_READ;
+	section_error = FALSE;
+	if (!ReadDirectory(section_file)) {
+		Log_print("The directory of the state file is damaged.");
+		ok = FALSE;
+	}
+	else
+		ok = ReadModules(StateVersion, SaveVerbose) && !section_error;
+	fclose(section_file);
+	section_file = NULL;
+	FreeSections();
+	sections_mode = SECTIONS_OFF;
+	return ok;
 }
+#endif /* SECTIONED_FILES */
 
 int StateSav_ReadAtariState(const char *filename, const char *mode)
 {
 	char header_string[8];
 	UBYTE StateVersion = 0;  /* The version of the save file */
 	UBYTE SaveVerbose = 0;   /* Verbose mode means save basic, OS if patched */
+	int ok;
+
+	/* The file may be still being written. */
+	StateSav_FinishBackgroundSave();
 
 	if (StateFile != NULL) {
 		GZCLOSE(StateFile);
@@ -455,93 +1141,173 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 		return FALSE;
 	}
 
+#ifdef SECTIONED_FILES
 	if (StateVersion > SAVE_VERSION_NUMBER || StateVersion < 3) {
+#else
+	/* Sectioned files are only written and read as files. */
+	if (StateVersion >= SECTIONED_VERSION_NUMBER || StateVersion < 3) {
+#endif
 		Log_print("Cannot read this state file because it is an incompatible version.");
 		GZCLOSE(StateFile);
 		StateFile = NULL;
 		return FALSE;
 	}
 
-	Atari800_StateRead(StateVersion);
-	if (StateVersion >= 4) {
-		CARTRIDGE_StateRead(StateVersion);
-		SIO_StateRead();
+#ifdef SECTIONED_FILES
+	if (StateVersion >= SECTIONED_VERSION_NUMBER) {
+		/* Read again, from the directory on. */
+		GZCLOSE(StateFile);
+		StateFile = NULL;
+		return ReadSectionedState(filename, StateVersion, SaveVerbose);
 	}
+#endif
+
+	ok = ReadModules(StateVersion, SaveVerbose);
+
+	GZCLOSE(StateFile);
+	StateFile = NULL;
+
+	if (nFileError != Z_OK)
+		return FALSE;
+
+	return ok;
+}
+
+
+/* The parts of the state that go into a snapshot, in the order of a state
+   file. The machine configuration and the media are left out: they don't
+   change in between, and reinserting cartridges and disks would reopen
+   their files. */
+static void SnapshotSave(void)
+{
+	ULONG random_counter = POKEY_GetRandomCounter();
+
+	CARTRIDGE_StateSaveBanks();
+	ANTIC_StateSave();
+	CPU_StateSave(FALSE);
+	GTIA_StateSave();
+	PIA_StateSave();
+	POKEY_StateSave();
+#ifdef XEP80_EMULATION
+	XEP80_StateSave();
+#endif
+	PBI_StateSave();
+#ifdef PBI_MIO
+	PBI_MIO_StateSave();
+#endif
+#ifdef PBI_BB
+	PBI_BB_StateSave();
+#endif
+#ifdef PBI_XLD
+	PBI_XLD_StateSave();
+#endif
+	SIO_StateSaveTransfer();
+	INPUT_StateSaveHistory();
+	/* Counters that state files don't keep. The snapshot never leaves the
+	   process, so they are stored as they are. */
+	WriteBytes(&ANTIC_screenline_cpu_clock, sizeof(ANTIC_screenline_cpu_clock));
+	WriteBytes(&random_counter, sizeof(random_counter));
+	WriteBytes(&GTIA_consol_override, sizeof(GTIA_consol_override));
+}
+
+static void SnapshotRead(void)
+{
+	ULONG random_counter;
+
+	CARTRIDGE_StateReadBanks();
 	ANTIC_StateRead();
-	CPU_StateRead(SaveVerbose, StateVersion);
-	GTIA_StateRead(StateVersion);
-	PIA_StateRead(StateVersion);
+	CPU_StateRead(FALSE, SAVE_VERSION_NUMBER);
+	GTIA_StateRead(SAVE_VERSION_NUMBER);
+	PIA_StateRead(SAVE_VERSION_NUMBER);
 	POKEY_StateRead();
-	if (StateVersion >= 6) {
 #ifdef XEP80_EMULATION
-		XEP80_StateRead();
-#else
-		int local_xep80_enabled = FALSE;
-		StateSav_ReadINT(&local_xep80_enabled,1);
-		if (local_xep80_enabled) {
-			Log_print("Cannot read this state file because this version does not support XEP80.");
-			GZCLOSE(StateFile);
-			StateFile = NULL;
-			return FALSE;
-		}
-#endif /* XEP80_EMULATION */
-		PBI_StateRead();
+	XEP80_StateRead();
+#endif
+	PBI_StateRead();
 #ifdef PBI_MIO
-		PBI_MIO_StateRead();
-#else
-		{
-			int local_mio_enabled;
-			StateSav_ReadINT(&local_mio_enabled,1);
-			if (local_mio_enabled) {
-				Log_print("Cannot read this state file because this version does not support MIO.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
-				return FALSE;
-			}
-		}
-#endif /* PBI_MIO */
+	PBI_MIO_StateRead();
+#endif
 #ifdef PBI_BB
-		PBI_BB_StateRead();
-#else
-		{
-			int local_bb_enabled;
-			StateSav_ReadINT(&local_bb_enabled,1);
-			if (local_bb_enabled) {
-				Log_print("Cannot read this state file because this version does not support the Black Box.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
-				return FALSE;
-			}
-		}
-#endif /* PBI_BB */
+	PBI_BB_StateRead();
+#endif
 #ifdef PBI_XLD
-		PBI_XLD_StateRead();
-#else
-		{
-			int local_xld_enabled;
-			StateSav_ReadINT(&local_xld_enabled,1);
-			if (local_xld_enabled) {
-				Log_print("Cannot read this state file because this version does not support the 1400XL/1450XLD.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
-				return FALSE;
-			}
-		}
-#endif /* PBI_XLD */
-	}
-#ifdef DREAMCAST
-	DCStateRead();
+	PBI_XLD_StateRead();
 #endif
+	SIO_StateReadTransfer();
+	INPUT_StateReadHistory();
+	ReadBytes(&ANTIC_screenline_cpu_clock, sizeof(ANTIC_screenline_cpu_clock));
+	if (ReadBytes(&random_counter, sizeof(random_counter)))
+		POKEY_SetRandomCounter(random_counter);
+	ReadBytes(&GTIA_consol_override, sizeof(GTIA_consol_override));
+}
 
-	GZCLOSE(StateFile);
-	StateFile = NULL;
+int StateSav_SaveSnapshot(StateSav_snapshot_t *snap)
+{
+#ifdef LIBATARI800
+	/* The module offsets are reported for state files only. */
+	statesav_tags_t ignored_tags;
+	statesav_tags_t *tags = LIBATARI800_StateSav_tags;
+	LIBATARI800_StateSav_tags = &ignored_tags;
+#endif
+	if (snap->data != NULL && snap->data->refs > 1) {
+		/* Copy on write: the copies keep the old data. */
+		StateSav_snapshot_data_t *data = (StateSav_snapshot_data_t *) Util_malloc(sizeof(StateSav_snapshot_data_t) + snap->data->size);
+		data->refs = 1;
+		data->size = snap->data->size;
+		snap->data->refs--;
+		snap->data = data;
+	}
+	snapshot = snap;
+	snapshot_pos = 0;
+	snapshot_error = FALSE;
+	SnapshotSave();
+#ifdef LIBATARI800
+	LIBATARI800_StateSav_tags = tags;
+#endif
+	snap->used = snapshot_pos;
+	snapshot = NULL;
+	return !snapshot_error;
+}
 
-	if (nFileError != Z_OK)
+int StateSav_RestoreSnapshot(StateSav_snapshot_t *snap)
+{
+	int ok;
+	if (snap->used == 0)
 		return FALSE;
+	snapshot = snap;
+	snapshot_pos = 0;
+	snapshot_error = FALSE;
+	SnapshotRead();
+	ok = !snapshot_error && snapshot_pos == snap->used;
+	snapshot = NULL;
+	return ok;
+}
 
-	return TRUE;
+void StateSav_CopySnapshot(StateSav_snapshot_t *dest, StateSav_snapshot_t const *src)
+{
+	if (dest == src)
+		return;
+	if (src->data != NULL)
+		src->data->refs++;
+	StateSav_FreeSnapshot(dest);
+	dest->data = src->data;
+	dest->used = src->used;
+	MEMORY_SharePages(&dest->pages, &src->pages);
+}
+
+void StateSav_FreeSnapshot(StateSav_snapshot_t *snap)
+{
+	if (snap->data != NULL && --snap->data->refs == 0)
+		free(snap->data);
+	snap->data = NULL;
+	snap->used = 0;
+	MEMORY_FreePages(&snap->pages);
 }
 
+MEMORY_pages_t *StateSav_SnapshotPages(void)
+{
+	return snapshot == NULL ? NULL : &snapshot->pages;
+}
 
 /* Common definitions for in-memory state save used for DREAMCAST and libatari800
  */
@@ -653,8 +1419,9 @@ static gzFile mem_open(const char *name, const char *mode)
 {
 	plainmembuf = (char *)LIBATARI800_StateSav_buffer;
 	plainmemoff = 0; /*HDR_LEN;*/
-	unclen = STATESAV_MAX_SIZE;
-	return (gzFile) plainmembuf;
+	unclen = LIBATARI800_StateSav_size;
+	/* Without a buffer, the state is only measured. */
+	return plainmembuf != NULL ? (gzFile) plainmembuf : (gzFile) &plainmemoff;
 }
 
 /* replacement for GZCLOSE */
@@ -673,7 +1440,10 @@ ULONG StateSav_Tell()
 /* replacement for GZREAD */
 static size_t mem_read(void *buf, size_t len, gzFile stream)
 {
-	if (plainmemoff + len > unclen) return 0;  /* shouldn't happen */
+	if (plainmemoff + len > unclen) {
+		nFileError = Z_BUF_ERROR;
+		return 0;
+	}
 	memcpy(buf, plainmembuf + plainmemoff, len);
 	plainmemoff += len;
 	return len;
@@ -682,8 +1452,13 @@ static size_t mem_read(void *buf, size_t len, gzFile stream)
 /* replacement for GZWRITE */
 static size_t mem_write(const void *buf, size_t len, gzFile stream)
 {
-	if (plainmemoff + len > unclen) return 0;  /* shouldn't happen */
-	memcpy(plainmembuf + plainmemoff, buf, len);
+	if (plainmemoff + len > unclen) {
+		/* The buffer is too small for this machine. */
+		nFileError = Z_BUF_ERROR;
+		return 0;
+	}
+	if (plainmembuf != NULL)
+		memcpy(plainmembuf + plainmemoff, buf, len);
 	plainmemoff += len;
 	return len;
 }
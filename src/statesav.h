@@ -3,10 +3,74 @@
 
 #include "config.h"
 #include "atari.h"
+#include "memory.h"
 
+/* MODE is as for gzopen(): a digit in it sets the compression level, which
+   for sectioned state files applies to each section. */
 int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose);
 int StateSav_ReadAtariState(const char *filename, const char *mode);
 
+/* Takes the state now, but leaves compressing and writing the state file
+   to a background thread, so that emulation goes on meanwhile. DONE, if
+   not NULL, is called with FILENAME and whether the file was written, from
+   StateSav_PollBackgroundSave or StateSav_FinishBackgroundSave, or before
+   returning when there are no threads. Returns FALSE if the state could not
+   be taken. A save started before is finished first. */
+typedef void (*StateSav_done_func_t)(const char *filename, int ok);
+int StateSav_SaveAtariStateInBackground(const char *filename, UBYTE SaveVerbose, StateSav_done_func_t done);
+/* Reports the background save if it is finished; called every frame. */
+void StateSav_PollBackgroundSave(void);
+/* Waits for the background save and reports it. */
+void StateSav_FinishBackgroundSave(void);
+
+/* State files are made of named sections, each compressed on its own and
+   found through a directory at the start of the file, so that a part of
+   the state can be read without the rest. The sections are "ATARI",
+   "CART", "SIO" (the disk drives), "ANTIC", "CPU" (the registers),
+   "MEMORY", "EXTMEM" (the RAM banks of the XL/XE, Axlon and Mosaic
+   expansions), "GTIA", "PIA", "POKEY", "XEP80", "PBI", "PBI_MIO", "PBI_BB"
+   and "PBI_XLD". The StateSav_Save* and StateSav_Read* functions work on
+   the section begun last; elsewhere this does nothing. */
+void StateSav_BeginSection(const char *name);
+/* Reads the section NAME of the state file FILENAME without reading the
+   others: sets *DATA to a buffer to free() and *SIZE to its length.
+   Returns FALSE on failure, also for state files older than sections. */
+int StateSav_ReadFileSection(const char *filename, const char *name, UBYTE **data, size_t *size);
+
+/* An in-memory snapshot of the running emulator, for going back to it
+   later in the same session (eg. for run-ahead). It holds what a state
+   file does except the machine configuration and the inserted media,
+   which stay as they are, plus the counters that state files leave out,
+   so that emulation after a restore goes on exactly as it did after the
+   save. There is no compression and no temporary file, and words and
+   integers are copied in the host's layout, not byte by byte. DATA grows as
+   needed and is reused by later saves; initialise the structure with
+   zeros and release it with StateSav_FreeSnapshot(). */
+typedef struct StateSav_snapshot_data_t {
+	int refs;
+	size_t size; /* allocated */
+	UBYTE bytes[1];
+} StateSav_snapshot_data_t;
+
+typedef struct StateSav_snapshot_t {
+	StateSav_snapshot_data_t *data;
+	size_t used; /* filled by the last save */
+	/* MEMORY_mem, kept apart from DATA. */
+	MEMORY_pages_t pages;
+} StateSav_snapshot_t;
+
+/* Return FALSE on failure. */
+int StateSav_SaveSnapshot(StateSav_snapshot_t *snap);
+int StateSav_RestoreSnapshot(StateSav_snapshot_t *snap);
+/* Makes DEST a copy of SRC without copying anything: they share their
+   data, and their main memory page by page, until one of them is saved
+   again. */
+void StateSav_CopySnapshot(StateSav_snapshot_t *dest, StateSav_snapshot_t const *src);
+void StateSav_FreeSnapshot(StateSav_snapshot_t *snap);
+/* The pages of the snapshot being saved or restored, or NULL when a state
+   file is. */
+MEMORY_pages_t *StateSav_SnapshotPages(void);
+
 void StateSav_SaveUBYTE(const UBYTE *data, int num);
 void StateSav_SaveUWORD(const UWORD *data, int num);
 void StateSav_SaveINT(const int *data, int num);
@@ -59,6 +59,7 @@
 #include "pal_blending.h"
 #endif /* PAL_BLENDING */
 #include "platform.h"
+#include "rewind.h"
 #include "rtime.h"
 #include "screen.h"
 #include "sio.h"
@@ -2247,6 +2248,15 @@ static void AtariSettings(void)
 		UI_MENU_END
 	};
 #endif /* XEP80_EMULATION */
+	static const UI_tMenuItem rewind_menu_array[] = {
+		UI_MENU_ACTION(0, "off"),
+		UI_MENU_ACTION(16, "16 MB"),
+		UI_MENU_ACTION(32, "32 MB"),
+		UI_MENU_ACTION(64, "64 MB"),
+		UI_MENU_ACTION(128, "128 MB"),
+		UI_MENU_ACTION(256, "256 MB"),
+		UI_MENU_END
+	};
 
 	static UI_tMenuItem menu_array[] = {
 		UI_MENU_CHECK(0, "Disable BASIC when booting Atari:"),
@@ -2258,6 +2268,7 @@ static void AtariSettings(void)
 		UI_MENU_CHECK(3, "SIO patch (fast disk access):"),
 		UI_MENU_CHECK(17, "Turbo (F12):"),
 		UI_MENU_ACTION(20, " Turbo speed:"),
+		UI_MENU_SUBMENU_SUFFIX(21, "Rewind buffer (hold Shift+F12):", NULL),
 		UI_MENU_CHECK(19, "Slow booting of DOS binary files:"),
 		UI_MENU_CHECK(5, "P: device (printer):"),
 		UI_MENU_ACTION_PREFIX(12, " Print command: ", Devices_print_command),
@@ -2279,6 +2290,7 @@ static void AtariSettings(void)
 
 	char tmp_command[256];
 	char turbo[40];
+	char rewind[16];
 
 	int option = 0;
 	int speed = 0;
@@ -2295,6 +2307,11 @@ static void AtariSettings(void)
 		SetItemChecked(menu_array, 17, Atari800_turbo);
 		format_turbo_speed(turbo, find_turbo_speed_index(Atari800_turbo_speed), NULL);
 		FindMenuItem(menu_array, 20)->suffix = turbo;
+		if (REWIND_buffer_size == 0)
+			strcpy(rewind, "off");
+		else
+			sprintf(rewind, "%d MB", REWIND_buffer_size);
+		FindMenuItem(menu_array, 21)->suffix = rewind;
 		SetItemChecked(menu_array, 19, BINLOAD_slow_xex_loading);
 		SetItemChecked(menu_array, 5, Devices_enable_p_patch);
 #ifdef R_IO_DEVICE
@@ -2373,6 +2390,13 @@ static void AtariSettings(void)
 				Atari800_turbo_speed = turbo_speeds[speed];
 			}
 			break;
+		case 21:
+			{
+				int option2 = UI_driver->fSelect(NULL, UI_SELECT_POPUP, REWIND_buffer_size, rewind_menu_array, NULL);
+				if (option2 >= 0 && option2 != REWIND_buffer_size)
+					REWIND_SetBufferSize(option2);
+			}
+			break;
 		default:
 			ESC_UpdatePatches();
 			return;
@@ -2399,14 +2423,16 @@ static const char* get_state_filename(void) {
 	return state_filename;
 }
 
+static void QuickSaveDone(const char *filename, int ok) {
+	Screen_SetStatusText(ok ? "Saved" : "Save failed", 120);
+}
+
 static void QuickSaveState(void) {
-	int result = StateSav_SaveAtariState(get_state_filename(), "wb", TRUE);
+	/* Written in the background, so that emulation doesn't stop. */
+	int result = StateSav_SaveAtariStateInBackground(get_state_filename(), TRUE, QuickSaveDone);
 	if (!result) {
 		CantSave(state_filename);
 	}
-	else {
-		Screen_SetStatusText("Saved", 120);
-	}
 }
 
 static void QuickLoadState(void) {
@@ -4347,6 +4373,14 @@ int UI_Initialise(int *argc, char *argv[])
 	return TRUE;
 }
 
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+static int RunOnUIThread(void *arg)
+{
+	UI_Run();
+	return 0;
+}
+#endif
+
 void UI_Run(void)
 {
 	static UI_tMenuItem menu_array[] = {
@@ -4400,6 +4434,12 @@ void UI_Run(void)
 
 	int option = UI_MENU_RUN;
 	int done = FALSE;
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+	int ui_thread_result;
+
+	if (PLATFORM_RunOnUIThread(&RunOnUIThread, NULL, &ui_thread_result))
+		return;
+#endif
 #if SUPPORTS_CHANGE_VIDEOMODE
 	VIDEOMODE_ForceStandardScreen(TRUE);
 #endif
@@ -58,6 +58,13 @@
 #include "util.h"
 #include "log.h"
 
+/* Util_time() reads the monotonic clock when there is one, so that
+   Util_sleep_until() can wait for a deadline on the same clock. */
+#if !defined(SUPPORTS_PLATFORM_TIME) && !defined(HAVE_WINDOWS_H) && !defined(DJGPP) \
+    && defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+#define MONOTONIC_TIME
+#endif
+
 int Util_chrieq(char c1, char c2)
 {
 	switch (c1 ^ c2) {
@@ -556,6 +563,10 @@ double Util_time(void)
 #elif defined(DJGPP)
 	/* DJGPP has gettimeofday, but it's not more accurate than uclock */
 	return uclock() * (1.0 / UCLOCKS_PER_SEC);
+#elif defined(MONOTONIC_TIME)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
 #elif defined(HAVE_GETTIMEOFDAY)
 	struct timeval tp;
 	gettimeofday(&tp, NULL);
@@ -610,6 +621,22 @@ void Util_sleep(double s)
 	}
 }
 
+void Util_sleep_until(double t)
+{
+#if defined(MONOTONIC_TIME) && defined(HAVE_CLOCK_NANOSLEEP) && defined(TIMER_ABSTIME) && !defined(SUPPORTS_PLATFORM_SLEEP)
+	/* An absolute deadline is not pushed back by the time spent getting
+	   here, nor by signals that interrupt the sleep. */
+	struct timespec ts;
+	ts.tv_sec = (time_t) t;
+	ts.tv_nsec = (long) ((t - ts.tv_sec) * 1e9);
+	if (ts.tv_nsec > 999999999L)
+		ts.tv_nsec = 999999999L;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+	Util_sleep(t - Util_time());
+#endif
+}
+
 char *Util_getcwd(char *buf, size_t size)
 {
 #ifdef HAVE_GETCWD
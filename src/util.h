@@ -225,6 +225,8 @@ FILE *Util_uniqopen(char *filename, const char *mode);
 
 void Util_sleep(double s);
 double Util_time(void);
+/* Sleeps until Util_time() reaches T, or a little after. */
+void Util_sleep_until(double t);
 
 /* Get current working directory. */
 char *Util_getcwd(char *buf, size_t size);
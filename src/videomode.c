@@ -612,8 +612,23 @@ int VIDEOMODE_SetWindowSize(unsigned int width, unsigned int height)
 	return TRUE;
 }
 
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+/* The emulated 80-column cards and TV system changes update the video mode
+   from the emulation. Where that runs on a thread of its own, the display
+   geometry is changed only on the thread that draws with it. */
+static int UpdateOnUIThread(void *arg)
+{
+	return VIDEOMODE_Update();
+}
+#endif
+
 int VIDEOMODE_Update(void)
 {
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+	int result;
+	if (PLATFORM_RunOnUIThread(&UpdateOnUIThread, NULL, &result))
+		return result;
+#endif
 	if (VIDEOMODE_windowed || force_windowed)
 		return UpdateVideoWindowed(FALSE);
 	else
@@ -791,8 +806,20 @@ int VIDEOMODE_ToggleRotate90(void)
 #endif /* SUPPORTS_ROTATE_VIDEOMODE */
 
 #if COLUMN_80
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+static int Set80ColumnOnUIThread(void *value)
+{
+	return VIDEOMODE_Set80Column(*(int *) value);
+}
+#endif
+
 int VIDEOMODE_Set80Column(int value)
 {
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+	int result;
+	if (PLATFORM_RunOnUIThread(&Set80ColumnOnUIThread, &value, &result))
+		return result;
+#endif
 	return SetIntAndUpdateVideo(&VIDEOMODE_80_column, value);
 }
 
@@ -884,15 +911,41 @@ static void UpdateTvSystemSettings(void)
 	display_modes[VIDEOMODE_MODE_NORMAL].asp_ratio = Atari800_tv_mode == Atari800_TV_PAL ? pixel_aspect_ratio_pal : pixel_aspect_ratio_ntsc;
 }
 
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+static int SetVideoSystemOnUIThread(void *mode)
+{
+	VIDEOMODE_SetVideoSystem(*(int *) mode);
+	return 0;
+}
+#endif
+
 void VIDEOMODE_SetVideoSystem(int mode)
 {
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+	int result;
+	if (PLATFORM_RunOnUIThread(&SetVideoSystemOnUIThread, &mode, &result))
+		return;
+#endif
 	UpdateTvSystemSettings();
 	VIDEOMODE_Update();
 }
 
 #ifdef XEP80_EMULATION
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+static int UpdateXEP80OnUIThread(void *arg)
+{
+	VIDEOMODE_UpdateXEP80();
+	return 0;
+}
+#endif
+
 void VIDEOMODE_UpdateXEP80(void)
 {
+#ifdef SUPPORTS_PLATFORM_RUNONUITHREAD
+	int result;
+	if (PLATFORM_RunOnUIThread(&UpdateXEP80OnUIThread, NULL, &result))
+		return;
+#endif
 	display_modes[VIDEOMODE_MODE_XEP80].src_height = XEP80_scrn_height;
 	if (XEP80_char_height == 12) /* PAL */
 		display_modes[VIDEOMODE_MODE_XEP80].asp_ratio = xep80_aspect_ratio_pal;
@@ -98,6 +98,24 @@ static int time_to_samples(int ms)
 	return sample_rate[votraxsc01_locals.actIntonation]*ms/1000;
 }
 
+/* Quarter sine curves sin(pos/len*pi/2) for the crossfades between phonemes,
+   computed in Votrax_Start for each fade length PrepareVoiceData uses
+   (10, 20, 30 and 40 ms), so that a phoneme change needs no sin() calls. */
+#define FADE_CURVES 4
+static struct {
+	int len;
+	double *curve;
+} fade_curves[FADE_CURVES];
+
+static double fade_curve(int pos, int len)
+{
+	int i;
+	for (i = 0; i < FADE_CURVES; i++)
+		if (fade_curves[i].len == len)
+			return fade_curves[i].curve[pos];
+	return sin((1.0*pos/len)*3.1415/2);
+}
+
 static void PrepareVoiceData(int nextPhoneme, int nextIntonation)
 {
 	int iNextRemainingSamples;
@@ -261,7 +279,7 @@ static void PrepareVoiceData(int nextPhoneme, int nextIntonation)
 			double dFadeOut = 1.0;
 
 			if ( !doMix )
-				dFadeOut = 1.0-sin((1.0*iFadeOutPos/iFadeOutSamples)*3.1415/2);
+				dFadeOut = 1.0-fade_curve(iFadeOutPos, iFadeOutSamples);
 
 			if ( !votraxsc01_locals.iRemainingSamples ) {
 				votraxsc01_locals.iRemainingSamples = PhonemeData[votraxsc01_locals.actPhoneme].iLength[votraxsc01_locals.actIntonation];
@@ -280,7 +298,7 @@ static void PrepareVoiceData(int nextPhoneme, int nextIntonation)
 			double dFadeIn = 1.0;
 			
 			if ( iFadeInPos<iFadeInSamples ) {
-				dFadeIn = sin((1.0*iFadeInPos/iFadeInSamples)*3.1415/2);
+				dFadeIn = fade_curve(iFadeInPos, iFadeInSamples);
 				iFadeInPos++;
 			}
 
@@ -433,16 +451,43 @@ int Votrax_Start(void *sound_interface)
 		if (size > buffer_size)  buffer_size = size;
 	}
 	votraxsc01_locals.lpBuffer = (SWORD*) Util_malloc(buffer_size*sizeof(SWORD));
+	for (i = 0; i < FADE_CURVES; i++) {
+		int len = time_to_samples(10 * (i + 1));
+		int pos;
+		free(fade_curves[i].curve);
+		fade_curves[i].curve = (double *) Util_malloc(len * sizeof(double));
+		for (pos = 0; pos < len; pos++)
+			fade_curves[i].curve[pos] = sin((1.0*pos/len)*3.1415/2);
+		fade_curves[i].len = len;
+	}
 	PrepareVoiceData(votraxsc01_locals.actPhoneme, votraxsc01_locals.actIntonation);
 	return 0;
 }
 
 void Votrax_Stop(void)
 {
+	int i;
 	if ( votraxsc01_locals.lpBuffer ) {
 		free(votraxsc01_locals.lpBuffer);
 		votraxsc01_locals.lpBuffer = NULL;
 	}
+	for (i = 0; i < FADE_CURVES; i++) {
+		free(fade_curves[i].curve);
+		fade_curves[i].curve = NULL;
+		fade_curves[i].len = 0;
+	}
+}
+
+int Votrax_IsSilent(void)
+{
+	int p = votraxsc01_locals.actPhoneme;
+	/* Nothing is queued and Votrax_Update would only repeat the zero
+	   sample of the STOP phoneme. */
+	return !votraxsc01_locals.busy && !votraxsc01_locals.iDelay
+	       && votraxsc01_locals.iSamplesInBuffer == 0
+	       && (PhonemeData[p].iType >= PT_VS || PhonemeData[p].sameAs == 0x3f)
+	       && (votraxsc01_locals.iRemainingSamples == 0
+	           || votraxsc01_locals.pActPos == (SWORD *) STOP);
 }
 
 int Votrax_Samples(int currentP, int nextP, int cursamples)
@@ -19,5 +19,8 @@ UBYTE Votrax_GetStatus(void);
 
 void Votrax_Update(int num, SWORD *buffer, int length);
 int Votrax_Samples(int currentP, int nextP, int cursamples);
+/* TRUE if Votrax_Update would produce only silence until the next
+   Votrax_PutByte. */
+int Votrax_IsSilent(void);
 
 #endif /* VOTRAX_H_ */
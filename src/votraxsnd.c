@@ -55,6 +55,8 @@ static int votrax_written_byte = 0x3f;
 
 void VOTRAXSND_PutByte(UBYTE byte)
 {
+	if (!Atari800_DeviceIO())
+		return;
 	/* put byte to voice box */
 	votrax_sync_samples = (int)((1.0/ratio)*(double)Votrax_Samples((votrax_written_byte&0x3f), (byte&0x3f), votrax_sync_samples));
 	votrax_written = TRUE;
@@ -138,11 +140,16 @@ static void votrax_process(SWORD *v_buffer, int len, SWORD *temp_v_buffer)
 {
 	static SWORD last_sample;
 	static SWORD last_sample2;
-	static double startpos;
+	/* fractional position of the next output sample, 1/2^32 units */
+	static ULONG startpos;
 	static int have;
-	int max_left_sample_index = (int)(startpos + (double)(len - 1)*ratio);
+	/* the resampling step in 32.32 fixed point */
+	int step_int = (int)ratio;
+	ULONG step_frac = (ULONG)((ratio - step_int) * 4294967296.0);
+	int max_left_sample_index = (len - 1) * step_int
+	                            + (int)((startpos + (double)(len - 1) * step_frac) / 4294967296.0);
 	int pos = 0;
-	double fraction = 0;
+	ULONG fraction = startpos;
 	int i;
 	int floor_next_pos;
 
@@ -164,18 +171,16 @@ static void votrax_process(SWORD *v_buffer, int len, SWORD *temp_v_buffer)
 	}
 
 	for (i = 0; i < len; i++) {
-		SWORD left_sample;
-		SWORD right_sample;
-		SWORD interp_sample;
-		pos = (int)(startpos + (double)i*ratio);
-		fraction = startpos + (double)i*ratio - (double)pos;
-		left_sample = temp_v_buffer[pos];
-		right_sample = temp_v_buffer[pos+1];
-		interp_sample = (int)(left_sample + fraction*(double)(right_sample-left_sample));
-		v_buffer[i] = interp_sample;
+		int left_sample = temp_v_buffer[pos];
+		int right_sample = temp_v_buffer[pos + 1];
+		ULONG next_fraction = fraction + step_frac;
+		/* 14 bits of the fraction keep the product within 32 bits */
+		v_buffer[i] = (SWORD)(left_sample + (((right_sample - left_sample) * (SLONG)(fraction >> 18)) >> 14));
+		pos += step_int + (next_fraction < fraction); /* carry */
+		fraction = next_fraction;
 	}
-	floor_next_pos = (int)(startpos + (double)len*ratio);
-	startpos = (startpos + (double)len*ratio) - (double)floor_next_pos;
+	floor_next_pos = pos;
+	startpos = fraction;
 	if (floor_next_pos == max_left_sample_index)
 	{
 		have = 2;
@@ -191,45 +196,27 @@ static void votrax_process(SWORD *v_buffer, int len, SWORD *temp_v_buffer)
 	}
 }
 
-/* 16 bit mixing */
-static void mix(SWORD *dst, SWORD *src, int sndn, int volume)
+/* 16 bit mixing, STRIDE is the number of interleaved channels in DST */
+static void mix(SWORD *dst, SWORD const *src, int sndn, int volume, int stride)
 {
-	SWORD s1, s2;
-	int val;
-
 	while (sndn--) {
-		s1 = *src;
-		s1 = s1*volume/128;
-		s2 = *dst;
-		src++;
-		val = s1 + s2;
+		int val = *dst + (SWORD)(*src++ * volume / 128);
 		if (val > 32767) val = 32767;
-		if (val < -32768) val = -32768;
-		*dst++ = val;
-		if (num_pokeys == 2) {
-			dst++;
-		}
+		else if (val < -32768) val = -32768;
+		*dst = (SWORD)val;
+		dst += stride;
 	}
 }
 
 /* 8 bit mixing */
-static void mix8(UBYTE *dst, SWORD *src, int sndn, int volume)
+static void mix8(UBYTE *dst, SWORD const *src, int sndn, int volume, int stride)
 {
-	SWORD s1, s2;
-	int val;
-
 	while (sndn--) {
-		s1 = *src;
-		s1 = s1*volume/128;
-		s2 = ((int)(*dst) - 0x80)*256;
-		src++;
-		val = s1 + s2;
+		int val = ((int)(*dst) - 0x80)*256 + (SWORD)(*src++ * volume / 128);
 		if (val > 32767) val = 32767;
-		if (val < -32768) val = -32768;
-		*dst++ = (UBYTE)((val/256) + 0x80);
-		if (num_pokeys == 2) {
-			dst++;
-		}
+		else if (val < -32768) val = -32768;
+		*dst = (UBYTE)((val/256) + 0x80);
+		dst += stride;
 	}
 }
 
@@ -261,12 +248,16 @@ void VOTRAXSND_Process(void *sndbuffer, int sndn)
 		votrax_written = FALSE;
 		Votrax_PutByte(votrax_written_byte);
 	}
+	/* While the chip is quiet, mixing would add zeros - skip resampling
+	   and mixing altogether. */
+	if (Votrax_IsSilent())
+		return;
 	sndn /= num_pokeys;
 	while (sndn > 0) {
 		int amount = ((sndn > VTRX_BLOCK_SIZE) ? VTRX_BLOCK_SIZE : sndn);
 		votrax_process(votrax_buffer, amount, temp_votrax_buffer);
-		if (bit16) mix((SWORD *)sndbuffer, votrax_buffer, amount, POKEYSND_volume >> 3);
-		else mix8((UBYTE *)sndbuffer, votrax_buffer, amount, POKEYSND_volume >> 3);
+		if (bit16) mix((SWORD *)sndbuffer, votrax_buffer, amount, POKEYSND_volume >> 3, num_pokeys);
+		else mix8((UBYTE *)sndbuffer, votrax_buffer, amount, POKEYSND_volume >> 3, num_pokeys);
 		sndbuffer = (char *) sndbuffer + VTRX_BLOCK_SIZE*(bit16 ? 2 : 1)*((num_pokeys == 2) ? 2: 1);
 		sndn -= VTRX_BLOCK_SIZE;
 	}
@@ -0,0 +1,262 @@
+/*
+ * workers.c - pool of worker threads for data-parallel jobs
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef THREADS
+#include <pthread.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "atari.h"
+#include "log.h"
+#include "util.h"
+#include "workers.h"
+
+/* Upper limit for the automatic size of the shared pool. The jobs handed
+   to it are small, and more threads mostly add wake-up latency. */
+#define MAX_AUTO_THREADS 7
+
+struct Workers_pool_t {
+	int num_threads;
+#ifdef THREADS
+	pthread_t *threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	int quit;
+	Workers_func_t func;
+	void *arg;
+	int num_jobs;
+	int next_job;
+	int pending;
+#endif
+};
+
+int Workers_num_threads = -1;
+
+static Workers_pool_t *shared_pool = NULL;
+static int shared_pool_created = FALSE;
+
+int Workers_NumCPUs(void)
+{
+	int n = 1;
+#if defined(HAVE_WINDOWS_H)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	n = (int) info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	n = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return n < 1 ? 1 : n;
+}
+
+#ifdef THREADS
+static void *WorkerThread(void *p)
+{
+	Workers_pool_t *pool = (Workers_pool_t *) p;
+
+	pthread_mutex_lock(&pool->mutex);
+	for (;;) {
+		int job;
+		while (!pool->quit && pool->next_job >= pool->num_jobs)
+			pthread_cond_wait(&pool->start, &pool->mutex);
+		if (pool->quit)
+			break;
+		job = pool->next_job++;
+		pthread_mutex_unlock(&pool->mutex);
+		pool->func(pool->arg, job);
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->pending == 0)
+			pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+#endif /* THREADS */
+
+Workers_pool_t *Workers_CreatePool(int num_threads)
+{
+	Workers_pool_t *pool;
+
+	if (num_threads <= 0)
+		return NULL;
+#ifdef THREADS
+	pool = (Workers_pool_t *) Util_malloc(sizeof(Workers_pool_t));
+	memset(pool, 0, sizeof(Workers_pool_t));
+	pool->threads = (pthread_t *) Util_malloc(num_threads * sizeof(pthread_t));
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	while (pool->num_threads < num_threads
+	       && pthread_create(&pool->threads[pool->num_threads], NULL, WorkerThread, pool) == 0)
+		pool->num_threads++;
+	if (pool->num_threads == 0) {
+		Log_print("Could not start worker threads");
+		Workers_DestroyPool(pool);
+		return NULL;
+	}
+	return pool;
+#else
+	return NULL;
+#endif
+}
+
+void Workers_DestroyPool(Workers_pool_t *pool)
+{
+	if (pool == NULL)
+		return;
+#ifdef THREADS
+	{
+		int i;
+		pthread_mutex_lock(&pool->mutex);
+		pool->quit = TRUE;
+		pthread_cond_broadcast(&pool->start);
+		pthread_mutex_unlock(&pool->mutex);
+		for (i = 0; i < pool->num_threads; i++)
+			pthread_join(pool->threads[i], NULL);
+		pthread_cond_destroy(&pool->done);
+		pthread_cond_destroy(&pool->start);
+		pthread_mutex_destroy(&pool->mutex);
+		free(pool->threads);
+	}
+#endif
+	free(pool);
+}
+
+static Workers_pool_t *SharedPool(void)
+{
+	if (!shared_pool_created) {
+		int n = Workers_num_threads;
+		if (n < 0) {
+			n = Workers_NumCPUs() - 1;
+			if (n > MAX_AUTO_THREADS)
+				n = MAX_AUTO_THREADS;
+		}
+		shared_pool = Workers_CreatePool(n);
+		shared_pool_created = TRUE;
+	}
+	return shared_pool;
+}
+
+void Workers_Run(Workers_pool_t *pool, Workers_func_t func, void *arg, int num_jobs)
+{
+	if (pool == NULL)
+		pool = SharedPool();
+#ifdef THREADS
+	if (pool != NULL && num_jobs > 1) {
+		pthread_mutex_lock(&pool->mutex);
+		pool->func = func;
+		pool->arg = arg;
+		pool->num_jobs = num_jobs;
+		pool->next_job = 0;
+		pool->pending = num_jobs;
+		pthread_cond_broadcast(&pool->start);
+		while (pool->next_job < pool->num_jobs) {
+			int job = pool->next_job++;
+			pthread_mutex_unlock(&pool->mutex);
+			func(arg, job);
+			pthread_mutex_lock(&pool->mutex);
+			pool->pending--;
+		}
+		while (pool->pending > 0)
+			pthread_cond_wait(&pool->done, &pool->mutex);
+		pthread_mutex_unlock(&pool->mutex);
+		return;
+	}
+#endif
+	{
+		int job;
+		for (job = 0; job < num_jobs; job++)
+			func(arg, job);
+	}
+}
+
+int Workers_Concurrency(Workers_pool_t *pool)
+{
+	if (pool == NULL)
+		pool = SharedPool();
+	return pool == NULL ? 1 : pool->num_threads + 1;
+}
+
+void Workers_SetNumThreads(int num_threads)
+{
+	Workers_num_threads = num_threads;
+	Workers_DestroyPool(shared_pool);
+	shared_pool = NULL;
+	shared_pool_created = FALSE;
+}
+
+int Workers_ReadConfig(char *option, char *ptr)
+{
+	if (strcmp(option, "WORKER_THREADS") == 0)
+		return Util_sscansdec(ptr, &Workers_num_threads);
+	return FALSE;
+}
+
+void Workers_WriteConfig(FILE *fp)
+{
+	fprintf(fp, "WORKER_THREADS=%d\n", Workers_num_threads);
+}
+
+int Workers_Initialise(int *argc, char *argv[])
+{
+	int i, j;
+
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+		int a_i = FALSE;			/* error, argument invalid! */
+
+		if (strcmp(argv[i], "-threads") == 0) {
+			if (i_a)
+				a_i = !Util_sscansdec(argv[++i], &Workers_num_threads) || Workers_num_threads < -1;
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-threads <n>         Use n worker threads (-1: one per extra CPU core, 0: none)");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		} else if (a_i) {
+			Log_print("Invalid argument for '%s'", argv[--i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
+
+void Workers_Exit(void)
+{
+	Workers_SetNumThreads(Workers_num_threads);
+}
@@ -0,0 +1,48 @@
+#ifndef WORKERS_H_
+#define WORKERS_H_
+
+#include <stdio.h>
+
+#include "config.h"
+
+/* A pool of persistent worker threads that runs a batch of independent
+   jobs and returns when all of them are done. The calling thread takes
+   jobs as well, so a pool with no threads simply runs the jobs in order.
+   Without THREADS, every pool behaves like that. */
+
+typedef struct Workers_pool_t Workers_pool_t;
+
+/* Job function: called once for each JOB in 0..num_jobs-1. */
+typedef void (*Workers_func_t)(void *arg, int job);
+
+/* Creates a pool with NUM_THREADS threads besides the caller. Returns NULL
+   if no thread could be started. */
+Workers_pool_t *Workers_CreatePool(int num_threads);
+void Workers_DestroyPool(Workers_pool_t *pool);
+
+/* Runs FUNC(ARG, job) for all NUM_JOBS jobs on POOL and the calling thread.
+   POOL may be NULL, in which case the shared pool is used. Must not be
+   called again on the same pool before it returns. */
+void Workers_Run(Workers_pool_t *pool, Workers_func_t func, void *arg, int num_jobs);
+
+/* Number of threads that take part in Workers_Run on POOL (or the shared
+   pool if NULL), including the caller. Useful for choosing NUM_JOBS. */
+int Workers_Concurrency(Workers_pool_t *pool);
+
+/* Number of CPU cores online, at least 1. */
+int Workers_NumCPUs(void);
+
+/* Number of threads in the shared pool, besides the emulation thread.
+   -1 means one less than the number of CPU cores, 0 disables threading.
+   Change with Workers_SetNumThreads. */
+extern int Workers_num_threads;
+
+void Workers_SetNumThreads(int num_threads);
+
+int Workers_Initialise(int *argc, char *argv[]);
+void Workers_Exit(void);
+
+int Workers_ReadConfig(char *option, char *ptr);
+void Workers_WriteConfig(FILE *fp);
+
+#endif /* WORKERS_H_ */
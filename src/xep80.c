@@ -178,6 +178,13 @@ static UBYTE const output_mask[2] = {0x01,0x10};
 
 UBYTE XEP80_screen_1[XEP80_SCRN_WIDTH*XEP80_MAX_SCRN_HEIGHT];
 UBYTE XEP80_screen_2[XEP80_SCRN_WIDTH*XEP80_MAX_SCRN_HEIGHT];
+UBYTE XEP80_changed_lines[XEP80_MAX_SCRN_HEIGHT];
+
+/* Characters to be drawn again by XEP80_UpdateScreen, by row and screen
+   column. */
+static UBYTE dirty_chars[XEP80_HEIGHT][XEP80_LINE_LEN];
+static UBYTE dirty_rows[XEP80_HEIGHT];
+static int any_dirty = FALSE;
 
 UBYTE (*font)[XEP80_FONTS_CHAR_COUNT][XEP80_MAX_CHAR_HEIGHT][XEP80_CHAR_WIDTH];
 
@@ -514,16 +521,38 @@ static void BlitChar(int x, int y, int cur)
 	}
 }
 
+/* Marks the character at X, Y to be drawn again. */
+static void DirtyChar(int x, int y)
+{
+	if (x < xscroll || x >= xscroll + XEP80_LINE_LEN)
+		return;
+	dirty_chars[y][x-xscroll] = TRUE;
+	dirty_rows[y] = TRUE;
+	any_dirty = TRUE;
+}
+
+/* Marks rows Y_START..Y_END to be drawn again. */
+static void DirtyRows(int y_start, int y_end)
+{
+	int screen_row;
+
+	for (screen_row = y_start; screen_row <= y_end; screen_row++) {
+		memset(dirty_chars[screen_row], TRUE, XEP80_LINE_LEN);
+		dirty_rows[screen_row] = TRUE;
+	}
+	any_dirty = TRUE;
+}
+
 static void UpdateCursor(void)
 {
 	if (!graphics_mode && cursor_on) {
 		/* Redraw character cursor was at */
-		BlitChar(cursor_x, cursor_y, FALSE);
+		DirtyChar(cursor_x, cursor_y);
 		/* Handle reblitting double wide's which cursor may have overwritten */
 		if (cursor_x != 0)
-			BlitChar(cursor_x-1, cursor_y, FALSE);
+			DirtyChar(cursor_x-1, cursor_y);
 		/* Redraw cursor at new location */
-		BlitChar(xpos, ypos, TRUE);
+		DirtyChar(xpos, ypos);
 	}
 	cursor_x = xpos;
 	cursor_y = ypos;
@@ -532,24 +561,38 @@ static void UpdateCursor(void)
 
 static void BlitCharScreen(void)
 {
-	int screen_row, screen_col;
-
-	for (screen_row = 0; screen_row < XEP80_HEIGHT; screen_row++) {
-		for (screen_col = xscroll; screen_col < xscroll + XEP80_LINE_LEN;
-		     screen_col++)
-			BlitChar(screen_col, screen_row, FALSE);
-	}
+	DirtyRows(0, XEP80_HEIGHT-1);
 	UpdateCursor();
 }
 
-static void BlitRows(int y_start, int y_end)
+void XEP80_UpdateScreen(void)
 {
 	int screen_row, screen_col;
 
-	for (screen_row = y_start; screen_row <= y_end; screen_row++) {
-		for (screen_col = xscroll; screen_col < xscroll + XEP80_LINE_LEN;
-		     screen_col++)
-			BlitChar(screen_col, screen_row, FALSE);
+	if (!any_dirty)
+		return;
+	any_dirty = FALSE;
+	for (screen_row = 0; screen_row < XEP80_HEIGHT; screen_row++) {
+		/* A double wide character covers its neighbour, so with double
+		   wide fonts the whole row is drawn again. */
+		int whole_row = font_a_double || font_b_double;
+
+		if (!dirty_rows[screen_row])
+			continue;
+		dirty_rows[screen_row] = FALSE;
+		if (graphics_mode) {
+			memset(dirty_chars[screen_row], FALSE, XEP80_LINE_LEN);
+			continue;
+		}
+		for (screen_col = 0; screen_col < XEP80_LINE_LEN; screen_col++) {
+			if (whole_row || dirty_chars[screen_row][screen_col])
+				BlitChar(xscroll + screen_col, screen_row, FALSE);
+			dirty_chars[screen_row][screen_col] = FALSE;
+		}
+		/* The cursor goes over the characters. */
+		if (cursor_on && screen_row == cursor_y)
+			BlitChar(cursor_x, cursor_y, TRUE);
+		memset(XEP80_changed_lines + screen_row * XEP80_char_height, TRUE, XEP80_char_height);
 	}
 }
 
@@ -576,6 +619,7 @@ static void BlitGraphChar(int x, int y)
 	to2 = &XEP80_screen_2[XEP80_SCRN_WIDTH * (y + GRAPH_Y_OFFSET)
 	                      + x * 8 + GRAPH_X_OFFSET];
 
+	XEP80_changed_lines[y + GRAPH_Y_OFFSET] = TRUE;
 	for (graph_col=0; graph_col < 8; graph_col++) {
 		if (ch & (1<<graph_col)) {
 			*to1++ = on;
@@ -594,6 +638,7 @@ static void BlitGraphScreen(void)
 
 	memset(XEP80_screen_1, XEP80_FONTS_offcolor, XEP80_SCRN_WIDTH*XEP80_MAX_SCRN_HEIGHT);
 	memset(XEP80_screen_2, XEP80_FONTS_offcolor, XEP80_SCRN_WIDTH*XEP80_MAX_SCRN_HEIGHT);
+	memset(XEP80_changed_lines, TRUE, sizeof(XEP80_changed_lines));
 	for (x=0; x<XEP80_GRAPH_WIDTH/8; x++)
 		for (y=0; y<XEP80_GRAPH_HEIGHT; y++)
 			BlitGraphChar(x,y);
@@ -768,7 +813,7 @@ static void InsertLine(void)
 {
 	ScrollDown(ypos);
 	ClearLineCursorToLeftMargin();
-	BlitRows(ypos, XEP80_HEIGHT-2);
+	DirtyRows(ypos, XEP80_HEIGHT-2);
 	UpdateCursor();
 }
 
@@ -806,7 +851,7 @@ static void AddCharAtCursor(UBYTE byte)
 {
 	UBYTE prev_char = video_ram[curs];
 	video_ram[curs] = byte;
-	BlitChar(xpos, ypos, FALSE);
+	DirtyChar(xpos, ypos);
 	escape_mode = FALSE;
 	AdvanceCursor(prev_char);
 }
@@ -879,7 +924,7 @@ static void Backspace(void)
 		--ypos;
 	}
 	char_data(ypos, xpos) = 0x20;
-	BlitChar(xpos, ypos, FALSE);
+	DirtyChar(xpos, ypos);
 	UpdateCursor();
 }
 
@@ -909,7 +954,7 @@ static void DeleteChar(void)
 	for (y = y_end; y > ypos; --y) {
 		if (lmargin == rmargin) {
 			video_ram[curs] = prev_dropped;
-			BlitRows(ypos, y_end);
+			DirtyRows(ypos, y_end);
 			UpdateCursor();
 			return;
 		}
@@ -924,7 +969,7 @@ static void DeleteChar(void)
 	else {
 		ShiftLeft(y, xpos, prev_dropped);
 	}
-	BlitRows(ypos, y_end);
+	DirtyRows(ypos, y_end);
 	UpdateCursor();
 }
 
@@ -969,7 +1014,7 @@ static void InsertChar(void)
 			else {
 				ScrollDown(y+1);
 				ClearLine(y+1);
-				BlitRows(ypos, XEP80_HEIGHT-2);
+				DirtyRows(ypos, XEP80_HEIGHT-2);
 				UpdateCursor();
 				return;
 			}
@@ -979,7 +1024,7 @@ static void InsertChar(void)
 		++y;
 		x = lmargin;
 	}
-	BlitRows(ypos, y);
+	DirtyRows(ypos, y);
 	UpdateCursor();
 }
 
@@ -1028,7 +1073,7 @@ static void DeleteLogicalLine(void)
 		}
 		xpos = lmargin;
 	}
-	BlitRows(ypos, XEP80_HEIGHT-2);
+	DirtyRows(ypos, XEP80_HEIGHT-2);
 	UpdateCursor();
 }
 
@@ -1074,7 +1119,7 @@ static void ReceiveChar(UBYTE byte)
 		if (byte == 0x9c) { /* Delete Line */
 			/* ROM location: 07df */
 			ClearLineCursorToLeftMargin();
-			BlitRows(ypos, XEP80_HEIGHT-2);
+			DirtyRows(ypos, XEP80_HEIGHT-2);
 			UpdateCursor();
 		}
 		else
@@ -1300,7 +1345,7 @@ static void SetCursorMode(int on, int blink)
 	cursor_blink = blink;
 	if (!graphics_mode) {
 		if (!cursor_on)
-			BlitChar(xpos, ypos, FALSE);
+			DirtyChar(xpos, ypos);
 		else
 			UpdateCursor();
 	}
@@ -43,6 +43,13 @@ extern int XEP80_port;
 
 extern UBYTE XEP80_screen_1[XEP80_SCRN_WIDTH*XEP80_MAX_SCRN_HEIGHT];
 extern UBYTE XEP80_screen_2[XEP80_SCRN_WIDTH*XEP80_MAX_SCRN_HEIGHT];
+/* Nonzero for the lines of XEP80_screen_1/2 changed since the display
+   last cleared them. */
+extern UBYTE XEP80_changed_lines[XEP80_MAX_SCRN_HEIGHT];
+
+/* Draws the characters changed since the last call into XEP80_screen_1/2.
+   Called at the end of each displayed frame. */
+void XEP80_UpdateScreen(void);
 
 UBYTE XEP80_GetBit(void);
 void XEP80_PutBit(UBYTE byte);
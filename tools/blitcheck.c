@@ -0,0 +1,428 @@
+/*
+ * Check of the row kernels in blit.c and of the PAL blending blitters:
+ * runs each of them with and without SIMD code on random rows of many
+ * widths and starting offsets and compares the outputs byte for byte
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "atari.h"
+#include "blit.h"
+#ifdef PAL_BLENDING
+#include "artifact.h"
+#include "colours.h"
+#include "colours_pal.h"
+#include "pal_blending.h"
+#include "platform.h"
+#include "screen.h"
+#endif
+
+/* Widths up to SMALL_WIDTHS are all checked, to cover every length of the
+   tail left after the vector loops; the others are typical screen widths
+   and the sizes around MAX_SPAN in blit.c. */
+#define SMALL_WIDTHS 72
+static int const widths[] = {
+	127, 128, 129, 320, 336, 384, 511, 512, 513, 672, 1344
+};
+#define NUM_WIDTHS ((int) (sizeof(widths) / sizeof(widths[0])))
+#define MAX_WIDTH 1344
+
+/* Column steps of BLIT_ScaleColumns in 16.16 fixed point: upscaling,
+   1:1 and downscaling, which for wide rows spans more than MAX_SPAN
+   source pixels. */
+static int const steps[] = { 0x4000, 0x8000, 0xaaab, 0x10000, 0x15555, 0x18000, 0x30000 };
+#define NUM_STEPS ((int) (sizeof(steps) / sizeof(steps[0])))
+#define MAX_STEP 3
+
+/* Starting offsets of the rows are chosen below this, so that they are
+   not aligned to the vector size. */
+#define MAX_OFFSET 8
+
+#define SRC_SIZE (MAX_WIDTH * MAX_STEP + 2 * MAX_OFFSET)
+#define OUT_SIZE (MAX_WIDTH + 2 * MAX_OFFSET)
+
+enum {
+	EXPAND8TO16,
+	EXPAND8TO32,
+	SCALE8,
+	SCALE8TO16,
+	SCALE8TO32,
+	SCALE32,
+	SCALE32TO16,
+	NUM_KERNELS
+};
+
+static char const * const kernel_names[NUM_KERNELS] = {
+	"BLIT_Expand8to16",
+	"BLIT_Expand8to32",
+	"BLIT_Scale8",
+	"BLIT_Scale8to16",
+	"BLIT_Scale8to32",
+	"BLIT_Scale32",
+	"BLIT_Scale32to16"
+};
+
+static UBYTE src8[SRC_SIZE];
+static ULONG src32[SRC_SIZE];
+/* 16-bit pixels zero-extended to 32 bits, as BLIT_Scale32to16 expects */
+static ULONG src16[SRC_SIZE];
+static UWORD palette16[256];
+static ULONG palette32[256];
+static int xs_buffer[OUT_SIZE];
+static ULONG out_plain[OUT_SIZE];
+static ULONG out_simd[OUT_SIZE];
+
+static ULONG Random(void)
+{
+	static ULONG seed = 12345;
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) | (seed << 16);
+}
+
+static void MakeInputs(void)
+{
+	int i;
+	for (i = 0; i < SRC_SIZE; i++) {
+		src8[i] = (UBYTE) Random();
+		src32[i] = Random() ^ (Random() << 8);
+		src16[i] = Random() & 0xffff;
+	}
+	for (i = 0; i < 256; i++) {
+		palette16[i] = (UWORD) Random();
+		palette32[i] = Random() ^ (Random() << 8);
+	}
+	/* make sure the extremes are there */
+	palette16[0] = 0x0000;
+	palette16[255] = 0xffff;
+	palette32[0] = 0x00000000;
+	palette32[255] = 0xffffffff;
+}
+
+static int IsScaling(int kernel)
+{
+	return kernel != EXPAND8TO16 && kernel != EXPAND8TO32;
+}
+
+static void Run(int kernel, ULONG *out, int dest_offset, int src_offset, int const *xs, int width)
+{
+	UBYTE const *s8 = src8 + src_offset;
+	switch (kernel) {
+	case EXPAND8TO16:
+		BLIT_Expand8to16((UWORD *) out + dest_offset, s8, width, palette16);
+		break;
+	case EXPAND8TO32:
+		BLIT_Expand8to32(out + dest_offset, s8, width, palette32);
+		break;
+	case SCALE8:
+		BLIT_Scale8((UBYTE *) out + dest_offset, s8, xs, width);
+		break;
+	case SCALE8TO16:
+		BLIT_Scale8to16((UWORD *) out + dest_offset, s8, xs, width, palette16);
+		break;
+	case SCALE8TO32:
+		BLIT_Scale8to32(out + dest_offset, s8, xs, width, palette32);
+		break;
+	case SCALE32:
+		BLIT_Scale32(out + dest_offset, src32 + src_offset, xs, width);
+		break;
+	case SCALE32TO16:
+		BLIT_Scale32to16((UWORD *) out + dest_offset, src16 + src_offset, xs, width);
+		break;
+	}
+}
+
+/* Runs KERNEL on one row both ways and returns whether the outputs,
+   including the untouched bytes around the row, are the same. */
+static int Check(int kernel, int width, int step, int dest_offset, int src_offset)
+{
+	int *xs = xs_buffer + dest_offset;
+	if (IsScaling(kernel)) {
+		int first = Random() % MAX_OFFSET;
+		int frac = Random() & 0xffff;
+		BLIT_ScaleColumns(xs, width, (first << 16) + frac + (width - 1) * step, step);
+	}
+	memset(out_plain, 0xa5, sizeof(out_plain));
+	memset(out_simd, 0xa5, sizeof(out_simd));
+	BLIT_vectorize = FALSE;
+	Run(kernel, out_plain, dest_offset, src_offset, xs, width);
+	BLIT_vectorize = TRUE;
+	Run(kernel, out_simd, dest_offset, src_offset, xs, width);
+	if (memcmp(out_plain, out_simd, sizeof(out_plain)) != 0) {
+		printf("%s, width %d, step 0x%x, offsets %d/%d: output differs\n",
+		       kernel_names[kernel], width, step, dest_offset, src_offset);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static int CheckWidth(int kernel, int width)
+{
+	int offset;
+	for (offset = 0; offset < MAX_OFFSET; offset++) {
+		int src_offset = (offset * 3) % MAX_OFFSET;
+		if (IsScaling(kernel)) {
+			int s;
+			for (s = 0; s < NUM_STEPS; s++)
+				if (!Check(kernel, width, steps[s], offset, src_offset))
+					return FALSE;
+		}
+		else if (!Check(kernel, width, 0x10000, offset, src_offset))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static int CheckExpandBits(void)
+{
+	int pixels;
+	for (pixels = 0; pixels < 256; pixels++) {
+		ULONG fg = Random();
+		ULONG bg = Random();
+		int offset = pixels % MAX_OFFSET;
+		memset(out_plain, 0xa5, sizeof(out_plain));
+		memset(out_simd, 0xa5, sizeof(out_simd));
+		BLIT_vectorize = FALSE;
+		BLIT_ExpandBits32(out_plain + offset, (UBYTE) pixels, fg, bg);
+		BLIT_vectorize = TRUE;
+		BLIT_ExpandBits32(out_simd + offset, (UBYTE) pixels, fg, bg);
+		if (memcmp(out_plain, out_simd, sizeof(out_plain)) != 0) {
+			printf("BLIT_ExpandBits32, pixels 0x%02x: output differs\n", pixels);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+#ifdef PAL_BLENDING
+/* Stubs for PAL_BLENDING_UpdateLookup: the palettes it builds are random,
+   in the pixel format of PAL_FORMAT. */
+ARTIFACT_t ARTIFACT_mode = ARTIFACT_PAL_BLEND;
+Colours_setup_t COLOURS_PAL_setup;
+COLOURS_EXTERNAL_t COLOURS_PAL_external;
+static PLATFORM_pixel_format_t pal_format;
+
+void COLOURS_PAL_GetYUV(double yuv_table[256*5])
+{
+	memset(yuv_table, 0, 256 * 5 * sizeof(double));
+}
+
+void Colours_YUV2RGB(double y, double u, double v, double *r, double *g, double *b)
+{
+	*r = *g = *b = y;
+}
+
+double Colours_Gamma2Linear(double c, double gamma_adj)
+{
+	return c;
+}
+
+double Colours_Linear2sRGB(double c)
+{
+	return c;
+}
+
+void Colours_SetRGB(int i, int r, int g, int b, int *colortable_ptr)
+{
+	colortable_ptr[i] = (r << 16) | (g << 8) | b;
+}
+
+void PLATFORM_GetPixelFormat(PLATFORM_pixel_format_t *format)
+{
+	*format = pal_format;
+}
+
+void PLATFORM_MapRGB(void *dest, int const *palette, int size)
+{
+	int i;
+	for (i = 0; i < size; i++) {
+		if (pal_format.bpp == 16)
+			((UWORD *) dest)[i] = (UWORD) Random();
+		else
+			((ULONG *) dest)[i] = Random() ^ (Random() << 8);
+	}
+}
+
+/* Source lines of the PAL blending checks; the scaled blitters may read
+   one pixel left of the line. */
+#define PAL_HEIGHT 6
+#define PAL_LEFT 8
+#define PAL_MAX_WIDTH (Screen_WIDTH - 2 * PAL_LEFT)
+/* Scaling up 5 times reaches the leftmost column -1. */
+#define PAL_MAX_DEST_WIDTH (PAL_MAX_WIDTH * 5)
+#define PAL_MAX_DEST_HEIGHT (PAL_HEIGHT * 3)
+#define PAL_PITCH (PAL_MAX_DEST_WIDTH + MAX_OFFSET)
+#define PAL_OUT_SIZE (PAL_PITCH * PAL_MAX_DEST_HEIGHT + MAX_OFFSET)
+
+enum {
+	PAL_BLIT16,
+	PAL_BLIT32,
+	PAL_SCALED16,
+	PAL_SCALED32,
+	NUM_PAL_BLITTERS
+};
+
+static char const * const pal_blitter_names[NUM_PAL_BLITTERS] = {
+	"PAL_BLENDING_Blit16",
+	"PAL_BLENDING_Blit32",
+	"PAL_BLENDING_BlitScaled16",
+	"PAL_BLENDING_BlitScaled32"
+};
+
+static UBYTE pal_src[(PAL_HEIGHT + 1) * Screen_WIDTH];
+static ULONG pal_plain[PAL_OUT_SIZE];
+static ULONG pal_simd[PAL_OUT_SIZE];
+
+static void RunPal(int blitter, ULONG *out, int width, int dest_width, int dest_height, int start_odd, int first_line, int last_line)
+{
+	UBYTE *src = pal_src + PAL_LEFT;
+	switch (blitter) {
+	case PAL_BLIT16:
+		PAL_BLENDING_Blit16(out, src, PAL_PITCH, width, PAL_HEIGHT, start_odd);
+		break;
+	case PAL_BLIT32:
+		PAL_BLENDING_Blit32(out, src, PAL_PITCH, width, PAL_HEIGHT, start_odd);
+		break;
+	case PAL_SCALED16:
+		PAL_BLENDING_BlitScaled16(out, src, PAL_PITCH, width, PAL_HEIGHT, dest_width, dest_height, start_odd, first_line, last_line);
+		break;
+	case PAL_SCALED32:
+		PAL_BLENDING_BlitScaled32(out, src, PAL_PITCH, width, PAL_HEIGHT, dest_width, dest_height, start_odd, first_line, last_line);
+		break;
+	}
+}
+
+/* Runs BLITTER both ways and returns whether the outputs, including the
+   untouched words around the lines, are the same. */
+static int CheckPal(int blitter, int width, int dest_width, int dest_height, int start_odd, int first_line, int last_line)
+{
+	int offset = width % MAX_OFFSET;
+	memset(pal_plain, 0xa5, sizeof(pal_plain));
+	memset(pal_simd, 0xa5, sizeof(pal_simd));
+	BLIT_vectorize = FALSE;
+	RunPal(blitter, pal_plain + offset, width, dest_width, dest_height, start_odd, first_line, last_line);
+	BLIT_vectorize = TRUE;
+	RunPal(blitter, pal_simd + offset, width, dest_width, dest_height, start_odd, first_line, last_line);
+	if (memcmp(pal_plain, pal_simd, sizeof(pal_plain)) != 0) {
+		printf("%s, width %d, output %dx%d, odd %d, lines %d-%d: output differs\n",
+		       pal_blitter_names[blitter], width, dest_width, dest_height, start_odd, first_line, last_line);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static int CheckPalBlending(void)
+{
+	static int const bpps[] = { 16, 32 };
+	static int const scaled_widths[] = { 7, 100, 320, 336, PAL_MAX_WIDTH };
+	/* Output widths in multiples of the source width, in 16.16 fixed point. */
+	static int const scales[] = { 0x8000, 0x10000, 0x18000, 0x20000, 0x30000, 0x50000 };
+	static int const dest_heights[] = { PAL_HEIGHT / 2, PAL_HEIGHT, PAL_MAX_DEST_HEIGHT };
+	int b;
+	int i;
+	for (i = 0; i < (int) sizeof(pal_src); i++)
+		pal_src[i] = (UBYTE) Random();
+	for (b = 0; b < 2; b++) {
+		int blitter;
+		pal_format.bpp = bpps[b];
+		if (pal_format.bpp == 16) {
+			pal_format.rmask = 0xf800;
+			pal_format.gmask = 0x07e0;
+			pal_format.bmask = 0x001f;
+		}
+		else {
+			pal_format.rmask = 0xff0000;
+			pal_format.gmask = 0x00ff00;
+			pal_format.bmask = 0x0000ff;
+		}
+		PAL_BLENDING_UpdateLookup();
+		for (blitter = b; blitter < NUM_PAL_BLITTERS; blitter += 2) {
+			int start_odd;
+			for (start_odd = 0; start_odd < 2; start_odd++) {
+				if (blitter == PAL_BLIT16 || blitter == PAL_BLIT32) {
+					int width;
+					for (width = 1; width <= PAL_MAX_WIDTH; width += width < SMALL_WIDTHS ? 1 : 17)
+						if (!CheckPal(blitter, width, 0, 0, start_odd, 0, 0))
+							return FALSE;
+				}
+				else {
+					int w;
+					for (w = 0; w < (int) (sizeof(scaled_widths) / sizeof(scaled_widths[0])); w++) {
+						int s;
+						for (s = 0; s < (int) (sizeof(scales) / sizeof(scales[0])); s++) {
+							int width = scaled_widths[w];
+							/* The 16-bit blitter writes pixels in pairs. */
+							int dest_width = (int) (((double) width * scales[s] / 0x10000)) & ~1;
+							int h;
+							if (dest_width == 0 || dest_width > PAL_MAX_DEST_WIDTH)
+								continue;
+							for (h = 0; h < (int) (sizeof(dest_heights) / sizeof(dest_heights[0])); h++) {
+								int dest_height = dest_heights[h];
+								if (!CheckPal(blitter, width, dest_width, dest_height, start_odd, 0, dest_height)
+								    || !CheckPal(blitter, width, dest_width, dest_height, start_odd, 1, dest_height - 1))
+									return FALSE;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	return TRUE;
+}
+#endif /* PAL_BLENDING */
+
+int main(void)
+{
+	int failed = FALSE;
+	int k;
+
+	MakeInputs();
+#ifdef BLIT_AVX2
+	if (!BLIT_HaveAVX2())
+		printf("The CPU lacks AVX2, so the AVX2 kernels are not checked\n");
+#endif
+	for (k = 0; k < NUM_KERNELS; k++) {
+		int w;
+		for (w = 0; w <= SMALL_WIDTHS; w++)
+			if (!CheckWidth(k, w)) {
+				failed = TRUE;
+				break;
+			}
+		for (w = 0; w < NUM_WIDTHS; w++)
+			if (!CheckWidth(k, widths[w])) {
+				failed = TRUE;
+				break;
+			}
+	}
+	if (!CheckExpandBits())
+		failed = TRUE;
+#ifdef PAL_BLENDING
+	if (!CheckPalBlending())
+		failed = TRUE;
+#endif
+	if (failed)
+		return 1;
+	printf("Vectorised output matches the plain C kernels\n");
+	return 0;
+}
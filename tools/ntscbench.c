@@ -0,0 +1,309 @@
+/*
+ * Benchmark of the NTSC filter blitters: checks that the vectorised code
+ * produces the same pixels as the original scalar code, then times both,
+ * alone and split into row bands over worker threads
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_GETTIMEOFDAY
+#include <sys/time.h>
+#endif
+
+#include "atari.h"
+#include "atari_ntsc/atari_ntsc.h"
+#include "colours.h"
+#include "log.h"
+#include "util.h"
+#include "workers.h"
+
+/* Input rows as drawn for the SDL NTSC filter: 320 visible pixels, or up
+   to 384 with the overscan area. */
+#define MAX_WIDTH 384
+#define HEIGHT 240
+#define MAX_OUT_WIDTH ATARI_NTSC_OUT_WIDTH(MAX_WIDTH)
+
+/* Rows of a band when the frame is split over threads, as in video_sw.c. */
+#define MIN_BAND_ROWS 16
+
+typedef void (*blit_func_t)(atari_ntsc_t const *ntsc, ATARI_NTSC_IN_T const *atari_in,
+                            long in_row_width, int in_width, int in_height,
+                            void *rgb_out, long out_pitch);
+
+static struct {
+	char const *name;
+	blit_func_t func;
+	int bpp;
+} const formats[] = {
+	{ "rgb16", atari_ntsc_blit_rgb16, 2 },
+	{ "bgr16", atari_ntsc_blit_bgr16, 2 },
+	{ "argb32", atari_ntsc_blit_argb32, 4 },
+	{ "bgra32", atari_ntsc_blit_bgra32, 4 }
+};
+#define NUM_FORMATS (int) (sizeof(formats) / sizeof(formats[0]))
+
+static int const widths[] = { 320, 336, 384 };
+#define NUM_WIDTHS (int) (sizeof(widths) / sizeof(widths[0]))
+
+/* The few emulator functions that atari_ntsc.c and workers.c call. */
+void Log_print(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+void *Util_malloc(size_t size)
+{
+	void *ptr = malloc(size);
+	if (ptr == NULL) {
+		fprintf(stderr, "Fatal error: out of memory\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+int Util_sscansdec(char const *s, int *dest)
+{
+	return sscanf(s, "%d", dest) == 1;
+}
+
+double Colours_Gamma2Linear(double c, double gamma_adj)
+{
+	return c >= 0.0 ? pow(c, gamma_adj) : c / 12.92;
+}
+
+double Colours_Linear2sRGB(double c)
+{
+	return c <= 0.0031308 ? c * 12.92 : 1.055 * pow(c, 1.0/2.4) - 0.055;
+}
+
+static double Time(void)
+{
+#ifdef HAVE_GETTIMEOFDAY
+	struct timeval tp;
+	gettimeofday(&tp, NULL);
+	return tp.tv_sec + 1e-6 * tp.tv_usec;
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* A palette in the layout of colours_ntsc.c: 16 hues of 16 luminances,
+   hue 0 being grey. Only needs to exercise the filter, not to look right. */
+static void MakeYIQPalette(double *yiq)
+{
+	int hue, lum;
+	for (hue = 0; hue < 16; hue++) {
+		for (lum = 0; lum < 16; lum++) {
+			double angle = hue * (2.0 * 3.14159265358979 / 15.0);
+			double sat = hue == 0 ? 0.0 : 0.2;
+			*yiq++ = lum / 15.0;
+			*yiq++ = sat * cos(angle);
+			*yiq++ = sat * sin(angle);
+		}
+	}
+}
+
+/* Something like a busy Atari screen: runs of colour of varying length,
+   with single-pixel detail that produces artifacts. */
+static void MakeScreen(UBYTE *screen)
+{
+	ULONG seed = 12345;
+	int i = 0;
+	while (i < MAX_WIDTH * HEIGHT) {
+		int run, colour;
+		seed = seed * 1103515245 + 12345;
+		run = 1 + (seed >> 16) % 12;
+		colour = (seed >> 8) & 0xff;
+		while (run-- > 0 && i < MAX_WIDTH * HEIGHT)
+			screen[i++] = (UBYTE) colour;
+	}
+}
+
+typedef struct {
+	atari_ntsc_t const *ntsc;
+	blit_func_t func;
+	UBYTE const *screen;
+	int width;
+	UBYTE *out;
+	int bpp;
+	int band_rows;
+} band_t;
+
+static void BlitBand(void *arg, int job)
+{
+	band_t const *b = (band_t const *) arg;
+	int first = job * b->band_rows;
+	int rows = HEIGHT - first < b->band_rows ? HEIGHT - first : b->band_rows;
+	long pitch = MAX_OUT_WIDTH * b->bpp;
+	b->func(b->ntsc, b->screen + first * MAX_WIDTH, MAX_WIDTH, b->width, rows,
+	        b->out + first * pitch, pitch);
+}
+
+static void Blit(Workers_pool_t *pool, int jobs, band_t *b)
+{
+	if (jobs <= 1) {
+		b->band_rows = HEIGHT;
+		BlitBand(b, 0);
+		return;
+	}
+	b->band_rows = (HEIGHT + jobs - 1) / jobs;
+	if (b->band_rows < MIN_BAND_ROWS)
+		b->band_rows = MIN_BAND_ROWS;
+	Workers_Run(pool, BlitBand, b, (HEIGHT + b->band_rows - 1) / b->band_rows);
+}
+
+/* Returns milliseconds per frame. */
+static double TimeBlit(Workers_pool_t *pool, int jobs, band_t *b, int frames)
+{
+	double start;
+	int i;
+	Blit(pool, jobs, b); /* warm up the caches and the threads */
+	start = Time();
+	for (i = 0; i < frames; i++)
+		Blit(pool, jobs, b);
+	return (Time() - start) * 1000.0 / frames;
+}
+
+static void Usage(void)
+{
+	printf("Usage: ntscbench [options]\n"
+	       "Checks and times the NTSC filter blitters.\n"
+	       "\t-frames <n>        Frames blitted per measurement (default: 200)\n"
+	       "\t-threads <n>       Highest number of threads to time (default: one per CPU)\n"
+	       );
+}
+
+int main(int argc, char **argv)
+{
+	static double yiq[256 * 3];
+	static UBYTE screen[MAX_WIDTH * HEIGHT];
+	atari_ntsc_setup_t setup = atari_ntsc_composite;
+	atari_ntsc_t *ntsc;
+	UBYTE *out_scalar;
+	UBYTE *out_vector;
+	/* with room after the last row of the widest frame */
+	size_t out_size = (size_t) MAX_OUT_WIDTH * HEIGHT * 4 + 64;
+	int frames = 200;
+	int max_threads = Workers_NumCPUs();
+	int failed = FALSE;
+	int f, w, i;
+
+	for (i = 1; i < argc; i++) {
+		int i_a = (i + 1 < argc);
+		if (strcmp(argv[i], "-frames") == 0 && i_a)
+			frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-threads") == 0 && i_a)
+			max_threads = atoi(argv[++i]);
+		else {
+			Usage();
+			return strcmp(argv[i], "-help") == 0 ? 0 : 1;
+		}
+	}
+	if (frames < 1)
+		frames = 1;
+	if (max_threads < 1)
+		max_threads = 1;
+
+	MakeYIQPalette(yiq);
+	MakeScreen(screen);
+	setup.yiq_palette = yiq;
+	ntsc = (atari_ntsc_t *) Util_malloc(sizeof(atari_ntsc_t));
+	atari_ntsc_init(ntsc, &setup);
+	out_scalar = (UBYTE *) Util_malloc(out_size);
+	out_vector = (UBYTE *) Util_malloc(out_size);
+
+	for (f = 0; f < NUM_FORMATS; f++) {
+		for (w = 0; w < NUM_WIDTHS; w++) {
+			band_t b;
+			size_t row_size = (size_t) ATARI_NTSC_OUT_WIDTH(widths[w]) * formats[f].bpp;
+			int y;
+			b.ntsc = ntsc;
+			b.func = formats[f].func;
+			b.screen = screen;
+			b.width = widths[w];
+			b.bpp = formats[f].bpp;
+			memset(out_scalar, 0x55, out_size);
+			memset(out_vector, 0xaa, out_size);
+			atari_ntsc_vectorize = FALSE;
+			b.out = out_scalar;
+			Blit(NULL, 1, &b);
+			atari_ntsc_vectorize = TRUE;
+			b.out = out_vector;
+			Blit(NULL, 1, &b);
+			for (y = 0; y < HEIGHT; y++) {
+				size_t offset = (size_t) y * MAX_OUT_WIDTH * b.bpp;
+				/* also catches writes past the end of the last row */
+				if (memcmp(out_scalar + offset, out_vector + offset, row_size) != 0
+				    || (y == HEIGHT - 1 && out_vector[offset + row_size] != 0xaa)) {
+					printf("%s, width %d: row %d differs\n", formats[f].name, b.width, y);
+					failed = TRUE;
+					break;
+				}
+			}
+		}
+	}
+	if (failed)
+		return 1;
+	printf("Vectorised output matches the scalar blitters\n\n");
+
+	printf("ms per %dx%d frame:\n", ATARI_NTSC_OUT_WIDTH(320), HEIGHT);
+	printf("%-8s %8s %8s", "format", "scalar", "vector");
+	for (i = 2; i <= max_threads; i++)
+		printf("  %2d thr", i);
+	printf("\n");
+	for (f = 0; f < NUM_FORMATS; f++) {
+		band_t b;
+		b.ntsc = ntsc;
+		b.func = formats[f].func;
+		b.screen = screen;
+		b.width = 320;
+		b.bpp = formats[f].bpp;
+		b.out = out_vector;
+		atari_ntsc_vectorize = FALSE;
+		printf("%-8s %8.3f", formats[f].name, TimeBlit(NULL, 1, &b, frames));
+		atari_ntsc_vectorize = TRUE;
+		printf(" %8.3f", TimeBlit(NULL, 1, &b, frames));
+		for (i = 2; i <= max_threads; i++) {
+			Workers_pool_t *pool = Workers_CreatePool(i - 1);
+			if (pool == NULL)
+				break;
+			printf(" %7.3f", TimeBlit(pool, i, &b, frames));
+			Workers_DestroyPool(pool);
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	free(out_vector);
+	free(out_scalar);
+	free(ntsc);
+	return 0;
+}
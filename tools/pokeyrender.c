@@ -0,0 +1,500 @@
+/*
+ * Render a timestamped POKEY register log (atari800 -pokeylog) to a WAV
+ * file, offline and faster than real time
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if defined(HAVE_FORK) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_WAIT_H)
+#include <sys/mman.h>
+#include <sys/wait.h>
+#define RENDER_JOBS
+#endif
+
+#include "atari.h"
+#include "antic.h"
+#include "gtia.h"
+#include "log.h"
+#include "pokey.h"
+#include "pokeysnd.h"
+#include "pokeyrec.h"
+#include "util.h"
+#include "workers.h"
+#ifdef AUDIO_RECORDING
+#include "file_export.h"
+#endif
+#if defined(PBI_XLD) || defined(VOICEBOX)
+#include "votraxsnd.h"
+#endif
+
+#ifndef SOUND_GAIN /* must match pokey.c */
+#define SOUND_GAIN 4
+#endif
+
+/* Audio rendered before the start of a job's range and then thrown away,
+   so that the filters of the sound engine have settled when the part that
+   is kept begins. In CPU cycles, about 50 ms. */
+#define PREROLL_CYCLES 90000
+
+/* The emulator globals that the sound engines read. The engines are
+   linked unmodified and keep their state in file-scope variables, which is
+   why parallel rendering uses processes rather than threads. */
+int Atari800_tv_mode = Atari800_TV_PAL;
+int Atari800_turbo = FALSE;
+unsigned int ANTIC_screenline_cpu_clock = 0;
+int ANTIC_xpos = 0;
+#ifdef NEW_CYCLE_EXACT
+int ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
+const int *ANTIC_cpu2antic_ptr = NULL;
+#endif
+int GTIA_speaker = 0;
+UBYTE POKEY_AUDF[4 * POKEY_MAXPOKEYS];
+UBYTE POKEY_AUDC[4 * POKEY_MAXPOKEYS];
+UBYTE POKEY_AUDCTL[POKEY_MAXPOKEYS];
+int POKEY_Base_mult[POKEY_MAXPOKEYS];
+UBYTE POKEY_poly9_lookup[POKEY_POLY9_SIZE];
+UBYTE POKEY_poly17_lookup[16385];
+
+void Log_print(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+void *Util_malloc(size_t size)
+{
+	void *ptr = malloc(size);
+	if (ptr == NULL) {
+		fprintf(stderr, "Fatal error: out of memory\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+#ifdef AUDIO_RECORDING
+int File_Export_StopRecording(void) { return TRUE; }
+int File_Export_WriteAudio(const UBYTE *samples, int num_samples) { return TRUE; }
+#endif
+/* Parallelism comes from RENDER_JOBS here, so the chips run in turn. */
+void Workers_Run(Workers_pool_t *pool, Workers_func_t func, void *arg, int num_jobs)
+{
+	int job;
+	for (job = 0; job < num_jobs; job++)
+		func(arg, job);
+}
+#if defined(PBI_XLD) || defined(VOICEBOX)
+void VOTRAXSND_Init(int playback_freq, int n_pokeys, int b16) {}
+void VOTRAXSND_Process(void *sndbuffer, int sndn) {}
+#endif
+
+typedef struct {
+	uint64_t cycle;
+	UBYTE event;
+	UBYTE val;
+} log_event_t;
+
+static log_event_t *events;
+static int num_events;
+static int num_chips;
+static int scanlines;
+static uint64_t total_cycles;
+
+static int rate = 44100;
+static int bits = 16;
+static int engine_mz = TRUE;
+static int quality = 0;
+static int volume = 100;
+static int jobs = 0;
+
+static int ReadLog(const char *filename)
+{
+	FILE *fp;
+	UBYTE header[POKEYREC_LOG_HEADER_SIZE];
+	int capacity = 0;
+	uint64_t cycle = 0;
+
+	fp = fopen(filename, "rb");
+	if (fp == NULL) {
+		perror(filename);
+		return FALSE;
+	}
+	if (fread(header, 1, sizeof(header), fp) != sizeof(header)
+		|| memcmp(header, POKEYREC_LOG_MAGIC, 8) != 0) {
+		fprintf(stderr, "%s: not a POKEY register log\n", filename);
+		fclose(fp);
+		return FALSE;
+	}
+	if (header[8] != POKEYREC_LOG_VERSION) {
+		fprintf(stderr, "%s: unsupported log version %d\n", filename, header[8]);
+		fclose(fp);
+		return FALSE;
+	}
+	num_chips = header[9];
+	if (num_chips < 1 || num_chips > POKEY_MAXPOKEYS)
+		num_chips = 1;
+	scanlines = header[10] | (header[11] << 8);
+	if (scanlines != Atari800_TV_NTSC)
+		scanlines = Atari800_TV_PAL;
+
+	for (;;) {
+		uint64_t delta = 0;
+		int shift = 0;
+		int c;
+		int event;
+		int val;
+		do {
+			c = getc(fp);
+			if (c == EOF)
+				break;
+			delta |= (uint64_t) (c & 0x7f) << shift;
+			shift += 7;
+		} while (c & 0x80);
+		event = getc(fp);
+		val = getc(fp);
+		if (c == EOF || val == EOF)
+			/* a log that was not closed properly just ends */
+			break;
+		cycle += delta;
+		if (event == POKEYREC_LOG_END)
+			break;
+		if (num_events == capacity) {
+			capacity = capacity ? capacity * 2 : 4096;
+			events = (log_event_t *) realloc(events, capacity * sizeof(log_event_t));
+			if (events == NULL) {
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
+			}
+		}
+		events[num_events].cycle = cycle;
+		events[num_events].event = (UBYTE) event;
+		events[num_events].val = (UBYTE) val;
+		num_events++;
+	}
+	total_cycles = cycle;
+	fclose(fp);
+	return TRUE;
+}
+
+/* Replay one logged write the way POKEY_PutByte and GTIA_PutByte do. */
+static void ApplyEvent(const log_event_t *ev)
+{
+	int chip = ev->event >> 4;
+	int addr = ev->event & 0x0f;
+
+	if (ev->event == POKEYREC_LOG_CONSOL) {
+		GTIA_speaker = ev->val;
+#ifdef CONSOLE_SOUND
+		POKEYSND_UpdateConsol(1);
+#endif
+		return;
+	}
+	if (chip >= num_chips)
+		return;
+	switch (addr) {
+	case POKEY_OFFSET_AUDF1:
+	case POKEY_OFFSET_AUDF2:
+	case POKEY_OFFSET_AUDF3:
+	case POKEY_OFFSET_AUDF4:
+		POKEY_AUDF[chip * 4 + addr / 2] = ev->val;
+		break;
+	case POKEY_OFFSET_AUDC1:
+	case POKEY_OFFSET_AUDC2:
+	case POKEY_OFFSET_AUDC3:
+	case POKEY_OFFSET_AUDC4:
+		POKEY_AUDC[chip * 4 + addr / 2] = ev->val;
+		break;
+	case POKEY_OFFSET_AUDCTL:
+		POKEY_AUDCTL[chip] = ev->val;
+		POKEY_Base_mult[chip] = (ev->val & POKEY_CLOCK_15) ? POKEY_DIV_15 : POKEY_DIV_64;
+		break;
+	default:
+		break;
+	}
+	POKEYSND_Update(addr, ev->val, chip, SOUND_GAIN);
+}
+
+/* Same tables as built by POKEY_Initialise. */
+static void InitPolyTables(void)
+{
+	ULONG reg;
+	int i;
+
+	reg = 0x1ff;
+	for (i = 0; i < POKEY_POLY9_SIZE; i++) {
+		reg = ((((reg >> 5) ^ reg) & 1) << 8) + (reg >> 1);
+		POKEY_poly9_lookup[i] = (UBYTE) reg;
+	}
+	reg = 0x1ffff;
+	for (i = 0; i < 16385; i++) {
+		reg = ((((reg >> 5) ^ reg) & 0xff) << 9) + (reg >> 8);
+		POKEY_poly17_lookup[i] = (UBYTE) (reg >> 1);
+	}
+}
+
+static double TicksPerSample(void)
+{
+	return (double) scanlines * 114
+		* (scanlines == Atari800_TV_PAL ? Atari800_FPS_PAL : Atari800_FPS_NTSC) / rate;
+}
+
+/* Renders output frames [first, first + count) into OUT. */
+static void RenderRange(UBYTE *out, uint64_t first, uint64_t count)
+{
+	int const frame_size = num_chips * (bits / 8);
+	double const ticks_per_sample = TicksPerSample();
+	uint64_t const step = scanlines * 114;
+	uint64_t start = (uint64_t) (first * ticks_per_sample);
+	uint64_t end = (uint64_t) ((first + count) * ticks_per_sample);
+	uint64_t now;
+	uint64_t produced = 0;
+	uint64_t buffer_frames = count + (PREROLL_CYCLES + 2 * step) / ticks_per_sample + 16;
+	UBYTE *buffer = (UBYTE *) Util_malloc(buffer_frames * frame_size);
+	int i;
+
+	memset(POKEY_AUDF, 0, sizeof(POKEY_AUDF));
+	memset(POKEY_AUDC, 0, sizeof(POKEY_AUDC));
+	memset(POKEY_AUDCTL, 0, sizeof(POKEY_AUDCTL));
+	for (i = 0; i < POKEY_MAXPOKEYS; i++)
+		POKEY_Base_mult[i] = POKEY_DIV_64;
+	GTIA_speaker = 0;
+
+	now = start > PREROLL_CYCLES ? start - PREROLL_CYCLES : 0;
+	ANTIC_screenline_cpu_clock = (unsigned int) now;
+	POKEYSND_SetVolume(volume);
+	POKEYSND_enable_new_pokey = engine_mz;
+	POKEYSND_SetMzQuality(quality);
+	POKEYSND_Init(POKEYSND_FREQ_17_EXACT, rate, num_chips, bits == 16 ? POKEYSND_BIT16 : 0);
+
+	/* bring the registers up to date without producing any audio */
+	for (i = 0; i < num_events && events[i].cycle <= now; i++)
+		ApplyEvent(&events[i]);
+
+	while (now < end) {
+		uint64_t target = now + step;
+		int sndn;
+		if (target > end)
+			target = end;
+		if (i < num_events && events[i].cycle < target)
+			target = events[i].cycle;
+		/* the engines work on the low 32 bits, like ANTIC_CPU_CLOCK */
+		ANTIC_screenline_cpu_clock = (unsigned int) target;
+		sndn = POKEYSND_UpdateProcessBuffer();
+		if (produced + sndn / num_chips > buffer_frames)
+			sndn = (int) (buffer_frames - produced) * num_chips;
+		memcpy(buffer + produced * frame_size, POKEYSND_process_buffer, sndn * (bits / 8));
+		produced += sndn / num_chips;
+		now = target;
+		while (i < num_events && events[i].cycle <= now)
+			ApplyEvent(&events[i++]);
+	}
+
+	/* keep the tail, so that consecutive ranges line up */
+	if (produced >= count)
+		memcpy(out, buffer + (produced - count) * frame_size, count * frame_size);
+	else {
+		uint64_t missing = count - produced;
+		memset(out, bits == 16 ? 0 : 0x80, missing * frame_size);
+		memcpy(out + missing * frame_size, buffer, produced * frame_size);
+	}
+	free(buffer);
+}
+
+static void PutLE(UBYTE *p, ULONG value, int size)
+{
+	while (size-- > 0) {
+		*p++ = (UBYTE) value;
+		value >>= 8;
+	}
+}
+
+static int WriteWav(const char *filename, UBYTE *samples, uint64_t frames)
+{
+	FILE *fp;
+	UBYTE header[44];
+	ULONG data_size = (ULONG) (frames * num_chips * (bits / 8));
+
+	fp = fopen(filename, "wb");
+	if (fp == NULL) {
+		perror(filename);
+		return FALSE;
+	}
+	memcpy(header, "RIFF", 4);
+	PutLE(header + 4, data_size + 36, 4);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	PutLE(header + 16, 16, 4);
+	PutLE(header + 20, 1, 2); /* PCM */
+	PutLE(header + 22, num_chips, 2);
+	PutLE(header + 24, rate, 4);
+	PutLE(header + 28, rate * num_chips * (bits / 8), 4);
+	PutLE(header + 32, num_chips * (bits / 8), 2);
+	PutLE(header + 34, bits, 2);
+	memcpy(header + 36, "data", 4);
+	PutLE(header + 40, data_size, 4);
+#ifdef WORDS_BIGENDIAN
+	if (bits == 16) {
+		ULONG i;
+		for (i = 0; i < data_size; i += 2) {
+			UBYTE t = samples[i];
+			samples[i] = samples[i + 1];
+			samples[i + 1] = t;
+		}
+	}
+#endif
+	if (fwrite(header, 1, sizeof(header), fp) != sizeof(header)
+		|| fwrite(samples, 1, data_size, fp) != data_size) {
+		perror(filename);
+		fclose(fp);
+		return FALSE;
+	}
+	return fclose(fp) == 0;
+}
+
+static void Usage(void)
+{
+	printf("Usage: pokeyrender [options] <logfile> <wavfile>\n"
+	       "Renders a POKEY register log written by atari800 -pokeylog.\n"
+	       "\t-rate <hz>         Output sample rate (default: 44100)\n"
+	       "\t-audio8            8-bit output (default: 16-bit)\n"
+	       "\t-engine <mz|rf>    Sound engine: MZ (default) or Ron Fries\n"
+	       "\t-quality <0..2>    MZ filter quality (default: 0)\n"
+	       "\t-volume <0..100>   Output volume (default: 100)\n"
+#ifdef RENDER_JOBS
+	       "\t-jobs <n>          Render in n parallel processes (default: one per CPU)\n"
+#endif
+	       );
+}
+
+int main(int argc, char **argv)
+{
+	const char *logfile = NULL;
+	const char *wavfile = NULL;
+	double ticks_per_sample;
+	uint64_t frames;
+	size_t out_size;
+	UBYTE *out;
+	int i;
+	int result;
+
+	for (i = 1; i < argc; i++) {
+		int i_a = (i + 1 < argc);
+		if (strcmp(argv[i], "-rate") == 0 && i_a)
+			rate = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-audio8") == 0)
+			bits = 8;
+		else if (strcmp(argv[i], "-engine") == 0 && i_a)
+			engine_mz = strcmp(argv[++i], "rf") != 0;
+		else if (strcmp(argv[i], "-quality") == 0 && i_a)
+			quality = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-volume") == 0 && i_a)
+			volume = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-jobs") == 0 && i_a)
+			jobs = atoi(argv[++i]);
+		else if (argv[i][0] == '-') {
+			Usage();
+			return strcmp(argv[i], "-help") == 0 ? 0 : 1;
+		}
+		else if (logfile == NULL)
+			logfile = argv[i];
+		else
+			wavfile = argv[i];
+	}
+	if (wavfile == NULL) {
+		Usage();
+		return 1;
+	}
+	if (rate < (engine_mz ? 8192 : 1000) || rate > 65535) {
+		fprintf(stderr, "Sample rate %d not supported\n", rate);
+		return 1;
+	}
+	if (!ReadLog(logfile))
+		return 1;
+
+	Atari800_tv_mode = scanlines;
+	InitPolyTables();
+	ticks_per_sample = TicksPerSample();
+	frames = (uint64_t) (total_cycles / ticks_per_sample);
+	out_size = frames * num_chips * (bits / 8);
+	if (out_size == 0)
+		out_size = 1;
+
+#ifdef RENDER_JOBS
+	if (jobs <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+		jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		if (jobs <= 0)
+			jobs = 1;
+	}
+	/* do not bother splitting below a second of audio per job */
+	if ((uint64_t) jobs > frames / rate)
+		jobs = (int) (frames / rate) + 1;
+	if (jobs > 1) {
+		int failed = FALSE;
+		out = (UBYTE *) mmap(NULL, out_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (out == MAP_FAILED) {
+			perror("mmap");
+			return 1;
+		}
+		for (i = 0; i < jobs; i++) {
+			uint64_t first = frames * i / jobs;
+			uint64_t last = frames * (i + 1) / jobs;
+			pid_t pid = fork();
+			if (pid == 0) {
+				RenderRange(out + first * num_chips * (bits / 8), first, last - first);
+				_exit(0);
+			}
+			if (pid < 0) {
+				perror("fork");
+				failed = TRUE;
+				break;
+			}
+		}
+		for (;;) {
+			int status;
+			pid_t pid = wait(&status);
+			if (pid < 0)
+				break;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				failed = TRUE;
+		}
+		result = !failed && WriteWav(wavfile, out, frames);
+		munmap(out, out_size);
+		return result ? 0 : 1;
+	}
+#endif /* RENDER_JOBS */
+
+	out = (UBYTE *) Util_malloc(out_size);
+	RenderRange(out, 0, frames);
+	result = WriteWav(wavfile, out, frames);
+	free(out);
+	return result ? 0 : 1;
+}
@@ -0,0 +1,429 @@
+/*
+ * Check of the sectioned state files of statesav.c: saves a state made up
+ * by stand-ins for the emulator modules, reads it back whole and a section
+ * at a time, and makes sure that damaged directories are refused before
+ * anything is allocated for them
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "antic.h"
+#include "cartridge.h"
+#include "cpu.h"
+#include "gtia.h"
+#include "input.h"
+#include "log.h"
+#include "memory.h"
+#include "pbi.h"
+#include "pia.h"
+#include "pokey.h"
+#include "sio.h"
+#include "statesav.h"
+#include "util.h"
+#ifdef PBI_MIO
+#include "pbi_mio.h"
+#endif
+#ifdef PBI_BB
+#include "pbi_bb.h"
+#endif
+#ifdef PBI_XLD
+#include "pbi_xld.h"
+#endif
+#ifdef XEP80_EMULATION
+#include "xep80.h"
+#endif
+
+#define STATE_FILE "statesavcheck.a8s"
+/* Directory layout, as described in statesav.c. */
+#define HEADER_LEN 14
+#define DIRECTORY_ENTRY_LEN 24
+#define SECTION_NAME_LEN 8
+
+/* Allocations bigger than this mean a damaged directory was believed. */
+#define MAX_ALLOC 0x200000
+
+static size_t largest_alloc = 0;
+
+/* The emulator functions that statesav.c calls. */
+void Log_print(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+void *Util_malloc(size_t size)
+{
+	void *ptr;
+	if (size > largest_alloc)
+		largest_alloc = size;
+	ptr = malloc(size);
+	if (ptr == NULL) {
+		fprintf(stderr, "Fatal error: out of memory\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+void *Util_realloc(void *ptr, size_t size)
+{
+	if (size > largest_alloc)
+		largest_alloc = size;
+	ptr = realloc(ptr, size);
+	if (ptr == NULL) {
+		fprintf(stderr, "Fatal error: out of memory\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+char *Util_strlcpy(char *dest, const char *src, size_t size)
+{
+	strncpy(dest, src, size);
+	dest[size - 1] = '\0';
+	return dest;
+}
+
+char *Util_getcwd(char *buf, size_t size)
+{
+	buf[0] = '\0';
+	return buf;
+}
+
+unsigned int ANTIC_screenline_cpu_clock = 0;
+int GTIA_consol_override = 0;
+
+ULONG POKEY_GetRandomCounter(void)
+{
+	return 0;
+}
+
+void POKEY_SetRandomCounter(ULONG value)
+{
+}
+
+void MEMORY_SharePages(MEMORY_pages_t *dest, MEMORY_pages_t const *src)
+{
+}
+
+void MEMORY_FreePages(MEMORY_pages_t *pages)
+{
+}
+
+/* The modules save a few bytes of their own each, except CPU_StateSave,
+   which saves the registers around the 64 KB of MEMORY_mem, as cpu.c does. */
+enum {
+	M_ATARI, M_CART, M_SIO, M_ANTIC, M_GTIA, M_PIA, M_POKEY, M_PBI,
+	M_PBI_MIO, M_PBI_BB, M_PBI_XLD, M_XEP80, M_CART_BANKS, M_SIO_TRANSFER,
+	M_INPUT_HISTORY,
+	NUM_MODULES
+};
+
+static int modules_ok;
+static UBYTE regs[6] = { 0x12, 0x34, 0xf6, 0x56, 0x78, 0x00 };
+static UWORD pc = 0xe477;
+static UBYTE mem[65536];
+
+static int ModuleLen(int module)
+{
+	return 5 + module * 3;
+}
+
+static void SaveModule(int module)
+{
+	int i;
+	for (i = 0; i < ModuleLen(module); i++) {
+		UBYTE b = (UBYTE) (module * 37 + i);
+		StateSav_SaveUBYTE(&b, 1);
+	}
+}
+
+static void ReadModule(int module)
+{
+	int i;
+	for (i = 0; i < ModuleLen(module); i++) {
+		UBYTE b = 0;
+		StateSav_ReadUBYTE(&b, 1);
+		if (b != (UBYTE) (module * 37 + i))
+			modules_ok = FALSE;
+	}
+}
+
+void Atari800_StateSave(void) { SaveModule(M_ATARI); }
+void Atari800_StateRead(UBYTE version) { ReadModule(M_ATARI); }
+void CARTRIDGE_StateSave(void) { SaveModule(M_CART); }
+void CARTRIDGE_StateRead(UBYTE version) { ReadModule(M_CART); }
+void CARTRIDGE_StateSaveBanks(void) { SaveModule(M_CART_BANKS); }
+void CARTRIDGE_StateReadBanks(void) { ReadModule(M_CART_BANKS); }
+void SIO_StateSave(void) { SaveModule(M_SIO); }
+void SIO_StateRead(void) { ReadModule(M_SIO); }
+void SIO_StateSaveTransfer(void) { SaveModule(M_SIO_TRANSFER); }
+void SIO_StateReadTransfer(void) { ReadModule(M_SIO_TRANSFER); }
+void INPUT_StateSaveHistory(void) { SaveModule(M_INPUT_HISTORY); }
+void INPUT_StateReadHistory(void) { ReadModule(M_INPUT_HISTORY); }
+void ANTIC_StateSave(void) { SaveModule(M_ANTIC); }
+void ANTIC_StateRead(void) { ReadModule(M_ANTIC); }
+void GTIA_StateSave(void) { SaveModule(M_GTIA); }
+void GTIA_StateRead(UBYTE version) { ReadModule(M_GTIA); }
+void PIA_StateSave(void) { SaveModule(M_PIA); }
+void PIA_StateRead(UBYTE version) { ReadModule(M_PIA); }
+void POKEY_StateSave(void) { SaveModule(M_POKEY); }
+void POKEY_StateRead(void) { ReadModule(M_POKEY); }
+void PBI_StateSave(void) { SaveModule(M_PBI); }
+void PBI_StateRead(void) { ReadModule(M_PBI); }
+#ifdef PBI_MIO
+void PBI_MIO_StateSave(void) { SaveModule(M_PBI_MIO); }
+void PBI_MIO_StateRead(void) { ReadModule(M_PBI_MIO); }
+#endif
+#ifdef PBI_BB
+void PBI_BB_StateSave(void) { SaveModule(M_PBI_BB); }
+void PBI_BB_StateRead(void) { ReadModule(M_PBI_BB); }
+#endif
+#ifdef PBI_XLD
+void PBI_XLD_StateSave(void) { SaveModule(M_PBI_XLD); }
+void PBI_XLD_StateRead(void) { ReadModule(M_PBI_XLD); }
+#endif
+#ifdef XEP80_EMULATION
+void XEP80_StateSave(void) { SaveModule(M_XEP80); }
+void XEP80_StateRead(void) { ReadModule(M_XEP80); }
+#endif
+
+void CPU_StateSave(UBYTE SaveVerbose)
+{
+	StateSav_SaveUBYTE(regs, 6);
+	StateSav_BeginSection("MEMORY");
+	StateSav_SaveUBYTE(mem, 65536);
+	StateSav_BeginSection("CPU");
+	StateSav_SaveUWORD(&pc, 1);
+}
+
+void CPU_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
+{
+	static UBYTE mem_read[65536];
+	UBYTE regs_read[6];
+	UWORD pc_read = 0;
+	StateSav_ReadUBYTE(regs_read, 6);
+	StateSav_BeginSection("MEMORY");
+	StateSav_ReadUBYTE(mem_read, 65536);
+	StateSav_BeginSection("CPU");
+	StateSav_ReadUWORD(&pc_read, 1);
+	if (memcmp(regs_read, regs, 6) != 0 || memcmp(mem_read, mem, 65536) != 0 || pc_read != pc)
+		modules_ok = FALSE;
+}
+
+static long FileSize(const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	long size = -1;
+	if (fp != NULL) {
+		if (fseek(fp, 0, SEEK_END) == 0)
+			size = ftell(fp);
+		fclose(fp);
+	}
+	return size;
+}
+
+static ULONG GetULONG(const UBYTE *p)
+{
+	return p[0] | (p[1] << 8) | ((ULONG) p[2] << 16) | ((ULONG) p[3] << 24);
+}
+
+static void PutULONG(UBYTE *p, ULONG value)
+{
+	p[0] = (UBYTE) value;
+	p[1] = (UBYTE) (value >> 8);
+	p[2] = (UBYTE) (value >> 16);
+	p[3] = (UBYTE) (value >> 24);
+}
+
+/* Returns whether the MEMORY and CPU sections of STATE_FILE read alone are
+   what was saved, and that a section that isn't there can't be read. */
+static int CheckSections(void)
+{
+	UBYTE *data;
+	size_t size;
+	int ok;
+
+	if (!StateSav_ReadFileSection(STATE_FILE, "MEMORY", &data, &size)) {
+		printf("Could not read the MEMORY section\n");
+		return FALSE;
+	}
+	ok = size == 65536 && memcmp(data, mem, 65536) == 0;
+	free(data);
+	if (!ok) {
+		printf("The MEMORY section differs from what was saved\n");
+		return FALSE;
+	}
+
+	if (!StateSav_ReadFileSection(STATE_FILE, "CPU", &data, &size)) {
+		printf("Could not read the CPU section\n");
+		return FALSE;
+	}
+	ok = size == 8 && memcmp(data, regs, 6) == 0
+	     && data[6] == (pc & 0xff) && data[7] == (pc >> 8);
+	free(data);
+	if (!ok) {
+		printf("The CPU section differs from what was saved\n");
+		return FALSE;
+	}
+
+	if (StateSav_ReadFileSection(STATE_FILE, "EXTMEM", &data, &size)) {
+		free(data);
+		printf("Read an EXTMEM section that was never saved\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Sets the uncompressed length of section NAME in the directory of
+   STATE_FILE to what FUNC makes of its length in the file. Returns FALSE if
+   there is no such section. */
+static int DamageDirectory(const char *name, ULONG (*func)(ULONG length))
+{
+	UBYTE header[HEADER_LEN];
+	UBYTE entry[DIRECTORY_ENTRY_LEN];
+	FILE *fp = fopen(STATE_FILE, "r+b");
+	ULONG count;
+	ULONG i;
+	int found = FALSE;
+
+	if (fp == NULL)
+		return FALSE;
+	if (fread(header, HEADER_LEN, 1, fp) == 1) {
+		count = GetULONG(header + 10);
+		for (i = 0; i < count && !found; i++) {
+			long pos = ftell(fp);
+			if (fread(entry, DIRECTORY_ENTRY_LEN, 1, fp) != 1)
+				break;
+			if (strncmp((char *) entry, name, SECTION_NAME_LEN) == 0) {
+				PutULONG(entry + SECTION_NAME_LEN + 8, func(GetULONG(entry + SECTION_NAME_LEN + 4)));
+				found = fseek(fp, pos, SEEK_SET) == 0
+				        && fwrite(entry, DIRECTORY_ENTRY_LEN, 1, fp) == 1;
+			}
+		}
+	}
+	fclose(fp);
+	return found;
+}
+
+/* As much as deflate could expand LENGTH bytes to. */
+static ULONG MaxInflated(ULONG length)
+{
+	return length * 1032;
+}
+
+static ULONG Huge(ULONG length)
+{
+	return 0xfffffff0;
+}
+
+/* Returns whether STATE_FILE, damaged by FUNC, is refused both whole and a
+   section at a time without big allocations. */
+static int CheckDamaged(ULONG (*func)(ULONG length), const char *what)
+{
+	UBYTE *data;
+	size_t size;
+
+	if (!StateSav_SaveAtariState(STATE_FILE, "wb9", TRUE)
+	 || !DamageDirectory("MEMORY", func)) {
+		printf("Could not make a state file with %s\n", what);
+		return FALSE;
+	}
+	largest_alloc = 0;
+	modules_ok = TRUE;
+	if (StateSav_ReadAtariState(STATE_FILE, "rb")) {
+		printf("Read a state file with %s\n", what);
+		return FALSE;
+	}
+	if (StateSav_ReadFileSection(STATE_FILE, "MEMORY", &data, &size)) {
+		free(data);
+		printf("Read the MEMORY section of a state file with %s\n", what);
+		return FALSE;
+	}
+	if (largest_alloc > MAX_ALLOC) {
+		printf("Allocated %lu bytes for a state file with %s\n",
+		       (unsigned long) largest_alloc, what);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+int main(void)
+{
+	int failed = FALSE;
+	int i;
+	ULONG seed = 12345;
+
+	/* Something that compresses, but not to nothing. */
+	for (i = 0; i < 65536; i++) {
+		seed = seed * 1103515245 + 12345;
+		mem[i] = (i & 0x100) ? (UBYTE) (seed >> 16) : (UBYTE) (i >> 4);
+	}
+
+	/* Whole state. */
+	if (!StateSav_SaveAtariState(STATE_FILE, "wb", TRUE)) {
+		printf("Could not save the state\n");
+		return 1;
+	}
+	modules_ok = TRUE;
+	if (!StateSav_ReadAtariState(STATE_FILE, "rb") || !modules_ok) {
+		printf("The state read back differs from what was saved\n");
+		failed = TRUE;
+	}
+	if (!CheckSections())
+		failed = TRUE;
+
+	/* The compression level of the mode. */
+#ifdef HAVE_LIBZ
+	{
+		long stored;
+		if (!StateSav_SaveAtariState(STATE_FILE, "wb0", TRUE) || !CheckSections())
+			failed = TRUE;
+		stored = FileSize(STATE_FILE);
+		if (!StateSav_SaveAtariState(STATE_FILE, "wb9", TRUE) || !CheckSections())
+			failed = TRUE;
+		if (stored <= FileSize(STATE_FILE)) {
+			printf("Saving with \"wb0\" did not store the sections uncompressed\n");
+			failed = TRUE;
+		}
+	}
+
+	/* Directories that claim more than the sections can hold. */
+	if (!CheckDamaged(MaxInflated, "an oversized deflated section"))
+		failed = TRUE;
+#endif /* HAVE_LIBZ */
+	if (!CheckDamaged(Huge, "a huge section"))
+		failed = TRUE;
+
+	remove(STATE_FILE);
+	if (failed)
+		return 1;
+	printf("State files read back as saved, whole and by section\n");
+	return 0;
+}